@@ -0,0 +1,188 @@
+/***********************************************************************
+ *  File Name   : arena.c
+ *  Description : Index-owned arena allocator for the Inverted Search
+ *                System. Main nodes and sub nodes are bump-allocated
+ *                out of large chunks, so building an index costs a few
+ *                hundred mallocs instead of one per word and per
+ *                (word, file) pair. Nothing is returned to malloc
+ *                individually; the whole arena is released in one call.
+ *                Growable sub node arrays recycle their outgrown blocks
+ *                through per-size free lists (slab style), which also
+ *                serve the fixed-size blocks of packed postings.
+ *
+ *                Building with -DARENA_USE_MALLOC switches back to one
+ *                malloc per node (for benchmarking the old behaviour).
+ *
+ *                Functions:
+ *                  - arena_init()
+ *                  - arena_alloc()
+ *                  - arena_grow()
+ *                  - arena_release() / arena_reuse()
+ *                  - arena_adopt()
+ *                  - arena_free()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+
+void arena_init(Arena_t *arena)
+{
+    arena->chunks = NULL; // No chunk until first allocation
+    for (int i = 0; i < ARENA_CLASSES; i++)
+        arena->free_blocks[i] = NULL;
+    arena->bytes_used = 0;
+    arena->bytes_reserved = 0;
+}
+
+#ifndef ARENA_USE_MALLOC
+
+void *arena_alloc(Arena_t *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1); // Keep every node aligned
+    Arena_chunk *chunk = arena->chunks;
+
+    if (chunk == NULL || chunk->used + size > chunk->size) // Current chunk exhausted
+    {
+        size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        chunk = malloc(sizeof(Arena_chunk) + chunk_size);
+        if (chunk == NULL)
+            return NULL;
+
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->next = arena->chunks; // Newest chunk becomes the head
+        arena->chunks = chunk;
+        arena->bytes_reserved += chunk_size;
+    }
+
+    void *ptr = chunk->data + chunk->used; // Bump allocate
+    chunk->used += size;
+    arena->bytes_used += size;
+
+    return ptr;
+}
+
+#else
+
+void *arena_alloc(Arena_t *arena, size_t size)
+{
+    Arena_chunk *chunk = malloc(sizeof(Arena_chunk) + size); // One malloc per node
+    if (chunk == NULL)
+        return NULL;
+
+    chunk->size = size;
+    chunk->used = size;
+    chunk->next = arena->chunks; // Tracked only so arena_free() can release it
+    arena->chunks = chunk;
+    arena->bytes_used += size;
+    arena->bytes_reserved += size;
+
+    return chunk->data;
+}
+
+#endif
+
+static int block_class(size_t size)
+{
+    int size_class = 0;
+    while (((size_t)ARENA_ALIGN << size_class) < size) // Smallest class holding size bytes
+        size_class++;
+    return size_class;
+}
+
+static int recycle_class(size_t size)
+{
+    int size_class = 0;
+    while (((size_t)ARENA_ALIGN << (size_class + 1)) <= size) // Largest class fitting in size bytes
+        size_class++;
+    return size_class;
+}
+
+void *arena_grow(Arena_t *arena, void *block, size_t old_size, size_t new_size)
+{
+    int new_class = block_class(new_size);
+    void *grown = arena->free_blocks[new_class];
+
+    if (grown) // Reuse a block outgrown earlier
+        arena->free_blocks[new_class] = *(void **)grown;
+    else
+        grown = arena_alloc(arena, (size_t)ARENA_ALIGN << new_class);
+
+    if (grown == NULL)
+        return NULL;
+
+    if (block) // Move contents and recycle the old block (which may be any size)
+    {
+        memcpy(grown, block, old_size);
+        arena_release(arena, block, old_size);
+    }
+    return grown;
+}
+
+/* Hands a block of at least size bytes back to the free lists */
+void arena_release(Arena_t *arena, void *block, size_t size)
+{
+    if (size < sizeof(void *)) // Too small to link
+        return;
+
+    int size_class = recycle_class(size);
+    *(void **)block = arena->free_blocks[size_class];
+    arena->free_blocks[size_class] = block;
+}
+
+/* Fixed-size block carved from the smallest recycled block that fits, else exactly size fresh bytes */
+void *arena_reuse(Arena_t *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    for (int size_class = block_class(size); size_class < ARENA_CLASSES; size_class++)
+    {
+        void *block = arena->free_blocks[size_class];
+        if (block == NULL)
+            continue;
+
+        arena->free_blocks[size_class] = *(void **)block;
+        arena_release(arena, (unsigned char *)block + size, ((size_t)ARENA_ALIGN << size_class) - size); // Rest stays reusable
+        return block;
+    }
+    return arena_alloc(arena, size);
+}
+
+void arena_adopt(Arena_t *arena, Arena_t *from)
+{
+    if (from->chunks == NULL)
+        return;
+
+    Arena_chunk *tail = from->chunks;
+    while (tail->next) // Find last chunk of the donor arena
+        tail = tail->next;
+
+    if (arena->chunks) // Splice behind the current chunk so bump allocation continues there
+    {
+        tail->next = arena->chunks->next;
+        arena->chunks->next = from->chunks;
+    }
+    else
+    {
+        arena->chunks = from->chunks;
+    }
+
+    arena->bytes_used += from->bytes_used;
+    arena->bytes_reserved += from->bytes_reserved;
+    arena_init(from); // Donor no longer owns anything
+}
+
+void arena_free(Arena_t *arena)
+{
+    Arena_chunk *chunk = arena->chunks;
+    while (chunk) // Release every chunk
+    {
+        Arena_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena_init(arena); // Arena is reusable afterwards
+}
@@ -0,0 +1,361 @@
+/***********************************************************************
+ *  File Name   : batch.c
+ *  Description : Non-interactive batch search for the Inverted Search
+ *                System:
+ *
+ *                  --index backup.bin --queries queries.txt
+ *                  [--format tsv|json] [--top N] [--threads N]
+ *
+ *                The index (.bin or .txt backup, or a segment directory,
+ *                see segments.c) is loaded once and every line of the query file is run through the query
+ *                engine and ranked, with no menu and no tables. Blank
+ *                lines and lines starting with '#' are skipped; a
+ *                query is identified by its line number.
+ *
+ *                  tsv  : one row per ranked file,
+ *                           line, query, matches, rank, file,
+ *                           word count, score
+ *                         a query without results (or with an error)
+ *                         gets one row with the rank fields empty and
+ *                         matches set to 0 (or "error")
+ *                  json : one object per line (JSON Lines),
+ *                           {"line", "query", "matches",
+ *                            "results": [{"file", "word_count", "score"}]}
+ *                         or {"line", "query", "error"}
+ *
+ *                With --threads N the queries are shared out among N
+ *                workers a round at a time. Every query formats its
+ *                result into its own buffer and a round is written in
+ *                query order once all of it is done, so the output is
+ *                identical for any thread count. Output goes through
+ *                one large stdout buffer; a throughput line is printed
+ *                on stderr at the end.
+ *
+ *                Functions:
+ *                  - text_append()
+ *                  - load_search_index()
+ *                  - format_query()
+ *                  - run_batch()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define BATCH_ROUND 1024          // Queries formatted before a round is written out
+#define BATCH_OUTPUT_SIZE (1 << 20) // stdout buffer
+
+typedef struct batch_query
+{
+    const char *text; // NUL-terminated line of the query file
+    uint32_t line;    // 1-based line number
+} Batch_query;
+
+typedef struct batch_job
+{
+    Hash_t *hash;
+    const Options_t *options;
+    Batch_query *queries; // This round
+    Text_buffer *output;  // One per query of the round
+    uint32_t count;
+    atomic_uint next;     // Next query of the round to take
+} Batch_job;
+
+/* printf-style append, growing the buffer as needed */
+void text_append(Text_buffer *buf, const char *format, ...)
+{
+    while (!buf->failed)
+    {
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buf->data + buf->len, buf->capacity - buf->len, format, args);
+        va_end(args);
+
+        if (n < 0)
+        {
+            buf->failed = true;
+            return;
+        }
+        if ((size_t)n < buf->capacity - buf->len) // Fitted, including the NUL
+        {
+            buf->len += n;
+            return;
+        }
+
+        size_t capacity = buf->capacity ? buf->capacity : 256;
+        while (capacity <= buf->len + (size_t)n)
+            capacity *= 2;
+        char *grown = realloc(buf->data, capacity);
+        if (grown == NULL)
+        {
+            buf->failed = true;
+            return;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+}
+
+/* Query text as a TSV field (tabs would split it) */
+static void append_tsv(Text_buffer *buf, const char *text)
+{
+    for (; *text; text++)
+        text_append(buf, "%c", *text == '\t' ? ' ' : *text);
+}
+
+/* JSON string literal with the mandatory escapes */
+static void append_json(Text_buffer *buf, const char *text)
+{
+    text_append(buf, "\"");
+    for (; *text; text++)
+    {
+        unsigned char ch = *text;
+        if (ch == '"' || ch == '\\')
+            text_append(buf, "\\%c", ch);
+        else if (ch < 0x20)
+            text_append(buf, "\\u%04x", ch);
+        else
+            text_append(buf, "%c", ch);
+    }
+    text_append(buf, "\"");
+}
+
+/* Runs and ranks one query, formatting the outcome into out (also used by server.c) */
+void format_query(Hash_t *hash, const Options_t *options, const char *text, uint32_t line, Ranked_doc *top, Text_buffer *out)
+{
+    Query_t parsed;
+    uint32_t shown = 0, matches = 0;
+    bool json = options->format == FORMAT_JSON;
+    Hash_t *index = segments_acquire(hash); // Current view of a segmented index, names included
+
+    bool ok = query_parse(text, index->normalize, &parsed) == SUCCESS && search_cached(index, &parsed, options->top_k, top, &shown, &matches) == SUCCESS;
+
+    if (json)
+    {
+        text_append(out, "{\"line\":%u,\"query\":", line);
+        append_json(out, text);
+        if (!ok)
+        {
+            text_append(out, ",\"error\":\"invalid query\"}\n");
+        }
+        else
+        {
+            text_append(out, ",\"matches\":%u,\"results\":[", matches);
+            for (uint32_t i = 0; i < shown; i++)
+            {
+                text_append(out, "%s{\"file\":", i ? "," : "");
+                append_json(out, doc_name(&index->docs, top[i].doc_id));
+                text_append(out, ",\"word_count\":%u,\"score\":%.4f}", top[i].word_count, top[i].score);
+            }
+            text_append(out, "]}\n");
+        }
+    }
+    else if (!ok || shown == 0) // One row even without results
+    {
+        text_append(out, "%u\t", line);
+        append_tsv(out, text);
+        if (ok)
+            text_append(out, "\t%u\t\t\t\t\n", matches);
+        else
+            text_append(out, "\terror\t\t\t\t\n");
+    }
+    else
+    {
+        for (uint32_t i = 0; i < shown; i++)
+        {
+            text_append(out, "%u\t", line);
+            append_tsv(out, text);
+            text_append(out, "\t%u\t%u\t%s\t%u\t%.4f\n", matches, i + 1, doc_name(&index->docs, top[i].doc_id),
+                        top[i].word_count, top[i].score);
+        }
+    }
+    segments_release(hash, index);
+}
+
+static void *batch_worker(void *arg)
+{
+    Batch_job *job = arg;
+    Ranked_doc *top = malloc(job->options->top_k * sizeof(Ranked_doc));
+    uint32_t i;
+
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->count) // Take the next query of the round
+    {
+        if (top == NULL)
+            job->output[i].failed = true;
+        else
+            format_query(job->hash, job->options, job->queries[i].text, job->queries[i].line, top, &job->output[i]);
+    }
+    free(top);
+    return NULL;
+}
+
+/* Splits the query file into NUL-terminated lines, skipping blanks and comments */
+static Batch_query *read_queries(char *data, size_t size, uint32_t *count)
+{
+    size_t lines = 1;
+    for (size_t i = 0; i < size; i++)
+        lines += data[i] == '\n';
+
+    Batch_query *queries = malloc(lines * sizeof(Batch_query));
+    if (queries == NULL)
+        return NULL;
+
+    uint32_t n = 0, line = 0;
+    char *pos = data, *end = data + size;
+    while (pos < end)
+    {
+        char *eol = memchr(pos, '\n', end - pos);
+        if (eol == NULL)
+            eol = end;
+        *eol = '\0';
+        line++;
+
+        char *text = pos;
+        size_t len = eol - pos;
+        if (len && text[len - 1] == '\r') // CRLF files
+            text[--len] = '\0';
+        while (*text == ' ' || *text == '\t')
+            text++;
+
+        if (*text && *text != '#')
+        {
+            queries[n].text = text;
+            queries[n++].line = line;
+        }
+        pos = eol + 1;
+    }
+    *count = n;
+    return queries;
+}
+
+static char *read_file(const char *file_name, size_t *size)
+{
+    FILE *fptr = fopen(file_name, "rb");
+    if (fptr == NULL)
+        return NULL;
+
+    long len = validate_file_size(fptr); // Leaves the position at the start
+    char *data = len >= 0 ? malloc(len + 1) : NULL;
+    if (data == NULL || fread(data, 1, len, fptr) != (size_t)len)
+    {
+        free(data);
+        fclose(fptr);
+        return NULL;
+    }
+    fclose(fptr);
+
+    data[len] = '\0';
+    *size = len;
+    return data;
+}
+
+/* Loads a .bin or .txt backup, or opens a segment directory, for read-only searching from several threads */
+Status load_search_index(Hash_t *hash, const Options_t *options)
+{
+    File_list *head = NULL;
+    char *index_name = options->index_name;
+
+    if (initialise_hash(hash) == FAILURE)
+        return FAILURE;
+    hash->normalize = options->normalize; // Text backups record no normalization, .bin indexes override it
+
+    Status loaded = query_cache_create(hash, options->cache_size); // First: the views of a segment set take it over
+    if (loaded == SUCCESS)
+        loaded = is_segment_dir(index_name) ? segments_open(hash, index_name, options)
+                 : is_index_file(index_name) ? load_index(hash, index_name, &head, options->verify_postings)
+                                             : update_database(hash, index_name, &head);
+    if (loaded == FAILURE || term_dict_update(hash) == FAILURE) // Wildcards only read the dictionary from here on
+    {
+        fprintf(stderr, "Error: Unable to load index '%s'\n", index_name);
+        free_hash(hash);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+Status run_batch(const Options_t *options)
+{
+    Hash_t hash;
+    size_t size;
+
+    if (load_search_index(&hash, options) == FAILURE)
+        return FAILURE;
+
+    char *data = read_file(options->query_name, &size);
+    uint32_t count = 0;
+    Batch_query *queries = data ? read_queries(data, size, &count) : NULL;
+    if (queries == NULL)
+    {
+        fprintf(stderr, "Error: Unable to read queries from '%s'\n", options->query_name);
+        free(data);
+        free_hash(&hash);
+        return FAILURE;
+    }
+
+    int threads = options->threads;
+    Text_buffer *output = calloc(BATCH_ROUND, sizeof(Text_buffer));
+    Status status = output ? SUCCESS : FAILURE;
+    setvbuf(stdout, NULL, _IOFBF, BATCH_OUTPUT_SIZE);
+
+    if (status == SUCCESS && options->format == FORMAT_TSV)
+        printf("line\tquery\tmatches\trank\tfile\tword_count\tscore\n");
+
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (uint32_t first = 0; first < count && status == SUCCESS; first += BATCH_ROUND)
+    {
+        Batch_job job = {.hash = &hash, .options = options, .queries = queries + first, .output = output,
+                         .count = count - first < BATCH_ROUND ? count - first : BATCH_ROUND};
+        atomic_init(&job.next, 0);
+
+        pthread_t tids[MAX_THREADS];
+        int started = 0;
+        for (; started < threads - 1; started++) // The main thread is the last worker
+        {
+            if (pthread_create(&tids[started], NULL, batch_worker, &job) != 0)
+                break;
+        }
+        batch_worker(&job);
+        for (int t = 0; t < started; t++)
+            pthread_join(tids[t], NULL);
+
+        for (uint32_t i = 0; i < job.count; i++) // Query order, whoever ran them
+        {
+            if (output[i].failed)
+                status = FAILURE;
+            else if (output[i].len)
+                fwrite(output[i].data, 1, output[i].len, stdout);
+            output[i].len = 0; // Buffers are reused by the next round
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    if (fflush(stdout) != 0)
+        status = FAILURE;
+
+    double seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+    if (status == SUCCESS)
+        fprintf(stderr, "INFO: %u queries in %.3f s (%.0f queries/s, %d thread%s)\n", count, seconds,
+                seconds > 0 ? count / seconds : 0.0, threads, threads == 1 ? "" : "s");
+    if (status == SUCCESS)
+        print_cache_stats(stderr, &hash);
+    if (status == SUCCESS && options->stats)
+        print_stats(stderr, &hash);
+    if (status == FAILURE)
+        fprintf(stderr, "Error: Batch search failed\n");
+
+    for (uint32_t i = 0; output && i < BATCH_ROUND; i++)
+        free(output[i].data);
+    free(output);
+    free(queries);
+    free(data);
+    free_hash(&hash);
+    return status;
+}
@@ -0,0 +1,1160 @@
+/***********************************************************************
+ *  File Name   : benchmark.c
+ *  Description : Stand-alone benchmark for the Inverted Search System.
+ *                Builds the index from the given files several times
+ *                and reports build time, node memory and peak RSS,
+ *                then times the tokenizer alone over the same files.
+ *                With --scaling it repeats the build with 1, 2, 4, 8
+ *                and 16 threads, reports the speed-up and checks that
+ *                every parallel build matches the sequential one.
+ *                With --load-scaling it writes synthetic text backups of
+ *                125k to 1M words and times update_database() on each,
+ *                showing that loading grows linearly with backup size.
+ *                With --query it builds the index once and times a
+ *                boolean query (AND / OR / NOT) over many iterations,
+ *                with and without BM25 top-k ranking (--top N).
+ *                --positions builds positional indexes, so the cost of
+ *                recording positions shows up in the build figures and
+ *                phrase / NEAR queries can be timed. --normalize
+ *                STEPS picks the token normalization of every build
+ *                (default lower,punct, "none" to measure without it).
+ *                With --suite it times build, tokenizing, text and
+ *                binary save, text and binary load, and the single-word
+ *                and multi-term queries of a query log (--queries, e.g. from
+ *                corpus.c; otherwise sampled from the index), and prints
+ *                one JSON object with throughput, latency percentiles
+ *                and peak RSS on stdout. Progress messages of the index
+ *                code go to stderr in that mode.
+ *                With --cursor-check it packs lists of 1 to 1000
+ *                postings and checks that a posting cursor seeking past
+ *                the last one, from inside the last block, stops there.
+ *                With --corrupt-check it saves a small .bin index, loads
+ *                copies with one postings byte changed (no --verify)
+ *                and queries them: each copy must be refused or answer
+ *                with document IDs inside its table.
+ *                With --journal-check a child process logs a mix of
+ *                additions and removals to a journaled database and
+ *                dies without a snapshot; the log is then replayed
+ *                into an empty table and must give the child's index.
+ *                With --build-check a child process runs the external
+ *                build (--build) at the smallest --memory; its peak RSS
+ *                above its size at the start must stay within that
+ *                budget, and the index must hold the words and postings
+ *                of an in-memory build.
+ *
+ *                Input files are checked like the program's own
+ *                (directories and @lists expanded); with no readable
+ *                file or no indexed word it exits with status 1.
+ *
+ *                Compile once normally and once with -DARENA_USE_MALLOC
+ *                to compare the arena against one malloc per node:
+ *
+ *                  gcc -O2 -pthread benchmark.c database.c helper.c validate.c arena.c document.c parallel.c tokenizer.c binary_index.c incremental.c query.c dictionary.c rank.c positions.c postings.c batch.c server.c cache.c stats.c string_pool.c normalize.c spimi.c segments.c journal.c -o bench_arena -lm
+ *                  gcc -O2 -pthread -DARENA_USE_MALLOC benchmark.c database.c helper.c validate.c arena.c document.c parallel.c tokenizer.c binary_index.c incremental.c query.c dictionary.c rank.c positions.c postings.c batch.c server.c cache.c stats.c string_pool.c normalize.c spimi.c segments.c journal.c -o bench_malloc -lm
+ *
+ *                Usage : ./bench_arena [--repeat N] [--positions] [--normalize STEPS] [--threads N | --scaling] <file1.txt> <file2.txt> ...
+ *                        ./bench_arena [--repeat N] --load-scaling
+ *                        ./bench_arena [--repeat N] [--positions] --query "a AND b NOT c" [--top N] <file1.txt> ...
+ *                        ./bench_arena --suite [--repeat N] [--threads N] [--queries FILE] [--top N] <file1.txt> ...
+ *                        ./bench_arena --cursor-check
+ *                        ./bench_arena --corrupt-check
+ *                        ./bench_arena --journal-check [--positions] <file1.txt> ... (at least 6 files)
+ *                        ./bench_arena --build-check [--positions] <file1.txt> ...
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <time.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SUITE_TEXT_BACKUP "bench_suite_backup.txt"
+#define SUITE_BIN_INDEX "bench_suite_index.bin"
+#define SUITE_SAMPLED_QUERIES 500 // Queries of each kind sampled from the index without --queries
+#define CHECK_JOURNAL "bench_journal.bin"
+#define CHECK_BUILD "bench_build_check.bin"
+#define CHECK_BACKUP "bench_check_backup.txt"
+#define CHECK_INDEX "bench_check_index.bin"
+#define CHECK_DAMAGED "bench_check_damaged.bin"
+#define CHECK_DAMAGED_COPIES 300
+
+static bool build_positions = false; // --positions
+static unsigned build_normalize = NORM_DEFAULT; // --normalize
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long peak_rss_kb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // Kilobytes on Linux
+}
+
+/* Order-sensitive digest of words, sub nodes and positions, used to compare builds */
+static uint64_t index_digest(Hash_t *hash)
+{
+    uint64_t digest = hash->count;
+    Sub_node *scratch = NULL;
+    uint32_t scratch_size = 0;
+    for (Main_node *node = hash->head; node; node = node->m_link)
+    {
+        const Sub_node *subs = postings_get(node, &scratch, &scratch_size);
+        digest = digest * 31 + node->hash;
+        for (uint32_t i = 0; subs && i < node->file_count; i++)
+        {
+            digest = digest * 31 + ((uint64_t)subs[i].doc_id << 32 | subs[i].word_count);
+            if (node->positions)
+            {
+                const uint8_t *data = node->positions->data + node->positions->offsets[i];
+                uint32_t len = positions_span(data, subs[i].word_count);
+                for (uint32_t b = 0; b < len; b++)
+                    digest = digest * 31 + data[b];
+            }
+        }
+    }
+    free(scratch);
+    return digest;
+}
+
+typedef struct build_result
+{
+    double best;
+    double total;
+    size_t words;
+    size_t used;
+    size_t reserved;
+    uint64_t digest;
+} Build_result;
+
+static Status run_builds(File_list *head, int threads, int repeat, Build_result *result)
+{
+    result->best = result->total = 0;
+
+    for (int r = 0; r < repeat; r++)
+    {
+        Hash_t hash;
+        if (initialise_hash(&hash) == FAILURE)
+            return FAILURE;
+        hash.positional = build_positions;
+        hash.normalize = build_normalize;
+
+        double start = now_seconds();
+        if (create_database_parallel(&hash, head, threads) == FAILURE)
+        {
+            fprintf(stderr, "Error: create_database failed\n");
+            return FAILURE;
+        }
+        double elapsed = now_seconds() - start;
+
+        result->total += elapsed;
+        if (r == 0 || elapsed < result->best)
+            result->best = elapsed;
+
+        result->words = hash.count;
+        result->used = hash.arena.bytes_used;
+        result->reserved = hash.arena.bytes_reserved;
+        result->digest = index_digest(&hash);
+        free_hash(&hash); // Whole index released in one call
+    }
+    return SUCCESS;
+}
+
+/* Best time of the tokenizer alone over every file, the files already in the page cache */
+static double tokenize_best(File_list *head, int repeat, uint64_t *tokens)
+{
+    double best = 0;
+    for (int r = 0; r < repeat; r++)
+    {
+        uint64_t count = 0;
+        double start = now_seconds();
+        for (File_list *file = head; file; file = file->next)
+        {
+            Tokenizer_t tok;
+            const char *token;
+            size_t len;
+            if (tokenizer_open(&tok, file->file_name) == FAILURE)
+                continue;
+            while (tokenizer_next(&tok, &token, &len))
+                count++;
+            tokenizer_close(&tok);
+        }
+        double elapsed = now_seconds() - start;
+        if (r == 0 || elapsed < best)
+            best = elapsed;
+        *tokens = count;
+    }
+    return best;
+}
+
+/* The files of head at the given positions, in that order */
+static File_list *pick_files(File_list *head, const int *picks, int count)
+{
+    File_list *files = NULL;
+    for (int i = 0; i < count; i++)
+    {
+        File_list *file = head;
+        for (int k = 0; k < picks[i] && file; k++)
+            file = file->next;
+        if (file == NULL || insert_at_last(&files, file->file_name) == FAILURE)
+        {
+            delete_list(&files);
+            return NULL;
+        }
+    }
+    return files;
+}
+
+/* Child of run_journal_check(): logs and applies the changes, reports the index and exits without a snapshot */
+static void journal_child(File_list *head, const Options_t *options, int report)
+{
+    static const int removed[] = {1, 2, 3}, readded[] = {1}, removed_again[] = {4}, removed_last[] = {5};
+    static const struct { bool add; const int *picks; int count; } steps[] = {
+        {false, removed, 3}, {true, readded, 1}, {false, removed_again, 1}, {false, removed_last, 1}};
+    Hash_t hash;
+    Journal_t *journal = NULL;
+    File_list *none = NULL, *all = NULL;
+    uint64_t result[2] = {0, 0};
+
+    if (initialise_hash(&hash) == FAILURE)
+        _exit(1);
+    hash.positional = build_positions;
+    hash.normalize = build_normalize;
+    for (File_list *file = head; file; file = file->next)
+        insert_at_last(&all, file->file_name);
+    if (journal_open(&journal, &hash, CHECK_JOURNAL, options, &none) == FAILURE ||
+        journal_add(journal, all) == FAILURE || add_files(&hash, &all, options->threads) == FAILURE)
+        _exit(1);
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+    {
+        File_list *files = pick_files(head, steps[i].picks, steps[i].count);
+        if (files == NULL || (steps[i].add ? journal_add(journal, files) == FAILURE || add_files(&hash, &files, options->threads) == FAILURE
+                                           : journal_remove(journal, files) == FAILURE || remove_files(&hash, files) == FAILURE))
+            _exit(1);
+        delete_list(&files);
+    }
+
+    result[0] = index_digest(&hash);
+    result[1] = hash.docs.live;
+    if (write(report, result, sizeof(result)) != sizeof(result))
+        _exit(1);
+    _exit(0); // Like kill -9: no snapshot, the log holds every change
+}
+
+/* Replays the log a crashed child left behind and compares the result with the child's index */
+static Status run_journal_check(File_list *head)
+{
+    Options_t options = {.threads = 1, .verify_postings = true};
+    uint64_t expected[2], replayed[2] = {0, 0};
+    int report[2];
+
+    remove(CHECK_JOURNAL);
+    remove(CHECK_JOURNAL ".wal");
+    if (pipe(report) != 0)
+        return FAILURE;
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0)
+        return FAILURE;
+    if (child == 0)
+    {
+        close(report[0]);
+        journal_child(head, &options, report[1]);
+    }
+    close(report[1]);
+    int child_status;
+    bool reported = read(report[0], expected, sizeof(expected)) == sizeof(expected);
+    close(report[0]);
+    if (waitpid(child, &child_status, 0) != child || !WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0 || !reported)
+    {
+        fprintf(stderr, "Error: The journaled changes could not be made\n");
+        return FAILURE;
+    }
+
+    Hash_t hash;
+    Journal_t *journal = NULL;
+    File_list *none = NULL;
+    Status status = initialise_hash(&hash);
+    if (status == SUCCESS && (status = journal_open(&journal, &hash, CHECK_JOURNAL, &options, &none)) == SUCCESS)
+    {
+        replayed[0] = index_digest(&hash);
+        replayed[1] = hash.docs.live;
+        journal_close(journal, &hash);
+    }
+    free_hash(&hash);
+    remove(CHECK_JOURNAL);
+    remove(CHECK_JOURNAL ".wal");
+    if (status == FAILURE)
+        return FAILURE;
+
+    bool same = replayed[0] == expected[0] && replayed[1] == expected[1];
+    printf("journal replay : %s (%llu of %llu files live)\n", same ? "same" : "DIFFERS", (unsigned long long)replayed[1],
+           (unsigned long long)expected[1]);
+    return same ? SUCCESS : FAILURE;
+}
+
+/* Resident size of this process now, in kilobytes */
+static long resident_kb(void)
+{
+    long pages = 0;
+    FILE *fptr = fopen("/proc/self/statm", "r");
+    if (fptr)
+    {
+        if (fscanf(fptr, "%*s %ld", &pages) != 1)
+            pages = 0;
+        fclose(fptr);
+    }
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/* Child of run_build_check(): builds the index and reports its resident size before the build and its peak */
+static void build_child(File_list *head, const Options_t *options, int report)
+{
+    int null_fd = open("/dev/null", O_WRONLY); // One INFO line per run
+    if (null_fd >= 0)
+        dup2(null_fd, STDOUT_FILENO);
+    long rss[2] = {resident_kb(), 0};
+    Status status = run_build(options, head);
+    rss[1] = peak_rss_kb();
+    bool sent = write(report, rss, sizeof(rss)) == sizeof(rss);
+    _exit(status == SUCCESS && sent ? 0 : 1);
+}
+
+/* External build at the smallest --memory in a child process: its peak RSS must stay within the budget of
+   its resident size at the start, and the index must hold the words and postings of an in-memory build */
+static Status run_build_check(File_list *head)
+{
+    Options_t options = {.threads = 1, .positions = build_positions, .normalize = build_normalize, .build_name = CHECK_BUILD,
+                         .memory_budget = (size_t)BUILD_MEMORY_MIN_MB << 20};
+    long rss[2];
+    int report[2];
+
+    if (pipe(report) != 0)
+        return FAILURE;
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0)
+        return FAILURE;
+    if (child == 0)
+    {
+        close(report[0]);
+        build_child(head, &options, report[1]);
+    }
+    close(report[1]);
+    int child_status;
+    bool reported = read(report[0], rss, sizeof(rss)) == sizeof(rss);
+    close(report[0]);
+    if (waitpid(child, &child_status, 0) != child || !WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0 || !reported)
+    {
+        fprintf(stderr, "Error: The external build failed\n");
+        remove(CHECK_BUILD);
+        return FAILURE;
+    }
+
+    Hash_t built, loaded;
+    File_list *none = NULL;
+    uint64_t postings[2] = {0, 0};
+    size_t words[2] = {0, 0};
+    Status status = initialise_hash(&built);
+    if (status == SUCCESS)
+    {
+        built.positional = build_positions;
+        built.normalize = build_normalize;
+        status = create_database_parallel(&built, head, 1);
+        words[0] = built.count;
+        for (Main_node *node = built.head; node; node = node->m_link)
+            postings[0] += node->file_count;
+        free_hash(&built);
+    }
+    if (status == SUCCESS && (status = initialise_hash(&loaded)) == SUCCESS)
+    {
+        loaded.normalize = build_normalize;
+        status = load_index(&loaded, CHECK_BUILD, &none, true);
+        words[1] = loaded.count;
+        for (Main_node *node = loaded.head; node; node = node->m_link)
+            postings[1] += node->file_count;
+        free_hash(&loaded);
+        delete_list(&none);
+    }
+    remove(CHECK_BUILD);
+    if (status == FAILURE)
+        return FAILURE;
+
+    long budget_kb = (long)(options.memory_budget >> 10), used_kb = rss[1] - rss[0];
+    bool within = used_kb <= budget_kb, same = words[0] == words[1] && postings[0] == postings[1];
+    printf("build memory : peak RSS %ld KB above the %ld KB at start, budget %ld KB, %s\n", used_kb, rss[0], budget_kb,
+           within ? "ok" : "OVER");
+    printf("build index  : %zu words, %llu postings, %s\n", words[1], (unsigned long long)postings[1],
+           same ? "same as in memory" : "DIFFERS from in memory");
+    return within && same ? SUCCESS : FAILURE;
+}
+
+/* Writes a backup with the given number of words, 1-4 files each, out of 1000 files */
+static Status write_synthetic_backup(const char *name, uint32_t words)
+{
+    FILE *fptr = fopen(name, "w");
+    if (fptr == NULL)
+        return FAILURE;
+
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (uint32_t i = 0; i < words; i++)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull; // LCG
+        uint32_t files = 1 + (uint32_t)(state >> 62);
+        uint32_t first = (uint32_t)(state >> 32) % 1000;
+
+        fprintf(fptr, "#%d;w%07x;%u;", 26, i, files);
+        for (uint32_t f = 0; f < files; f++)
+            fprintf(fptr, "file%03u.txt;%u;", (first + f * 7) % 1000, 1 + (uint32_t)(state >> (8 * f)) % 9);
+        fprintf(fptr, "#\n");
+    }
+    return fclose(fptr) == 0 ? SUCCESS : FAILURE;
+}
+
+static Status run_load_scaling(int repeat)
+{
+    static const uint32_t sizes[] = {125000, 250000, 500000, 1000000};
+    char name[] = "bench_load_backup.txt";
+    double base = 0;
+
+    printf("%-10s %-12s %-12s %-10s\n", "words", "best (s)", "ns/word", "growth");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        if (write_synthetic_backup(name, sizes[i]) == FAILURE)
+            return FAILURE;
+
+        double best = 0;
+        for (int r = 0; r < repeat; r++)
+        {
+            Hash_t hash;
+            File_list *head = NULL;
+            if (initialise_hash(&hash) == FAILURE)
+                return FAILURE;
+
+            double start = now_seconds();
+            Status status = update_database(&hash, name, &head);
+            double elapsed = now_seconds() - start;
+
+            free_hash(&hash);
+            if (status == FAILURE)
+            {
+                remove(name);
+                return FAILURE;
+            }
+            if (r == 0 || elapsed < best)
+                best = elapsed;
+        }
+        if (i == 0)
+            base = best;
+
+        printf("%-10u %-12.6f %-12.1f %-10.2f\n", sizes[i], best, best * 1e9 / sizes[i], best / base);
+    }
+    remove(name);
+    printf("peak RSS (KB)  : %ld\n", peak_rss_kb());
+    return SUCCESS;
+}
+
+static Status run_query_bench(File_list *head, int threads, int repeat, const char *text, int top_k)
+{
+    Hash_t hash;
+    Query_t query;
+    Doc_set result;
+    Ranked_doc *ranked = malloc(top_k * sizeof(Ranked_doc));
+    uint32_t shown = 0;
+    const int iterations = 1000 * repeat;
+
+    if (ranked == NULL)
+        return FAILURE;
+
+    if (query_parse(text, build_normalize, &query) == FAILURE || initialise_hash(&hash) == FAILURE)
+    {
+        free(ranked);
+        return FAILURE;
+    }
+    hash.positional = build_positions;
+    hash.normalize = build_normalize;
+    if (create_database_parallel(&hash, head, threads) == FAILURE)
+    {
+        free(ranked);
+        free_hash(&hash);
+        return FAILURE;
+    }
+
+    uint32_t matches = 0;
+    double start = now_seconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        if (query_run(&hash, &query, &result) == FAILURE)
+        {
+            free(ranked);
+            free_hash(&hash);
+            return FAILURE;
+        }
+        matches = result.count;
+        doc_set_free(&result);
+    }
+    double elapsed = now_seconds() - start;
+
+    start = now_seconds();
+    for (int i = 0; i < iterations; i++) // Same query plus BM25 top-k
+    {
+        if (query_run(&hash, &query, &result) == FAILURE ||
+            rank_top_k(&hash, &query, &result, top_k, ranked, &shown, NULL) == FAILURE)
+        {
+            doc_set_free(&result);
+            free(ranked);
+            free_hash(&hash);
+            return FAILURE;
+        }
+        doc_set_free(&result);
+    }
+    double ranked_elapsed = now_seconds() - start;
+
+    printf("query          : %s\n", text);
+    printf("documents      : %u\n", hash.docs.count);
+    printf("matches        : %u\n", matches);
+    printf("iterations     : %d\n", iterations);
+    printf("latency (us)   : %.3f\n", elapsed * 1e6 / iterations);
+    printf("top-%-3d (us)   : %.3f\n", top_k, ranked_elapsed * 1e6 / iterations);
+
+    free(ranked);
+    free_hash(&hash);
+    return SUCCESS;
+}
+
+typedef struct latency
+{
+    uint32_t count;
+    double seconds; // Sum of all samples
+    double p50, p90, p99, p999, max; // Microseconds
+} Latency_t;
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Sorts the samples (seconds) and takes nearest-rank percentiles */
+static void summarise(double *samples, uint32_t count, Latency_t *out)
+{
+    memset(out, 0, sizeof(Latency_t));
+    if (count == 0)
+        return;
+
+    qsort(samples, count, sizeof(double), compare_double);
+    out->count = count;
+    for (uint32_t i = 0; i < count; i++)
+        out->seconds += samples[i];
+
+    double *p[] = {&out->p50, &out->p90, &out->p99, &out->p999};
+    static const double at[] = {0.50, 0.90, 0.99, 0.999};
+    for (int i = 0; i < 4; i++)
+    {
+        uint32_t rank = (uint32_t)(at[i] * count + 0.999999);
+        *p[i] = samples[rank ? rank - 1 : 0] * 1e6;
+    }
+    out->max = samples[count - 1] * 1e6;
+}
+
+/* Query log lines, or single words and AND / OR pairs spread over the vocabulary */
+static char **suite_queries(Hash_t *hash, const char *query_file, uint32_t *count)
+{
+    uint32_t capacity = query_file ? 1024 : 3 * SUITE_SAMPLED_QUERIES;
+    char **queries = malloc(capacity * sizeof(char *));
+    char line[QUERY_SIZE];
+    *count = 0;
+    if (queries == NULL)
+        return NULL;
+
+    if (query_file)
+    {
+        FILE *fptr = fopen(query_file, "r");
+        if (fptr == NULL)
+        {
+            free(queries);
+            return NULL;
+        }
+        while (fgets(line, sizeof(line), fptr))
+        {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] == '\0' || line[0] == '#')
+                continue;
+            if (*count == capacity)
+            {
+                char **grown = realloc(queries, 2 * capacity * sizeof(char *));
+                if (grown == NULL)
+                    break;
+                queries = grown;
+                capacity *= 2;
+            }
+            if ((queries[*count] = strdup(line)) != NULL)
+                (*count)++;
+        }
+        fclose(fptr);
+        return queries;
+    }
+
+    size_t step = hash->count / SUITE_SAMPLED_QUERIES + 1;
+    Main_node *sample[SUITE_SAMPLED_QUERIES + 1];
+    uint32_t n = 0;
+    size_t i = 0;
+    for (Main_node *node = hash->head; node && n <= SUITE_SAMPLED_QUERIES; node = node->m_link, i++)
+    {
+        if (i % step == 0)
+            sample[n++] = node;
+    }
+    for (uint32_t q = 0; q + 1 < n && *count + 3 <= capacity; q++)
+    {
+        const char *a = sample[q]->word, *b = sample[q + 1]->word;
+        snprintf(line, sizeof(line), "%s", a);
+        queries[(*count)++] = strdup(line);
+        snprintf(line, sizeof(line), "%s AND %s", a, b);
+        queries[(*count)++] = strdup(line);
+        snprintf(line, sizeof(line), "%s OR %s", a, b);
+        queries[(*count)++] = strdup(line);
+    }
+    return queries;
+}
+
+static void print_latency(FILE *json, const char *name, const Latency_t *lat, bool last)
+{
+    fprintf(json, "    \"%s\": {\"samples\": %u, \"qps\": %.1f, \"p50_us\": %.2f, \"p90_us\": %.2f, \"p99_us\": %.2f, "
+                  "\"p999_us\": %.2f, \"max_us\": %.2f}%s\n",
+            name, lat->count, lat->seconds > 0 ? lat->count / lat->seconds : 0.0, lat->p50, lat->p90, lat->p99, lat->p999,
+            lat->max, last ? "" : ",");
+}
+
+/* Times every workload once the index is built and writes the JSON report */
+static Status run_suite(File_list *head, int threads, int repeat, const char *query_file, int top_k, double input_mb, FILE *json)
+{
+    Build_result build;
+    if (run_builds(head, threads, repeat, &build) == FAILURE)
+        return FAILURE;
+    uint64_t tokens;
+    double tokenize = tokenize_best(head, repeat, &tokens);
+
+    Hash_t hash;
+    if (initialise_hash(&hash) == FAILURE)
+        return FAILURE;
+    hash.positional = build_positions;
+    hash.normalize = build_normalize;
+    if (create_database_parallel(&hash, head, threads) == FAILURE)
+    {
+        free_hash(&hash);
+        return FAILURE;
+    }
+
+    double save_txt = 0, save_bin = 0, load_txt = 0, load_bin = 0;
+    Status status = SUCCESS;
+    for (int r = 0; r < repeat && status == SUCCESS; r++) // Best of repeat for each step
+    {
+        double start = now_seconds();
+        status = save_database(&hash, SUITE_TEXT_BACKUP);
+        double t1 = now_seconds();
+        if (status == SUCCESS)
+            status = save_index(&hash, SUITE_BIN_INDEX);
+        double t2 = now_seconds();
+
+        Hash_t loaded;
+        File_list *pending = NULL;
+        if (status == SUCCESS && initialise_hash(&loaded) == SUCCESS)
+        {
+            status = update_database(&loaded, SUITE_TEXT_BACKUP, &pending);
+            free_hash(&loaded);
+        }
+        double t3 = now_seconds();
+        if (status == SUCCESS && initialise_hash(&loaded) == SUCCESS)
+        {
+            status = load_index(&loaded, SUITE_BIN_INDEX, &pending, false);
+            free_hash(&loaded);
+        }
+        double t4 = now_seconds();
+
+        if (r == 0 || t1 - start < save_txt)
+            save_txt = t1 - start;
+        if (r == 0 || t2 - t1 < save_bin)
+            save_bin = t2 - t1;
+        if (r == 0 || t3 - t2 < load_txt)
+            load_txt = t3 - t2;
+        if (r == 0 || t4 - t3 < load_bin)
+            load_bin = t4 - t3;
+    }
+
+    struct stat txt_st = {0}, bin_st = {0};
+    stat(SUITE_TEXT_BACKUP, &txt_st);
+    stat(SUITE_BIN_INDEX, &bin_st);
+    remove(SUITE_TEXT_BACKUP);
+    remove(SUITE_BIN_INDEX);
+
+    uint32_t count = 0;
+    char **queries = status == SUCCESS ? suite_queries(&hash, query_file, &count) : NULL;
+    double *single = malloc(((size_t)count * repeat + 1) * sizeof(double));
+    double *multi = malloc(((size_t)count * repeat + 1) * sizeof(double));
+    Ranked_doc *top = malloc(top_k * sizeof(Ranked_doc));
+    uint32_t singles = 0, multis = 0, failed = 0;
+
+    if (queries == NULL || single == NULL || multi == NULL || top == NULL)
+    {
+        if (status == SUCCESS)
+            fprintf(stderr, "Error: Unable to read queries%s%s\n", query_file ? " from " : "", query_file ? query_file : "");
+        status = FAILURE;
+    }
+
+    for (int r = 0; r < repeat && status == SUCCESS; r++) // Parse, match and rank, as a search does
+    {
+        for (uint32_t q = 0; q < count; q++)
+        {
+            Query_t query;
+            uint32_t shown, matches;
+            double start = now_seconds();
+            bool ok = query_parse(queries[q], hash.normalize, &query) == SUCCESS &&
+                      search_cached(&hash, &query, top_k, top, &shown, &matches) == SUCCESS;
+            double elapsed = now_seconds() - start;
+
+            if (!ok)
+                failed += r == 0;
+            else if (query.nodes[query.root].op == Q_TERM)
+                single[singles++] = elapsed;
+            else
+                multi[multis++] = elapsed;
+        }
+    }
+
+    if (status == SUCCESS)
+    {
+        Latency_t single_lat, multi_lat;
+        summarise(single, singles, &single_lat);
+        summarise(multi, multis, &multi_lat);
+
+        fprintf(json, "{\n");
+        fprintf(json, "  \"corpus\": {\"files\": %u, \"mb\": %.2f, \"unique_words\": %zu},\n", hash.docs.count, input_mb, hash.count);
+        char steps[NORM_NAME_SIZE];
+        fprintf(json, "  \"config\": {\"threads\": %d, \"repeat\": %d, \"top_k\": %d, \"positions\": %s, \"normalize\": \"%s\"},\n",
+                threads, repeat, top_k, build_positions ? "true" : "false", normalize_name(build_normalize, steps));
+        fprintf(json, "  \"build\": {\"best_s\": %.6f, \"avg_s\": %.6f, \"mb_per_s\": %.1f, \"node_bytes\": %zu},\n", build.best,
+                build.total / repeat, input_mb / build.best, build.used);
+        fprintf(json, "  \"tokenize\": {\"best_s\": %.6f, \"mb_per_s\": %.1f, \"tokens\": %llu},\n", tokenize,
+                input_mb / tokenize, (unsigned long long)tokens);
+        fprintf(json, "  \"save_text\": {\"best_s\": %.6f, \"bytes\": %lld},\n", save_txt, (long long)txt_st.st_size);
+        fprintf(json, "  \"save_binary\": {\"best_s\": %.6f, \"bytes\": %lld},\n", save_bin, (long long)bin_st.st_size);
+        fprintf(json, "  \"load_text\": {\"best_s\": %.6f, \"words_per_s\": %.0f},\n", load_txt, hash.count / load_txt);
+        fprintf(json, "  \"load_binary\": {\"best_s\": %.6f, \"words_per_s\": %.0f},\n", load_bin, hash.count / load_bin);
+        fprintf(json, "  \"queries\": {\n");
+        fprintf(json, "    \"source\": \"%s\",\n", query_file ? "file" : "sampled");
+        fprintf(json, "    \"invalid\": %u,\n", failed);
+        print_latency(json, "single_term", &single_lat, false);
+        print_latency(json, "multi_term", &multi_lat, true);
+        fprintf(json, "  },\n");
+        fprintf(json, "  \"peak_rss_kb\": %ld\n", peak_rss_kb());
+        fprintf(json, "}\n");
+    }
+
+    for (uint32_t q = 0; q < count; q++)
+        free(queries[q]);
+    free(queries);
+    free(single);
+    free(multi);
+    free(top);
+    free_hash(&hash);
+    return status;
+}
+
+/* Packs count postings (IDs 0, 2, 4, ...), seeks the last one and then past it, as ranking does */
+static bool cursor_stops_at_end(Hash_t *hash, uint32_t count)
+{
+    Sub_node *subs = malloc(count * sizeof(Sub_node));
+    Main_node *node = create_main_node(hash, "cursor", 6);
+    if (subs == NULL || node == NULL)
+    {
+        free(subs);
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        subs[i].doc_id = 2 * i;
+        subs[i].word_count = i + 1;
+    }
+    bool ok = postings_pack_list(&hash->arena, node, subs, count) == SUCCESS;
+    free(subs);
+
+    Posting_cursor cursor;
+    uint32_t index = 0, word_count = 0, last = 2 * (count - 1);
+    cursor_init(&cursor, node);
+    ok = ok && cursor_seek(&cursor, last, &index, &word_count) && index == count - 1 && word_count == count;
+    ok = ok && !cursor_seek(&cursor, last + 1, &index, &word_count) && cursor.pos == count; // Past the last block
+    ok = ok && !cursor_seek(&cursor, UINT32_MAX - 1, &index, &word_count) && cursor.pos == count;
+    return ok;
+}
+
+/* Lists with and without a tail block, around one and two full blocks */
+static Status run_cursor_check(void)
+{
+    static const uint32_t sizes[] = {1, 2, POSTING_BLOCK - 1, POSTING_BLOCK, POSTING_BLOCK + 1, 200,
+                                     2 * POSTING_BLOCK - 1, 2 * POSTING_BLOCK, 2 * POSTING_BLOCK + 1, 1000};
+    Hash_t hash;
+    if (initialise_hash(&hash) == FAILURE)
+        return FAILURE;
+
+    Status status = SUCCESS;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        bool ok = cursor_stops_at_end(&hash, sizes[i]);
+        printf("cursor past end : %-5u postings %s\n", sizes[i], ok ? "ok" : "FAILED");
+        if (!ok)
+            status = FAILURE;
+    }
+    free_hash(&hash);
+    return status;
+}
+
+/* Backup of 1000 files: "common" in all, "even" in every other one, "rare" in three; full blocks and tails */
+static Status write_check_backup(const char *name)
+{
+    FILE *fptr = fopen(name, "w");
+    if (fptr == NULL)
+        return FAILURE;
+
+    fprintf(fptr, "#%d;common;1000;", 'c' - 'a');
+    for (uint32_t f = 0; f < 1000; f++)
+        fprintf(fptr, "file%03u.txt;%u;", f, 1 + f % 7);
+    fprintf(fptr, "#\n#%d;even;500;", 'e' - 'a');
+    for (uint32_t f = 0; f < 1000; f += 2)
+        fprintf(fptr, "file%03u.txt;%u;", f, 1 + f % 3);
+    fprintf(fptr, "#\n#%d;rare;3;file010.txt;1;file500.txt;2;file990.txt;3;#\n", 'r' - 'a');
+    return fclose(fptr) == 0 ? SUCCESS : FAILURE;
+}
+
+/* Runs each query on a loaded index; false if one yields a document ID past the table */
+static bool damaged_queries_in_range(Hash_t *hash, uint32_t *failed)
+{
+    static const char *const queries[] = {"common", "even", "common AND even", "rare AND common", "even AND NOT rare",
+                                          "common OR rare", "e*"};
+    Ranked_doc top[TOP_K_DEFAULT];
+
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++)
+    {
+        Query_t query;
+        Doc_set result;
+        uint32_t shown;
+        if (query_parse(queries[q], hash->normalize, &query) == FAILURE || query_run(hash, &query, &result) == FAILURE)
+        {
+            (*failed)++;
+            continue;
+        }
+        for (uint32_t i = 0; i < result.count; i++)
+        {
+            if (result.ids[i] >= hash->docs.count)
+            {
+                doc_set_free(&result);
+                return false;
+            }
+        }
+        if (rank_top_k(hash, &query, &result, TOP_K_DEFAULT, top, &shown, NULL) == FAILURE)
+            (*failed)++;
+        doc_set_free(&result);
+    }
+    return true;
+}
+
+/* Saves a small index, then loads copies with one postings byte changed and queries them without --verify */
+static Status run_corrupt_check(void)
+{
+    Hash_t hash;
+    File_list *pending = NULL;
+    if (write_check_backup(CHECK_BACKUP) == FAILURE || initialise_hash(&hash) == FAILURE)
+        return FAILURE;
+    fflush(stdout);
+    fflush(stderr);
+    int saved_stdout = dup(STDOUT_FILENO), saved_stderr = dup(STDERR_FILENO); // Keep the index code's messages out of the report
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    Status status = update_database(&hash, CHECK_BACKUP, &pending);
+    if (status == SUCCESS)
+        status = save_index(&hash, CHECK_INDEX);
+    free_hash(&hash);
+    delete_list(&pending);
+    remove(CHECK_BACKUP);
+
+    FILE *fptr = status == SUCCESS ? fopen(CHECK_INDEX, "rb") : NULL;
+    uint8_t *bytes = NULL;
+    long size = 0;
+    if (fptr && fseek(fptr, 0, SEEK_END) == 0 && (size = ftell(fptr)) > (long)sizeof(Bin_header) && (bytes = malloc(size)) &&
+        fseek(fptr, 0, SEEK_SET) == 0 && fread(bytes, 1, size, fptr) != (size_t)size)
+    {
+        free(bytes);
+        bytes = NULL;
+    }
+    if (fptr)
+        fclose(fptr);
+    remove(CHECK_INDEX);
+
+    Bin_header header;
+    uint32_t refused = 0, failed = 0, loaded = 0;
+    bool in_range = true;
+    if (bytes)
+        memcpy(&header, bytes, sizeof(header));
+    for (uint32_t copy = 0; bytes && copy < CHECK_DAMAGED_COPIES && in_range; copy++)
+    {
+        uint64_t state = 0x9e3779b97f4a7c15ull * (copy + 1);
+        state = state * 6364136223846793005ull + 1442695040888963407ull; // LCG
+        uint64_t at = header.postings_offset + (state >> 33) % header.postings_size;
+        uint8_t flip = (uint8_t)(1 + (state >> 8) % 255);
+
+        bytes[at] ^= flip;
+        fptr = fopen(CHECK_DAMAGED, "wb");
+        bool written = fptr && fwrite(bytes, 1, size, fptr) == (size_t)size;
+        if (fptr && fclose(fptr) != 0)
+            written = false;
+        bytes[at] ^= flip;
+        if (!written)
+        {
+            status = FAILURE;
+            break;
+        }
+
+        Hash_t damaged;
+        if (initialise_hash(&damaged) == FAILURE)
+        {
+            status = FAILURE;
+            break;
+        }
+        if (load_index(&damaged, CHECK_DAMAGED, &pending, false) == FAILURE)
+            refused++;
+        else
+        {
+            loaded++;
+            in_range = damaged_queries_in_range(&damaged, &failed);
+        }
+        free_hash(&damaged);
+        delete_list(&pending);
+    }
+    remove(CHECK_DAMAGED);
+    free(bytes);
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved_stdout, STDOUT_FILENO);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stdout);
+    close(saved_stderr);
+    if (null_fd >= 0)
+        close(null_fd);
+    if (bytes == NULL || status == FAILURE)
+        return FAILURE;
+
+    printf("damaged postings : %u copies, %u refused at load, %u loaded (%u queries failed), IDs %s\n",
+           refused + loaded, refused, loaded, failed, in_range ? "in range" : "OUT OF RANGE");
+    return in_range ? SUCCESS : FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+    int repeat = 5;
+    int threads = 1;
+    bool scaling = false;
+    bool load_scaling = false;
+    bool cursor_check = false;
+    bool corrupt_check = false;
+    bool suite = false;
+    bool journal_check = false;
+    bool build_check = false;
+    const char *query = NULL;
+    const char *query_file = NULL;
+    int top_k = TOP_K_DEFAULT;
+    int first = 1;
+
+    while (first < argc && strncmp(argv[first], "--", 2) == 0) // Benchmark options
+    {
+        if (strcmp(argv[first], "--repeat") == 0 && first + 1 < argc)
+            repeat = atoi(argv[++first]);
+        else if (strcmp(argv[first], "--threads") == 0 && first + 1 < argc)
+            threads = atoi(argv[++first]);
+        else if (strcmp(argv[first], "--scaling") == 0)
+            scaling = true;
+        else if (strcmp(argv[first], "--load-scaling") == 0)
+            load_scaling = true;
+        else if (strcmp(argv[first], "--cursor-check") == 0)
+            cursor_check = true;
+        else if (strcmp(argv[first], "--corrupt-check") == 0)
+            corrupt_check = true;
+        else if (strcmp(argv[first], "--query") == 0 && first + 1 < argc)
+            query = argv[++first];
+        else if (strcmp(argv[first], "--top") == 0 && first + 1 < argc)
+            top_k = atoi(argv[++first]);
+        else if (strcmp(argv[first], "--positions") == 0)
+            build_positions = true;
+        else if (strcmp(argv[first], "--normalize") == 0 && first + 1 < argc && parse_normalize(argv[first + 1], &build_normalize) == SUCCESS)
+            first++;
+        else if (strcmp(argv[first], "--suite") == 0)
+            suite = true;
+        else if (strcmp(argv[first], "--queries") == 0 && first + 1 < argc)
+            query_file = argv[++first];
+        else if (strcmp(argv[first], "--journal-check") == 0)
+            journal_check = true;
+        else if (strcmp(argv[first], "--build-check") == 0)
+            build_check = true;
+        else
+            break;
+        first++;
+    }
+
+    if (load_scaling && repeat >= 1)
+        return run_load_scaling(repeat) == SUCCESS ? 0 : EXIT_FAILURE;
+    if (cursor_check)
+        return run_cursor_check() == SUCCESS ? 0 : EXIT_FAILURE;
+    if (corrupt_check)
+        return run_corrupt_check() == SUCCESS ? 0 : EXIT_FAILURE;
+
+    if (first >= argc || repeat < 1 || threads < 1 || top_k < 1)
+    {
+        fprintf(stderr, "Usage: %s [--repeat N] [--positions] [--normalize STEPS] [--threads N | --scaling] <file1.txt> <file2.txt> ...\n", argv[0]);
+        fprintf(stderr, "       %s [--repeat N] --load-scaling\n", argv[0]);
+        fprintf(stderr, "       %s [--repeat N] [--positions] --query \"a AND b NOT c\" [--top N] <file1.txt> ...\n", argv[0]);
+        fprintf(stderr, "       %s --suite [--repeat N] [--threads N] [--queries FILE] [--top N] <file1.txt> ...\n", argv[0]);
+        fprintf(stderr, "       %s --cursor-check\n", argv[0]);
+        fprintf(stderr, "       %s --corrupt-check\n", argv[0]);
+        fprintf(stderr, "       %s --journal-check [--positions] <file1.txt> ... (at least 6 files)\n", argv[0]);
+        fprintf(stderr, "       %s --build-check [--positions] <file1.txt> ...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Same checks as the program (directories and @lists expanded), reported on stderr to keep the output clean */
+    File_list *head = NULL;
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    Status valid = read_and_validate_input_arguments(argc - first + 1, argv + first - 1, &head);
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    if (valid == FAILURE)
+    {
+        fprintf(stderr, "Error: No readable .txt files to index\n");
+        delete_list(&head);
+        return EXIT_FAILURE;
+    }
+
+    double input_mb = 0;
+    for (File_list *file = head; file; file = file->next)
+    {
+        struct stat st;
+        if (stat(file->file_name, &st) == 0)
+            input_mb += st.st_size / 1e6;
+    }
+
+    if (suite) // JSON alone on stdout, the index code's messages go to stderr
+    {
+        fflush(stdout);
+        FILE *json = fdopen(dup(STDOUT_FILENO), "w");
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        Status status = json ? run_suite(head, threads, repeat, query_file, top_k, input_mb, json) : FAILURE;
+        if (json)
+            fclose(json);
+        delete_list(&head);
+        return status == SUCCESS ? 0 : EXIT_FAILURE;
+    }
+
+    if (journal_check)
+    {
+        Status status = FAILURE;
+        int count = 0;
+        for (File_list *file = head; file; file = file->next)
+            count++;
+        if (count < 6)
+            fprintf(stderr, "Error: --journal-check needs at least 6 files\n");
+        else
+            status = run_journal_check(head);
+        delete_list(&head);
+        return status == SUCCESS ? 0 : EXIT_FAILURE;
+    }
+
+    if (build_check)
+    {
+        Status status = run_build_check(head);
+        delete_list(&head);
+        return status == SUCCESS ? 0 : EXIT_FAILURE;
+    }
+
+    if (query)
+    {
+        Status status = run_query_bench(head, threads, repeat, query, top_k);
+        delete_list(&head);
+        return status == SUCCESS ? 0 : EXIT_FAILURE;
+    }
+
+    Build_result result;
+
+    if (scaling)
+    {
+        static const int sweep[] = {1, 2, 4, 8, 16};
+        double base = 0;
+        uint64_t expected = 0;
+
+        printf("%-8s %-12s %-10s %-10s %-9s\n", "threads", "best (s)", "speed-up", "MB/s", "output");
+        for (size_t i = 0; i < sizeof(sweep) / sizeof(sweep[0]); i++)
+        {
+            if (run_builds(head, sweep[i], repeat, &result) == FAILURE)
+                return EXIT_FAILURE;
+            if (result.words == 0)
+            {
+                fprintf(stderr, "Error: No words were indexed\n");
+                delete_list(&head);
+                return EXIT_FAILURE;
+            }
+            if (i == 0)
+            {
+                base = result.best;
+                expected = result.digest;
+            }
+            printf("%-8d %-12.6f %-10.2f %-10.1f %-9s\n", sweep[i], result.best, base / result.best,
+                   input_mb / result.best, result.digest == expected ? "same" : "DIFFERS");
+        }
+        printf("peak RSS (KB)  : %ld\n", peak_rss_kb());
+        delete_list(&head);
+        return 0;
+    }
+
+    if (run_builds(head, threads, repeat, &result) == FAILURE)
+        return EXIT_FAILURE;
+    if (result.words == 0) // Nothing to report a rate for
+    {
+        fprintf(stderr, "Error: No words were indexed\n");
+        delete_list(&head);
+        return EXIT_FAILURE;
+    }
+
+#ifdef ARENA_USE_MALLOC
+    const char *mode = "malloc-per-node";
+#else
+    const char *mode = "arena";
+#endif
+
+    printf("allocator      : %s\n", mode);
+    printf("threads        : %d\n", threads);
+    printf("repeat         : %d\n", repeat);
+    printf("unique words   : %zu\n", result.words);
+    printf("node bytes     : %zu\n", result.used);
+    printf("reserved bytes : %zu\n", result.reserved);
+    printf("build best (s) : %.6f\n", result.best);
+    printf("build avg  (s) : %.6f\n", result.total / repeat);
+    printf("ingest (MB/s)  : %.1f\n", input_mb / result.best);
+    uint64_t tokens;
+    double tokenize = tokenize_best(head, repeat, &tokens);
+    printf("tokens         : %llu\n", (unsigned long long)tokens);
+    printf("tokenize (MB/s): %.1f\n", input_mb / tokenize);
+    printf("peak RSS (KB)  : %ld\n", peak_rss_kb());
+
+    delete_list(&head);
+    return 0;
+}
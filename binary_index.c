@@ -0,0 +1,876 @@
+/***********************************************************************
+ *  File Name   : binary_index.c
+ *  Description : Compact, versioned binary index file for the Inverted
+ *                Search System. Layout (every section 8-byte aligned):
+ *
+ *                  Bin_header                 magic, version, counts,
+ *                                             offsets, checksums
+ *                  document table             Bin_doc[] + name bytes
+ *                  term dictionary            Bin_term[] (insertion order)
+ *                  strings                    word bytes
+ *                  postings                   packed sub nodes per word
+ *                                             (postings.c)
+ *                  positions (optional)       per word: uint32_t offsets
+ *                                             [file_count] + varint bytes
+ *                  chunk table                Bin_chunk[]
+ *
+ *                The words are split into chunks: runs of consecutive
+ *                words with their own 8-byte aligned region of the
+ *                terms, strings, postings and positions sections and
+ *                their own checksums. Saving and loading take one chunk
+ *                per thread at a time.
+ *
+ *                Loading maps the file and builds only the main nodes;
+ *                every word's packed sub nodes are read straight from
+ *                the mapped postings section, and so are its positions when
+ *                the index has them. A word is copied out of the
+ *                mapping only if it is modified later. The text backup
+ *                (save_database / update_database) remains available
+ *                for import and export.
+ *
+ *                Functions:
+ *                  - is_index_file()
+ *                  - checksum_words()
+ *                  - section_begin() / section_write() / section_end()
+ *                  - section_chunk()
+ *                  - write_chunk_table()
+ *                  - index_header_init()
+ *                  - write_doc_section()
+ *                  - commit_index()
+ *                  - save_index()
+ *                  - load_index()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define IO_BUFFER_SIZE (1 << 20) // stdio buffer and chunk write buffers of save_index()
+
+bool is_index_file(const char *file_name)
+{
+    const char *dot = strrchr(file_name, '.');
+    return dot && strcmp(dot, ".bin") == 0;
+}
+
+uint64_t checksum_words(uint64_t sum, const void *data, size_t len)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i + 8 <= len; i += 8) // len is always a multiple of 8
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        sum = (sum ^ word) * 0x100000001b3ull;
+        sum ^= sum >> 29;
+    }
+    return sum;
+}
+
+/* ------------------ Saving ------------------ */
+
+/* Bytes of a word's block in the positions section (offsets, then varints, 4-byte aligned) */
+static uint64_t positions_block_size(const Main_node *node, const Sub_node *subs)
+{
+    uint64_t size = (uint64_t)node->file_count * sizeof(uint32_t);
+    for (uint32_t i = 0; i < node->file_count; i++)
+        size += positions_span(node->positions->data + node->positions->offsets[i], subs[i].word_count);
+    return (size + 3) & ~(uint64_t)3;
+}
+
+void section_begin(Section_writer *w)
+{
+    w->size = 0;
+    w->checksum = 0;
+    w->pending_len = 0;
+}
+
+void section_write(Section_writer *w, const void *data, size_t len)
+{
+    const unsigned char *bytes = data;
+    if (len && fwrite(bytes, 1, len, w->fptr) != len)
+        w->failed = true;
+    w->size += len;
+
+    while (len) // Feed the checksum in whole words
+    {
+        size_t take = 8 - w->pending_len;
+        if (w->pending_len == 0 && len >= 8)
+        {
+            size_t whole = len & ~(size_t)7;
+            w->checksum = checksum_words(w->checksum, bytes, whole);
+            bytes += whole;
+            len -= whole;
+            continue;
+        }
+        if (take > len)
+            take = len;
+        memcpy(w->pending + w->pending_len, bytes, take);
+        w->pending_len += take;
+        bytes += take;
+        len -= take;
+        if (w->pending_len == 8)
+        {
+            w->checksum = checksum_words(w->checksum, w->pending, 8);
+            w->pending_len = 0;
+        }
+    }
+}
+
+void section_end(Section_writer *w)
+{
+    static const unsigned char zero[8] = {0};
+    if (w->size % 8) // Pad to the next 8-byte boundary
+        section_write(w, zero, 8 - w->size % 8);
+}
+
+void index_header_init(Bin_header *header, uint32_t doc_count, bool positional, unsigned normalize)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, INDEX_MAGIC, sizeof(header->magic));
+    header->version = INDEX_VERSION;
+    header->header_size = sizeof(Bin_header);
+    header->doc_count = doc_count;
+    header->flags = (positional ? INDEX_POSITIONS : 0) | normalize << INDEX_NORMALIZE_SHIFT;
+}
+
+/* Writes the document table section: Bin_doc[], then the names back to back */
+void write_doc_section(Section_writer *w, const Doc_table *docs)
+{
+    section_begin(w);
+    uint32_t name_offset = 0;
+    for (uint32_t i = 0; i < docs->count; i++)
+    {
+        const char *name = docs->names[i];
+        Bin_doc doc = {name_offset, name ? (uint32_t)strlen(name) : 0, docs->lengths[i]}; // Removed files keep their ID
+        section_write(w, &doc, sizeof(doc));
+        name_offset += doc.name_len;
+    }
+    for (uint32_t i = 0; i < docs->count; i++)
+    {
+        if (docs->names[i])
+            section_write(w, docs->names[i], strlen(docs->names[i]));
+    }
+    section_end(w);
+}
+
+/* Seals the header, flushes the file to disk and renames it over file_name; the temporary file is removed on failure */
+Status commit_index(Section_writer *w, Bin_header *header, const char *temp_name, const char *file_name)
+{
+    header->header_checksum = checksum_words(0, header, offsetof(Bin_header, header_checksum));
+
+    if (fseek(w->fptr, 0, SEEK_SET) != 0 || fwrite(header, sizeof(*header), 1, w->fptr) != 1)
+        w->failed = true;
+    if (fflush(w->fptr) != 0 || fsync(fileno(w->fptr)) != 0) // A crash after the rename must not leave a torn index
+        w->failed = true;
+    if (fclose(w->fptr) != 0)
+        w->failed = true;
+
+    if (w->failed || rename(temp_name, file_name) != 0)
+    {
+        fprintf(stderr, "Error: Failed to write index '%s'\n", file_name);
+        remove(temp_name);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* Pads the section to 8 bytes and returns the checksum of the chunk written since the last call */
+uint64_t section_chunk(Section_writer *w)
+{
+    section_end(w);
+    uint64_t checksum = w->checksum;
+    w->checksum = 0;
+    return checksum;
+}
+
+/* Writes the chunk table at the current position; chunks_offset and chunk_count are the caller's */
+void write_chunk_table(Section_writer *w, Bin_header *header, const Bin_chunk *chunks)
+{
+    section_begin(w);
+    section_write(w, chunks, header->chunk_count * sizeof(Bin_chunk));
+    section_end(w);
+    header->checksum[1] = w->checksum;
+}
+
+/* Threads to save or load count chunks: one per core, at most one per chunk */
+static int index_threads(uint64_t count)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t threads = cpus > 0 ? (uint64_t)cpus : 1;
+    if (threads > count)
+        threads = count;
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    return threads ? (int)threads : 1;
+}
+
+/* Runs routine on the calling thread and threads - 1 more, thread i getting the arg_size bytes at args + i * arg_size */
+static void run_threads(int threads, void *(*routine)(void *), void *args, size_t arg_size)
+{
+    pthread_t ids[MAX_THREADS];
+    int started = 1;
+    while (started < threads && pthread_create(&ids[started], NULL, routine, (char *)args + started * arg_size) == 0)
+        started++; // Chunks are pulled from a shared counter, so fewer threads still finish the work
+    routine(args);
+    for (int i = 1; i < started; i++)
+        pthread_join(ids[i], NULL);
+}
+
+/* Buffered writer of one chunk region, flushed with large pwrite() calls so threads never share a file position */
+typedef struct chunk_writer
+{
+    int fd;
+    uint64_t offset;       // File position of buffer[0]
+    unsigned char *buffer; // IO_BUFFER_SIZE bytes, page aligned
+    size_t len;
+    uint64_t size;         // Bytes of the region so far
+    uint64_t checksum;     // Of the bytes flushed so far
+    bool failed;
+} Chunk_writer;
+
+typedef struct save_job
+{
+    Hash_t *hash;
+    Main_node **nodes;         // Every word, in insertion order
+    uint64_t *sizes;           // Packed bytes of each word
+    Bin_chunk *chunks;         // Offsets planned, checksums filled in by the workers
+    uint64_t *positions_sizes; // Sizing pass: bytes of each chunk in the positions section
+    const Bin_header *header;
+    int fd;
+    bool sizing;               // Measure positions only, write nothing
+    atomic_ulong next;         // Next chunk to take
+    atomic_int failed;
+} Save_job;
+
+/* Writes the buffer, whole 8-byte words since IO_BUFFER_SIZE and every padded region are */
+static void chunk_flush(Chunk_writer *w)
+{
+    w->checksum = checksum_words(w->checksum, w->buffer, w->len);
+    for (size_t done = 0; done < w->len;)
+    {
+        ssize_t n = pwrite(w->fd, w->buffer + done, w->len - done, w->offset + done);
+        if (n <= 0)
+        {
+            w->failed = true;
+            break;
+        }
+        done += n;
+    }
+    w->offset += w->len;
+    w->len = 0;
+}
+
+static void chunk_begin(Chunk_writer *w, uint64_t offset)
+{
+    w->offset = offset;
+    w->len = 0;
+    w->size = 0;
+    w->checksum = 0;
+}
+
+static void chunk_write(Chunk_writer *w, const void *data, size_t len)
+{
+    const unsigned char *bytes = data;
+    w->size += len;
+    while (len)
+    {
+        size_t take = IO_BUFFER_SIZE - w->len;
+        if (take > len)
+            take = len;
+        memcpy(w->buffer + w->len, bytes, take);
+        w->len += take;
+        bytes += take;
+        len -= take;
+        if (w->len == IO_BUFFER_SIZE)
+            chunk_flush(w);
+    }
+}
+
+/* Pads the region to 8 bytes, writes the rest of it and returns its checksum */
+static uint64_t chunk_end(Chunk_writer *w)
+{
+    static const unsigned char zero[8] = {0};
+    if (w->size % 8)
+        chunk_write(w, zero, 8 - w->size % 8);
+    chunk_flush(w);
+    return w->checksum;
+}
+
+/* Sizing pass: bytes chunk c takes in the positions section */
+static Status size_chunk(Save_job *job, uint64_t c, Sub_node **scratch, uint32_t *scratch_size)
+{
+    const Bin_chunk *chunk = &job->chunks[c];
+    uint64_t size = 0;
+    for (uint64_t i = chunk->first_term; i < chunk->first_term + chunk->term_count; i++)
+    {
+        const Sub_node *subs = postings_get(job->nodes[i], scratch, scratch_size);
+        if (subs == NULL)
+            return FAILURE;
+        size += positions_block_size(job->nodes[i], subs);
+    }
+    job->positions_sizes[c] = (size + 7) & ~(uint64_t)7;
+    return SUCCESS;
+}
+
+/* Writes chunk c's dictionary entries, word bytes, postings and positions at their planned offsets */
+static Status save_chunk(Save_job *job, uint64_t c, Chunk_writer *w, Sub_node **scratch, uint32_t *scratch_size)
+{
+    const Bin_header *header = job->header;
+    Bin_chunk *chunk = &job->chunks[c];
+    Main_node **nodes = job->nodes + chunk->first_term;
+    const uint64_t *sizes = job->sizes + chunk->first_term;
+    bool positional = job->hash->positional;
+
+    /* Term dictionary, offsets continue from where the chunk starts in each section */
+    chunk_begin(w, header->terms_offset + chunk->first_term * sizeof(Bin_term));
+    uint64_t word_offset = chunk->strings_offset, posting_offset = chunk->postings_offset;
+    uint64_t block = chunk->positions_offset / 4;
+    for (uint64_t i = 0; i < chunk->term_count; i++)
+    {
+        Main_node *node = nodes[i];
+        Bin_term term = {node->hash, posting_offset, (uint32_t)word_offset, node->word_len, node->file_count, (uint32_t)block};
+        chunk_write(w, &term, sizeof(term));
+        word_offset += node->word_len;
+        posting_offset += sizes[i];
+        if (positional)
+        {
+            const Sub_node *subs = postings_get(node, scratch, scratch_size);
+            if (subs == NULL)
+                return FAILURE;
+            block += positions_block_size(node, subs) / 4;
+        }
+    }
+    chunk->checksum[0] = chunk_end(w);
+
+    /* Strings */
+    chunk_begin(w, header->strings_offset + chunk->strings_offset);
+    for (uint64_t i = 0; i < chunk->term_count; i++)
+        chunk_write(w, nodes[i]->word, nodes[i]->word_len);
+    chunk->checksum[1] = chunk_end(w);
+
+    /* Postings */
+    chunk_begin(w, header->postings_offset + chunk->postings_offset);
+    for (uint64_t i = 0; i < chunk->term_count; i++)
+        chunk_write(w, nodes[i]->packed, sizes[i]);
+    chunk->checksum[2] = chunk_end(w);
+
+    /* Positions, offsets rebased so each word's varints are contiguous */
+    chunk_begin(w, header->positions_offset + chunk->positions_offset);
+    for (uint64_t i = 0; positional && i < chunk->term_count; i++)
+    {
+        const Main_node *node = nodes[i];
+        const Positions_t *pos = node->positions;
+        const Sub_node *subs = postings_get(node, scratch, scratch_size);
+        uint64_t start = w->size;
+        uint32_t offset = 0;
+
+        if (subs == NULL)
+            return FAILURE;
+        for (uint32_t j = 0; j < node->file_count; j++)
+        {
+            chunk_write(w, &offset, sizeof(offset));
+            offset += positions_span(pos->data + pos->offsets[j], subs[j].word_count);
+        }
+        for (uint32_t j = 0; j < node->file_count; j++)
+            chunk_write(w, pos->data + pos->offsets[j], positions_span(pos->data + pos->offsets[j], subs[j].word_count));
+
+        static const unsigned char zero[4] = {0};
+        chunk_write(w, zero, (start + positions_block_size(node, subs)) - w->size); // Align the next block
+    }
+    chunk->checksum[3] = chunk_end(w);
+
+    return w->failed ? FAILURE : SUCCESS;
+}
+
+static void *save_worker(void *arg)
+{
+    Save_job *job = arg;
+    Chunk_writer w = {.fd = job->fd};
+    Sub_node *scratch = NULL; // Word counts of a packed word, for its positions
+    uint32_t scratch_size = 0;
+
+    if (!job->sizing && (w.buffer = aligned_alloc(4096, IO_BUFFER_SIZE)) == NULL)
+        atomic_store(&job->failed, 1);
+
+    uint64_t c;
+    while (!atomic_load(&job->failed) && (c = atomic_fetch_add(&job->next, 1)) < job->header->chunk_count)
+    {
+        Status status = job->sizing ? size_chunk(job, c, &scratch, &scratch_size) : save_chunk(job, c, &w, &scratch, &scratch_size);
+        if (status == FAILURE)
+            atomic_store(&job->failed, 1);
+    }
+
+    free(scratch);
+    free(w.buffer);
+    return NULL;
+}
+
+/* Splits the words into runs of about equal bytes, at least INDEX_CHUNK_BYTES and at most INDEX_MAX_CHUNKS of them */
+static Bin_chunk *plan_chunks(Main_node **nodes, uint64_t *sizes, uint64_t count, uint64_t *chunk_count)
+{
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        sizes[i] = nodes[i]->packed ? postings_size(nodes[i]) : 0;
+        total += sizeof(Bin_term) + nodes[i]->word_len + sizes[i];
+    }
+    uint64_t target = total / INDEX_MAX_CHUNKS + 1;
+    if (target < INDEX_CHUNK_BYTES)
+        target = INDEX_CHUNK_BYTES;
+
+    Bin_chunk *chunks = calloc(total / target + 2, sizeof(Bin_chunk));
+    if (chunks == NULL)
+        return NULL;
+
+    uint64_t n = 0, bytes = 0;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        bytes += sizeof(Bin_term) + nodes[i]->word_len + sizes[i];
+        chunks[n].term_count++;
+        if (bytes >= target && i + 1 < count) // Next word opens a chunk
+        {
+            chunks[++n].first_term = i + 1;
+            bytes = 0;
+        }
+    }
+    *chunk_count = n + 1;
+    return chunks;
+}
+
+/* Writes every chunk on its own thread, then the chunk table, then renames the file into place */
+Status save_index(Hash_t *hash, const char *file_name)
+{
+    Stats_timer timer;
+    STAT_START(timer);
+    if (postings_pack_all(hash) == FAILURE) // The file stores every word packed
+        return FAILURE;
+
+    Save_job job = {.hash = hash, .nodes = malloc((hash->count + 1) * sizeof(Main_node *)),
+                    .sizes = malloc((hash->count + 1) * sizeof(uint64_t))};
+    uint64_t count = 0;
+    for (Main_node *node = job.nodes && job.sizes ? hash->head : NULL; node; node = node->m_link)
+        job.nodes[count++] = node;
+
+    Bin_header header;
+    index_header_init(&header, hash->docs.count, hash->positional, hash->normalize);
+    header.term_count = count;
+    job.header = &header;
+    if (job.nodes == NULL || job.sizes == NULL || (job.chunks = plan_chunks(job.nodes, job.sizes, count, &header.chunk_count)) == NULL ||
+        (job.positions_sizes = calloc(header.chunk_count, sizeof(uint64_t))) == NULL)
+    {
+        free(job.chunks);
+        free(job.sizes);
+        free(job.nodes);
+        return FAILURE;
+    }
+
+    /* Sizing pass, then every chunk's place in each section */
+    if (hash->positional)
+    {
+        job.sizing = true;
+        run_threads(index_threads(header.chunk_count), save_worker, &job, 0);
+        job.sizing = false;
+        atomic_store(&job.next, 0);
+    }
+    for (uint64_t c = 0; c < header.chunk_count; c++)
+    {
+        Bin_chunk *chunk = &job.chunks[c];
+        chunk->strings_offset = header.strings_size;
+        chunk->postings_offset = header.postings_size;
+        chunk->positions_offset = header.positions_size;
+        uint64_t strings = 0, postings = 0;
+        for (uint64_t i = chunk->first_term; i < chunk->first_term + chunk->term_count; i++)
+        {
+            strings += job.nodes[i]->word_len;
+            postings += job.sizes[i];
+            header.posting_count += job.nodes[i]->file_count;
+        }
+        header.strings_size += (strings + 7) & ~(uint64_t)7;
+        header.postings_size += (postings + 7) & ~(uint64_t)7;
+        header.positions_size += job.positions_sizes[c];
+    }
+
+    char temp_name[PATH_MAX + 8];
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", file_name); // Replace atomically via rename()
+
+    FILE *fptr = NULL;
+    if (header.strings_size > UINT32_MAX || header.positions_size / 4 > UINT32_MAX) // Bin_term fields are 32-bit
+        fprintf(stderr, "Error: Index '%s' is too large for the .bin format\n", file_name);
+    else if (!atomic_load(&job.failed) && (fptr = fopen(temp_name, "wb")) == NULL) // Failed: a word could not be decoded
+        fprintf(stderr, "Error: Unable to open '%s' file\n", temp_name);
+    if (fptr == NULL)
+    {
+        free(job.positions_sizes);
+        free(job.chunks);
+        free(job.sizes);
+        free(job.nodes);
+        return FAILURE;
+    }
+    setvbuf(fptr, NULL, _IOFBF, IO_BUFFER_SIZE); // Large sequential writes
+
+    /* Header placeholder and document table through stdio */
+    Section_writer w = {.fptr = fptr, .failed = false};
+    section_write(&w, &header, sizeof(header)); // Placeholder, rewritten at the end
+    header.docs_offset = sizeof(header);
+    write_doc_section(&w, &hash->docs);
+    header.docs_size = w.size;
+    header.checksum[0] = w.checksum;
+
+    header.terms_offset = header.docs_offset + header.docs_size;
+    header.terms_size = count * sizeof(Bin_term);
+    header.strings_offset = header.terms_offset + header.terms_size;
+    header.postings_offset = header.strings_offset + header.strings_size;
+    header.positions_offset = header.postings_offset + header.postings_size;
+    header.chunks_offset = header.positions_offset + header.positions_size;
+
+    /* Chunks in parallel, each at its own offsets */
+    if (fflush(fptr) != 0)
+        w.failed = true;
+    job.fd = fileno(fptr);
+    run_threads(index_threads(header.chunk_count), save_worker, &job, 0);
+    if (atomic_load(&job.failed))
+        w.failed = true;
+
+    /* Chunk table last, once every checksum is known */
+    if (fseek(fptr, header.chunks_offset, SEEK_SET) != 0)
+        w.failed = true;
+    write_chunk_table(&w, &header, job.chunks);
+
+    free(job.positions_sizes);
+    free(job.chunks);
+    free(job.sizes);
+    free(job.nodes);
+    if (commit_index(&w, &header, temp_name, file_name) == FAILURE)
+        return FAILURE;
+    STAT_STOP(timer, PHASE_SAVE);
+
+    printf("INFO: Database saved successfully in index file '%s'\n\n", file_name);
+    return SUCCESS;
+}
+
+/* ------------------ Loading ------------------ */
+
+typedef struct load_job
+{
+    Hash_t *hash;
+    const Bin_header *header;
+    const unsigned char *base;
+    const Bin_chunk *chunks;
+    Main_node **firsts;  // Per chunk: its words, linked in order
+    Main_node **lasts;
+    bool positional;
+    bool verify;         // Also checksum the postings and positions of every chunk
+    atomic_ulong next;   // Next chunk to take
+    atomic_int failed;
+} Load_job;
+
+typedef struct load_worker
+{
+    Load_job *job;
+    Arena_t arena;       // Nodes of the chunks this thread loads, adopted by the table afterwards
+    String_pool strings; // Their words, likewise
+} Load_worker;
+
+static bool section_ok(uint64_t offset, uint64_t size, size_t file_size)
+{
+    return offset % 8 == 0 && offset >= sizeof(Bin_header) && offset <= file_size && size <= file_size - offset;
+}
+
+static Status validate_header(const Bin_header *header, size_t file_size, const unsigned char *base)
+{
+    if (memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0)
+        return FAILURE;
+    if (header->version != INDEX_VERSION || header->header_size != sizeof(Bin_header))
+    {
+        fprintf(stderr, " ERROR: Unsupported index version %u\n", header->version);
+        return FAILURE;
+    }
+    if (checksum_words(0, header, offsetof(Bin_header, header_checksum)) != header->header_checksum)
+        return FAILURE;
+
+    if (!section_ok(header->docs_offset, header->docs_size, file_size) ||
+        !section_ok(header->chunks_offset, header->chunk_count * sizeof(Bin_chunk), file_size) ||
+        !section_ok(header->terms_offset, header->terms_size, file_size) ||
+        !section_ok(header->strings_offset, header->strings_size, file_size) ||
+        !section_ok(header->postings_offset, header->postings_size, file_size))
+        return FAILURE;
+
+    if (header->doc_count * sizeof(Bin_doc) > header->docs_size || header->chunk_count == 0 ||
+        header->chunk_count > INDEX_MAX_CHUNKS || header->term_count > header->terms_size / sizeof(Bin_term))
+        return FAILURE;
+
+    if (checksum_words(0, base + header->docs_offset, header->docs_size) != header->checksum[0] ||
+        checksum_words(0, base + header->chunks_offset, header->chunk_count * sizeof(Bin_chunk)) != header->checksum[1])
+        return FAILURE;
+
+    if ((header->flags & INDEX_POSITIONS) ? !section_ok(header->positions_offset, header->positions_size, file_size) : header->positions_size != 0)
+        return FAILURE;
+
+    /* Chunks cover the dictionary in order, and their regions follow each other in every section */
+    const Bin_chunk *chunks = (const Bin_chunk *)(base + header->chunks_offset);
+    uint64_t first = 0;
+    for (uint64_t c = 0; c < header->chunk_count; c++)
+    {
+        const Bin_chunk *chunk = &chunks[c];
+        const Bin_chunk *prev = c ? chunk - 1 : NULL;
+        if (chunk->first_term != first || chunk->term_count > header->term_count - first ||
+            (chunk->strings_offset | chunk->postings_offset | chunk->positions_offset) % 8 ||
+            chunk->strings_offset > header->strings_size || chunk->postings_offset > header->postings_size ||
+            chunk->positions_offset > header->positions_size)
+            return FAILURE;
+        if (prev ? chunk->strings_offset < prev->strings_offset || chunk->postings_offset < prev->postings_offset ||
+                       chunk->positions_offset < prev->positions_offset
+                 : chunk->strings_offset || chunk->postings_offset || chunk->positions_offset)
+            return FAILURE;
+        first += chunk->term_count;
+    }
+    return first == header->term_count ? SUCCESS : FAILURE;
+}
+
+/* Puts a node in its slot of a table sized for every word; threads loading other chunks may probe alongside */
+static Status claim_slot(Hash_t *hash, Main_node *node)
+{
+    size_t mask = hash->capacity - 1;
+    for (size_t i = node->hash & mask;; i = (i + 1) & mask)
+    {
+        Main_node *seen = __atomic_load_n(&hash->table[i], __ATOMIC_ACQUIRE); // Only empty slots are worth a locked exchange
+        if (seen == NULL && __atomic_compare_exchange_n(&hash->table[i], &seen, node, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+            return SUCCESS;
+        if (seen->hash == node->hash && seen->word_len == node->word_len && memcmp(seen->word, node->word, node->word_len) == 0)
+            return DUPLICATE;
+    }
+}
+
+/* Checks chunk c and builds its main nodes; sub nodes stay in the mapping */
+static Status load_chunk(Load_worker *worker, uint64_t c)
+{
+    Load_job *job = worker->job;
+    const Bin_header *header = job->header;
+    const Bin_chunk *chunk = &job->chunks[c];
+    const Bin_chunk *next = c + 1 < header->chunk_count ? chunk + 1 : NULL;
+    const Bin_term *terms = (const Bin_term *)(job->base + header->terms_offset);
+    const char *strings = (const char *)(job->base + header->strings_offset);
+    const uint8_t *postings = job->base + header->postings_offset;
+    uint32_t *positions = (uint32_t *)(job->base + header->positions_offset);
+
+    uint64_t strings_end = next ? next->strings_offset : header->strings_size;
+    uint64_t postings_end = next ? next->postings_offset : header->postings_size;
+    uint64_t positions_end = next ? next->positions_offset : header->positions_size;
+    if (checksum_words(0, terms + chunk->first_term, chunk->term_count * sizeof(Bin_term)) != chunk->checksum[0] ||
+        checksum_words(0, strings + chunk->strings_offset, strings_end - chunk->strings_offset) != chunk->checksum[1])
+        return FAILURE;
+    if (job->verify && (checksum_words(0, postings + chunk->postings_offset, postings_end - chunk->postings_offset) != chunk->checksum[2] ||
+                        checksum_words(0, (const uint8_t *)positions + chunk->positions_offset, positions_end - chunk->positions_offset) != chunk->checksum[3]))
+        return FAILURE;
+
+    Main_node *first = NULL, *last = NULL;
+    for (uint64_t i = chunk->first_term; i < chunk->first_term + chunk->term_count; i++)
+    {
+        const Bin_term *term = &terms[i];
+        uint64_t end = i + 1 < header->term_count ? terms[i + 1].posting_offset : header->postings_size; // Words are stored back to back
+        if (term->word_len == 0 || term->word_len > MAX_WORD_LEN ||
+            (uint64_t)term->word_offset + term->word_len > header->strings_size ||
+            term->posting_offset > end || end > header->postings_size ||
+            postings_check(postings + term->posting_offset, end - term->posting_offset, term->file_count, header->doc_count) == FAILURE)
+            return FAILURE;
+
+        Main_node *node = arena_alloc(&worker->arena, sizeof(Main_node));
+        if (node == NULL)
+            return FAILURE;
+
+        node->word = pool_add(&worker->strings, strings + term->word_offset, term->word_len); // NUL-terminated copy
+        if (node->word == NULL)
+            return FAILURE;
+        node->word_len = term->word_len;
+        node->hash = term->hash;
+        node->file_count = term->file_count;
+        node->capacity = 0;
+        node->s_list = NULL;
+        node->packed = postings + term->posting_offset; // Decoded from the mapping on demand
+        node->positions = NULL;
+        node->m_link = NULL;
+
+        if (job->positional) // Offsets and varints stay in the mapping too
+        {
+            if (((uint64_t)term->positions + term->file_count) * sizeof(uint32_t) > header->positions_size ||
+                positions_attach(&worker->arena, node) == FAILURE)
+                return FAILURE;
+            node->positions->offsets = positions + term->positions;
+            node->positions->data = (uint8_t *)(positions + term->positions + term->file_count);
+        }
+
+        if (claim_slot(job->hash, node) != SUCCESS)
+            return FAILURE;
+        if (last)
+            last->m_link = node;
+        else
+            first = node;
+        last = node;
+    }
+
+    job->firsts[c] = first;
+    job->lasts[c] = last;
+    return SUCCESS;
+}
+
+static void *load_worker(void *arg)
+{
+    Load_worker *worker = arg;
+    Load_job *job = worker->job;
+
+    uint64_t c;
+    while (!atomic_load(&job->failed) && (c = atomic_fetch_add(&job->next, 1)) < job->header->chunk_count)
+    {
+        if (load_chunk(worker, c) == FAILURE)
+            atomic_store(&job->failed, 1);
+    }
+    return NULL;
+}
+
+/* Builds the document table, then the main nodes of every chunk on one thread per core */
+static Status load_sections(Hash_t *hash, const Bin_header *header, const unsigned char *base, bool verify_postings)
+{
+    /* Document table */
+    const Bin_doc *docs = (const Bin_doc *)(base + header->docs_offset);
+    const char *names = (const char *)(docs + header->doc_count);
+    uint64_t names_size = header->docs_size - header->doc_count * sizeof(Bin_doc);
+    char file_name_buf[PATH_MAX];
+
+    for (uint32_t i = 0; i < header->doc_count; i++)
+    {
+        if (docs[i].name_len >= PATH_MAX || (uint64_t)docs[i].name_offset + docs[i].name_len > names_size)
+            return FAILURE;
+        if (docs[i].name_len == 0) // Removed file, ID stays reserved
+        {
+            if (doc_table_add_removed(&hash->docs) != i)
+                return FAILURE;
+            continue;
+        }
+        memcpy(file_name_buf, names + docs[i].name_offset, docs[i].name_len);
+        file_name_buf[docs[i].name_len] = '\0';
+
+        if (doc_table_add(&hash->docs, &hash->arena, file_name_buf) != i) // IDs must come back unchanged
+            return FAILURE;
+        doc_table_set_length(&hash->docs, i, docs[i].length);
+    }
+
+    /* Term dictionary -> main nodes borrowing their sub nodes from the mapping */
+    if (reserve_hash(hash, header->term_count) == FAILURE) // Size the table once, chunks fill it concurrently
+        return FAILURE;
+
+    bool positional = header->flags & INDEX_POSITIONS;
+    if (hash->positional && !positional)
+        fprintf(stderr, "INFO: Index has no word positions, phrase and NEAR queries are disabled\n");
+    hash->positional = positional;
+
+    unsigned normalize = (header->flags >> INDEX_NORMALIZE_SHIFT) & NORM_ALL; // 0 for indexes older than normalization
+    char name[NORM_NAME_SIZE];
+    if (normalize != hash->normalize)
+        fprintf(stderr, "INFO: Index words are normalized as '%s', queries follow it\n", normalize_name(normalize, name));
+    hash->normalize = normalize;
+
+    Load_job job = {.hash = hash, .header = header, .base = base, .positional = positional, .verify = verify_postings,
+                    .chunks = (const Bin_chunk *)(base + header->chunks_offset),
+                    .firsts = calloc(header->chunk_count, sizeof(Main_node *)),
+                    .lasts = calloc(header->chunk_count, sizeof(Main_node *))};
+    Load_worker workers[MAX_THREADS];
+    int threads = index_threads(header->chunk_count);
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].job = &job;
+        arena_init(&workers[t].arena);
+        pool_init(&workers[t].strings);
+    }
+    if (job.firsts && job.lasts)
+        run_threads(threads, load_worker, workers, sizeof(Load_worker));
+    else
+        atomic_store(&job.failed, 1);
+
+    for (int t = 0; t < threads; t++) // The table owns every node from here on, even after a failure
+    {
+        arena_adopt(&hash->arena, &workers[t].arena);
+        pool_adopt(&hash->strings, &workers[t].strings);
+    }
+    for (uint64_t c = 0; !atomic_load(&job.failed) && c < header->chunk_count; c++) // Insertion order, chunk by chunk
+    {
+        if (job.firsts[c] == NULL)
+            continue;
+        if (hash->tail)
+            hash->tail->m_link = job.firsts[c];
+        else
+            hash->head = job.firsts[c];
+        hash->tail = job.lasts[c];
+    }
+    hash->count = header->term_count;
+    hash->dict.stale = true;
+
+    free(job.firsts);
+    free(job.lasts);
+    return atomic_load(&job.failed) ? FAILURE : SUCCESS;
+}
+
+Status load_index(Hash_t *hash, const char *file_name, File_list **head, bool verify_postings)
+{
+    if (hash->count || hash->docs.count || hash->map) // Only into an empty database
+    {
+        fprintf(stderr, " ERROR: Database is not empty\n");
+        return FAILURE;
+    }
+
+    Stats_timer timer;
+    STAT_START(timer);
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: Unable to open '%s' file\n", file_name);
+        return FAILURE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(Bin_header))
+    {
+        fprintf(stderr, " ERROR: %s file is not an INDEX file\n", file_name);
+        close(fd);
+        return FAILURE;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "Error: Unable to map '%s' file\n", file_name);
+        return FAILURE;
+    }
+
+    const unsigned char *base = map;
+    const Bin_header *header = map;
+
+    if (validate_header(header, st.st_size, base) == FAILURE)
+    {
+        fprintf(stderr, " ERROR: %s file is not a valid INDEX file (bad header or checksum)\n", file_name);
+        munmap(map, st.st_size);
+        return FAILURE;
+    }
+
+    hash->map = map; // From here on free_hash() releases the mapping
+    hash->map_size = st.st_size;
+
+    if (load_sections(hash, header, base, verify_postings) == FAILURE)
+    {
+        fprintf(stderr, " ERROR: %s file is not a valid INDEX file (corrupt dictionary, postings or chunk checksum)\n", file_name);
+        reset_hash(hash); // Drop the partial database and the mapping
+        return FAILURE;
+    }
+    STAT_STOP(timer, PHASE_LOAD);
+
+    remove_indexed_files(head, &hash->docs, file_name); // Files already indexed are not indexed again
+    return SUCCESS;
+}
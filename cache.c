@@ -0,0 +1,355 @@
+/***********************************************************************
+ *  File Name   : cache.c
+ *  Description : Query result cache for the Inverted Search System.
+ *                Query logs repeat the same few words and combinations
+ *                over and over; every repeat used to walk the postings
+ *                and rank the files again. search_cached() sits in
+ *                front of query_run() / rank_top_k() and keeps, per
+ *                query, the number of matching files and the ranked
+ *                top files, so a repeat is a table lookup and a copy.
+ *
+ *                The key is the parsed query written out in prefix
+ *                form, so spacing, operator case and redundant
+ *                parentheses do not create separate entries. Entries
+ *                live in a chained hash table and a doubly linked
+ *                recency list; each is charged its real size and the
+ *                least recently used entries are evicted once the
+ *                budget (--cache MB) is exceeded. An entry ranked for
+ *                k files also answers any smaller k.
+ *
+ *                Every change to the index changes the document table
+ *                (build, load, add, remove, merge), whose generation
+ *                the cache remembers; on a mismatch the whole cache is
+ *                emptied before the lookup. One mutex makes the cache
+ *                safe for the batch and server worker threads; the
+ *                query itself runs outside it. The views of a segmented
+ *                index (segments.c) share their handle's cache, each
+ *                with a generation of its own.
+ *
+ *                Functions:
+ *                  - query_cache_create()
+ *                  - query_cache_clear()
+ *                  - query_cache_free()
+ *                  - query_cache_stats()
+ *                  - print_cache_stats()
+ *                  - search_cached()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <pthread.h>
+
+#define CACHE_BUCKETS 256                               // Initial bucket count, must be a power of two
+#define CACHE_KEY_SIZE (MAX_QUERY_NODES * (WORD_SIZE + 16)) // Longest canonical query
+
+typedef struct cache_entry
+{
+    struct cache_entry *chain; // Next entry in the same bucket
+    struct cache_entry *newer; // Recency list, most recent at cache->newest
+    struct cache_entry *older;
+    uint64_t hash;             // Of the key
+    size_t size;               // Bytes charged to the budget
+    uint32_t matches;          // Files matching the query
+    uint32_t shown;            // Ranked files stored in top[]
+    uint32_t top_k;            // k the ranking was done for
+    uint32_t key_len;          // Key bytes follow top[shown]
+    Ranked_doc top[];
+} Cache_entry;
+
+struct query_cache
+{
+    pthread_mutex_t lock;
+    Cache_entry **buckets;
+    size_t bucket_count; // Power of two
+    Cache_entry *newest;
+    Cache_entry *oldest;
+    uint64_t generation; // Doc_table generation the entries belong to
+    Cache_stats stats;
+};
+
+static const char *entry_key(const Cache_entry *entry)
+{
+    return (const char *)(entry->top + entry->shown);
+}
+
+/* Appends node n of the query in prefix form; words carry their length so no two queries share a key */
+static void write_key(const Query_t *query, int n, char *key, size_t *len)
+{
+    const Query_node *node = &query->nodes[n];
+    size_t room = CACHE_KEY_SIZE - *len;
+    int used = 0;
+
+    switch (node->op)
+    {
+    case Q_TERM:
+    case Q_WILDCARD:
+        used = snprintf(key + *len, room, "%c%zu:%s", node->op == Q_TERM ? 't' : 'w', strlen(node->word), node->word);
+        break;
+    case Q_AND:
+    case Q_OR:
+        used = snprintf(key + *len, room, "%c", node->op == Q_AND ? '&' : '|');
+        break;
+    case Q_NOT:
+        used = snprintf(key + *len, room, "!");
+        break;
+    case Q_PHRASE:
+        used = snprintf(key + *len, room, "\"%d", node->right);
+        break;
+    case Q_NEAR:
+        used = snprintf(key + *len, room, "~%u", node->distance);
+        break;
+    }
+    *len += used > 0 && (size_t)used < room ? (size_t)used : 0;
+
+    if (node->op == Q_PHRASE) // Its words are consecutive Q_TERM nodes
+    {
+        for (int i = 0; i < node->right; i++)
+            write_key(query, node->left + i, key, len);
+    }
+    else if (node->op != Q_TERM && node->op != Q_WILDCARD)
+    {
+        write_key(query, node->left, key, len);
+        if (node->op != Q_NOT)
+            write_key(query, node->right, key, len);
+    }
+}
+
+static void unlink_recent(Query_cache *cache, Cache_entry *entry)
+{
+    if (entry->newer)
+        entry->newer->older = entry->older;
+    else
+        cache->newest = entry->older;
+    if (entry->older)
+        entry->older->newer = entry->newer;
+    else
+        cache->oldest = entry->newer;
+}
+
+static void link_newest(Query_cache *cache, Cache_entry *entry)
+{
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    if (cache->newest)
+        cache->newest->newer = entry;
+    else
+        cache->oldest = entry;
+    cache->newest = entry;
+}
+
+static Cache_entry **find_entry(Query_cache *cache, const char *key, size_t len, uint64_t key_hash)
+{
+    Cache_entry **link = &cache->buckets[key_hash & (cache->bucket_count - 1)];
+    while (*link && ((*link)->hash != key_hash || (*link)->key_len != len || memcmp(entry_key(*link), key, len) != 0))
+        link = &(*link)->chain;
+    return link;
+}
+
+static void drop_entry(Query_cache *cache, Cache_entry *entry)
+{
+    Cache_entry **link = find_entry(cache, entry_key(entry), entry->key_len, entry->hash);
+    *link = entry->chain;
+    unlink_recent(cache, entry);
+    cache->stats.entries--;
+    cache->stats.bytes -= entry->size;
+    free(entry);
+}
+
+/* Doubles the bucket array once entries outnumber buckets; the cache keeps working if it cannot */
+static void grow_buckets(Query_cache *cache)
+{
+    size_t count = cache->bucket_count * 2;
+    Cache_entry **buckets = calloc(count, sizeof(Cache_entry *));
+    if (buckets == NULL)
+        return;
+
+    for (size_t b = 0; b < cache->bucket_count; b++)
+    {
+        Cache_entry *entry = cache->buckets[b];
+        while (entry)
+        {
+            Cache_entry *next = entry->chain;
+            entry->chain = buckets[entry->hash & (count - 1)];
+            buckets[entry->hash & (count - 1)] = entry;
+            entry = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_count = count;
+}
+
+Status query_cache_create(Hash_t *hash, size_t budget)
+{
+    if (budget == 0) // Caching disabled
+        return SUCCESS;
+
+    Query_cache *cache = calloc(1, sizeof(Query_cache));
+    if (cache == NULL)
+        return FAILURE;
+    cache->buckets = calloc(CACHE_BUCKETS, sizeof(Cache_entry *));
+    if (cache->buckets == NULL)
+    {
+        free(cache);
+        return FAILURE;
+    }
+
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->bucket_count = CACHE_BUCKETS;
+    cache->generation = hash->docs.generation;
+    cache->stats.budget = budget;
+    hash->cache = cache;
+    return SUCCESS;
+}
+
+/* Drops every entry, counters are kept */
+void query_cache_clear(Query_cache *cache)
+{
+    while (cache->oldest)
+        drop_entry(cache, cache->oldest);
+}
+
+void query_cache_free(Hash_t *hash)
+{
+    Query_cache *cache = hash->cache;
+    if (cache == NULL)
+        return;
+
+    query_cache_clear(cache);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache);
+    hash->cache = NULL;
+}
+
+void query_cache_stats(const Hash_t *hash, Cache_stats *stats)
+{
+    memset(stats, 0, sizeof(Cache_stats));
+    if (hash->cache == NULL)
+        return;
+
+    pthread_mutex_lock(&hash->cache->lock);
+    *stats = hash->cache->stats;
+    pthread_mutex_unlock(&hash->cache->lock);
+}
+
+/* One summary line on out, nothing when caching is disabled */
+void print_cache_stats(FILE *out, const Hash_t *hash)
+{
+    Cache_stats stats;
+    query_cache_stats(hash, &stats);
+    if (stats.budget == 0)
+        return;
+
+    uint64_t lookups = stats.hits + stats.misses;
+    fprintf(out, "INFO: Query cache: %llu hits, %llu misses (%.1f%% hit rate), %llu evictions, %llu invalidations, %zu entries in %zu / %zu KB\n",
+            (unsigned long long)stats.hits, (unsigned long long)stats.misses, lookups ? 100.0 * stats.hits / lookups : 0.0,
+            (unsigned long long)stats.evictions, (unsigned long long)stats.invalidations, stats.entries, stats.bytes >> 10,
+            stats.budget >> 10);
+}
+
+/* Runs the query and ranks its matches */
+static Status search_index(Hash_t *hash, const Query_t *query, uint32_t k, Ranked_doc *top, uint32_t *shown, uint32_t *matches)
+{
+    Doc_set result;
+    if (query_run(hash, query, &result) == FAILURE)
+        return FAILURE;
+    *shown = 0;
+    Stats_timer timer;
+    STAT_START(timer);
+    Status status = result.count ? rank_top_k(hash, query, &result, k, top, shown, NULL) : SUCCESS;
+    STAT_STOP(timer, PHASE_RANK);
+    *matches = result.count;
+    doc_set_free(&result);
+    return status;
+}
+
+/* Files matching the query and its k best, from the cache when the index has not changed since */
+Status search_cached(Hash_t *hash, const Query_t *query, uint32_t k, Ranked_doc *top, uint32_t *shown, uint32_t *matches)
+{
+    Query_cache *cache = hash->cache;
+    char key[CACHE_KEY_SIZE];
+    size_t len = 0;
+    uint64_t key_hash = 0;
+
+    STAT_ADD(queries, 1);
+    if (cache)
+    {
+        write_key(query, query->root, key, &len);
+        key_hash = hash_word(key, len);
+
+        pthread_mutex_lock(&cache->lock);
+        if (cache->generation != hash->docs.generation) // Index changed -> every entry is stale
+        {
+            if (cache->stats.entries)
+                cache->stats.invalidations++;
+            query_cache_clear(cache);
+            cache->generation = hash->docs.generation;
+        }
+
+        Cache_entry *entry = *find_entry(cache, key, len, key_hash);
+        if (entry && (entry->top_k >= k || entry->shown == entry->matches)) // Ranked deep enough
+        {
+            *shown = entry->shown < k ? entry->shown : k;
+            *matches = entry->matches;
+            memcpy(top, entry->top, *shown * sizeof(Ranked_doc));
+            unlink_recent(cache, entry);
+            link_newest(cache, entry);
+            cache->stats.hits++;
+            pthread_mutex_unlock(&cache->lock);
+            return SUCCESS;
+        }
+        cache->stats.misses++;
+        pthread_mutex_unlock(&cache->lock);
+    }
+
+    Status status = hash->view ? segments_search(hash, query, k, top, shown, matches) // Every segment, their best merged
+                               : search_index(hash, query, k, top, shown, matches);
+
+    size_t size = sizeof(Cache_entry) + *shown * sizeof(Ranked_doc) + len;
+    if (cache == NULL || status == FAILURE || size > cache->stats.budget / 8) // Errors and huge entries are not kept
+        return status;
+
+    Cache_entry *entry = malloc(size);
+    if (entry == NULL)
+        return status;
+    entry->hash = key_hash;
+    entry->size = size;
+    entry->matches = *matches;
+    entry->shown = *shown;
+    entry->top_k = k;
+    entry->key_len = len;
+    memcpy(entry->top, top, *shown * sizeof(Ranked_doc));
+    memcpy((char *)(entry->top + *shown), key, len);
+
+    pthread_mutex_lock(&cache->lock);
+    Cache_entry *old = *find_entry(cache, key, len, key_hash);
+    if (cache->generation != hash->docs.generation || (old && old->top_k >= k)) // Stale, or another thread stored it first
+    {
+        pthread_mutex_unlock(&cache->lock);
+        free(entry);
+        return status;
+    }
+    if (old) // Ranked for a smaller k, replaced
+        drop_entry(cache, old);
+
+    Cache_entry **link = &cache->buckets[key_hash & (cache->bucket_count - 1)];
+    entry->chain = *link;
+    *link = entry;
+    link_newest(cache, entry);
+    cache->stats.entries++;
+    cache->stats.bytes += size;
+
+    while (cache->stats.bytes > cache->stats.budget) // Least recently used go first
+    {
+        drop_entry(cache, cache->oldest);
+        cache->stats.evictions++;
+    }
+    if (cache->stats.entries > cache->bucket_count)
+        grow_buckets(cache);
+    pthread_mutex_unlock(&cache->lock);
+    return status;
+}
@@ -0,0 +1,272 @@
+/***********************************************************************
+ *  File Name   : corpus.c
+ *  Description : Synthetic corpus generator for benchmarking the
+ *                Inverted Search System at scale. Writes N text files
+ *                of about the given size into a directory. Words are
+ *                drawn from a vocabulary of V words with Zipfian
+ *                frequencies (rank r has weight 1 / r^s), which is how
+ *                word frequencies in real text fall off: a few words are
+ *                everywhere and most are rare.
+ *
+ *                The word of rank r is r written in bijective base 26
+ *                over a shuffled alphabet, so every word is distinct
+ *                and frequent words are short. Each file has its own
+ *                random stream derived from the seed, so the same
+ *                options always produce the same corpus.
+ *
+ *                With --queries N a query log is written next to the
+ *                files (queries.log). Its terms follow the same Zipf
+ *                law: half single words, the rest AND, OR and AND ...
+ *                NOT combinations. It can be fed to the benchmark suite
+ *                (benchmark.c --suite), batch mode or loadgen.
+ *
+ *                Stand-alone program, it does not link the index code:
+ *
+ *                  gcc -O2 corpus.c -o gen_corpus -lm
+ *
+ *                Usage : ./gen_corpus --out DIR [--files N] [--size BYTES[K|M]] [--vocab V]
+ *                                     [--zipf S] [--seed N] [--queries N]
+ *
+ *                Defaults: 100 files of 64K, 50000 words, s = 1.0,
+ *                seed 1, no query log. Files are named DIR/d000000.txt
+ *                and so on.
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define CORPUS_NAME_SIZE PATH_MAX // Generated file names, including the NUL
+#define CORPUS_LINE_WORDS 12    // Words per line of a generated file
+#define CORPUS_WORD_SIZE 16     // Generated words are at most 6 letters for --vocab up to 10^8
+
+static double *cdf;         // cdf[r] = P(rank <= r)
+static uint32_t vocab_size;
+static char alphabet[27];   // Shuffled letters of the seed
+
+/* splitmix64, one independent stream per file */
+static uint64_t next_random(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/* Rank of a Zipf-distributed word: binary search of the cumulative weights */
+static uint32_t next_rank(uint64_t *state)
+{
+    double u = (next_random(state) >> 11) * 0x1.0p-53;
+    uint32_t lo = 0, hi = vocab_size - 1;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (cdf[mid] < u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Word of a rank, bijective base 26: a .. z, aa .. zz, aaa ... */
+static size_t rank_word(uint32_t rank, char *word)
+{
+    char reversed[CORPUS_WORD_SIZE];
+    size_t len = 0;
+    uint64_t n = (uint64_t)rank + 1;
+    while (n)
+    {
+        n--;
+        reversed[len++] = alphabet[n % 26];
+        n /= 26;
+    }
+    for (size_t i = 0; i < len; i++)
+        word[i] = reversed[len - 1 - i];
+    word[len] = '\0';
+    return len;
+}
+
+static bool build_cdf(double exponent)
+{
+    cdf = malloc(vocab_size * sizeof(double));
+    if (cdf == NULL)
+        return false;
+
+    double sum = 0;
+    for (uint32_t r = 0; r < vocab_size; r++)
+    {
+        sum += 1.0 / pow(r + 1, exponent);
+        cdf[r] = sum;
+    }
+    for (uint32_t r = 0; r < vocab_size; r++)
+        cdf[r] /= sum;
+    cdf[vocab_size - 1] = 1.0;
+    return true;
+}
+
+static bool write_file(const char *name, uint64_t seed, uint32_t index, size_t size)
+{
+    FILE *fptr = fopen(name, "w");
+    if (fptr == NULL)
+        return false;
+
+    uint64_t state = seed ^ (0x632be59bd9b4e019ull * (index + 1));
+    char word[CORPUS_WORD_SIZE];
+    size_t written = 0;
+    uint32_t column = 0;
+
+    while (written < size)
+    {
+        size_t len = rank_word(next_rank(&state), word);
+        fputs(word, fptr);
+        fputc(++column == CORPUS_LINE_WORDS ? '\n' : ' ', fptr);
+        column %= CORPUS_LINE_WORDS;
+        written += len + 1;
+    }
+    if (column)
+        fputc('\n', fptr);
+    return fclose(fptr) == 0;
+}
+
+static bool write_queries(const char *name, uint64_t seed, uint32_t count)
+{
+    FILE *fptr = fopen(name, "w");
+    if (fptr == NULL)
+        return false;
+
+    uint64_t state = seed ^ 0x5851f42d4c957f2dull;
+    char a[CORPUS_WORD_SIZE], b[CORPUS_WORD_SIZE], c[CORPUS_WORD_SIZE];
+
+    fprintf(fptr, "# %u queries, Zipf-distributed terms\n", count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        rank_word(next_rank(&state), a);
+        rank_word(next_rank(&state), b);
+        rank_word(next_rank(&state), c);
+
+        uint32_t kind = next_random(&state) % 10; // 50% single, 20% AND, 20% OR, 10% AND NOT
+        if (kind < 5)
+            fprintf(fptr, "%s\n", a);
+        else if (kind < 7)
+            fprintf(fptr, "%s AND %s\n", a, b);
+        else if (kind < 9)
+            fprintf(fptr, "%s OR %s\n", a, b);
+        else
+            fprintf(fptr, "%s AND %s NOT %s\n", a, b, c);
+    }
+    return fclose(fptr) == 0;
+}
+
+/* Byte count with an optional K or M suffix */
+static long parse_size(const char *text)
+{
+    char *end;
+    long size = strtol(text, &end, 10);
+    if (*end == 'K' || *end == 'k')
+        size <<= 10;
+    else if (*end == 'M' || *end == 'm')
+        size <<= 20;
+    else
+        return *end == '\0' ? size : -1;
+    return end[1] == '\0' ? size : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *out = NULL;
+    long files = 100, size = 64 << 10, vocab = 50000, queries = 0;
+    double exponent = 1.0;
+    uint64_t seed = 1;
+    bool usage = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage = true;
+        else if (strcmp(argv[i], "--out") == 0)
+            out = argv[++i];
+        else if (strcmp(argv[i], "--files") == 0)
+            files = atol(argv[++i]);
+        else if (strcmp(argv[i], "--size") == 0)
+            size = parse_size(argv[++i]);
+        else if (strcmp(argv[i], "--vocab") == 0)
+            vocab = atol(argv[++i]);
+        else if (strcmp(argv[i], "--zipf") == 0)
+            exponent = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--queries") == 0)
+            queries = atol(argv[++i]);
+        else
+            usage = true;
+    }
+
+    if (usage || out == NULL || files < 1 || files > 999999 || size < 1 || vocab < 1 || vocab > 100000000 ||
+        exponent <= 0 || queries < 0)
+    {
+        fprintf(stderr, "Usage: %s --out DIR [--files N] [--size BYTES[K|M]] [--vocab V] [--zipf S] [--seed N] [--queries N]\n", argv[0]);
+        return 1;
+    }
+    if (strlen(out) + sizeof("/d000000.txt") > CORPUS_NAME_SIZE)
+    {
+        fprintf(stderr, "Error: '%s' is too long, file names must stay under %d characters\n", out, CORPUS_NAME_SIZE);
+        return 1;
+    }
+    if (mkdir(out, 0755) < 0 && errno != EEXIST)
+    {
+        perror(out);
+        return 1;
+    }
+
+    vocab_size = vocab;
+    strcpy(alphabet, "abcdefghijklmnopqrstuvwxyz");
+    uint64_t state = seed;
+    for (int i = 25; i > 0; i--) // Fisher-Yates shuffle of the letters
+    {
+        int j = next_random(&state) % (i + 1);
+        char t = alphabet[i];
+        alphabet[i] = alphabet[j];
+        alphabet[j] = t;
+    }
+    if (!build_cdf(exponent))
+    {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+
+    char name[CORPUS_NAME_SIZE + 16];
+    for (long f = 0; f < files; f++)
+    {
+        snprintf(name, sizeof(name), "%s/d%06ld.txt", out, f);
+        if (!write_file(name, seed, f, size))
+        {
+            perror(name);
+            return 1;
+        }
+    }
+    if (queries)
+    {
+        snprintf(name, sizeof(name), "%s/queries.log", out);
+        if (!write_queries(name, seed, queries))
+        {
+            perror(name);
+            return 1;
+        }
+    }
+
+    printf("Wrote %ld files of ~%ld bytes (%.1f MB), vocabulary %ld, zipf %.2f, seed %llu%s\n", files, size,
+           files * (double)size / 1e6, vocab, exponent, (unsigned long long)seed, queries ? ", plus queries.log" : "");
+    free(cdf);
+    return 0;
+}
@@ -2,13 +2,14 @@
  *  File Name   : database.c
  *  Description : Contains all major database operations for the
  *                Inverted Search System:
- *                  - Creating the inverted index
+ *                  - Creating the inverted index (one file at a time)
  *                  - Displaying the database
- *                  - Searching for words
+ *                  - Searching for words and AND / OR / NOT queries
  *                  - Saving the database to a backup file
- *                  - Loading database from a backup
+ *                  - Loading database from a backup (streaming bulk loader)
  *
  *                Functions:
+ *                  - index_file()
  *                  - create_database()
  *                  - display_database()
  *                  - search_database()
@@ -21,118 +22,123 @@
  ***********************************************************************/
 
 #include "inverted_search.h"
+#include <fcntl.h>
+#include <unistd.h>
 
-Status create_database(Hash_t *hash_array, File_list *head)
+Status index_file(Hash_t *hash, const char *file_name, uint32_t doc_id, uint32_t *length)
 {
-    while (head != NULL) // Loop through each file in the file list
+    Tokenizer_t tok;
+    Stats_timer timer;
+    *length = 0;
+    STAT_START(timer);
+    if (tokenizer_open(&tok, file_name) == FAILURE) // Map file, skipped on failure
+    {
+        fprintf(stderr, "Error : Failed to open '%s' file\n", file_name);
+        return SUCCESS;
+    }
+    STAT_STOP(timer, PHASE_OPEN);
+    STAT_ADD(files, 1);
+    STAT_ADD(file_bytes, tok.size);
+
+    const char *words[TOKEN_BATCH]; // Slices of the mapped file, split in batches so the phases can be timed apart
+    size_t lens[TOKEN_BATCH];
+    char terms[TOKEN_BATCH][WORD_SIZE]; // Normalized tokens that differ from their slice
+    size_t batch;
+    bool more = true;
+    do
     {
-        FILE *fptr = fopen(head->file_name, "r"); // Open file for reading
-        if (fptr == NULL)                         // Check file open failure
+        STAT_START(timer);
+        batch = 0;
+        while (batch < TOKEN_BATCH && (more = tokenizer_next(&tok, &words[batch], &lens[batch])))
         {
-            fprintf(stderr, "Error : Failed to open '%s' file\n", head->file_name);
-            head = head->next;
-            continue;
+            if (hash->normalize) // Stop words and bare punctuation are dropped here
+                lens[batch] = normalize_word(hash->normalize, &words[batch], lens[batch], terms[batch]);
+            batch += lens[batch] != 0;
         }
-        char buffer[WORD_SIZE];
-        while (fscanf(fptr, "%s", buffer) != EOF) // Read each word from the file
+        STAT_STOP(timer, PHASE_TOKENIZE);
+        STAT_START(timer);
+
+        for (size_t t = 0; t < batch; t++)
         {
-            int index;
+            const char *word = words[t];
+            size_t len = lens[t];
+            uint32_t position = (*length)++; // Document length for ranking, token offset for positions
+            uint64_t word_hash = hash_word(word, len); // Hash the full word
+            Main_node *main_node = lookup_word(hash, word, len, word_hash);
 
-            find_index(&index, buffer); // Find hash index for current word
+            if (main_node == NULL) // Word does not exist -> create new main node
+            {
+                main_node = create_main_node(hash, word, len);
+                if (main_node == NULL || insert_main_node(hash, main_node) == FAILURE ||
+                    (hash->positional && positions_attach(&hash->arena, main_node) == FAILURE))
+                {
+                    tokenizer_close(&tok);
+                    return FAILURE;
+                }
+            }
 
-            if (hash_array[index].m_link == NULL) // No main node exists at this index
+            if (postings_unpack(&hash->arena, main_node) == FAILURE) // Word packed by an earlier build
             {
-                Main_node *main_new_node = create_main_node(buffer);       // Create new main node
-                Sub_node *sub_new_node = create_sub_node(head->file_name); // Create sub node for file
+                tokenizer_close(&tok);
+                return FAILURE;
+            }
 
-                main_new_node->s_link = sub_new_node;     // Connect sub node
-                main_new_node->file_count = 1;            // First file occurrence
-                hash_array[index].m_link = main_new_node; // Insert into hash table
+            /* Files are indexed one at a time, so this file's sub node (if any) is the last one */
+            uint32_t last = main_node->file_count;
+            if (last && main_node->s_list[last - 1].doc_id == doc_id) // File exists -> increment count
+            {
+                main_node->s_list[last - 1].word_count++;
             }
-            else
+            else if (create_sub_node(&hash->arena, main_node, doc_id) == NULL) // New file -> append subnode
             {
-                int flag = 0; // Flag to check if word exists
-                Main_node *temp1 = hash_array[index].m_link;
-                Main_node *backup_main = NULL;
-                Main_node *prev_main = NULL;
-
-                while (temp1) // Traverse all main nodes at this index
-                {
-                    if (strcmp(buffer, temp1->word) == 0) // Word found
-                    {
-                        flag = 1;
-                        backup_main = temp1;
-                        break;
-                    }
-                    prev_main = temp1;
-                    temp1 = temp1->m_link;
-                }
+                tokenizer_close(&tok);
+                return FAILURE;
+            }
 
-                if (flag) // Word already exists in database
-                {
-                    int flag1 = 0; // Subnode file match flag
-                    Sub_node *temp2 = backup_main->s_link;
-                    Sub_node *backup_sub = NULL;
-                    Sub_node *prev_sub = NULL;
-
-                    while (temp2) // Traverse subnode list to find same file
-                    {
-                        if (strcmp(temp2->file_name, head->file_name) == 0)
-                        {
-                            flag1 = 1;
-                            backup_sub = temp2;
-                            break;
-                        }
-                        prev_sub = temp2;
-                        temp2 = temp2->s_link;
-                    }
-                    if (flag1) // File exists -> increment count
-                    {
-                        backup_sub->word_count++;
-                    }
-                    else // File does not exist -> create new subnode
-                    {
-                        Sub_node *new = create_sub_node(head->file_name);
-                        backup_main->file_count++; // Increase file count
-
-                        if (prev_sub == NULL) // Insert at beginning
-                        {
-                            backup_main->s_link = new;
-                        }
-                        else // Insert at end
-                        {
-                            prev_sub->s_link = new;
-                        }
-                    }
-                }
-                else // Word does not exist -> create new main node
-                {
-                    Main_node *main_new = create_main_node(buffer);
-                    Sub_node *sub_new = create_sub_node(head->file_name);
-
-                    main_new->s_link = sub_new;
-                    main_new->file_count = 1;
-
-                    if (prev_main == NULL) // Insert at head
-                    {
-                        // Insert at head
-                        hash_array[index].m_link = main_new;
-                    }
-                    else // Insert at end
-                    {
-                        // Insert at end
-                        prev_main->m_link = main_new;
-                    }
-                }
+            if (hash->positional && positions_add(&hash->arena, main_node, position) == FAILURE) // Token offset
+            {
+                tokenizer_close(&tok);
+                return FAILURE;
             }
         }
-        fclose(fptr);      // Close file after reading all words
+        STAT_STOP(timer, PHASE_INSERT);
+
+        if (hash->spill && hash->spill(hash) == FAILURE) // External build: a full block becomes a run, even mid-file
+        {
+            tokenizer_close(&tok);
+            return FAILURE;
+        }
+    } while (more);
+    STAT_ADD(tokens, *length);
+
+    if (tok.truncated) // Over-long tokens were indexed by their first MAX_WORD_LEN bytes
+        fprintf(stderr, "Warning : %ld word(s) in '%s' longer than %d bytes were truncated\n", tok.truncated, file_name, MAX_WORD_LEN);
+
+    tokenizer_close(&tok);
+    return SUCCESS;
+}
+
+Status create_database(Hash_t *hash, File_list *head)
+{
+    while (head != NULL) // Loop through each file in the file list
+    {
+        uint32_t length;
+        uint32_t doc_id = doc_table_add(&hash->docs, &hash->arena, head->file_name); // Intern file name
+        if (doc_id == DOC_NONE || index_file(hash, head->file_name, doc_id, &length) == FAILURE)
+            return FAILURE;
+        doc_table_set_length(&hash->docs, doc_id, length);
+
         head = head->next; // Move to next file
     }
-    return SUCCESS;
+
+    Stats_timer timer;
+    STAT_START(timer);
+    Status status = postings_pack_all(hash); // Words are final, compress their sub nodes
+    STAT_STOP(timer, PHASE_PACK);
+    return status;
 }
 
-void display_database(Hash_t *hash_array)
+void display_database(Hash_t *hash)
 {
     printf("\n======================================================================================\n");
     printf("                                DISPLAY DATABASE                                        \n");
@@ -143,46 +149,60 @@ void display_database(Hash_t *hash_array)
            "Index", "Word", "FileCount", "FileName", "WordCount");
     printf("+--------+----------------------+------------+---------------------------+-----------+\n");
 
-    for (int i = 0; i < HASH_SIZE; i++) // Loop through all hash indexes
-    {
-        Main_node *main_temp = hash_array[i].m_link;
+    Main_node *main_temp = hash->head;
+    Sub_node *scratch = NULL; // Decoded sub nodes of a packed word
+    uint32_t scratch_size = 0;
 
-        while (main_temp) // Traverse all main nodes
+    while (main_temp) // Traverse all words in insertion order
+    {
+        if (main_temp->file_count == 0) // Skip words with no subnodes
         {
-            Sub_node *sub_temp = main_temp->s_link;
-
-            if (!sub_temp) // Skip words with no subnodes
-            {
-                main_temp = main_temp->m_link;
-                continue;
-            }
+            main_temp = main_temp->m_link;
+            continue;
+        }
 
-            /* First row for each word */
-            printf("| %-6d | %-20s | %-10d | %-25s | %-9d |\n", i, main_temp->word, main_temp->file_count, sub_temp->file_name, sub_temp->word_count);
+        const Sub_node *sub_temp = postings_get(main_temp, &scratch, &scratch_size);
+        if (sub_temp == NULL)
+        {
+            fprintf(stderr, "Error: Out of memory or damaged postings while displaying the database\n");
+            break;
+        }
 
-            sub_temp = sub_temp->s_link;
+        int index;
+        find_index(&index, main_temp->word); // Category shown in the Index column
 
-            /* Additional rows */
-            while (sub_temp) // Print remaining file occurrences
-            {
-                printf("| %-6s | %-20s | %-10s | %-25s | %-9d |\n", " ", " ", " ", sub_temp->file_name, sub_temp->word_count);
+        /* First row for each word */
+        printf("| %-6d | %-20s | %-10u | %-25s | %-9u |\n", index, main_temp->word, main_temp->file_count,
+               doc_name(&hash->docs, sub_temp[0].doc_id), sub_temp[0].word_count);
 
-                sub_temp = sub_temp->s_link;
-            }
+        /* Additional rows */
+        for (uint32_t i = 1; i < main_temp->file_count; i++) // Print remaining file occurrences
+        {
+            printf("| %-6s | %-20s | %-10s | %-25s | %-9u |\n", " ", " ", " ",
+                   doc_name(&hash->docs, sub_temp[i].doc_id), sub_temp[i].word_count);
+        }
 
-            printf("+--------+----------------------+------------+---------------------------+-----------+\n");
+        printf("+--------+----------------------+------------+---------------------------+-----------+\n");
 
-            main_temp = main_temp->m_link; // Move to next word
-        }
+        main_temp = main_temp->m_link; // Move to next word
     }
+    free(scratch);
 }
 
-Status search_database(Hash_t *hash_arr, char *data)
+Status search_database(Hash_t *hash, char *data, int top_k)
 {
-    int index;
-    find_index(&index, data); // Compute index for word
+    Query_t query;
+    uint32_t shown, matches;
+    Ranked_doc *top = malloc(top_k * sizeof(Ranked_doc));
+
+    if (top == NULL || query_parse(data, hash->normalize, &query) == FAILURE ||
+        search_cached(hash, &query, top_k, top, &shown, &matches) == FAILURE) // AND / OR / NOT expression, best files only
+    {
+        free(top);
+        return FAILURE;
+    }
 
-    Main_node *main_temp = hash_arr[index].m_link;
+    bool single = query.nodes[query.root].op == Q_TERM; // Plain word search
 
     printf("\n=====================================================\n");
     printf("                  SEARCH RESULTS        \n");
@@ -190,45 +210,61 @@ Status search_database(Hash_t *hash_arr, char *data)
 
     printf("Searching for: \"%s\"\n\n", data);
 
-    while (main_temp) // Traverse main nodes
+    if (matches) // Query matched
     {
-        if (strcmp(main_temp->word, data) == 0) // Word found
-        {
-            Sub_node *sub_temp = main_temp->s_link;
+        /* Table header */
+        printf("+---------------------------+-----------+-----------+\n");
+        printf("| %-25s | %-9s | %-9s |\n", "FileName", "WordCount", "Score");
+        printf("+---------------------------+-----------+-----------+\n");
 
-            /* Table header */
-            printf("+---------------------------+-----------+\n");
-            printf("| %-25s | %-9s |\n", "FileName", "WordCount");
-            printf("+---------------------------+-----------+\n");
-
-            /* Print all file occurrences */
-            while (sub_temp)
-            {
-                printf("| %-25s | %-9d |\n", sub_temp->file_name, sub_temp->word_count);
-
-                sub_temp = sub_temp->s_link;
-            }
-
-            /* Bottom border */
-            printf("+---------------------------+-----------+\n");
+        /* Print the best files, highest BM25 score first */
+        for (uint32_t i = 0; i < shown; i++)
+        {
+            printf("| %-25s | %-9u | %-9.4f |\n", doc_name(&hash->docs, top[i].doc_id), top[i].word_count, top[i].score);
+        }
 
-            printf("\nWord '%s' found in %d file(s).\n", data, main_temp->file_count);
+        /* Bottom border */
+        printf("+---------------------------+-----------+-----------+\n");
 
-            printf("=====================================================\n");
-            return SUCCESS;
-        }
+        if (single)
+            printf("\nWord '%s' found in %u file(s).\n", data, matches);
+        else
+            printf("\nQuery matched %u file(s).\n", matches);
+        if (shown < matches)
+            printf("Showing the top %u by BM25 score.\n", shown);
 
-        main_temp = main_temp->m_link; // Move to next main node
+        printf("=====================================================\n");
+        free(top);
+        return SUCCESS;
     }
-
     /* Not found case */
-    printf("No entries found for word '%s'.\n\n", data);
+    if (single)
+        printf("No entries found for word '%s'.\n\n", data);
+    else
+        printf("No files match the query.\n\n");
     printf("=====================================================\n");
 
+    free(top);
     return SUCCESS;
 }
 
-Status save_database(Hash_t *hash_array, char *file_name)
+/* Writes text and its ';': '\\', ';', '#' and newlines inside it get a backslash in front (see reader_field) */
+static void write_field(FILE *fptr, const char *text)
+{
+    for (size_t n; *text; text += n)
+    {
+        n = strcspn(text, "\\;#\n");
+        fwrite(text, 1, n, fptr);
+        if (text[n]) // Escape the separator
+        {
+            fputc('\\', fptr);
+            fputc(text[n++], fptr);
+        }
+    }
+    fputc(';', fptr);
+}
+
+Status save_database(Hash_t *hash, char *file_name)
 {
     if (validate_file_extension(file_name) == FAILURE) // Validate extension
     {
@@ -237,33 +273,402 @@ Status save_database(Hash_t *hash_array, char *file_name)
     }
 
     FILE *fptr = fopen(file_name, "w+"); // Open file for writing
-    for (int i = 0; i < HASH_SIZE; i++)  // Loop through all indexes
+    if (fptr == NULL)
     {
-        Main_node *main_temp = hash_array[i].m_link;
-        while (main_temp) // Traverse all main nodes
-        {
-            Sub_node *sub_temp = main_temp->s_link;
+        fprintf(stderr, "Error: Unable to open '%s' file\n", file_name);
+        return FAILURE;
+    }
+    Stats_timer timer;
+    STAT_START(timer);
 
-            fprintf(fptr, "#%d;%s;%d;", i, main_temp->word, main_temp->file_count);
+    Main_node *main_temp = hash->head;
+    Sub_node *scratch = NULL; // Decoded sub nodes of a packed word
+    uint32_t scratch_size = 0;
+    while (main_temp) // Traverse all words in insertion order
+    {
+        const Sub_node *sub_temp = postings_get(main_temp, &scratch, &scratch_size);
+        if (sub_temp == NULL && main_temp->file_count)
+        {
+            fprintf(stderr, "Error: Out of memory or damaged postings while saving '%s'\n", file_name);
+            free(scratch);
+            fclose(fptr);
+            return FAILURE;
+        }
+        int index;
+        find_index(&index, main_temp->word); // Legacy first-letter category
 
-            while (sub_temp) // Write all subnodes
-            {
-                fprintf(fptr, "%s;%d;", sub_temp->file_name, sub_temp->word_count);
-                sub_temp = sub_temp->s_link;
-            }
+        fprintf(fptr, "#%d;", index);
+        write_field(fptr, main_temp->word); // Words and names may hold the separators, e.g. "com;.exe"
+        fprintf(fptr, "%u;", main_temp->file_count);
 
-            fprintf(fptr, "#\n");
-            main_temp = main_temp->m_link;
+        for (uint32_t i = 0; i < main_temp->file_count; i++) // Write all subnodes, IDs mapped back to names
+        {
+            write_field(fptr, doc_name(&hash->docs, sub_temp[i].doc_id));
+            fprintf(fptr, "%u;", sub_temp[i].word_count);
         }
+
+        fprintf(fptr, "#\n");
+        main_temp = main_temp->m_link;
     }
 
+    free(scratch);
     fclose(fptr); // Close backup file
+    STAT_STOP(timer, PHASE_SAVE);
+    if (hash->positional) // Text format has no place for them
+        printf("INFO: Word positions are not saved in text backups, use a .bin index to keep them\n");
     printf("INFO: Database saved successfully in file '%s'\n\n", file_name);
 
     return SUCCESS;
 }
 
-Status update_database(Hash_t *hash_array, char *backup, File_list **head)
+/* ------------------ Streaming backup reader ------------------ */
+
+typedef struct backup_reader
+{
+    int fd;
+    char *buf;  // LOAD_BUFFER_SIZE bytes
+    size_t len; // Valid bytes in buf
+    size_t pos; // Parse position
+    bool eof;
+    Sub_node *subs;     // One record's sub nodes before they are packed
+    uint32_t subs_size; // Entries allocated in subs
+} Backup_reader;
+
+static bool reader_fill(Backup_reader *r)
+{
+    if (r->eof)
+        return false;
+
+    memmove(r->buf, r->buf + r->pos, r->len - r->pos); // Keep the unparsed tail
+    r->len -= r->pos;
+    r->pos = 0;
+
+    ssize_t n = read(r->fd, r->buf + r->len, LOAD_BUFFER_SIZE - r->len);
+    if (n <= 0)
+    {
+        r->eof = true;
+        return false;
+    }
+    r->len += n;
+    return true;
+}
+
+/* Copies bytes up to delim into out (at most cap - 1 of them) and consumes the delimiter. A backslash before
+   '\\', ';', '#' or a newline stands for that byte (write_field); any other backslash is an ordinary byte */
+static bool reader_field(Backup_reader *r, char delim, char *out, size_t cap, size_t *out_len)
+{
+    size_t len = 0;
+    while (1)
+    {
+        char *start = r->buf + r->pos;
+        char *end = memchr(start, delim, r->len - r->pos);
+        char *escape = memchr(start, '\\', (end ? end : r->buf + r->len) - start);
+        char *stop = escape ? escape : end;
+        size_t take = (stop ? (size_t)(stop - r->buf) : r->len) - r->pos;
+
+        if (len + take >= cap) // Field too long for its destination
+            return false;
+        memcpy(out + len, r->buf + r->pos, take);
+        len += take;
+        r->pos += take;
+
+        if (escape)
+        {
+            if (r->pos + 1 == r->len && !reader_fill(r)) // Escaped byte still to be read
+                return false;
+            char next = r->buf[r->pos + 1];
+            bool escaped = next == '\\' || next == ';' || next == '#' || next == '\n';
+            if (len + 1 >= cap)
+                return false;
+            out[len++] = escaped ? next : '\\';
+            r->pos += escaped ? 2 : 1;
+            continue;
+        }
+        if (end) // Delimiter found
+        {
+            r->pos++;
+            out[len] = '\0';
+            if (out_len)
+                *out_len = len;
+            return true;
+        }
+        if (!reader_fill(r))
+            return false;
+    }
+}
+
+static bool reader_number(Backup_reader *r, uint32_t *value)
+{
+    char digits[16];
+    size_t len;
+    if (!reader_field(r, ';', digits, sizeof(digits), &len) || len == 0)
+        return false;
+
+    uint64_t v = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (!isdigit((unsigned char)digits[i]))
+            return false;
+        v = v * 10 + (digits[i] - '0');
+        if (v > UINT32_MAX)
+            return false;
+    }
+    *value = (uint32_t)v;
+    return true;
+}
+
+/* Consumes ch (after skipping newlines); returns false at end of input */
+static bool reader_expect(Backup_reader *r, char ch)
+{
+    while (1)
+    {
+        while (r->pos < r->len && r->buf[r->pos] == '\n')
+            r->pos++;
+        if (r->pos < r->len)
+            break;
+        if (!reader_fill(r))
+            return false;
+    }
+    if (r->buf[r->pos] != ch)
+        return false;
+    r->pos++;
+    return true;
+}
+
+/* Parses one "#index;word;count;file;n;...#" record into the database */
+/* Sub nodes ordered by document ID, as queries expect */
+static int compare_doc_id(const void *a, const void *b)
+{
+    uint32_t x = ((const Sub_node *)a)->doc_id, y = ((const Sub_node *)b)->doc_id;
+    return (x > y) - (x < y);
+}
+
+static Status load_record(Hash_t *hash, Backup_reader *r)
+{
+    char word[WORD_SIZE];
+    char file_name[PATH_MAX];
+    char index[16];
+    size_t len;
+    uint32_t file_count, word_count;
+
+    if (!reader_field(r, ';', index, sizeof(index), NULL) || // Legacy category, ignored
+        !reader_field(r, ';', word, sizeof(word), &len) || len == 0 ||
+        !reader_number(r, &file_count) || file_count == 0)
+        return FAILURE;
+
+    Main_node *node = create_main_node(hash, word, len);
+    if (node == NULL)
+        return FAILURE;
+
+    if (file_count > r->subs_size) // Record larger than any before it
+    {
+        Sub_node *grown = realloc(r->subs, file_count * sizeof(Sub_node));
+        if (grown == NULL)
+            return FAILURE;
+        r->subs = grown;
+        r->subs_size = file_count;
+    }
+    Sub_node *s_list = r->subs;
+
+    for (uint32_t i = 0; i < file_count; i++) // Read subnode data
+    {
+        if (!reader_field(r, ';', file_name, sizeof(file_name), NULL) || !reader_number(r, &word_count))
+            return FAILURE;
+
+        uint32_t doc_id = doc_table_add(&hash->docs, &hash->arena, file_name); // Interned once per distinct name
+        if (doc_id == DOC_NONE)
+            return FAILURE;
+
+        s_list[i].doc_id = doc_id;
+        s_list[i].word_count = word_count;
+        doc_table_set_length(&hash->docs, doc_id, hash->docs.lengths[doc_id] + word_count); // Length = sum of counts
+    }
+    for (uint32_t i = 1; i < file_count; i++) // Only lists that contradict the others are out of order (order_documents)
+    {
+        if (s_list[i - 1].doc_id >= s_list[i].doc_id)
+        {
+            qsort(s_list, file_count, sizeof(Sub_node), compare_doc_id);
+            break;
+        }
+    }
+    for (uint32_t i = 1; i < file_count; i++)
+    {
+        if (s_list[i - 1].doc_id == s_list[i].doc_id)
+        {
+            fprintf(stderr, " ERROR: File '%s' listed twice for word '%s' in backup\n", doc_name(&hash->docs, s_list[i].doc_id), word);
+            return FAILURE;
+        }
+    }
+
+    if (postings_pack_list(&hash->arena, node, s_list, file_count) == FAILURE) // Stored compressed straight away
+        return FAILURE;
+
+    if (!reader_expect(r, '#')) // Closing '#'
+        return FAILURE;
+
+    if (insert_main_node(hash, node) != SUCCESS) // Stored index is ignored, word is rehashed
+    {
+        fprintf(stderr, " ERROR: Duplicate word '%s' in backup\n", word);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* ------------------ Document order ------------------ */
+
+/* File names of a backup read ahead of its words */
+typedef struct doc_order
+{
+    Doc_table names; // Temporary IDs, in order of first appearance
+    Arena_t arena;   // Their bytes
+    uint32_t *pairs; // (before, after) ID pairs: before is listed right ahead of after for some word
+    size_t pair_count;
+    size_t pair_capacity;
+} Doc_order;
+
+/* Reads the file names of one record and notes the order they are listed in */
+static Status scan_record(Doc_order *order, Backup_reader *r)
+{
+    char field[PATH_MAX];
+    uint32_t file_count, word_count, prev = DOC_NONE;
+
+    if (!reader_field(r, ';', field, sizeof(field), NULL) || !reader_field(r, ';', field, sizeof(field), NULL) ||
+        !reader_number(r, &file_count))
+        return FAILURE;
+
+    for (uint32_t i = 0; i < file_count; i++)
+    {
+        if (!reader_field(r, ';', field, sizeof(field), NULL) || !reader_number(r, &word_count))
+            return FAILURE;
+
+        uint32_t doc_id = doc_table_add(&order->names, &order->arena, field);
+        if (doc_id == DOC_NONE)
+            return FAILURE;
+
+        if (prev != DOC_NONE && prev != doc_id)
+        {
+            if (order->pair_count == order->pair_capacity)
+            {
+                size_t capacity = order->pair_capacity ? order->pair_capacity * 2 : 1024;
+                uint32_t *grown = realloc(order->pairs, capacity * 2 * sizeof(uint32_t));
+                if (grown == NULL)
+                    return FAILURE;
+                order->pairs = grown;
+                order->pair_capacity = capacity;
+            }
+            order->pairs[2 * order->pair_count] = prev;
+            order->pairs[2 * order->pair_count + 1] = doc_id;
+            order->pair_count++;
+        }
+        prev = doc_id;
+    }
+    return reader_expect(r, '#') ? SUCCESS : FAILURE;
+}
+
+/* Min-heap of temporary IDs, so the earliest seen file goes first among those that are free to */
+static void heap_push(uint32_t *heap, uint32_t *size, uint32_t id)
+{
+    uint32_t i = (*size)++;
+    for (; i > 0 && heap[(i - 1) / 2] > id; i = (i - 1) / 2)
+        heap[i] = heap[(i - 1) / 2];
+    heap[i] = id;
+}
+
+static uint32_t heap_pop(uint32_t *heap, uint32_t *size)
+{
+    uint32_t top = heap[0], last = heap[--(*size)], i = 0;
+    for (uint32_t child; (child = 2 * i + 1) < *size; i = child)
+    {
+        if (child + 1 < *size && heap[child + 1] < heap[child])
+            child++;
+        if (heap[child] >= last)
+            break;
+        heap[i] = heap[child];
+    }
+    heap[i] = last;
+    return top;
+}
+
+/* Interns the files of a backup in an order that keeps every stored list ascending (a topological order of the
+   listed pairs), so IDs depend only on the backup and load_record never has to re-sort a list */
+static Status register_documents(Hash_t *hash, const Doc_order *order)
+{
+    uint32_t n = order->names.count, ready = 0;
+    uint32_t *start = calloc(n + 1, sizeof(uint32_t)); // Pairs grouped by their first ID
+    uint32_t *after = malloc((order->pair_count + 1) * sizeof(uint32_t));
+    uint32_t *waiting = calloc(n + 1, sizeof(uint32_t)); // Files still to be placed ahead of each one
+    uint32_t *heap = malloc((n + 1) * sizeof(uint32_t));
+    bool *placed = calloc(n + 1, sizeof(bool));
+    Status status = SUCCESS;
+
+    if (start == NULL || after == NULL || waiting == NULL || heap == NULL || placed == NULL)
+        status = FAILURE;
+
+    for (size_t i = 0; status == SUCCESS && i < order->pair_count; i++)
+    {
+        start[order->pairs[2 * i] + 1]++;
+        waiting[order->pairs[2 * i + 1]]++;
+    }
+    for (uint32_t id = 0; status == SUCCESS && id < n; id++)
+        start[id + 1] += start[id];
+    for (size_t i = 0; status == SUCCESS && i < order->pair_count; i++)
+        after[start[order->pairs[2 * i]]++] = order->pairs[2 * i + 1];
+    for (uint32_t id = n; status == SUCCESS && id > 0; id--) // Undo the advance of the fill above
+        start[id] = start[id - 1];
+    if (status == SUCCESS)
+        start[0] = 0;
+
+    for (uint32_t id = 0; status == SUCCESS && id < n; id++)
+        if (waiting[id] == 0)
+            heap_push(heap, &ready, id);
+    while (status == SUCCESS && ready)
+    {
+        uint32_t id = heap_pop(heap, &ready);
+        if (doc_table_add(&hash->docs, &hash->arena, order->names.names[id]) == DOC_NONE)
+            status = FAILURE;
+        placed[id] = true;
+        for (uint32_t i = start[id]; i < start[id + 1]; i++)
+            if (--waiting[after[i]] == 0)
+                heap_push(heap, &ready, after[i]);
+    }
+    for (uint32_t id = 0; status == SUCCESS && id < n; id++) // Lists that contradict each other, re-sorted on load
+        if (!placed[id] && doc_table_add(&hash->docs, &hash->arena, order->names.names[id]) == DOC_NONE)
+            status = FAILURE;
+
+    free(start);
+    free(after);
+    free(waiting);
+    free(heap);
+    free(placed);
+    return status;
+}
+
+/* First pass over the backup: gives its files their IDs before any word is loaded, then rewinds the reader.
+   A record it cannot read is left for load_record to report */
+static Status order_documents(Hash_t *hash, Backup_reader *r)
+{
+    Doc_order order = {.pairs = NULL, .pair_count = 0, .pair_capacity = 0};
+    if (doc_table_init(&order.names) == FAILURE)
+        return FAILURE;
+    arena_init(&order.arena);
+
+    bool complete = true;
+    while (complete && reader_expect(r, '#'))
+        complete = scan_record(&order, r) == SUCCESS;
+
+    Status status = complete ? register_documents(hash, &order) : SUCCESS;
+    doc_table_free(&order.names);
+    arena_free(&order.arena);
+    free(order.pairs);
+
+    r->len = r->pos = 0;
+    r->eof = false;
+    if (lseek(r->fd, 0, SEEK_SET) < 0)
+        return FAILURE;
+    return status;
+}
+
+Status update_database(Hash_t *hash, char *backup, File_list **head)
 {
     // Validate file
     if (validate_file_extension(backup) == FAILURE) // Check for .txt extension
@@ -283,66 +688,62 @@ Status update_database(Hash_t *hash_array, char *backup, File_list **head)
     if (validate_file_size(fptr) == 0) // Check empty file
     {
         fprintf(stderr, " ERROR: %s file is empty\n", backup);
+        fclose(fptr);
         return FAILURE;
     }
 
     if (validate_backup_database(fptr) == FAILURE) // Check database format
     {
         fprintf(stderr, " ERROR: %s file is not a DATABASE file\n", backup);
+        fclose(fptr);
         return FAILURE;
     }
-    int index, file_count;
-    char word[WORD_SIZE];
+    fclose(fptr);
 
-    while (fscanf(fptr, "#%d;%[^;];%d;", &index, word, &file_count) == 3) // Read each record
+    // Stream the records through one large buffer
+    Stats_timer timer;
+    STAT_START(timer);
+    Backup_reader reader = {.fd = open(backup, O_RDONLY), .buf = malloc(LOAD_BUFFER_SIZE), .len = 0, .pos = 0, .eof = false,
+                            .subs = NULL, .subs_size = 0};
+    if (reader.fd < 0 || reader.buf == NULL)
     {
-        Main_node *curr_main = hash_array[index].m_link;
-        Main_node *prev_main = NULL;
+        fprintf(stderr, "Error: Unable to open '%s' file\n", backup);
+        if (reader.fd >= 0)
+            close(reader.fd);
+        free(reader.buf);
+        return FAILURE;
+    }
 
-        while (curr_main) // Traverse to last main node
+    Status status = order_documents(hash, &reader); // IDs follow the stored lists, not the order files first appear
+    if (status == FAILURE)
+        fprintf(stderr, "Error: Out of memory while loading '%s'\n", backup);
+    while (status == SUCCESS && reader_expect(&reader, '#')) // Read each record
+    {
+        if (load_record(hash, &reader) == FAILURE)
         {
-            prev_main = curr_main;
-            curr_main = curr_main->m_link;
+            fprintf(stderr, " ERROR: %s has a malformed record near word %zu\n", backup, hash->count + 1);
+            status = FAILURE;
+            break;
         }
+    }
+    close(reader.fd);
+    free(reader.buf);
+    free(reader.subs);
 
-        Main_node *newNode = create_main_node(word); // Create new main node
-        newNode->file_count = file_count;
-
-        if (prev_main)
-            prev_main->m_link = newNode; // Insert after existing nodes
-        else
-            hash_array[index].m_link = newNode; // Insert as first node
-
-        Sub_node *temp_sub = newNode->s_link;
-
-        int word_count;
-        char file_name[WORD_SIZE];
-
-        for (int i = 0; i < file_count; i++) // Read subnode data
-        {
-            fscanf(fptr, "%[^;];%d;", file_name, &word_count);
-            Sub_node *newSubNode = create_sub_node(file_name);
-            newSubNode->word_count = word_count;
-
-            if (delete_duplicate_file(head, file_name) == SUCCESS) // Remove duplicate file entries
-            {
-                printf("INFO: Deleting File %s in FileList (already present in the database file %s)\n", file_name, backup);
-                // print_file_list(head);
-            }
+    if (status == FAILURE) // Do not leave a half-loaded database behind
+    {
+        reset_hash(hash);
+        return FAILURE;
+    }
 
-            if (temp_sub == NULL) // First subnode
-            {
-                newNode->s_link = newSubNode;
-            }
-            else // Append subnode
-            {
-                temp_sub->s_link = newSubNode;
-            }
-            temp_sub = newSubNode;
-        }
-        fscanf(fptr, "#\n"); // Skip closing '#'
+    if (hash->positional) // Text backups carry no token positions
+    {
+        fprintf(stderr, "INFO: %s has no word positions, phrase and NEAR queries are disabled\n", backup);
+        hash->positional = false;
     }
-    fclose(fptr);
+
+    STAT_STOP(timer, PHASE_LOAD);
+    remove_indexed_files(head, &hash->docs, backup); // Files already in the database are not indexed again
 
     // insert_at_last(head,backup);
     return SUCCESS;
@@ -0,0 +1,214 @@
+/***********************************************************************
+ *  File Name   : dictionary.c
+ *  Description : Sorted term dictionary for prefix, suffix and wildcard
+ *                search in the Inverted Search System. Next to the hash
+ *                table the index keeps two sorted arrays of word
+ *                pointers:
+ *                  - sorted   : words in byte order, for "prefix*"
+ *                  - reversed : words ordered by their reversed
+ *                               spelling, for "*suffix"
+ *                Both are rebuilt on demand after the vocabulary changes
+ *                and cost two pointers per word; the words themselves
+ *                are not copied.
+ *
+ *                A pattern "a*b*c" is answered from whichever of the
+ *                prefix range of "a" and the suffix range of "c" is
+ *                smaller, checking each candidate against the whole
+ *                pattern, so the cost follows the number of candidate
+ *                words rather than the vocabulary size. Only patterns
+ *                without a literal prefix or suffix ("*mid*") scan the
+ *                whole dictionary.
+ *
+ *                Functions:
+ *                  - term_dict_update()
+ *                  - term_dict_free()
+ *                  - match_terms()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+
+static int compare_words(const void *a, const void *b)
+{
+    return strcmp((*(Main_node *const *)a)->word, (*(Main_node *const *)b)->word);
+}
+
+/* Compares the last len bytes of a word, read backwards, with key read backwards */
+static int compare_tail(const char *word, size_t word_len, const char *key, size_t key_len)
+{
+    for (size_t i = 0; i < key_len; i++)
+    {
+        if (i == word_len) // Word is a proper suffix of the key
+            return -1;
+        unsigned char x = word[word_len - 1 - i], y = key[key_len - 1 - i];
+        if (x != y)
+            return x < y ? -1 : 1;
+    }
+    return 0;
+}
+
+static int compare_reversed(const void *a, const void *b)
+{
+    const Main_node *m = *(Main_node *const *)a, *n = *(Main_node *const *)b;
+    const char *x = m->word, *y = n->word;
+    size_t x_len = m->word_len, y_len = n->word_len;
+
+    size_t common = y_len < x_len ? y_len : x_len;
+    int cmp = compare_tail(x, x_len, y + y_len - common, common);
+    if (cmp)
+        return cmp;
+    return (x_len > y_len) - (x_len < y_len); // Shorter reversed spelling first
+}
+
+static Status term_dict_build(Hash_t *hash)
+{
+    Term_dict *dict = &hash->dict;
+    size_t count = hash->count;
+
+    Main_node **sorted = realloc(dict->sorted, (count + 1) * sizeof(Main_node *));
+    if (sorted == NULL)
+        return FAILURE;
+    dict->sorted = sorted;
+
+    Main_node **reversed = realloc(dict->reversed, (count + 1) * sizeof(Main_node *));
+    if (reversed == NULL)
+        return FAILURE;
+    dict->reversed = reversed;
+
+    size_t i = 0;
+    for (Main_node *node = hash->head; node; node = node->m_link)
+        sorted[i++] = node;
+
+    qsort(sorted, count, sizeof(Main_node *), compare_words);
+    memcpy(reversed, sorted, count * sizeof(Main_node *));
+    qsort(reversed, count, sizeof(Main_node *), compare_reversed);
+
+    dict->count = count;
+    dict->stale = false;
+    return SUCCESS;
+}
+
+void term_dict_free(Term_dict *dict)
+{
+    free(dict->sorted);
+    free(dict->reversed);
+    dict->sorted = NULL;
+    dict->reversed = NULL;
+    dict->count = 0;
+    dict->stale = true;
+}
+
+/* [first, last) of the words starting with prefix (sorted) or ending with it (reversed) */
+static void find_range(Term_dict *dict, bool by_suffix, const char *key, size_t key_len, size_t *first, size_t *last)
+{
+    Main_node **words = by_suffix ? dict->reversed : dict->sorted;
+
+    for (int bound = 0; bound < 2; bound++) // Lower bound, then upper bound
+    {
+        size_t lo = 0, hi = dict->count;
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            const char *word = words[mid]->word;
+            int cmp = by_suffix ? compare_tail(word, words[mid]->word_len, key, key_len) : strncmp(word, key, key_len);
+
+            if (cmp < 0 || (bound == 1 && cmp == 0))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (bound == 0)
+            *first = lo;
+        else
+            *last = lo;
+    }
+}
+
+/* '*' matches any run of bytes, everything else matches itself */
+static bool glob_match(const char *pattern, const char *word)
+{
+    const char *star = NULL, *resume = NULL;
+
+    while (*word)
+    {
+        if (*pattern == '*') // Remember the star, try matching nothing first
+        {
+            star = pattern++;
+            resume = word;
+        }
+        else if (*pattern == *word)
+        {
+            pattern++;
+            word++;
+        }
+        else if (star) // Let the last star swallow one more byte
+        {
+            pattern = star + 1;
+            word = ++resume;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (*pattern == '*')
+        pattern++;
+    return *pattern == '\0';
+}
+
+/* Rebuilds the sorted arrays if the vocabulary changed; afterwards match_terms() only reads them */
+Status term_dict_update(Hash_t *hash)
+{
+    if (hash->dict.stale || hash->dict.count != hash->count) // Vocabulary changed since the last build
+        return term_dict_build(hash);
+    return SUCCESS;
+}
+
+Status match_terms(Hash_t *hash, const char *pattern, Main_node ***nodes, size_t *count)
+{
+    *nodes = NULL;
+    *count = 0;
+
+    if (term_dict_update(hash) == FAILURE)
+        return FAILURE;
+
+    const char *first_star = strchr(pattern, '*');
+    const char *last_star = strrchr(pattern, '*');
+    size_t prefix_len = first_star ? (size_t)(first_star - pattern) : strlen(pattern);
+    const char *suffix = last_star ? last_star + 1 : "";
+    size_t suffix_len = strlen(suffix);
+
+    size_t first = 0, last = hash->dict.count; // Whole dictionary unless narrowed below
+    bool by_suffix = false;
+
+    if (prefix_len)
+        find_range(&hash->dict, false, pattern, prefix_len, &first, &last);
+    if (suffix_len)
+    {
+        size_t s_first, s_last;
+        find_range(&hash->dict, true, suffix, suffix_len, &s_first, &s_last);
+        if (!prefix_len || s_last - s_first < last - first) // Walk the smaller candidate range
+        {
+            first = s_first;
+            last = s_last;
+            by_suffix = true;
+        }
+    }
+
+    Main_node **words = by_suffix ? hash->dict.reversed : hash->dict.sorted;
+    Main_node **matches = malloc((last - first + 1) * sizeof(Main_node *));
+    if (matches == NULL)
+        return FAILURE;
+
+    for (size_t i = first; i < last; i++)
+    {
+        if (words[i]->file_count && glob_match(pattern, words[i]->word))
+            matches[(*count)++] = words[i];
+    }
+
+    *nodes = matches;
+    return SUCCESS;
+}
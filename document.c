@@ -0,0 +1,203 @@
+/***********************************************************************
+ *  File Name   : document.c
+ *  Description : Document table for the Inverted Search System. Every
+ *                indexed file is interned once and given a dense
+ *                uint32_t document ID. Sub nodes store only that ID;
+ *                file names are looked up again only when printing or
+ *                saving the database. Removed files keep their ID
+ *                (with no name) so IDs in sub nodes never change.
+ *                The table also keeps every file's length in words,
+ *                used by BM25 ranking. Every build, load, add, remove
+ *                or merge changes the table, so its generation counter
+ *                also tells the query cache (cache.c) when the index
+ *                changed.
+ *
+ *                Functions:
+ *                  - doc_table_init()
+ *                  - doc_table_free()
+ *                  - doc_table_add()
+ *                  - doc_table_add_removed()
+ *                  - doc_table_remove()
+ *                  - doc_table_set_length()
+ *                  - doc_table_find()
+ *                  - doc_name()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+
+Status doc_table_init(Doc_table *docs)
+{
+    docs->names = malloc(DOC_INITIAL_SIZE * sizeof(char *));
+    docs->lengths = malloc(DOC_INITIAL_SIZE * sizeof(uint32_t));
+    docs->slots = malloc(DOC_INITIAL_SIZE * 2 * sizeof(uint32_t));
+    if (docs->names == NULL || docs->lengths == NULL || docs->slots == NULL)
+    {
+        free(docs->names);
+        free(docs->lengths);
+        free(docs->slots);
+        return FAILURE;
+    }
+
+    docs->total_length = 0;
+    docs->generation = 0;
+    docs->live = 0;
+    docs->count = 0;
+    docs->capacity = DOC_INITIAL_SIZE;
+    docs->slot_capacity = DOC_INITIAL_SIZE * 2;                         // Map stays at most half full
+    memset(docs->slots, 0xff, docs->slot_capacity * sizeof(uint32_t)); // Every slot DOC_NONE
+    return SUCCESS;
+}
+
+void doc_table_free(Doc_table *docs)
+{
+    free(docs->names); // Names themselves live in the index arena
+    free(docs->lengths);
+    free(docs->slots);
+    docs->names = NULL;
+    docs->lengths = NULL;
+    docs->slots = NULL;
+    docs->total_length = 0;
+    docs->live = 0;
+    docs->count = 0;
+    docs->capacity = 0;
+    docs->slot_capacity = 0;
+}
+
+/* Returns the slot holding file_name, or the empty slot where it belongs */
+static size_t find_doc_slot(Doc_table *docs, const char *file_name)
+{
+    size_t mask = docs->slot_capacity - 1;
+    size_t i = hash_word(file_name, strlen(file_name)) & mask;
+
+    while (docs->slots[i] != DOC_NONE && strcmp(docs->names[docs->slots[i]], file_name) != 0)
+        i = (i + 1) & mask; // Linear probing
+
+    return i;
+}
+
+static Status grow_doc_table(Doc_table *docs)
+{
+    uint32_t capacity = docs->capacity * 2;
+    char **names = realloc(docs->names, capacity * sizeof(char *));
+    if (names == NULL)
+        return FAILURE;
+    docs->names = names;
+
+    uint32_t *lengths = realloc(docs->lengths, capacity * sizeof(uint32_t));
+    if (lengths == NULL)
+        return FAILURE;
+    docs->lengths = lengths;
+    docs->capacity = capacity;
+
+    uint32_t *slots = malloc(capacity * 2 * sizeof(uint32_t));
+    if (slots == NULL)
+        return FAILURE;
+
+    free(docs->slots);
+    docs->slots = slots;
+    docs->slot_capacity = capacity * 2;
+    memset(docs->slots, 0xff, docs->slot_capacity * sizeof(uint32_t));
+
+    for (uint32_t id = 0; id < docs->count; id++) // Re-insert every live name
+    {
+        if (docs->names[id])
+            docs->slots[find_doc_slot(docs, docs->names[id])] = id;
+    }
+
+    return SUCCESS;
+}
+
+uint32_t doc_table_add(Doc_table *docs, Arena_t *arena, const char *file_name)
+{
+    size_t slot = find_doc_slot(docs, file_name);
+    if (docs->slots[slot] != DOC_NONE) // Already interned
+        return docs->slots[slot];
+
+    if (docs->count == docs->capacity || docs->count == DOC_NONE - 1)
+    {
+        if (docs->count == DOC_NONE - 1 || grow_doc_table(docs) == FAILURE)
+            return DOC_NONE;
+        slot = find_doc_slot(docs, file_name); // Table was rebuilt
+    }
+
+    size_t len = strlen(file_name) + 1;
+    char *name = arena_alloc(arena, len);
+    if (name == NULL)
+        return DOC_NONE;
+    memcpy(name, file_name, len);
+
+    uint32_t doc_id = docs->count++; // Next dense ID
+    docs->names[doc_id] = name;
+    docs->lengths[doc_id] = 0; // Set once the file is indexed
+    docs->slots[slot] = doc_id;
+    docs->live++;
+    docs->generation++;
+    return doc_id;
+}
+
+uint32_t doc_table_add_removed(Doc_table *docs)
+{
+    if (docs->count == docs->capacity || docs->count == DOC_NONE - 1)
+    {
+        if (docs->count == DOC_NONE - 1 || grow_doc_table(docs) == FAILURE)
+            return DOC_NONE;
+    }
+
+    docs->names[docs->count] = NULL; // Placeholder keeps later IDs unchanged
+    docs->lengths[docs->count] = 0;
+    docs->generation++;
+    return docs->count++;
+}
+
+Status doc_table_remove(Doc_table *docs, uint32_t doc_id)
+{
+    if (doc_id >= docs->count || docs->names[doc_id] == NULL)
+        return FAILURE;
+
+    size_t mask = docs->slot_capacity - 1;
+    size_t i = find_doc_slot(docs, docs->names[doc_id]);
+    size_t j = i;
+
+    while (1) // Backward-shift deletion keeps every probe sequence intact
+    {
+        j = (j + 1) & mask;
+        if (docs->slots[j] == DOC_NONE)
+            break;
+
+        const char *name = docs->names[docs->slots[j]];
+        size_t home = hash_word(name, strlen(name)) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) // Entry at j may move back to i
+        {
+            docs->slots[i] = docs->slots[j];
+            i = j;
+        }
+    }
+    docs->slots[i] = DOC_NONE;
+    docs->names[doc_id] = NULL; // Name bytes stay in the arena
+    docs->total_length -= docs->lengths[doc_id];
+    docs->lengths[doc_id] = 0;
+    docs->live--;
+    docs->generation++;
+    return SUCCESS;
+}
+
+void doc_table_set_length(Doc_table *docs, uint32_t doc_id, uint32_t length)
+{
+    docs->total_length += (uint64_t)length - docs->lengths[doc_id];
+    docs->lengths[doc_id] = length;
+    docs->generation++;
+}
+
+uint32_t doc_table_find(Doc_table *docs, const char *file_name)
+{
+    return docs->slots[find_doc_slot(docs, file_name)];
+}
+
+const char *doc_name(Doc_table *docs, uint32_t doc_id)
+{
+    return doc_id < docs->count && docs->names[doc_id] ? docs->names[doc_id] : "?";
+}
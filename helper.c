@@ -2,21 +2,30 @@
  *  File Name   : helpers.c
  *  Description : Contains helper functions for the Inverted Search System,
  *                including:
- *                  - Hash table initialization
- *                  - Word-to-index mapping
- *                  - Main node creation
- *                  - Sub node creation
+ *                  - Hash table initialization and release
+ *                  - Full-word hashing, lookup and insertion
+ *                  - Word-to-index mapping (backup format category)
+ *                  - Main node creation (word copied into the string pool)
+ *                  - Sub node append (growable per-word array)
  *                  - Backup file format validation
  *                  - Duplicate file removal
  *                  - File list printing
  *
  *                Functions:
  *                  - initialise_hash()
+ *                  - free_hash()
+ *                  - reset_hash()
+ *                  - hash_word()
+ *                  - reserve_hash()
+ *                  - lookup_word()
+ *                  - insert_main_node()
+ *                  - remove_main_node()
  *                  - find_index()
  *                  - create_main_node()
  *                  - create_sub_node()
  *                  - validate_backup_database()
  *                  - delete_duplicate_file()
+ *                  - remove_indexed_files()
  *                  - print_file_list()
  *
  *  Author      : Omkar Ashok Sawant
@@ -25,18 +34,190 @@
  ***********************************************************************/
 
 #include "inverted_search.h"
+#include <sys/mman.h>
 
 Status initialise_hash(Hash_t *hash)
 {
-    for (int i = 0; i < HASH_SIZE; i++) // Initialize each hash index
+    hash->table = calloc(HASH_INITIAL_SIZE, sizeof(Main_node *)); // All slots empty
+    if (hash->table == NULL)
+        return FAILURE;
+
+    hash->capacity = HASH_INITIAL_SIZE;
+    hash->count = 0;
+    hash->head = NULL; // No words inserted yet
+    hash->tail = NULL;
+    hash->map = NULL; // No binary index mapped
+    hash->map_size = 0;
+    hash->dict.sorted = NULL; // Term dictionary is built on first wildcard query
+    hash->dict.reversed = NULL;
+    hash->dict.count = 0;
+    hash->dict.stale = true;
+    hash->positional = false; // Enabled by --positions or a positional .bin index
+    hash->normalize = NORM_DEFAULT; // --normalize, or the steps recorded in a .bin index
+    hash->cache = NULL;       // Attached by query_cache_create()
+    hash->spill = NULL;       // Set only by an external build
+    hash->spill_context = NULL;
+    hash->segments = NULL;    // Set by segments_open()
+    hash->view = NULL;
+    arena_init(&hash->arena);
+    pool_init(&hash->strings);
+
+    if (doc_table_init(&hash->docs) == FAILURE)
+    {
+        free(hash->table);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+void free_hash(Hash_t *hash)
+{
+    if (hash->segments) // Stops its merger and drops every segment
+        segments_close(hash);
+    free(hash->table);        // Slot array
+    arena_free(&hash->arena); // Every node of the index in one go
+    pool_free(&hash->strings); // And every word
+    doc_table_free(&hash->docs);
+    term_dict_free(&hash->dict);
+    query_cache_free(hash);
+    if (hash->map) // Borrowed sub nodes of a loaded binary index
+        munmap(hash->map, hash->map_size);
+    hash->map = NULL;
+    hash->map_size = 0;
+    hash->table = NULL;
+    hash->capacity = 0;
+    hash->count = 0;
+    hash->head = NULL;
+    hash->tail = NULL;
+}
+
+/* Drops a half-loaded index; the query cache stays attached, emptied since generations restart */
+Status reset_hash(Hash_t *hash)
+{
+    Query_cache *cache = hash->cache;
+    unsigned normalize = hash->normalize; // Settings outlive the contents
+    hash->cache = NULL;
+    free_hash(hash);
+
+    Status status = initialise_hash(hash);
+    if (cache)
+        query_cache_clear(cache);
+    hash->cache = cache;
+    hash->normalize = normalize;
+    return status;
+}
+
+/* 128-bit multiply folded to 64 bits (wyhash mixing step) */
+static inline uint64_t hash_mix(uint64_t a, uint64_t b)
+{
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+static inline uint64_t hash_read(const char *p, size_t n)
+{
+    uint64_t v = 0;
+    memcpy(&v, p, n); // Unaligned-safe little-endian read of up to 8 bytes
+    return v;
+}
+
+uint64_t hash_word(const char *word, size_t len)
+{
+    const uint64_t s0 = 0xa0761d6478bd642full, s1 = 0xe7037ed1a0b428dbull;
+    uint64_t seed = s0 ^ len;
+
+    while (len > 16) // Consume 16 bytes per round
+    {
+        seed = hash_mix(hash_read(word, 8) ^ s1, hash_read(word + 8, 8) ^ seed);
+        word += 16;
+        len -= 16;
+    }
+
+    uint64_t a = hash_read(word, len > 8 ? 8 : len);
+    uint64_t b = len > 8 ? hash_read(word + 8, len - 8) : 0;
+
+    return hash_mix(s1 ^ len, hash_mix(a ^ s1, b ^ seed));
+}
+
+/* Returns the slot holding the word, or the empty slot where it belongs */
+static Main_node **find_slot(Main_node **table, size_t capacity, const char *word, size_t len, uint64_t word_hash)
+{
+    size_t mask = capacity - 1;
+    size_t i = word_hash & mask;
+    uint64_t probes = 1;
+
+    while (table[i]) // Linear probing until hit or empty slot
+    {
+        if (table[i]->hash == word_hash && table[i]->word_len == len && memcmp(table[i]->word, word, len) == 0)
+            break;
+        i = (i + 1) & mask;
+        probes++;
+    }
+    STAT_PROBES(probes);
+    return &table[i];
+}
+
+static Status resize_hash(Hash_t *hash, size_t capacity)
+{
+    Main_node **table = calloc(capacity, sizeof(Main_node *));
+    if (table == NULL)
+        return FAILURE;
+
+    for (Main_node *node = hash->head; node; node = node->m_link) // Re-insert every word
+    {
+        size_t i = node->hash & (capacity - 1);
+        while (table[i])
+            i = (i + 1) & (capacity - 1);
+        table[i] = node;
+    }
+
+    free(hash->table);
+    hash->table = table;
+    hash->capacity = capacity;
+    STAT_ADD(resizes, 1);
+    return SUCCESS;
+}
+
+Status reserve_hash(Hash_t *hash, size_t count)
+{
+    size_t capacity = hash->capacity;
+    while (count * 100 > capacity * HASH_MAX_LOAD) // Smallest power of two keeping the load bounded
+        capacity *= 2;
+
+    return capacity == hash->capacity ? SUCCESS : resize_hash(hash, capacity);
+}
+
+Main_node *lookup_word(Hash_t *hash, const char *word, size_t len, uint64_t word_hash)
+{
+    return *find_slot(hash->table, hash->capacity, word, len, word_hash);
+}
+
+Status insert_main_node(Hash_t *hash, Main_node *node)
+{
+    if ((hash->count + 1) * 100 > hash->capacity * HASH_MAX_LOAD) // Keep load factor bounded
     {
-        hash[i].index = i;     // Store index value
-        hash[i].m_link = NULL; // Set main node link to NULL
+        if (resize_hash(hash, hash->capacity * 2) == FAILURE)
+            return FAILURE;
     }
+
+    Main_node **slot = find_slot(hash->table, hash->capacity, node->word, node->word_len, node->hash);
+    if (*slot) // Word already present
+        return DUPLICATE;
+
+    *slot = node;
+    hash->count++;
+    hash->dict.stale = true;
+
+    if (hash->tail) // Append to insertion order list
+        hash->tail->m_link = node;
+    else
+        hash->head = node;
+    hash->tail = node;
+
     return SUCCESS;
 }
 
-void find_index(int *index, char *buffer)
+void find_index(int *index, const char *buffer)
 {
     if (isupper(buffer[0])) // Uppercase A–Z
     {
@@ -52,31 +233,100 @@ void find_index(int *index, char *buffer)
     }
 }
 
-Main_node *create_main_node(char *word)
+Status remove_main_node(Hash_t *hash, Main_node *node, Main_node *prev)
+{
+    size_t mask = hash->capacity - 1;
+    size_t i = node->hash & mask;
+
+    while (hash->table[i] && hash->table[i] != node) // Locate the node's slot
+        i = (i + 1) & mask;
+    if (hash->table[i] == NULL)
+        return FAILURE;
+
+    size_t j = i;
+    while (1) // Backward-shift deletion keeps every probe sequence intact
+    {
+        j = (j + 1) & mask;
+        if (hash->table[j] == NULL)
+            break;
+
+        size_t home = hash->table[j]->hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) // Entry at j may move back to i
+        {
+            hash->table[i] = hash->table[j];
+            i = j;
+        }
+    }
+    hash->table[i] = NULL;
+    hash->count--;
+    hash->dict.stale = true;
+
+    if (prev) // Unlink from insertion order list
+        prev->m_link = node->m_link;
+    else
+        hash->head = node->m_link;
+    if (hash->tail == node)
+        hash->tail = prev;
+
+    return SUCCESS; // Node memory stays in the arena
+}
+
+Main_node *create_main_node(Hash_t *hash, const char *word, size_t len)
 {
-    Main_node *newnode = (Main_node *)malloc(sizeof(Main_node)); // Allocate main node
+    Main_node *newnode = arena_alloc(&hash->arena, sizeof(Main_node)); // Allocate main node from the index arena
 
-    if (newnode == NULL) // Check malloc failure
+    if (newnode == NULL) // Check allocation failure
         return NULL;
 
-    strcpy(newnode->word, word); // Store the word
-    newnode->file_count = 1;     // Initialize file count
-    newnode->m_link = NULL;      // Next main node = NULL
-    newnode->s_link = NULL;      // First subnode = NULL
+    newnode->word = pool_add(&hash->strings, word, len); // Store the word once, any length
+    if (newnode->word == NULL)
+        return NULL;
+    STAT_ADD(main_nodes, 1);
+    STAT_ADD(main_bytes, sizeof(Main_node) + len + 1);
+
+    newnode->word_len = (uint32_t)len;    // Cache its length
+    newnode->hash = hash_word(word, len); // Cache full-word hash
+    newnode->file_count = 0;              // No file yet
+    newnode->capacity = 0;
+    newnode->m_link = NULL; // Next main node = NULL
+    newnode->s_list = NULL; // No subnodes yet
+    newnode->packed = NULL;
+    newnode->positions = NULL;
 
     return newnode;
 }
 
-Sub_node *create_sub_node(char *filename)
+Sub_node *create_sub_node(Arena_t *arena, Main_node *node, uint32_t doc_id)
 {
-    Sub_node *newnode = (Sub_node *)malloc(sizeof(Sub_node)); // Allocate subnode
+    if (postings_unpack(arena, node) == FAILURE) // Packed word -> plain sub node array first
+        return NULL;
 
-    if (newnode == NULL) // Check malloc failure
+    uint32_t capacity = node->capacity;
+    if (node->file_count >= node->capacity) // Sub node array full -> double it
+    {
+        capacity = 1;
+        while (capacity <= node->file_count)
+            capacity *= 2;
+    }
+
+    if (node->positions && positions_reserve(arena, node, capacity) == FAILURE) // Position offsets follow the sub nodes
         return NULL;
 
-    strcpy(newnode->file_name, filename); // Store filename
-    newnode->word_count = 1;              // First occurrence
-    newnode->s_link = NULL;               // Next subnode = NULL
+    if (capacity != node->capacity)
+    {
+        Sub_node *grown = arena_grow(arena, node->s_list, node->capacity * sizeof(Sub_node), capacity * sizeof(Sub_node));
+        if (grown == NULL) // Check allocation failure
+            return NULL;
+
+        node->s_list = grown;
+        node->capacity = capacity;
+        STAT_ADD(sub_bytes, capacity * sizeof(Sub_node));
+    }
+    STAT_ADD(sub_nodes, 1);
+
+    Sub_node *newnode = &node->s_list[node->file_count++]; // Append after the last file
+    newnode->doc_id = doc_id;                               // Store document ID
+    newnode->word_count = 1;                                // First occurrence
 
     return newnode;
 }
@@ -125,15 +375,42 @@ Status delete_duplicate_file(File_list **head, char *file_name)
     return FAILURE; // No duplicate found
 }
 
+void remove_indexed_files(File_list **head, Doc_table *docs, const char *source)
+{
+    File_list **link = head; // Single pass, unlinking in place
+
+    while (*link)
+    {
+        File_list *curr = *link;
+        if (doc_table_find(docs, curr->file_name) != DOC_NONE) // Already in the database
+        {
+            printf("INFO: Deleting File %s in FileList (already present in the database file %s)\n", curr->file_name, source);
+            *link = curr->next;
+            free(curr);
+        }
+        else
+        {
+            link = &curr->next;
+        }
+    }
+}
+
 void print_file_list(File_list **file_list)
 {
     printf("\n>> FileList: ");
     File_list *temp = *file_list; // Pointer to traverse list
-    while (temp)
+    size_t shown = 0;
+    while (temp && shown < FILE_LIST_SHOWN)
     {
         printf("-> %s ", temp->file_name); // Print each filename
         temp = temp->next;                 // Move to next
+        shown++;
     }
+    size_t hidden = 0;
+    for (; temp; temp = temp->next) // Long lists (directories, file lists) are summarised
+        hidden++;
+    if (hidden)
+        printf("-> ... %zu more", hidden);
     printf("\n");
 }
 int delete_list(File_list **head)
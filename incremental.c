@@ -0,0 +1,267 @@
+/***********************************************************************
+ *  File Name   : incremental.c
+ *  Description : Incremental maintenance of a live database for the
+ *                Inverted Search System. Files can be added to or
+ *                removed from an index that was created or loaded
+ *                earlier, and a loaded backup can be merged into it,
+ *                without rebuilding the whole index.
+ *
+ *                New files always receive document IDs above every ID
+ *                already in use, so appending their sub nodes keeps
+ *                every word's file list sorted by document ID. Removed
+ *                files keep their ID (with no name) in the document
+ *                table; their sub nodes are dropped in a single pass
+ *                over the vocabulary and words left without any file
+ *                are unlinked from the table. Every operation leaves
+ *                the words it touched packed again (postings.c).
+ *                A backup normalized with other steps than the
+ *                database is not merged, as queries could not reach
+ *                its words.
+ *
+ *                Functions:
+ *                  - add_files()
+ *                  - remove_files()
+ *                  - merge_database()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+
+Status add_files(Hash_t *hash, File_list **files, int threads)
+{
+    File_list **link = files; // Drop files the database already has
+
+    while (*link)
+    {
+        File_list *curr = *link;
+        if (doc_table_find(&hash->docs, curr->file_name) != DOC_NONE)
+        {
+            printf("Info : File '%s' is already indexed, skipped.\n", curr->file_name);
+            *link = curr->next;
+            free(curr);
+        }
+        else
+        {
+            link = &curr->next;
+        }
+    }
+
+    if (*files == NULL) // Nothing new to index
+        return SUCCESS;
+
+    if (create_database_parallel(hash, *files, threads) == FAILURE)
+        return FAILURE;
+
+    delete_list(files); // Files now belong to the database
+    return SUCCESS;
+}
+
+/* Drops the sub nodes of removed documents from one word, packed words are decoded into scratch */
+static Status filter_word(Arena_t *arena, Main_node *node, const uint8_t *removed, Sub_node **scratch, uint32_t *scratch_size)
+{
+    if (postings_get(node, scratch, scratch_size) == NULL)
+        return FAILURE;
+    Sub_node *s_list = node->packed ? *scratch : node->s_list; // Compacted in place either way
+
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < node->file_count; i++)
+    {
+        if (!(removed[s_list[i].doc_id >> 3] & (1u << (s_list[i].doc_id & 7))))
+            kept++;
+    }
+    if (kept == node->file_count) // Word untouched
+        return SUCCESS;
+    if (kept == 0) // Word is about to be unlinked
+    {
+        node->file_count = 0;
+        return SUCCESS;
+    }
+
+    Positions_t *pos = node->positions;
+    uint32_t *offsets = pos ? pos->offsets : NULL;
+    if (pos && pos->offsets_capacity == 0) // Borrowed from a mapped index -> copy out
+    {
+        offsets = arena_alloc(arena, kept * sizeof(uint32_t));
+        if (offsets == NULL)
+            return FAILURE;
+    }
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < node->file_count; i++) // Compact in document ID order
+    {
+        Sub_node sub = s_list[i];
+        if (!(removed[sub.doc_id >> 3] & (1u << (sub.doc_id & 7))))
+        {
+            if (offsets) // Positions stay where they are, only their offsets move
+                offsets[n] = pos->offsets[i];
+            s_list[n++] = sub;
+        }
+    }
+
+    if (offsets)
+        pos->offsets = offsets;
+    if (node->packed) // Pack the survivors again, the old bytes are left behind
+        return postings_pack_list(arena, node, s_list, kept);
+
+    node->file_count = kept;
+    return SUCCESS;
+}
+
+Status remove_files(Hash_t *hash, File_list *files)
+{
+    uint8_t *removed = calloc(hash->docs.count / 8 + 1, 1); // One bit per document ID
+    if (removed == NULL)
+        return FAILURE;
+
+    int count = 0;
+    for (File_list *temp = files; temp; temp = temp->next)
+    {
+        uint32_t doc_id = doc_table_find(&hash->docs, temp->file_name);
+        if (doc_id == DOC_NONE)
+        {
+            fprintf(stderr, "Error: File '%s' is not in the database.\n", temp->file_name);
+            continue;
+        }
+        removed[doc_id >> 3] |= 1u << (doc_id & 7);
+        count++;
+    }
+
+    if (count == 0)
+    {
+        free(removed);
+        return FAILURE;
+    }
+
+    Main_node *prev = NULL;
+    Main_node *node = hash->head;
+    Sub_node *scratch = NULL;
+    uint32_t scratch_size = 0;
+    while (node) // One pass over the vocabulary
+    {
+        Main_node *next = node->m_link;
+
+        if (filter_word(&hash->arena, node, removed, &scratch, &scratch_size) == FAILURE)
+        {
+            free(scratch);
+            free(removed);
+            return FAILURE;
+        }
+
+        if (node->file_count == 0) // Word no longer occurs in any file
+            remove_main_node(hash, node, prev);
+        else
+            prev = node;
+
+        node = next;
+    }
+    free(scratch);
+    if (postings_pack_all(hash) == FAILURE) // Words that were still open
+    {
+        free(removed);
+        return FAILURE;
+    }
+
+    for (File_list *temp = files; temp; temp = temp->next)
+    {
+        uint32_t doc_id = doc_table_find(&hash->docs, temp->file_name);
+        if (doc_id != DOC_NONE && doc_table_remove(&hash->docs, doc_id) == SUCCESS)
+            printf("Info : File '%s' removed from the database.\n", temp->file_name);
+    }
+
+    free(removed);
+    return SUCCESS;
+}
+
+Status merge_database(Hash_t *hash, Hash_t *from)
+{
+    if (from->normalize != hash->normalize) // Its words could never be matched by this database's queries
+    {
+        char mine[NORM_NAME_SIZE], theirs[NORM_NAME_SIZE];
+        fprintf(stderr, "Error: Backup words are normalized as '%s', the database as '%s'; merge refused\n",
+                normalize_name(from->normalize, theirs), normalize_name(hash->normalize, mine));
+        free_hash(from);
+        return FAILURE;
+    }
+
+    uint32_t *remap = malloc((from->docs.count + 1) * sizeof(uint32_t)); // Old ID -> live ID
+    if (remap == NULL)
+    {
+        free_hash(from);
+        return FAILURE;
+    }
+
+    Status status = FAILURE;
+    Sub_node *scratch = NULL; // Decoded sub nodes of a backup word
+    uint32_t scratch_size = 0;
+
+    if (hash->positional && !from->positional) // Some files would lack positions
+    {
+        printf("INFO: Backup has no word positions, phrase and NEAR queries are disabled\n");
+        positions_drop(hash);
+    }
+    bool positions = hash->positional; // Both sides are positional
+
+    for (uint32_t id = 0; id < from->docs.count; id++) // New names get IDs above every live one
+    {
+        const char *name = from->docs.names[id];
+        remap[id] = DOC_NONE;
+
+        if (name == NULL) // Removed in the backup
+            continue;
+        if (doc_table_find(&hash->docs, name) != DOC_NONE) // Live copy wins
+        {
+            printf("INFO: Skipping File %s from backup (already present in the database)\n", name);
+            continue;
+        }
+
+        remap[id] = doc_table_add(&hash->docs, &hash->arena, name);
+        if (remap[id] == DOC_NONE)
+            goto cleanup;
+        doc_table_set_length(&hash->docs, remap[id], from->docs.lengths[id]);
+    }
+
+    for (Main_node *node = from->head; node; node = node->m_link) // Backup's insertion order
+    {
+        Main_node *target = NULL;
+        size_t len = node->word_len;
+        const Sub_node *subs = postings_get(node, &scratch, &scratch_size);
+        if (subs == NULL)
+            goto cleanup;
+
+        for (uint32_t i = 0; i < node->file_count; i++)
+        {
+            uint32_t doc_id = remap[subs[i].doc_id];
+            if (doc_id == DOC_NONE)
+                continue;
+
+            if (target == NULL) // First surviving file -> find or create the word
+            {
+                target = lookup_word(hash, node->word, len, node->hash);
+                if (target == NULL)
+                {
+                    target = create_main_node(hash, node->word, len);
+                    if (target == NULL || insert_main_node(hash, target) == FAILURE ||
+                        (positions && positions_attach(&hash->arena, target) == FAILURE))
+                        goto cleanup;
+                }
+            }
+
+            Sub_node *sub = create_sub_node(&hash->arena, target, doc_id); // Appended after live files
+            if (sub == NULL)
+                goto cleanup;
+            sub->word_count = subs[i].word_count;
+            if (positions && positions_copy(&hash->arena, target, target->file_count - 1, node, i, subs[i].word_count) == FAILURE)
+                goto cleanup;
+        }
+    }
+    status = postings_pack_all(hash); // Words that gained files from the backup
+
+cleanup:
+    free(scratch);
+    free(remap);
+    free_hash(from); // Sub nodes were copied, the backup is no longer needed
+    return status;
+}
@@ -18,53 +18,437 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
 
 /* Size limits */
-#define FILE_SIZE 50
 #define WORD_SIZE 50
-#define HASH_SIZE 27 // a–z + special symbol bucket
+#define MAX_WORD_LEN (WORD_SIZE - 1) // Longer tokens are truncated by the tokenizer
+#define HASH_SIZE 27          // a–z + special symbol category (backup format index)
+#define HASH_INITIAL_SIZE 1024 // Initial slot count, must be a power of two
+#define HASH_MAX_LOAD 70       // Grow the table once it is 70% full
+#define ARENA_CHUNK_SIZE (1 << 20) // Bytes per arena chunk
+#define ARENA_ALIGN 8              // Alignment of every arena allocation
+#define ARENA_CLASSES 40           // Power-of-two block classes recycled by arena_grow()
+#define POOL_CHUNK_SIZE (256 << 10) // Bytes per string pool chunk
+#define DOC_INITIAL_SIZE 64        // Initial document table capacity
+#define DOC_NONE UINT32_MAX        // Invalid / absent document ID
+#define MAX_THREADS 64             // Upper bound for --threads
+#define VALIDATE_FILES_PER_THREAD 1024 // Input files sized per thread during validation
+#define FILE_LIST_SHOWN 20         // File names printed by print_file_list(), the rest are counted
+#define INDEX_MAGIC "INVSRCH"      // Binary index signature (8 bytes with NUL)
+#define INDEX_VERSION 5            // Binary index format version (2: document lengths, 3: positions, 4: packed postings, 5: chunks)
+#define INDEX_POSITIONS 1u         // Bin_header.flags: the index has a positions section
+#define INDEX_NORMALIZE_SHIFT 8    // Bin_header.flags bits 8-11: NORM_* steps the words went through
+#define INDEX_CHUNK_BYTES (1 << 20) // Smallest chunk of a .bin index, saved and loaded by one thread
+#define INDEX_MAX_CHUNKS 1024      // Chunks grow beyond INDEX_CHUNK_BYTES rather than exceed this
+#define LOAD_BUFFER_SIZE (1 << 20) // Read buffer of the text backup loader
+#define TOKEN_BATCH 256            // Tokens split off before they are inserted (index_file)
+#define QUERY_SIZE 256             // Longest query line read by the menu
+#define MAX_QUERY_NODES 64         // Terms and operators in one query
+#define GALLOP_RATIO 32            // Intersect by galloping once one list is this many times longer
+#define TOP_K_DEFAULT 10           // Ranked results shown per search (--top N)
+#define BM25_K1 1.2                // BM25 term frequency saturation
+#define BM25_B 0.75                // BM25 document length normalisation
+#define VARINT_MAX_BYTES 5         // Longest varint encoding of a uint32_t
+#define POSTING_BLOCK 128          // Sub nodes per bit-packed postings block
+#define CACHE_DEFAULT_MB 16        // Query result cache budget (--cache MB, 0 disables)
+#define STATS_HISTOGRAM 8          // Probe length buckets: 1, 2-3, 4-7, ... 128+
+#define NORM_LOWER 1u              // Token normalization (--normalize): fold A-Z to a-z
+#define NORM_PUNCT 2u              // Strip leading and trailing punctuation
+#define NORM_STOP 4u               // Drop English stop words
+#define NORM_STEM 8u               // Porter stemming
+#define NORM_ALL 15u
+#define NORM_DEFAULT (NORM_LOWER | NORM_PUNCT)
+#define NORM_NAME_SIZE 24          // "lower,punct,stop,stem" and its NUL
+#define BUILD_MEMORY_MB 256        // External build memory budget (--memory MB)
+#define BUILD_MEMORY_MIN_MB 4      // Smallest budget accepted, a block needs a few arena chunks
+
+/* Operation status codes */
+typedef enum
+{
+    FAILURE = 0,
+    SUCCESS,
+    DUPLICATE,
+    EXIT
+} Status;
 
 /* ------------------ File List Node ------------------ */
 typedef struct node
 {
-    char file_name[FILE_SIZE];
     struct node *next;
+    char file_name[]; // Any length, allocated with the node
 } File_list;
 
 /* ------------------ Sub Node (File Occurrences) ------------------ */
 typedef struct sub
 {
-    int word_count;
-    char file_name[FILE_SIZE];
-    struct sub *s_link;
+    uint32_t doc_id;     // Index into the document table
+    uint32_t word_count; // Occurrences of the word in that file
 } Sub_node;
 
+/* ------------------ Positions (optional, --positions) ------------------ */
+typedef struct positions
+{
+    uint32_t *offsets;         // Sub node index -> first byte of that file's positions in data
+    uint8_t *data;             // Per file, word_count varint deltas of token offsets
+    uint32_t size;             // Bytes used in data
+    uint32_t capacity;         // Bytes allocated in data, 0 while borrowed from a mapped index
+    uint32_t offsets_capacity; // Entries allocated in offsets, 0 while borrowed or exactly sized
+    uint32_t last;             // Previous offset of the word in the file being indexed
+} Positions_t;
+
 /* ------------------ Main Node (Unique Word Entry) ------------------ */
 typedef struct main
 {
-    int file_count;
-    char word[WORD_SIZE];
-    Sub_node *s_link;
-    struct main *m_link;
+    uint64_t hash;       // Cached full-word hash, reused on resize
+    const char *word;    // NUL-terminated term bytes in the index's string pool
+    Sub_node *s_list;    // Contiguous sub nodes, one per file, while the word is being modified
+    const uint8_t *packed; // Compressed sub nodes (postings.c), NULL while s_list is in use
+    Positions_t *positions; // Token offsets per sub node, NULL unless positional
+    struct main *m_link; // Next word in insertion order
+    uint32_t file_count; // Sub nodes in use
+    uint32_t capacity;   // Sub nodes allocated (power of two), 0 while packed
+    uint32_t word_len;   // Cached strlen(word)
 } Main_node;
 
-/* ------------------ Hash Table Bucket ------------------ */
+/* ------------------ Arena (index-owned node memory) ------------------ */
+typedef struct arena_chunk
+{
+    struct arena_chunk *next;
+    size_t size;           // Usable bytes in data[]
+    size_t used;           // Bytes already handed out
+    unsigned char data[];
+} Arena_chunk;
+
+typedef struct arena
+{
+    Arena_chunk *chunks;                // Current chunk first
+    void *free_blocks[ARENA_CLASSES];   // Recycled blocks, one list per power-of-two size
+    size_t bytes_used;                  // Bytes handed out to nodes
+    size_t bytes_reserved;              // Bytes obtained from malloc
+} Arena_t;
+
+/* ------------------ String Pool (term bytes) ------------------ */
+typedef struct string_pool
+{
+    Arena_chunk *chunks;   // Current chunk first; chunks never move
+    size_t bytes_used;     // Term bytes including their NULs
+    size_t bytes_reserved; // Bytes obtained from malloc
+} String_pool;
+
+/* ------------------ Document Table (file name <-> ID) ------------------ */
+typedef struct doc_table
+{
+    char **names;          // Document ID -> file name (stored in the arena), NULL once removed
+    uint32_t *lengths;     // Document ID -> words in the file (BM25 document length)
+    uint64_t total_length; // Sum of lengths[] over live documents
+    uint64_t generation;   // Bumped by every change to the table, i.e. to the index
+    uint32_t live;         // Documents not removed
+    uint32_t count;        // Documents registered, IDs are 0 .. count - 1
+    uint32_t capacity;     // Entries allocated in names[]
+    uint32_t *slots;       // Open-addressing name -> ID map, DOC_NONE when empty
+    size_t slot_capacity;  // Slots allocated (power of two)
+} Doc_table;
+
+/* ------------------ Term Dictionary (wildcard search) ------------------ */
+typedef struct term_dict
+{
+    Main_node **sorted;   // Words in byte order
+    Main_node **reversed; // Words in byte order of their reversed spelling
+    size_t count;         // Words in both arrays
+    bool stale;           // Vocabulary changed since the arrays were built
+} Term_dict;
+
+/* ------------------ Query Result Cache ------------------ */
+typedef struct query_cache Query_cache; // Private to cache.c
+
+typedef struct cache_stats
+{
+    uint64_t hits;          // Searches answered from the cache
+    uint64_t misses;        // Searches that ran the query
+    uint64_t evictions;     // Entries dropped to stay within the budget
+    uint64_t invalidations; // Times the whole cache was emptied by an index change
+    size_t entries;
+    size_t bytes;           // Charged to the budget
+    size_t budget;
+} Cache_stats;
+
+/* ------------------ Segmented Index ------------------ */
+typedef struct segment_set Segment_set;   // Private to segments.c
+typedef struct segment_view Segment_view; // Likewise
+
+/* ------------------ Write-Ahead Log ------------------ */
+typedef struct journal Journal_t; // Private to journal.c
+
+/* ------------------ Instrumentation (--stats) ------------------ */
+typedef enum
+{
+    PHASE_OPEN,     // Opening / mapping input files
+    PHASE_TOKENIZE, // Splitting them into words and normalizing them (includes page faults of the mapping)
+    PHASE_INSERT,   // Hash lookups and sub node updates
+    PHASE_MERGE,    // Merging partial indexes of a parallel build, or the runs of an external build
+    PHASE_PACK,     // Compressing sub node lists
+    PHASE_SAVE,     // Writing a .txt backup, .bin index or sorted run
+    PHASE_LOAD,     // Reading one
+    PHASE_PARSE,    // Parsing queries
+    PHASE_MATCH,    // Evaluating them over the postings
+    PHASE_RANK,     // BM25 top-k selection
+    PHASE_COUNT
+} Stats_phase;
+
+typedef struct stats_counters // One per thread, summed by stats_collect(); uint64_t fields only
+{
+    uint64_t lookups;                     // Probe sequences of the word table
+    uint64_t probes;                      // Slots they inspected
+    uint64_t probe_hist[STATS_HISTOGRAM]; // Lookups by probe count
+    uint64_t resizes;                     // Word table doublings
+    uint64_t main_nodes;                  // create_main_node() calls
+    uint64_t main_bytes;
+    uint64_t sub_nodes;                   // create_sub_node() calls
+    uint64_t sub_bytes;                   // Sub node arrays allocated by them
+    uint64_t files;                       // Files indexed
+    uint64_t file_bytes;
+    uint64_t tokens;
+    uint64_t queries;                     // search_cached() calls
+    uint64_t calls[PHASE_COUNT];
+    uint64_t wall_ns[PHASE_COUNT];
+    uint64_t cpu_ns[PHASE_COUNT];         // Thread CPU time
+    struct stats_counters *next;          // Live threads
+} Stats_counters;
+
+typedef struct stats_timer
+{
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+} Stats_timer;
+
+extern bool stats_timing; // Phase timers run (--stats)
+
+#ifndef NO_STATS
+extern _Thread_local Stats_counters *stats_thread;
+Stats_counters *stats_register(void);
+void stats_start(Stats_timer *timer);
+void stats_stop(Stats_timer *timer, Stats_phase phase);
+
+#define STAT_ADD(field, n) ((stats_thread ? stats_thread : stats_register())->field += (n))
+#define STAT_START(timer) stats_start(&(timer))
+#define STAT_STOP(timer, phase) stats_stop(&(timer), (phase))
+#define STAT_PROBES(n) stats_probes(n)
+
+static inline void stats_probes(uint64_t n) // One word table lookup that inspected n slots
+{
+    Stats_counters *c = stats_thread ? stats_thread : stats_register();
+    c->lookups++;
+    c->probes += n;
+    c->probe_hist[n >= (1u << (STATS_HISTOGRAM - 1)) ? STATS_HISTOGRAM - 1 : 63 - __builtin_clzll(n)]++;
+}
+#else /* -DNO_STATS: counters and timers compile to nothing */
+#define STAT_ADD(field, n) ((void)0)
+#define STAT_START(timer) ((void)(timer))
+#define STAT_STOP(timer, phase) ((void)(timer))
+#define STAT_PROBES(n) ((void)(n))
+#endif
+
+/* ------------------ Hash Table (open addressing) ------------------ */
 typedef struct hash
 {
-    int index;
-    Main_node *m_link;
+    Main_node **table; // Slots, NULL when empty, probed linearly
+    size_t capacity;   // Number of slots (power of two)
+    size_t count;      // Number of words stored
+    Main_node *head;   // First word inserted (for display / save order)
+    Main_node *tail;   // Last word inserted
+    Arena_t arena;     // Owns every Main_node and Sub_node of the index
+    String_pool strings; // Owns the bytes of every word
+    Doc_table docs;    // Files known to the index
+    void *map;         // Mapped binary index serving packed sub nodes, or NULL
+    size_t map_size;
+    Term_dict dict;    // Sorted views for prefix / suffix / wildcard queries
+    bool positional;   // Every word records token positions (phrase / NEAR queries)
+    unsigned normalize; // NORM_* steps applied to tokens and query words
+    Query_cache *cache; // Recent query results, NULL when disabled
+    Status (*spill)(struct hash *hash); // External build (spimi.c): index_file() hands over full blocks, NULL otherwise
+    void *spill_context;
+    Segment_set *segments; // Segmented index: this table is only a handle on the set, NULL otherwise
+    Segment_view *view;    // Set on the document table of one view of a segment set (segments.c)
 } Hash_t;
 
-/* Operation status codes */
+/* ------------------ Binary Index File (all sections 8-byte aligned) ------------------ */
+typedef struct bin_header
+{
+    char magic[8];            // INDEX_MAGIC
+    uint32_t version;         // INDEX_VERSION
+    uint32_t header_size;     // sizeof(Bin_header)
+    uint32_t doc_count;       // Entries in the document table
+    uint32_t flags;           // INDEX_POSITIONS, NORM_* << INDEX_NORMALIZE_SHIFT
+    uint64_t term_count;      // Entries in the term dictionary
+    uint64_t posting_count;   // Sub nodes stored in the postings section
+    uint64_t docs_offset;     // Bin_doc[doc_count] followed by the name bytes
+    uint64_t docs_size;
+    uint64_t chunks_offset;   // Bin_chunk[chunk_count]
+    uint64_t chunk_count;
+    uint64_t terms_offset;    // Bin_term[term_count], insertion order
+    uint64_t terms_size;
+    uint64_t strings_offset;  // Word bytes referenced by Bin_term
+    uint64_t strings_size;
+    uint64_t postings_offset; // Packed sub nodes (postings.c), one run per word
+    uint64_t postings_size;
+    uint64_t positions_offset; // Per word: uint32_t offsets[file_count] + varint bytes, 4-byte aligned
+    uint64_t positions_size;   // 0 unless INDEX_POSITIONS
+    uint64_t checksum[2];     // docs, chunk table; the other sections are checksummed per chunk
+    uint64_t header_checksum; // Over every field above
+} Bin_header;
+
+/* A run of consecutive words, with its bytes in the terms, strings, postings and positions sections */
+typedef struct bin_chunk
+{
+    uint64_t first_term;       // Words [first_term, first_term + term_count) of the dictionary
+    uint64_t term_count;
+    uint64_t strings_offset;   // Start of the chunk in each section, 8-byte aligned; it ends
+    uint64_t postings_offset;  // where the next chunk starts, or with the section
+    uint64_t positions_offset;
+    uint64_t checksum[4];      // Of the chunk's terms, strings, postings and positions bytes
+} Bin_chunk;
+
+typedef struct bin_doc
+{
+    uint32_t name_offset; // From the end of the Bin_doc array
+    uint32_t name_len;    // 0 for a removed file
+    uint32_t length;      // Words in the file
+} Bin_doc;
+
+typedef struct bin_term
+{
+    uint64_t hash;          // Cached full-word hash
+    uint64_t posting_offset; // Word's packed sub nodes, from the start of the postings section
+    uint32_t word_offset;   // Into the strings section
+    uint32_t word_len;
+    uint32_t file_count;    // Sub nodes belonging to the word
+    uint32_t positions;     // Word's block in the positions section, in 4-byte units
+} Bin_term;
+
+typedef struct section_writer
+{
+    FILE *fptr;
+    uint64_t size;     // Bytes written to the current section
+    uint64_t checksum; // Running checksum of the current section, or of its current chunk
+    unsigned char pending[8];
+    size_t pending_len; // Bytes waiting for a full 8-byte word
+    bool failed;
+} Section_writer;
+
+/* ------------------ Tokenizer (zero-copy word slices) ------------------ */
+typedef struct tokenizer
+{
+    const char *data; // Mapped (or read) file contents
+    size_t size;      // Bytes in data
+    size_t pos;       // Scan position
+    size_t block;     // Offset of the 64-byte block described by words
+    uint64_t words;   // Bit i set when data[block + i] is a word byte not handed out yet
+    bool mapped;      // data is an mmap() rather than a malloc() buffer
+    long truncated;   // Tokens cut down to MAX_WORD_LEN bytes
+} Tokenizer_t;
+
+/* ------------------ Posting Cursor (forward seeks over one word) ------------------ */
+typedef struct posting_cursor
+{
+    const Main_node *node;
+    uint32_t block;                   // Decoded block, UINT32_MAX before the first seek
+    uint32_t first;                   // Sub node index of docs[0]
+    uint32_t size;                    // Entries decoded in docs / counts
+    uint32_t pos;                     // Sub node index reached so far
+    bool damaged;                     // A block failed its checks; seeks find nothing more
+    uint32_t docs[POSTING_BLOCK];
+    uint32_t counts[POSTING_BLOCK];
+} Posting_cursor;
+
+/* ------------------ Boolean Query (parsed expression tree) ------------------ */
 typedef enum
 {
-    FAILURE = 0,
-    SUCCESS,
-    DUPLICATE,
-    EXIT
-} Status;
+    Q_TERM,
+    Q_AND,
+    Q_OR,
+    Q_NOT,
+    Q_WILDCARD,
+    Q_PHRASE,
+    Q_NEAR
+} Query_op;
+
+typedef struct query_node
+{
+    Query_op op;
+    int left;             // Operand node index (-1 for Q_TERM / Q_WILDCARD), first Q_TERM of a Q_PHRASE
+    int right;            // Second operand of Q_AND / Q_OR / Q_NEAR, word count of a Q_PHRASE
+    uint32_t distance;    // Q_NEAR: largest allowed difference of the two words' positions, 1 = adjacent
+    char word[WORD_SIZE]; // Q_TERM word or Q_WILDCARD pattern
+} Query_node;
+
+typedef struct query
+{
+    Query_node nodes[MAX_QUERY_NODES];
+    int count; // Nodes in use
+    int root;  // Top of the expression
+} Query_t;
+
+typedef struct doc_set
+{
+    uint32_t *ids;  // Matching document IDs, ascending (malloc)
+    uint32_t count;
+} Doc_set;
+
+typedef struct ranked_doc
+{
+    uint32_t doc_id;
+    uint32_t word_count; // Occurrences of the query's words
+    double score;        // BM25
+} Ranked_doc;
+
+typedef struct rank_scope // Collection a segment is ranked in (segments.c)
+{
+    Hash_t **indexes;      // Every segment, the ranked one included
+    uint32_t count;
+    uint32_t live;         // Live files over the whole set
+    uint64_t total_length; // And their words
+} Rank_scope;
+
+/* ------------------ Command-line Options ------------------ */
+typedef enum
+{
+    FORMAT_TSV,
+    FORMAT_JSON
+} Output_format;
+
+typedef struct options
+{
+    int threads;          // Worker threads for create_database (1 = sequential)
+    bool verify_postings; // Checksum the postings section when loading a .bin index
+    int top_k;            // Ranked results shown per search
+    bool positions;       // Record token positions for phrase / NEAR queries
+    char *index_name;     // Batch mode: backup to search (--index)
+    char *query_name;     // Batch mode: one query per line (--queries), NULL for the menu
+    Output_format format; // Batch mode output (--format tsv|json)
+    char *listen_addr;    // Server mode: Unix socket path or localhost TCP port (--listen)
+    size_t cache_size;    // Query result cache budget in bytes (--cache MB)
+    bool stats;           // Time the build / load / query phases and report them (--stats)
+    unsigned normalize;   // NORM_* steps for new indexes and text backups (--normalize)
+    char *build_name;     // External build: .bin index to write, no menu (--build)
+    size_t memory_budget; // External build: bytes for the in-memory block, then for the merge buffers (--memory MB)
+    char *segment_dir;    // Segmented index: directory to add the files to, or to compact (--segments)
+    char *journal_name;   // Journaled database: .bin snapshot with a write-ahead log beside it (--journal)
+} Options_t;
+
+/* ------------------ Formatted Results ------------------ */
+typedef struct text_buffer
+{
+    char *data;
+    size_t len;
+    size_t capacity;
+    bool failed; // An append ran out of memory
+} Text_buffer;
 
 /* ------------------ File Validation ------------------ */
+Status read_options(int *argc, char *argv[], Options_t *options);
 Status read_and_validate_input_arguments(int argc, char *argv[], File_list **file);
 Status validate_file_extension(char *argv);
 long validate_file_size(FILE *fptr);
@@ -73,21 +457,165 @@ Status insert_at_last(File_list **head, char *argv);
 
 /* ------------------ Initialization ------------------ */
 Status initialise_hash(Hash_t *hash);
+void free_hash(Hash_t *hash);
+Status reset_hash(Hash_t *hash);
 Status validate_backup_database(FILE *fptr);
 
 /* ------------------ Database Operations ------------------ */
-Status create_database(Hash_t *hash_array, File_list *head);
-void display_database(Hash_t *hash_array);
-Status search_database(Hash_t *hash_arr, char *data);
-Status save_database(Hash_t *hash_array, char *file_name);
-Status update_database(Hash_t *hash_array, char *backup, File_list **head);
+Status index_file(Hash_t *hash, const char *file_name, uint32_t doc_id, uint32_t *length);
+Status create_database(Hash_t *hash, File_list *head);
+Status create_database_parallel(Hash_t *hash, File_list *head, int threads);
+void display_database(Hash_t *hash);
+Status search_database(Hash_t *hash, char *query, int top_k);
+Status save_database(Hash_t *hash, char *file_name);
+Status update_database(Hash_t *hash, char *backup, File_list **head);
+Status add_files(Hash_t *hash, File_list **files, int threads);
+Status remove_files(Hash_t *hash, File_list *files);
+Status merge_database(Hash_t *hash, Hash_t *from);
+
+/* ------------------ Binary Index ------------------ */
+bool is_index_file(const char *file_name);
+Status save_index(Hash_t *hash, const char *file_name);
+Status load_index(Hash_t *hash, const char *file_name, File_list **head, bool verify_postings);
+uint64_t checksum_words(uint64_t sum, const void *data, size_t len);
+void section_begin(Section_writer *w);
+void section_write(Section_writer *w, const void *data, size_t len);
+void section_end(Section_writer *w);
+uint64_t section_chunk(Section_writer *w);
+void write_chunk_table(Section_writer *w, Bin_header *header, const Bin_chunk *chunks);
+void index_header_init(Bin_header *header, uint32_t doc_count, bool positional, unsigned normalize);
+void write_doc_section(Section_writer *w, const Doc_table *docs);
+Status commit_index(Section_writer *w, Bin_header *header, const char *temp_name, const char *file_name);
+
+/* ------------------ External Build ------------------ */
+Status run_build(const Options_t *options, File_list *files);
+
+/* ------------------ Segmented Index ------------------ */
+bool is_segment_dir(const char *name);
+Status run_segments(const Options_t *options, File_list *files);
+Status segments_open(Hash_t *hash, const char *dir, const Options_t *options);
+Status segments_start_merger(Hash_t *hash);
+void segments_close(Hash_t *hash);
+Hash_t *segments_acquire(Hash_t *hash);
+void segments_release(Hash_t *hash, Hash_t *index);
+Status segments_search(Hash_t *index, const Query_t *query, uint32_t k, Ranked_doc *top, uint32_t *shown, uint32_t *matches);
+
+/* ------------------ Write-Ahead Log ------------------ */
+Status journal_open(Journal_t **journal, Hash_t *hash, const char *name, const Options_t *options, File_list **head);
+Status journal_add(Journal_t *journal, File_list *files);
+Status journal_remove(Journal_t *journal, File_list *files);
+Status journal_checkpoint(Journal_t *journal, Hash_t *hash, bool force);
+void journal_close(Journal_t *journal, Hash_t *hash);
 
 /* ------------------ Utility Functions ------------------ */
 void print_file_list(File_list **fileList);
 Status delete_duplicate_file(File_list **head, char *file_name);
-void find_index(int *index, char *buffer);
-Main_node *create_main_node(char *word);
-Sub_node *create_sub_node(char *filename);
+void remove_indexed_files(File_list **head, Doc_table *docs, const char *source);
+void find_index(int *index, const char *buffer);
+uint64_t hash_word(const char *word, size_t len);
+Status reserve_hash(Hash_t *hash, size_t count);
+Main_node *lookup_word(Hash_t *hash, const char *word, size_t len, uint64_t word_hash);
+Status insert_main_node(Hash_t *hash, Main_node *node);
+Status remove_main_node(Hash_t *hash, Main_node *node, Main_node *prev);
+Main_node *create_main_node(Hash_t *hash, const char *word, size_t len);
+Sub_node *create_sub_node(Arena_t *arena, Main_node *node, uint32_t doc_id);
 int delete_list(File_list **head);
 
+/* ------------------ Document Table ------------------ */
+Status doc_table_init(Doc_table *docs);
+void doc_table_free(Doc_table *docs);
+uint32_t doc_table_add(Doc_table *docs, Arena_t *arena, const char *file_name);
+uint32_t doc_table_add_removed(Doc_table *docs);
+Status doc_table_remove(Doc_table *docs, uint32_t doc_id);
+void doc_table_set_length(Doc_table *docs, uint32_t doc_id, uint32_t length);
+uint32_t doc_table_find(Doc_table *docs, const char *file_name);
+const char *doc_name(Doc_table *docs, uint32_t doc_id);
+
+/* ------------------ Tokenizer ------------------ */
+Status tokenizer_open(Tokenizer_t *tok, const char *file_name);
+bool tokenizer_next(Tokenizer_t *tok, const char **token, size_t *len);
+void tokenizer_close(Tokenizer_t *tok);
+size_t clamp_word_len(const char *word, size_t len);
+
+/* ------------------ Normalization ------------------ */
+size_t normalize_word(unsigned flags, const char **word, size_t len, char *buf);
+size_t normalize_pattern(unsigned flags, const char **pattern, size_t len, char *buf);
+Status parse_normalize(const char *text, unsigned *flags);
+const char *normalize_name(unsigned flags, char *out);
+
+/* ------------------ Query Engine ------------------ */
+Status query_parse(const char *text, unsigned normalize, Query_t *query);
+Status query_run(Hash_t *hash, const Query_t *query, Doc_set *result);
+void doc_set_free(Doc_set *set);
+Status query_positive_words(Hash_t *hash, const Query_t *query, Main_node ***words, size_t *count);
+
+/* ------------------ Positions ------------------ */
+Status positions_attach(Arena_t *arena, Main_node *node);
+Status positions_reserve(Arena_t *arena, Main_node *node, uint32_t capacity);
+Status positions_add(Arena_t *arena, Main_node *node, uint32_t position);
+Status positions_copy(Arena_t *arena, Main_node *to, uint32_t to_index, const Main_node *from, uint32_t from_index, uint32_t word_count);
+uint32_t positions_span(const uint8_t *data, uint32_t count);
+void positions_decode(const uint8_t *data, uint32_t count, uint32_t *out);
+void positions_drop(Hash_t *hash);
+
+/* ------------------ Compressed Postings ------------------ */
+uint32_t varint_put(uint8_t *out, uint32_t value);
+uint32_t varint_get(const uint8_t **in);
+size_t postings_packed_size(const Sub_node *subs, uint32_t count);
+void postings_encode(const Sub_node *subs, uint32_t count, uint8_t *out);
+Status postings_pack_list(Arena_t *arena, Main_node *node, const Sub_node *subs, uint32_t count);
+Status postings_pack(Arena_t *arena, Main_node *node);
+Status postings_pack_all(Hash_t *hash);
+Status postings_unpack(Arena_t *arena, Main_node *node);
+size_t postings_size(const Main_node *node);
+Status postings_check(const uint8_t *packed, uint64_t size, uint32_t count, uint32_t doc_count);
+Status postings_decode(const Main_node *node, Sub_node *out);
+Status postings_decode_docs(const Main_node *node, uint32_t *out);
+const Sub_node *postings_get(const Main_node *node, Sub_node **scratch, uint32_t *scratch_size);
+void cursor_init(Posting_cursor *cursor, const Main_node *node);
+bool cursor_seek(Posting_cursor *cursor, uint32_t doc_id, uint32_t *index, uint32_t *word_count);
+
+/* ------------------ Batch Search / Server ------------------ */
+void text_append(Text_buffer *buf, const char *format, ...);
+Status load_search_index(Hash_t *hash, const Options_t *options);
+void format_query(Hash_t *hash, const Options_t *options, const char *text, uint32_t line, Ranked_doc *top, Text_buffer *out);
+Status run_batch(const Options_t *options);
+Status run_server(const Options_t *options);
+
+/* ------------------ Query Result Cache ------------------ */
+Status query_cache_create(Hash_t *hash, size_t budget);
+void query_cache_clear(Query_cache *cache);
+void query_cache_free(Hash_t *hash);
+void query_cache_stats(const Hash_t *hash, Cache_stats *stats);
+void print_cache_stats(FILE *out, const Hash_t *hash);
+Status search_cached(Hash_t *hash, const Query_t *query, uint32_t k, Ranked_doc *top, uint32_t *shown, uint32_t *matches);
+
+/* ------------------ Instrumentation ------------------ */
+void stats_collect(Stats_counters *total);
+void print_stats(FILE *out, const Hash_t *hash);
+
+/* ------------------ Ranking ------------------ */
+Status rank_top_k(Hash_t *hash, const Query_t *query, const Doc_set *matches, uint32_t k, Ranked_doc *top, uint32_t *count,
+                  const Rank_scope *scope);
+
+/* ------------------ Term Dictionary ------------------ */
+Status term_dict_update(Hash_t *hash);
+Status match_terms(Hash_t *hash, const char *pattern, Main_node ***nodes, size_t *count);
+void term_dict_free(Term_dict *dict);
+
+/* ------------------ Arena Allocator ------------------ */
+void arena_init(Arena_t *arena);
+void *arena_alloc(Arena_t *arena, size_t size);
+void *arena_grow(Arena_t *arena, void *block, size_t old_size, size_t new_size);
+void arena_release(Arena_t *arena, void *block, size_t size);
+void *arena_reuse(Arena_t *arena, size_t size);
+void arena_adopt(Arena_t *arena, Arena_t *from);
+void arena_free(Arena_t *arena);
+
+/* ------------------ String Pool ------------------ */
+void pool_init(String_pool *pool);
+const char *pool_add(String_pool *pool, const char *word, size_t len);
+void pool_adopt(String_pool *pool, String_pool *from);
+void pool_free(String_pool *pool);
+
 #endif
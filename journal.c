@@ -0,0 +1,443 @@
+/***********************************************************************
+ *  File Name   : journal.c
+ *  Description : Write-ahead log for the menu's database (--journal).
+ *                The database lives in two files:
+ *
+ *                  index.bin      snapshot, an ordinary .bin index
+ *                  index.bin.wal  every change made since the snapshot
+ *
+ *                Adding or removing files appends one record per file
+ *                to the log before the database is touched. The
+ *                records of one menu operation are written with a
+ *                single write() and made durable with a single
+ *                fdatasync() (group commit), so saving costs an append
+ *                instead of rewriting the whole backup. A record
+ *                carries a sequence number and a checksum; a record
+ *                torn by a crash fails them and is cut off with
+ *                everything after it.
+ *
+ *                Once JOURNAL_SNAPSHOT_FILES records have accumulated,
+ *                and when the menu exits, a snapshot is saved: the
+ *                index is written to index.bin.tmp, flushed to disk
+ *                and renamed over index.bin (binary_index.c), then the
+ *                log is truncated. Loading a backup into the database
+ *                cannot be logged as file names, so it takes a
+ *                snapshot at once.
+ *
+ *                Opening the journal loads the snapshot and replays
+ *                the log. Records name files, which are indexed again
+ *                from disk, so recovery costs at most one snapshot
+ *                interval of indexing. Replay is idempotent: a name is
+ *                only added when it is missing and only removed when
+ *                present, so a crash between the rename and the
+ *                truncation, which replays records the snapshot
+ *                already holds, ends in the same set of files.
+ *
+ *                Log layout (native byte order):
+ *                  Journal_header                magic, version, flags
+ *                  Journal_record, name padded   one per file, in order
+ *
+ *                Functions:
+ *                  - journal_open()
+ *                  - journal_add() / journal_remove()
+ *                  - journal_checkpoint()
+ *                  - journal_close()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#define JOURNAL_MAGIC "INVWAL"
+#define JOURNAL_VERSION 1
+#define JOURNAL_SUFFIX ".wal"
+#define JOURNAL_SNAPSHOT_FILES 1024 // Records replayed at most on startup
+#define JOURNAL_ADD 1
+#define JOURNAL_REMOVE 2
+
+typedef struct journal_header
+{
+    char magic[8];     // "INVWAL"
+    uint32_t version;
+    uint32_t flags;    // Same layout as Bin_header.flags: positions, normalization steps
+    uint64_t checksum; // Over the fields above
+} Journal_header;
+
+typedef struct journal_record
+{
+    uint64_t checksum; // Over the rest of the record and its padded name
+    uint64_t sequence; // 1 for the first record after a snapshot, then +1
+    uint32_t type;     // JOURNAL_ADD or JOURNAL_REMOVE
+    uint32_t name_len; // Name bytes that follow, padded to 8
+    int64_t size;      // JOURNAL_ADD: file size when logged
+    int64_t mtime;     // JOURNAL_ADD: modification time in ns when logged
+} Journal_record;
+
+struct journal
+{
+    char name[PATH_MAX];              // Snapshot
+    char log_name[PATH_MAX + 8];      // name + ".wal"
+    int fd;                           // Log, appended to and flock()ed
+    uint64_t sequence;                // Of the last record written
+    uint32_t records;                 // Records since the last snapshot
+    int threads;                      // Indexing threads for replay
+};
+
+static uint32_t journal_flags(const Hash_t *hash)
+{
+    return (hash->positional ? INDEX_POSITIONS : 0) | hash->normalize << INDEX_NORMALIZE_SHIFT;
+}
+
+/* Checksum of a record and its padded name */
+static uint64_t record_checksum(const Journal_record *rec, const char *padded)
+{
+    uint64_t sum = checksum_words(0, (const char *)rec + sizeof(rec->checksum), sizeof(*rec) - sizeof(rec->checksum));
+    return checksum_words(sum, padded, (rec->name_len + 7) & ~7u);
+}
+
+/* Makes a rename in the directory of path durable */
+static void sync_directory(const char *path)
+{
+    char dir[PATH_MAX] = ".";
+    const char *slash = strrchr(path, '/');
+    if (slash)
+        snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/* Writes all of data to the log and flushes it to disk; a failed append is cut off again */
+static Status log_write(Journal_t *journal, const void *data, size_t len)
+{
+    off_t end = lseek(journal->fd, 0, SEEK_END);
+    const char *bytes = data;
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = write(journal->fd, bytes + done, len - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+
+    if (done < len || fdatasync(journal->fd) != 0)
+    {
+        fprintf(stderr, "Error: Unable to write the log '%s'\n", journal->log_name);
+        if (end >= 0 && ftruncate(journal->fd, end) == 0)
+            fdatasync(journal->fd);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* Empties the log down to a fresh header for the table's settings */
+static Status log_reset(Journal_t *journal, const Hash_t *hash)
+{
+    Journal_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.version = JOURNAL_VERSION;
+    header.flags = journal_flags(hash);
+    header.checksum = checksum_words(0, &header, offsetof(Journal_header, checksum));
+
+    if (ftruncate(journal->fd, 0) != 0)
+    {
+        fprintf(stderr, "Error: Unable to truncate the log '%s'\n", journal->log_name);
+        return FAILURE;
+    }
+    journal->sequence = 0;
+    journal->records = 0;
+    return log_write(journal, &header, sizeof(header));
+}
+
+/* Group commit: one record per file, written and flushed together */
+static Status log_files(Journal_t *journal, uint32_t type, File_list *files)
+{
+    size_t len = 0;
+    for (File_list *temp = files; temp; temp = temp->next)
+    {
+        if (strlen(temp->file_name) >= PATH_MAX) // Replay reads names into PATH_MAX bytes
+        {
+            fprintf(stderr, "Error: File name '%s' is too long to be logged\n", temp->file_name);
+            return FAILURE;
+        }
+        len += sizeof(Journal_record) + ((strlen(temp->file_name) + 7) & ~(size_t)7);
+    }
+    if (len == 0)
+        return SUCCESS;
+
+    char *buffer = calloc(1, len); // Zeroed, so the padding is too
+    if (buffer == NULL)
+        return FAILURE;
+
+    char *out = buffer;
+    uint64_t sequence = journal->sequence;
+    uint32_t records = 0;
+    for (File_list *temp = files; temp; temp = temp->next)
+    {
+        Journal_record rec = {0, ++sequence, type, (uint32_t)strlen(temp->file_name), -1, 0};
+        struct stat st;
+        if (type == JOURNAL_ADD && stat(temp->file_name, &st) == 0) // Lets replay notice a changed file
+        {
+            rec.size = st.st_size;
+            rec.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+        }
+        char *name = out + sizeof(rec);
+        memcpy(name, temp->file_name, rec.name_len);
+        rec.checksum = record_checksum(&rec, name);
+        memcpy(out, &rec, sizeof(rec));
+        out = name + ((rec.name_len + 7) & ~7u);
+        records++;
+    }
+
+    Status status = log_write(journal, buffer, len);
+    free(buffer);
+    if (status == SUCCESS)
+    {
+        journal->sequence = sequence;
+        journal->records += records;
+    }
+    return status;
+}
+
+/* Applies one run of records of the same type; names the table already agrees with are skipped */
+static Status replay_run(Journal_t *journal, Hash_t *hash, uint32_t type, File_list **run)
+{
+    File_list **link = run;
+    while (*link) // Idempotence: add only missing names, remove only present ones
+    {
+        File_list *curr = *link;
+        bool indexed = doc_table_find(&hash->docs, curr->file_name) != DOC_NONE;
+        if (indexed == (type == JOURNAL_ADD))
+        {
+            *link = curr->next;
+            free(curr);
+        }
+        else
+        {
+            link = &curr->next;
+        }
+    }
+
+    Status status = SUCCESS;
+    if (*run && type == JOURNAL_ADD)
+        status = add_files(hash, run, journal->threads);
+    else if (*run)
+        status = remove_files(hash, *run);
+    delete_list(run);
+    return status;
+}
+
+/* Reads the log, cuts off a torn tail and replays every record on the table */
+static Status replay_log(Journal_t *journal, Hash_t *hash, bool snapshot)
+{
+    struct stat st;
+    if (fstat(journal->fd, &st) != 0)
+        return FAILURE;
+    if (st.st_size == 0) // New log
+        return log_reset(journal, hash);
+
+    size_t size = st.st_size;
+    char *data = malloc(size);
+    if (data == NULL || pread(journal->fd, data, size, 0) != (ssize_t)size)
+    {
+        fprintf(stderr, "Error: Unable to read the log '%s'\n", journal->log_name);
+        free(data);
+        return FAILURE;
+    }
+
+    Journal_header header;
+    memcpy(&header, data, size < sizeof(header) ? size : sizeof(header));
+    if (size < sizeof(header) || memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+        header.version != JOURNAL_VERSION || header.checksum != checksum_words(0, &header, offsetof(Journal_header, checksum)))
+    {
+        fprintf(stderr, "Error: '%s' is not a valid log\n", journal->log_name);
+        free(data);
+        return FAILURE;
+    }
+    if (!snapshot) // Records were made with the log's settings
+    {
+        hash->positional = header.flags & INDEX_POSITIONS;
+        hash->normalize = header.flags >> INDEX_NORMALIZE_SHIFT & NORM_ALL;
+    }
+    else if (header.flags != journal_flags(hash))
+    {
+        fprintf(stderr, "Error: Log '%s' was written with other settings than its snapshot\n", journal->log_name);
+        free(data);
+        return FAILURE;
+    }
+
+    /* Replay runs of same-type records, so a batch of added files is indexed in one go */
+    size_t offset = sizeof(header);
+    uint32_t run_type = 0;
+    File_list *run = NULL, *tail = NULL;
+    Status status = SUCCESS;
+    while (status == SUCCESS && offset + sizeof(Journal_record) <= size)
+    {
+        Journal_record rec;
+        memcpy(&rec, data + offset, sizeof(rec));
+        const char *name = data + offset + sizeof(rec);
+        size_t padded = (rec.name_len + 7) & ~(size_t)7;
+        if ((rec.type != JOURNAL_ADD && rec.type != JOURNAL_REMOVE) || rec.name_len == 0 || rec.name_len >= PATH_MAX ||
+            rec.sequence != journal->sequence + 1 || offset + sizeof(rec) + padded > size || rec.checksum != record_checksum(&rec, name))
+            break; // Torn or never completed: the log ends here
+
+        if (rec.type != run_type && run)
+        {
+            status = replay_run(journal, hash, run_type, &run);
+            tail = NULL; // The next record starts a new run
+        }
+        run_type = rec.type;
+
+        char file_name[PATH_MAX];
+        memcpy(file_name, name, rec.name_len);
+        file_name[rec.name_len] = '\0';
+        struct stat fst;
+        if (rec.type == JOURNAL_ADD && stat(file_name, &fst) != 0)
+            fprintf(stderr, "Warning : File '%s' in the log no longer exists, skipped.\n", file_name);
+        else
+        {
+            if (rec.type == JOURNAL_ADD && (fst.st_size != rec.size || (int64_t)fst.st_mtim.tv_sec * 1000000000 + fst.st_mtim.tv_nsec != rec.mtime))
+                fprintf(stderr, "Warning : File '%s' changed since it was logged, its current contents are indexed.\n", file_name);
+            if (insert_at_last(run ? &tail : &run, file_name) == FAILURE)
+                status = FAILURE;
+            else
+                tail = tail ? tail->next : run; // Appended after the last node
+        }
+
+        journal->sequence = rec.sequence;
+        journal->records++;
+        offset += sizeof(rec) + padded;
+    }
+    if (status == SUCCESS && run)
+        status = replay_run(journal, hash, run_type, &run);
+    tail = NULL;
+    delete_list(&run);
+    free(data);
+    if (status == FAILURE)
+    {
+        fprintf(stderr, "Error: Replaying the log '%s' failed\n", journal->log_name);
+        return FAILURE;
+    }
+
+    if (offset < size) // Drop the torn tail, new records go right after the last good one
+    {
+        fprintf(stderr, "Warning : %zu byte(s) of an incomplete record cut off the end of the log '%s'.\n", size - offset, journal->log_name);
+        if (ftruncate(journal->fd, offset) != 0 || fdatasync(journal->fd) != 0)
+            return FAILURE;
+    }
+    if (journal->records)
+        printf("INFO: Replayed %u change(s) from the log '%s'\n", journal->records, journal->log_name);
+    return SUCCESS;
+}
+
+/***********************************************************************
+ * Function     : journal_open
+ * Description  : Opens the journaled database name: loads the snapshot
+ *                name if there is one, replays the log name.wal on it
+ *                and keeps the log open, locked, for new records. A
+ *                database without a snapshot or log starts empty with
+ *                the table's settings.
+ *
+ * Arguments    : journal - Set to the open journal
+ *                hash    - Empty table, receives the database
+ *                name    - Snapshot, a .bin index name (--journal)
+ *                options - Parsed options (--verify, --threads)
+ *                head    - Files waiting to be indexed; those already in
+ *                          the snapshot are dropped
+ *
+ * Returns      : SUCCESS, or FAILURE when the database cannot be
+ *                recovered; nothing is changed on disk then.
+ ***********************************************************************/
+Status journal_open(Journal_t **journal, Hash_t *hash, const char *name, const Options_t *options, File_list **head)
+{
+    Journal_t *j = calloc(1, sizeof(Journal_t));
+    if (j == NULL)
+        return FAILURE;
+    snprintf(j->name, sizeof(j->name), "%s", name);
+    snprintf(j->log_name, sizeof(j->log_name), "%s" JOURNAL_SUFFIX, name);
+    j->threads = options->threads;
+
+    j->fd = open(j->log_name, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (j->fd < 0)
+    {
+        fprintf(stderr, "Error: Unable to open the log '%s'\n", j->log_name);
+        free(j);
+        return FAILURE;
+    }
+    if (flock(j->fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        fprintf(stderr, "Error: Database '%s' is in use by another process\n", name);
+        close(j->fd);
+        free(j);
+        return FAILURE;
+    }
+
+    struct stat st;
+    bool snapshot = stat(name, &st) == 0;
+    if ((snapshot && load_index(hash, name, head, options->verify_postings) == FAILURE) || replay_log(j, hash, snapshot) == FAILURE)
+    {
+        close(j->fd);
+        free(j);
+        return FAILURE;
+    }
+
+    *journal = j;
+    return SUCCESS;
+}
+
+/* Logs files about to be added; they must not be indexed unless this succeeds */
+Status journal_add(Journal_t *journal, File_list *files)
+{
+    return log_files(journal, JOURNAL_ADD, files);
+}
+
+/* Logs files about to be removed */
+Status journal_remove(Journal_t *journal, File_list *files)
+{
+    return log_files(journal, JOURNAL_REMOVE, files);
+}
+
+/***********************************************************************
+ * Function     : journal_checkpoint
+ * Description  : Saves the table as the new snapshot and empties the
+ *                log, once JOURNAL_SNAPSHOT_FILES records have been
+ *                logged, or whenever there is a change when forced.
+ *
+ * Arguments    : journal - Open journal
+ *                hash    - The journaled table
+ *                force   - Snapshot even below the interval
+ *
+ * Returns      : SUCCESS, or FAILURE when the snapshot could not be
+ *                written; the log is kept then, nothing is lost.
+ ***********************************************************************/
+Status journal_checkpoint(Journal_t *journal, Hash_t *hash, bool force)
+{
+    if (journal->records < JOURNAL_SNAPSHOT_FILES && !force)
+        return SUCCESS;
+
+    if (save_index(hash, journal->name) == FAILURE) // Flushed, then renamed over the old snapshot
+        return FAILURE;
+    sync_directory(journal->name);
+    return log_reset(journal, hash); // A crash before this replays records the snapshot holds, harmlessly
+}
+
+/* Snapshots pending changes, so the next start replays nothing, and closes the log */
+void journal_close(Journal_t *journal, Hash_t *hash)
+{
+    if (journal->records)
+        journal_checkpoint(journal, hash, true);
+    close(journal->fd); // Releases the lock
+    free(journal);
+}
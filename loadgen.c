@@ -0,0 +1,302 @@
+/***********************************************************************
+ *  File Name   : loadgen.c
+ *  Description : Load generator for the Inverted Search query server
+ *                (server.c). Opens N client connections to a running
+ *                server, each of which sends queries from a query file
+ *                one at a time and waits for the response (the empty
+ *                line that ends it) before sending the next. The
+ *                latency of every request is recorded; at the end the
+ *                throughput and the p50 / p99 / p999 / max latencies
+ *                over all clients are reported. Warm-up requests are
+ *                sent first and left out of the figures.
+ *
+ *                Stand-alone program, it does not link the index code:
+ *
+ *                  gcc -O2 -pthread loadgen.c -o loadgen
+ *
+ *                Usage : ./loadgen --connect <socket path | port> --queries <file>
+ *                                  [--clients N] [--requests N] [--warmup N]
+ *
+ *                --requests is the total over all clients (default
+ *                10000), --warmup is per client (default 100).
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define LOADGEN_MAX_CLIENTS 256
+
+typedef struct client
+{
+    int id;
+    uint32_t requests;    // Measured requests to send
+    uint32_t warmup;      // Unmeasured requests sent first
+    uint64_t *latency_ns; // One per measured request
+    bool failed;
+} Client_t;
+
+static const char *server_addr;
+static char **queries;
+static uint32_t query_count;
+static pthread_barrier_t start_line; // Clients start measuring together
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Connects to a Unix socket path, or to localhost when the address is a port number */
+static int connect_server(const char *addr)
+{
+    bool tcp = *addr && strspn(addr, "0123456789") == strlen(addr);
+    int fd = socket(tcp ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    int connected;
+    if (tcp)
+    {
+        struct sockaddr_in sin = {.sin_family = AF_INET, .sin_port = htons(atoi(addr))};
+        sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connected = connect(fd, (struct sockaddr *)&sin, sizeof(sin));
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    else
+    {
+        struct sockaddr_un sun = {.sun_family = AF_UNIX};
+        strncpy(sun.sun_path, addr, sizeof(sun.sun_path) - 1);
+        connected = connect(fd, (struct sockaddr *)&sun, sizeof(sun));
+    }
+
+    if (connected < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool send_all(int fd, const char *data, size_t len)
+{
+    while (len)
+    {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+/* Reads one response, i.e. up to and including the empty line that ends it */
+static bool read_response(int fd, char **buf, size_t *capacity)
+{
+    size_t len = 0;
+    while (len < 2 || (*buf)[len - 1] != '\n' || (*buf)[len - 2] != '\n')
+    {
+        if (len == *capacity)
+        {
+            char *grown = realloc(*buf, *capacity * 2);
+            if (grown == NULL)
+                return false;
+            *buf = grown;
+            *capacity *= 2;
+        }
+        ssize_t n = recv(fd, *buf + len, *capacity - len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        len += n;
+    }
+    return true;
+}
+
+static void *run_client(void *arg)
+{
+    Client_t *client = arg;
+    size_t capacity = 4096;
+    char *buf = malloc(capacity);
+    int fd = connect_server(server_addr);
+
+    client->failed = fd < 0 || buf == NULL;
+    uint32_t next = client->id * 7919u; // Clients start at different queries
+
+    for (uint32_t i = 0; i < client->warmup && !client->failed; i++, next++)
+    {
+        const char *query = queries[next % query_count];
+        client->failed = !send_all(fd, query, strlen(query)) || !read_response(fd, &buf, &capacity);
+    }
+
+    pthread_barrier_wait(&start_line);
+
+    for (uint32_t i = 0; i < client->requests && !client->failed; i++, next++)
+    {
+        const char *query = queries[next % query_count];
+        uint64_t start = now_ns();
+        client->failed = !send_all(fd, query, strlen(query)) || !read_response(fd, &buf, &capacity);
+        client->latency_ns[i] = now_ns() - start;
+    }
+
+    if (fd >= 0)
+        close(fd);
+    free(buf);
+    return NULL;
+}
+
+/* Queries as "text\n" strings, blank lines and '#' comments skipped */
+static bool read_queries(const char *file_name)
+{
+    FILE *fptr = fopen(file_name, "r");
+    if (fptr == NULL)
+        return false;
+
+    char line[4096];
+    uint32_t capacity = 0;
+    while (fgets(line, sizeof(line), fptr))
+    {
+        char *text = line + strspn(line, " \t");
+        size_t len = strcspn(text, "\r\n");
+        if (len == 0 || *text == '#')
+            continue;
+
+        if (query_count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            char **grown = realloc(queries, capacity * sizeof(char *));
+            if (grown == NULL)
+                break;
+            queries = grown;
+        }
+        queries[query_count] = malloc(len + 2);
+        if (queries[query_count] == NULL)
+            break;
+        memcpy(queries[query_count], text, len);
+        strcpy(queries[query_count++] + len, "\n");
+    }
+    fclose(fptr);
+    return query_count > 0;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples, in milliseconds */
+static double percentile_ms(const uint64_t *sorted, size_t count, double p)
+{
+    size_t rank = (size_t)(p * count + 0.999999);
+    return sorted[rank ? rank - 1 : 0] / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *query_file = NULL;
+    int clients = 1;
+    long requests = 10000, warmup = 100;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc)
+            server_addr = argv[++i];
+        else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc)
+            query_file = argv[++i];
+        else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc)
+            clients = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc)
+            requests = atol(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+            warmup = atol(argv[++i]);
+        else
+            clients = 0; // Unknown option -> usage
+    }
+
+    if (server_addr == NULL || query_file == NULL || clients < 1 || clients > LOADGEN_MAX_CLIENTS || requests < clients ||
+        warmup < 0)
+    {
+        fprintf(stderr, "Usage: %s --connect <socket path | port> --queries <file> [--clients N] [--requests N] [--warmup N]\n", argv[0]);
+        return 1;
+    }
+    if (!read_queries(query_file))
+    {
+        fprintf(stderr, "Error: No queries in '%s'\n", query_file);
+        return 1;
+    }
+
+    Client_t client[LOADGEN_MAX_CLIENTS];
+    pthread_t tids[LOADGEN_MAX_CLIENTS];
+    uint64_t *latency_ns = malloc(requests * sizeof(uint64_t));
+    if (latency_ns == NULL)
+        return 1;
+
+    pthread_barrier_init(&start_line, NULL, clients + 1);
+    long offset = 0;
+    for (int c = 0; c < clients; c++) // Requests split as evenly as possible
+    {
+        client[c].id = c;
+        client[c].requests = requests / clients + (c < requests % clients);
+        client[c].warmup = warmup;
+        client[c].latency_ns = latency_ns + offset;
+        offset += client[c].requests;
+        if (pthread_create(&tids[c], NULL, run_client, &client[c]) != 0)
+        {
+            fprintf(stderr, "Error: Unable to start client %d\n", c);
+            return 1;
+        }
+    }
+
+    pthread_barrier_wait(&start_line);
+    uint64_t start = now_ns();
+    bool failed = false;
+    for (int c = 0; c < clients; c++)
+    {
+        pthread_join(tids[c], NULL);
+        failed |= client[c].failed;
+    }
+    double seconds = (now_ns() - start) / 1e9;
+
+    if (failed)
+    {
+        fprintf(stderr, "Error: A client lost its connection to '%s'\n", server_addr);
+        return 1;
+    }
+
+    qsort(latency_ns, requests, sizeof(uint64_t), compare_u64);
+    printf("Requests   : %ld (%d client%s, %ld warm-up each)\n", requests, clients, clients == 1 ? "" : "s", warmup);
+    printf("Time       : %.3f s\n", seconds);
+    printf("Throughput : %.0f queries/s\n", requests / seconds);
+    printf("Latency    : p50 %.3f ms  p99 %.3f ms  p999 %.3f ms  max %.3f ms\n", percentile_ms(latency_ns, requests, 0.50),
+           percentile_ms(latency_ns, requests, 0.99), percentile_ms(latency_ns, requests, 0.999), latency_ns[requests - 1] / 1e6);
+
+    pthread_barrier_destroy(&start_line);
+    for (uint32_t i = 0; i < query_count; i++)
+        free(queries[i]);
+    free(queries);
+    free(latency_ns);
+    return 0;
+}
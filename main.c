@@ -26,20 +26,35 @@
  *  --------------------------------------------------------------------
  *  Features
  *  --------------------------------------------------------------------
- *  • Validate and register input text files
- *  • Build the inverted index (hash-based database)
+ *  • Validate and register input text files, directory trees or @list files
+ *  • Journaled database (--journal): changes go to a write-ahead log,
+ *    snapshots are taken periodically and replayed on startup
+ *  • Build the inverted index (hash-based database), optionally multi-threaded
  *  • Display the complete indexed data
  *  • Search for a particular word across files
- *  • Save the database to a backup file
- *  • Load an existing database from a backup
+ *  • Boolean queries combining words with AND / OR / NOT
+ *  • Prefix, suffix and wildcard search (time*, *ing, t*e)
+ *  • Search results ranked by BM25, best N files shown (--top N)
+ *  • Phrase and proximity search ("a b", a NEAR/k b) with --positions
+ *  • Save the database to a backup file (.txt text or .bin binary index)
+ *  • Load an existing database from a backup (.bin files are memory-mapped)
+ *  • Merge a backup into the live database
+ *  • Add or remove files without rebuilding the index
+ *  • Batch search of a query file with TSV / JSON output (--index, --queries)
+ *  • Query server on a Unix socket or localhost TCP port (--index, --listen)
+ *  • Cache of recent query results, emptied when the index changes (--cache MB)
+ *  • Statistics report: table probing, memory by structure, phase times (--stats)
+ *  • Token normalization: case folding, punctuation, stop words, Porter stemming (--normalize)
+ *  • External build of corpora larger than memory into a .bin index (--build, --memory MB)
+ *  • Segmented index: cheap additions as new segments, merged in the background (--segments)
  *  • Organized and user-friendly menu system
  *
  *  --------------------------------------------------------------------
  *  Working Principle
  *  --------------------------------------------------------------------
  *  1. Input files are validated and added to a linked list.
- *  2. Hash table (size 27) is initialized for indexing words (a–z) & special characters.
- *  3. Each word extracted from the files is hashed and added to the table.
+ *  2. An open-addressing hash table is initialized; it grows with the vocabulary.
+ *  3. Each word extracted from the files is normalized, hashed (full word) and added to the table.
  *  4. Each main node stores the word and a sublist of file occurrences.
  *  5. User operations (display, search, save, update) are performed via menu.
  *
@@ -59,8 +74,11 @@
  *      2. Display Database
  *      3. Search Database
  *      4. Save Database (Backup)
- *      5. Update Database (Load Backup)
- *      6. Exit
+ *      5. Update Database (Load / Merge Backup)
+ *      6. Add Files to Database
+ *      7. Remove Files from Database
+ *      8. Index Statistics
+ *      9. Exit
  *
  *  --------------------------------------------------------------------
  *  Functions Included
@@ -70,19 +88,20 @@
  *  - print_menu()
  *  - read_and_validate_input_arguments()
  *  - initialise_hash()
- *  - create_database()
+ *  - create_database() / create_database_parallel()
  *  - display_database()
- *  - search_database()
+ *  - search_database() / search_cached()
  *  - save_database()
  *  - update_database()
+ *  - add_files() / remove_files() / merge_database()
+ *  - run_batch() / run_server() / run_build() / run_segments()
+ *  - print_stats()
+ *  - read_file_names()
  *
  *  --------------------------------------------------------------------
  *  Future Enhancements
  *  --------------------------------------------------------------------
- *  • Dynamic hash table resizing based on input volume
- *  • Stop-word filtering for cleaner indexing
  *  • Export database in JSON/CSV format
- *  • Full-text search features (prefix/suffix matching)
  *  • GUI-based version for user-friendly access
  *
  ***********************************************************************/
@@ -97,6 +116,55 @@ void print_startup_banner()
     printf("-----------------------------------------------------\n\n");
 }
 
+/* Reads one line of space-separated file names into a file list */
+Status read_file_names(File_list **files, bool validate)
+{
+    char *name; // Any length, allocated by scanf()
+    char **args = NULL;
+    int count = 1; // args[0] stands in for the program name
+    Status status = FAILURE;
+
+    while (scanf("%ms", &name) == 1)
+    {
+        char **grown = realloc(args, (count + 1) * sizeof(char *));
+        if (grown == NULL)
+        {
+            free(name);
+            goto cleanup;
+        }
+        grown[count] = name;
+        args = grown;
+        count++;
+
+        int ch = getchar(); // Stop at the end of the line
+        while (ch == ' ' || ch == '\t')
+            ch = getchar();
+        if (ch == '\n' || ch == EOF)
+            break;
+        ungetc(ch, stdin);
+    }
+
+    if (validate) // Same checks as the command line
+    {
+        status = count > 1 ? read_and_validate_input_arguments(count, args, files) : FAILURE;
+    }
+    else
+    {
+        status = count > 1 ? SUCCESS : FAILURE;
+        for (int i = 1; i < count && status == SUCCESS; i++)
+        {
+            if (validate_duplicate_file(args[i], files) == SUCCESS)
+                status = insert_at_last(files, args[i]);
+        }
+    }
+
+cleanup:
+    for (int i = 1; i < count; i++)
+        free(args[i]);
+    free(args);
+    return status;
+}
+
 /* ------------------ MAIN MENU ------------------ */
 void print_menu()
 {
@@ -106,19 +174,40 @@ void print_menu()
     printf("│  2. Display Database                              │\n");
     printf("│  3. Search Database                               │\n");
     printf("│  4. Save Database (Backup)                        │\n");
-    printf("│  5. Update Database (Load Backup)                 │\n");
-    printf("│  6. Exit                                          │\n");
+    printf("│  5. Update Database (Load / Merge Backup)         │\n");
+    printf("│  6. Add Files to Database                         │\n");
+    printf("│  7. Remove Files from Database                    │\n");
+    printf("│  8. Index Statistics                              │\n");
+    printf("│  9. Exit                                          │\n");
     printf("└───────────────────────────────────────────────────┘\n");
     printf(">> Enter your choice : ");
 }
 
 int main(int argc, char *argv[])
 {
+    Options_t options;
+    Status parsed = read_options(&argc, argv, &options);
+    stats_timing = parsed == SUCCESS && options.stats; // Phase timers run from the start
+
+    if (parsed == SUCCESS && options.query_name) // Batch mode: no banner, no menu, results on stdout
+        return run_batch(&options) == SUCCESS ? 0 : 1;
+    if (parsed == SUCCESS && options.listen_addr) // Server mode: runs until SIGINT / SIGTERM
+        return run_server(&options) == SUCCESS ? 0 : 1;
+
     print_startup_banner();
 
-    if (argc < 2)
+    if (parsed == SUCCESS && options.segment_dir && argc < 2) // No files: merge the segments that are due
+        return run_segments(&options, NULL) == SUCCESS ? 0 : 1;
+
+    if (parsed == FAILURE || (argc < 2 && !options.journal_name)) // A journaled database may start from its snapshot alone
     {
-        fprintf(stderr, "[ERROR] Invalid Arguments! \nUsage: ./a.out <file1> <file2> ...\n\n");
+        fprintf(stderr, "[ERROR] Invalid Arguments! \nUsage: ./a.out [--threads N] [--verify] [--top N] [--positions] [--cache MB] [--stats] [--normalize STEPS] <file1> <file2> ...\n"
+                        "       ./a.out --build <index.bin> [--memory MB] [--positions] [--stats] [--normalize STEPS] <file1> <file2> ...\n"
+                        "       ./a.out --segments <dir> [--threads N] [--positions] [--stats] [--normalize STEPS] [<file1> <file2> ...]\n"
+                        "       ./a.out --journal <index.bin> [--threads N] [--verify] [--top N] [--positions] [--cache MB] [--stats] [--normalize STEPS] [<file1> <file2> ...]\n"
+                        "       ./a.out --index <backup | dir> --queries <file> [--format tsv|json] [--top N] [--threads N] [--stats] [--normalize STEPS]\n"
+                        "       ./a.out --index <backup | dir> --listen <socket path | port> [--format tsv|json] [--top N] [--threads N] [--stats] [--normalize STEPS]\n"
+                        "A file argument may also be a directory (its .txt files, recursively) or @list (one path per line).\n\n");
         printf("-----------------------------------------------------\n\n");
 
         return FAILURE;
@@ -127,26 +216,57 @@ int main(int argc, char *argv[])
     File_list *head = NULL;
 
     /* Validate input files */
-    if (read_and_validate_input_arguments(argc, argv, &head) == FAILURE)
+    if (argc > 1 && read_and_validate_input_arguments(argc, argv, &head) == FAILURE)
     {
         fprintf(stderr, "\n[ERROR] File validation failed.\n");
         return FAILURE;
     }
 
-    Hash_t hash_array[HASH_SIZE];
+    if (options.build_name) // External build: straight to a .bin index, no menu
+    {
+        Status built = run_build(&options, head);
+        delete_list(&head);
+        return built == SUCCESS ? 0 : 1;
+    }
+
+    if (options.segment_dir) // New segment of a segmented index, no menu
+    {
+        Status added = run_segments(&options, head);
+        delete_list(&head);
+        return added == SUCCESS ? 0 : 1;
+    }
+
+    Hash_t hash_array;
 
     /* Initialise Hash Table */
-    if (initialise_hash(hash_array) == FAILURE)
+    if (initialise_hash(&hash_array) == FAILURE)
     {
         fprintf(stderr, "[ERROR] Hash Table initialization failed.\n");
         return FAILURE;
     }
+    hash_array.positional = options.positions; // Phrase / NEAR queries need token positions
+    hash_array.normalize = options.normalize;  // Case, punctuation, stop words, stemming
+    if (query_cache_create(&hash_array, options.cache_size) == FAILURE) // Searching still works without it
+        fprintf(stderr, "[WARNING] Query cache could not be allocated.\n");
 
     int choice;
     char backupfilename[WORD_SIZE];
-    char search[WORD_SIZE];
+    char search[QUERY_SIZE];
     bool create_flag = false;
-    bool update_flag = false;
+    Journal_t *journal = NULL; // --journal: every change is logged before it is made
+
+    if (options.journal_name)
+    {
+        if (journal_open(&journal, &hash_array, options.journal_name, &options, &head) == FAILURE)
+        {
+            fprintf(stderr, "[ERROR] Database '%s' could not be opened.\n", options.journal_name);
+            delete_list(&head);
+            free_hash(&hash_array);
+            return FAILURE;
+        }
+        create_flag = hash_array.docs.count > 0;
+        printf("[INFO] Database '%s' opened with %u file(s); changes are logged as they are made.\n", options.journal_name, hash_array.docs.live);
+    }
 
     /* ===================== MAIN LOOP ===================== */
     while (1)
@@ -155,7 +275,7 @@ int main(int argc, char *argv[])
 
         if (scanf("%d", &choice) != 1)
         {
-            fprintf(stderr, "\n[ERROR] Invalid Input! Enter a number between 1–6.\n");
+            fprintf(stderr, "\n[ERROR] Invalid Input! Enter a number between 1–9.\n");
             while (getchar() != '\n'); // clear buffer
             continue;
         }
@@ -164,17 +284,23 @@ int main(int argc, char *argv[])
         {
         /* -------- CREATE DATABASE -------- */
         case 1:
-            if (create_flag)
+            if (create_flag && head == NULL)
             {
                 fprintf(stderr, "\n[INFO] Database already created.\n");
             }
             else
             {
                 printf("\n[PROCESS] Creating Database...\n");
-                if (create_database(hash_array, head) == SUCCESS)
+                if (journal && journal_add(journal, head) == FAILURE)
+                {
+                    printf("[ERROR] Failed to create database.\n");
+                }
+                else if (add_files(&hash_array, &head, options.threads) == SUCCESS) // Also indexes files pending after a load
                 {
                     printf("[SUCCESS] Database created.\n");
                     create_flag = true;
+                    if (journal)
+                        journal_checkpoint(journal, &hash_array, false);
                 }
                 else
                 {
@@ -188,7 +314,7 @@ int main(int argc, char *argv[])
             if (create_flag)
             {
                 printf("\n[DISPLAY] Displaying Database...\n");
-                display_database(hash_array);
+                display_database(&hash_array);
             }
             else
             {
@@ -201,11 +327,11 @@ int main(int argc, char *argv[])
         case 3:
             if (create_flag)
             {
-                printf("\nEnter word to search: ");
-                scanf("%49s", search);
+                printf("\nEnter word or query to search (AND / OR / NOT, parentheses, \"phrase\", NEAR/k): ");
+                scanf(" %255[^\n]", search);
 
                 printf("\n[PROCESS] Searching for '%s'...\n", search);
-                search_database(hash_array, search);
+                search_database(&hash_array, search, options.top_k);
             }
             else
             {
@@ -218,11 +344,14 @@ int main(int argc, char *argv[])
         case 4:
             if (create_flag)
             {
-                printf("\nEnter backup filename: ");
+                printf("\nEnter backup filename (.txt text / .bin index): ");
                 scanf("%49s", backupfilename);
 
                 printf("\n[PROCESS] Saving database to '%s'...\n", backupfilename);
-                save_database(hash_array, backupfilename);
+                if (is_index_file(backupfilename))
+                    save_index(&hash_array, backupfilename);
+                else
+                    save_database(&hash_array, backupfilename);
             }
             else
             {
@@ -233,44 +362,125 @@ int main(int argc, char *argv[])
 
         /* -------- UPDATE DATABASE -------- */
         case 5:
-            if (create_flag)
+        {
+            printf("\nEnter backup file to load (.txt text / .bin index): ");
+            scanf("%49s", backupfilename);
+
+            printf("\n[PROCESS] Loading backup from '%s'...\n\n", backupfilename);
+
+            Hash_t backup; // Loaded on its own, then merged if a database is active
+            Hash_t *target = create_flag ? &backup : &hash_array;
+            if (create_flag && initialise_hash(&backup) == FAILURE)
             {
-                fprintf(stderr, "\n[INFO] Cannot load backup while database is active.\n");
-                fprintf(stderr, "[INFO] Restart the application to load backup.\n");
+                printf("[ERROR] Backup loading failed.\n");
+                break;
             }
-            else if (!update_flag)
+            backup.normalize = options.normalize;
+
+            Status loaded = is_index_file(backupfilename)
+                                ? load_index(target, backupfilename, &head, options.verify_postings)
+                                : update_database(target, backupfilename, &head);
+            if (loaded == SUCCESS && create_flag)
             {
-                printf("\nEnter backup file to load: ");
-                scanf("%49s", backupfilename);
+                loaded = merge_database(&hash_array, &backup);
+            }
+            else if (create_flag)
+            {
+                free_hash(&backup);
+            }
+
+            if (loaded == SUCCESS)
+            {
+                printf("\n[SUCCESS] Database %s backup.\n", create_flag ? "merged with" : "loaded from");
+                create_flag = true;
+                if (journal && journal_checkpoint(journal, &hash_array, true) == FAILURE) // A merge cannot be logged by file name
+                    fprintf(stderr, "[WARNING] The loaded backup is not in '%s' yet.\n", options.journal_name);
+            }
+            else
+            {
+                printf("[ERROR] Backup loading failed.\n");
+            }
+            break;
+        }
+
+        /* -------- ADD FILES -------- */
+        case 6:
+        {
+            File_list *files = NULL;
+
+            printf("\nEnter file names to add (space separated): ");
+            if (read_file_names(&files, true) == FAILURE)
+            {
+                delete_list(&files);
+                fprintf(stderr, "\n[ERROR] No valid files to add.\n");
+                break;
+            }
+
+            printf("\n[PROCESS] Adding files to database...\n");
+            if (journal && journal_add(journal, files) == FAILURE)
+            {
+                printf("[ERROR] Failed to add files.\n");
+            }
+            else if (add_files(&hash_array, &files, options.threads) == SUCCESS)
+            {
+                printf("[SUCCESS] Files added.\n");
+                create_flag = true;
+                if (journal)
+                    journal_checkpoint(journal, &hash_array, false);
+            }
+            else
+            {
+                printf("[ERROR] Failed to add files.\n");
+            }
+            delete_list(&files);
+            break;
+        }
 
-                printf("\n[PROCESS] Loading backup from '%s'...\n\n", backupfilename);
+        /* -------- REMOVE FILES -------- */
+        case 7:
+            if (create_flag)
+            {
+                File_list *files = NULL;
 
-                if (update_database(hash_array, backupfilename, &head) == SUCCESS)
+                printf("\nEnter file names to remove (space separated): ");
+                if (read_file_names(&files, false) == SUCCESS && (!journal || journal_remove(journal, files) == SUCCESS) &&
+                    remove_files(&hash_array, files) == SUCCESS)
                 {
-                    printf("\n[SUCCESS] Database loaded from backup.\n");
-                    create_flag = true;
-                    update_flag = true;
+                    printf("[SUCCESS] Files removed.\n");
+                    if (journal)
+                        journal_checkpoint(journal, &hash_array, false);
                 }
                 else
-                {
-                    printf("[ERROR] Backup loading failed.\n");
-                }
+                    printf("[ERROR] No file removed.\n");
+                delete_list(&files);
             }
             else
             {
-                printf("[ERROR] Database already loaded from backup.\n");
+                fprintf(stderr, "\n[ERROR] Cannot remove. No database available.\n");
+                fprintf(stderr, "[INFO] Create DB first or load backup.\n");
             }
             break;
 
+        /* -------- STATISTICS -------- */
+        case 8:
+            print_stats(stdout, &hash_array);
+            break;
+
         /* -------- EXIT -------- */
-        case 6:
+        case 9:
             delete_list(&head);
+            if (journal) // Snapshot the logged changes, so the next start replays nothing
+                journal_close(journal, &hash_array);
             printf("\n[EXIT] Program terminated.\n");
+            print_cache_stats(stdout, &hash_array);
+            if (options.stats)
+                print_stats(stdout, &hash_array);
+            free_hash(&hash_array); // Releases the table and every node
             return 0;
 
         /* -------- INVALID OPTION -------- */
         default:
-            fprintf(stderr, "\n[ERROR] Invalid Option! Enter between 1-6.\n");
+            fprintf(stderr, "\n[ERROR] Invalid Option! Enter between 1-9.\n");
         }
     }
 }
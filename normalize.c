@@ -0,0 +1,526 @@
+/***********************************************************************
+ *  File Name   : normalize.c
+ *  Description : Token normalization for the Inverted Search System.
+ *                Every token of an indexed file passes through it
+ *                between the tokenizer and the word table, and every
+ *                query word passes through it in the parser, so
+ *                "Apple", "apple," and "apple" are one term. The steps
+ *                are chosen with --normalize (NORM_* flags):
+ *
+ *                  lower : A-Z folded to a-z (ASCII only, UTF-8 bytes
+ *                          are left alone)
+ *                  punct : leading and trailing ASCII punctuation cut
+ *                          off ("(apple)," -> "apple"); inner marks
+ *                          stay ("e-mail", "don't", "3.14")
+ *                  stop  : common English words dropped ("the", "of")
+ *                  stem  : Porter stemming ("connected", "connection"
+ *                          -> "connect") of words made of a-z only
+ *
+ *                The default is lower,punct. A token that ends up empty
+ *                (bare punctuation) or is a stop word is dropped: it
+ *                gets no position and does not count towards the
+ *                document length. Wildcard patterns are only folded
+ *                and trimmed, their '*' kept, and never stemmed.
+ *
+ *                Trimming only narrows the token's slice of the file,
+ *                and a token is copied only when a letter has to change
+ *                (a capital, a stem), so the usual lower case token
+ *                costs one scan. The stop word test is one hash probe
+ *                into a small table built on first use, and each thread
+ *                keeps the stems of recent words, so the stemmer runs
+ *                mostly on words it has not seen lately.
+ *
+ *                Functions:
+ *                  - normalize_word()
+ *                  - normalize_pattern()
+ *                  - parse_normalize()
+ *                  - normalize_name()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <pthread.h>
+
+#define STOP_SLOTS 1024  // Stop word table, power of two, mostly empty so a miss stops early
+#define STOP_MAX_LEN 10  // Longest stop word
+#define STEM_CACHE_SIZE 1024 // Recent stems per thread, power of two
+#define STEM_CACHE_WORD 16   // Longer words are stemmed every time
+
+static const char *const stop_words[] = {
+    "a", "about", "above", "after", "again", "against", "all", "am", "an", "and", "any", "are", "as", "at",
+    "be", "because", "been", "before", "being", "below", "between", "both", "but", "by", "can", "could",
+    "did", "do", "does", "doing", "down", "during", "each", "few", "for", "from", "further", "had", "has",
+    "have", "having", "he", "her", "here", "hers", "herself", "him", "himself", "his", "how", "i", "if",
+    "in", "into", "is", "it", "its", "itself", "just", "me", "more", "most", "my", "myself", "no", "nor",
+    "not", "now", "of", "off", "on", "once", "only", "or", "other", "our", "ours", "ourselves", "out",
+    "over", "own", "same", "she", "should", "so", "some", "such", "than", "that", "the", "their", "theirs",
+    "them", "themselves", "then", "there", "these", "they", "this", "those", "through", "to", "too",
+    "under", "until", "up", "very", "was", "we", "were", "what", "when", "where", "which", "while", "who",
+    "whom", "why", "will", "with", "would", "you", "your", "yours", "yourself", "yourselves"};
+
+static struct
+{
+    uint64_t hash;    // hash_word() of word
+    const char *word; // NULL for an empty slot
+} stop_table[STOP_SLOTS];
+static pthread_once_t stop_once = PTHREAD_ONCE_INIT;
+
+static void build_stop_table(void)
+{
+    for (size_t i = 0; i < sizeof(stop_words) / sizeof(stop_words[0]); i++)
+    {
+        uint64_t word_hash = hash_word(stop_words[i], strlen(stop_words[i]));
+        size_t slot = word_hash & (STOP_SLOTS - 1);
+        while (stop_table[slot].word)
+            slot = (slot + 1) & (STOP_SLOTS - 1);
+        stop_table[slot].hash = word_hash;
+        stop_table[slot].word = stop_words[i];
+    }
+}
+
+static bool is_stop_word(const char *word, size_t len)
+{
+    if (len > STOP_MAX_LEN)
+        return false;
+    pthread_once(&stop_once, build_stop_table); // Worker threads normalize too
+
+    uint64_t word_hash = hash_word(word, len);
+    for (size_t slot = word_hash & (STOP_SLOTS - 1); stop_table[slot].word; slot = (slot + 1) & (STOP_SLOTS - 1))
+    {
+        if (stop_table[slot].hash == word_hash && strncmp(stop_table[slot].word, word, len) == 0 &&
+            stop_table[slot].word[len] == '\0')
+            return true;
+    }
+    return false;
+}
+
+/* Same set as ispunct() in the C locale */
+static inline bool is_punct(unsigned char ch)
+{
+    return (ch >= '!' && ch <= '/') || (ch >= ':' && ch <= '@') || (ch >= '[' && ch <= '`') || (ch >= '{' && ch <= '~');
+}
+
+/* High bit of every byte of x that is an ASCII capital */
+static inline uint64_t capitals(uint64_t x)
+{
+    const uint64_t ones = 0x0101010101010101ull, high = 0x8080808080808080ull;
+    uint64_t low = x & ~high;                              // No carry between bytes below
+    return (low + ones * (0x80 - 'A')) & ~(low + ones * (0x80 - 'Z' - 1)) & ~x & high; // >= 'A', <= 'Z', ASCII
+}
+
+/* Does s[0..n) hold a capital? Two overlapping loads cover a short token without a loop over its bytes */
+static bool has_capital(const unsigned char *s, size_t n)
+{
+    uint64_t first = 0, last = 0;
+
+    if (n >= 8)
+    {
+        for (size_t i = 0; i + 8 < n; i += 8)
+        {
+            memcpy(&first, s + i, 8);
+            if (capitals(first))
+                return true;
+        }
+        memcpy(&last, s + n - 8, 8);
+        return capitals(last) != 0;
+    }
+    if (n >= 4)
+    {
+        uint32_t a, b;
+        memcpy(&a, s, 4);
+        memcpy(&b, s + n - 4, 4);
+        first = a;
+        last = b;
+    }
+    else if (n >= 2)
+    {
+        uint16_t a, b;
+        memcpy(&a, s, 2);
+        memcpy(&b, s + n - 2, 2);
+        first = a;
+        last = b;
+    }
+    else if (n == 1)
+    {
+        first = s[0];
+    }
+    return (capitals(first) | capitals(last)) != 0; // Tested apart, OR-ing the bytes would mix them
+}
+
+/* ------------------ Porter Stemmer ------------------ */
+
+/* M. F. Porter, "An algorithm for suffix stripping", 1980, as in his reference C version */
+typedef struct stemmer
+{
+    char *b; // Word being stemmed, a-z only
+    int k;   // Index of its last letter
+    int j;   // End of the stem before the suffix matched by ends()
+} Stemmer;
+
+typedef struct stem_cache
+{
+    uint64_t hash;                // hash_word() of word, 0 while the entry is empty
+    uint8_t len;                  // Bytes in word, 0 while the entry is empty
+    uint8_t stem_len;
+    char word[STEM_CACHE_WORD];   // Not NUL-terminated
+    char stem[STEM_CACHE_WORD];
+} Stem_cache;
+
+typedef struct stem_rule
+{
+    const char *suffix;
+    const char *replacement;
+} Stem_rule;
+
+static bool consonant(const Stemmer *z, int i)
+{
+    switch (z->b[i])
+    {
+    case 'a':
+    case 'e':
+    case 'i':
+    case 'o':
+    case 'u':
+        return false;
+    case 'y':
+        return i == 0 || !consonant(z, i - 1);
+    default:
+        return true;
+    }
+}
+
+/* m: number of vowel-consonant sequences in b[0..j] */
+static int measure(const Stemmer *z)
+{
+    int n = 0, i = 0;
+
+    while (i <= z->j && consonant(z, i)) // Leading consonants
+        i++;
+    while (i <= z->j)
+    {
+        while (i <= z->j && !consonant(z, i))
+            i++;
+        if (i > z->j)
+            break;
+        n++;
+        while (i <= z->j && consonant(z, i))
+            i++;
+    }
+    return n;
+}
+
+static bool vowel_in_stem(const Stemmer *z)
+{
+    for (int i = 0; i <= z->j; i++)
+    {
+        if (!consonant(z, i))
+            return true;
+    }
+    return false;
+}
+
+static bool double_consonant(const Stemmer *z, int i)
+{
+    return i >= 1 && z->b[i] == z->b[i - 1] && consonant(z, i);
+}
+
+/* consonant-vowel-consonant ending at i, the last not w, x or y ("hop", not "snow") */
+static bool cvc(const Stemmer *z, int i)
+{
+    if (i < 2 || !consonant(z, i) || consonant(z, i - 1) || !consonant(z, i - 2))
+        return false;
+    return z->b[i] != 'w' && z->b[i] != 'x' && z->b[i] != 'y';
+}
+
+/* Does b[0..k] end with suffix? Sets j to the end of the stem when it does */
+static bool ends(Stemmer *z, const char *suffix)
+{
+    int len = (int)strlen(suffix);
+    if (len > z->k + 1 || suffix[len - 1] != z->b[z->k] || memcmp(z->b + z->k - len + 1, suffix, len) != 0)
+        return false;
+    z->j = z->k - len;
+    return true;
+}
+
+static void set_to(Stemmer *z, const char *replacement)
+{
+    int len = (int)strlen(replacement);
+    memcpy(z->b + z->j + 1, replacement, len);
+    z->k = z->j + len;
+}
+
+/* First rule whose suffix matches is applied when the stem measures more than min_measure */
+static void apply_rules(Stemmer *z, const Stem_rule *rules, size_t count, int min_measure)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (ends(z, rules[i].suffix))
+        {
+            if (measure(z) > min_measure)
+                set_to(z, rules[i].replacement);
+            return;
+        }
+    }
+}
+
+/* Plurals and -ed / -ing: caresses -> caress, ponies -> poni, hopping -> hop, filing -> file */
+static void step1ab(Stemmer *z)
+{
+    if (z->b[z->k] == 's')
+    {
+        if (ends(z, "sses"))
+            z->k -= 2;
+        else if (ends(z, "ies"))
+            set_to(z, "i");
+        else if (z->b[z->k - 1] != 's')
+            z->k--;
+    }
+    if (ends(z, "eed"))
+    {
+        if (measure(z) > 0)
+            z->k--;
+    }
+    else if ((ends(z, "ed") || ends(z, "ing")) && vowel_in_stem(z))
+    {
+        z->k = z->j;
+        if (ends(z, "at"))
+            set_to(z, "ate");
+        else if (ends(z, "bl"))
+            set_to(z, "ble");
+        else if (ends(z, "iz"))
+            set_to(z, "ize");
+        else if (double_consonant(z, z->k))
+        {
+            char ch = z->b[z->k--];
+            if (ch == 'l' || ch == 's' || ch == 'z')
+                z->k++;
+        }
+        else if (measure(z) == 1 && cvc(z, z->k))
+            set_to(z, "e");
+    }
+}
+
+/* Terminal y -> i when the stem has a vowel: happy -> happi */
+static void step1c(Stemmer *z)
+{
+    if (ends(z, "y") && vowel_in_stem(z))
+        z->b[z->k] = 'i';
+}
+
+/* Double suffixes to single ones: relational -> relate, digitizer -> digitize */
+static void step2(Stemmer *z)
+{
+    static const Stem_rule rules[] = {
+        {"ational", "ate"}, {"tional", "tion"}, {"enci", "ence"}, {"anci", "ance"}, {"izer", "ize"},
+        {"bli", "ble"}, {"alli", "al"}, {"entli", "ent"}, {"eli", "e"}, {"ousli", "ous"},
+        {"ization", "ize"}, {"ation", "ate"}, {"ator", "ate"}, {"alism", "al"}, {"iveness", "ive"},
+        {"fulness", "ful"}, {"ousness", "ous"}, {"aliti", "al"}, {"iviti", "ive"}, {"biliti", "ble"},
+        {"logi", "log"}};
+
+    if (z->k >= 1)
+        apply_rules(z, rules, sizeof(rules) / sizeof(rules[0]), 0);
+}
+
+/* -ic-, -full, -ness: triplicate -> triplic, hopeful -> hope */
+static void step3(Stemmer *z)
+{
+    static const Stem_rule rules[] = {
+        {"icate", "ic"}, {"ative", ""}, {"alize", "al"}, {"iciti", "ic"}, {"ical", "ic"}, {"ful", ""}, {"ness", ""}};
+
+    apply_rules(z, rules, sizeof(rules) / sizeof(rules[0]), 0);
+}
+
+/* Suffixes removed from stems of measure 2 or more: adjustable -> adjust */
+static void step4(Stemmer *z)
+{
+    static const char *const suffixes[] = {"al", "ance", "ence", "er", "ic", "able", "ible", "ant", "ement", "ment",
+                                           "ent", "ion", "ou", "ism", "ate", "iti", "ous", "ive", "ize"};
+
+    if (z->k < 1)
+        return;
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++)
+    {
+        if (ends(z, suffixes[i]))
+        {
+            bool ion = suffixes[i][0] == 'i' && suffixes[i][1] == 'o'; // Only after s or t: adoption -> adopt
+            if ((!ion || (z->j >= 0 && (z->b[z->j] == 's' || z->b[z->j] == 't'))) && measure(z) > 1)
+                z->k = z->j;
+            return;
+        }
+    }
+}
+
+/* Final -e and -ll: probate -> probat, controll -> control */
+static void step5(Stemmer *z)
+{
+    z->j = z->k;
+    if (z->b[z->k] == 'e')
+    {
+        int m = measure(z);
+        if (m > 1 || (m == 1 && !cvc(z, z->k - 1)))
+            z->k--;
+    }
+    if (z->b[z->k] == 'l' && double_consonant(z, z->k) && measure(z) > 1)
+        z->k--;
+}
+
+/* Stems word[0..len) in place, returns the new length; words of two letters or fewer are left as they are */
+static size_t stem(char *word, size_t len)
+{
+    Stemmer z = {word, (int)len - 1, 0};
+
+    step1ab(&z);
+    if (z.k > 0)
+    {
+        step1c(&z);
+        step2(&z);
+        step3(&z);
+        step4(&z);
+        step5(&z);
+    }
+    return (size_t)z.k + 1;
+}
+
+/* Stem of word, through a small per-thread cache: the same few words make up most of a text */
+static size_t cached_stem(char *word, size_t len)
+{
+    static _Thread_local Stem_cache cache[STEM_CACHE_SIZE];
+
+    if (len >= STEM_CACHE_WORD)
+        return stem(word, len);
+
+    uint64_t word_hash = hash_word(word, len);
+    Stem_cache *entry = &cache[word_hash & (STEM_CACHE_SIZE - 1)];
+    if (entry->hash != word_hash || entry->len != len || memcmp(entry->word, word, len) != 0) // Miss -> stem and remember
+    {
+        entry->hash = word_hash;
+        entry->len = (uint8_t)len;
+        memcpy(entry->word, word, len);
+        entry->stem_len = (uint8_t)stem(word, len);
+        memcpy(entry->stem, word, entry->stem_len);
+        return entry->stem_len;
+    }
+    memcpy(word, entry->stem, entry->stem_len);
+    return entry->stem_len;
+}
+
+/* ------------------ Normalization ------------------ */
+
+/* Trims *word and folds it to lower case; keep_star leaves the '*' of a pattern in place */
+static size_t fold(unsigned flags, const char **word, size_t len, bool keep_star, char *buf)
+{
+    const unsigned char *start = (const unsigned char *)*word, *end = start + len;
+
+    if (flags & NORM_PUNCT) // Trimming only moves the slice
+    {
+        while (start < end && is_punct(*start) && !(keep_star && *start == '*'))
+            start++;
+        while (end > start && is_punct(end[-1]) && !(keep_star && end[-1] == '*'))
+            end--;
+    }
+    *word = (const char *)start;
+
+    size_t n = end - start;
+    if ((flags & NORM_LOWER) && has_capital(start, n)) // Most tokens have none and are not copied
+    {
+        for (size_t i = 0; i < n; i++)
+            buf[i] = (unsigned char)(start[i] - 'A') < 26 ? start[i] + ('a' - 'A') : start[i];
+        *word = buf;
+    }
+    return n;
+}
+
+/***********************************************************************
+ * Function     : normalize_word
+ * Description  : Applies the NORM_* steps of flags to one token. The
+ *                term is left in place when no byte has to change
+ *                (a trimmed slice of the token) and written to buf
+ *                otherwise, so most tokens are never copied.
+ *
+ * Arguments    : flags - NORM_* steps
+ *                word  - Token bytes (at most MAX_WORD_LEN), set to
+ *                        the normalized term (not NUL-terminated)
+ *                len   - Token length
+ *                buf   - Buffer of at least WORD_SIZE bytes
+ *
+ * Returns      : Length of the term, 0 when the token is dropped (stop
+ *                word or nothing left).
+ ***********************************************************************/
+size_t normalize_word(unsigned flags, const char **word, size_t len, char *buf)
+{
+    len = fold(flags, word, len, false, buf);
+    if (len == 0 || ((flags & NORM_STOP) && is_stop_word(*word, len)))
+        return 0;
+
+    if ((flags & NORM_STEM) && len > 2)
+    {
+        size_t i = 0;
+        while (i < len && (unsigned char)((*word)[i] - 'a') < 26)
+            i++;
+        if (i == len) // a-z only, the stemmer knows nothing else
+        {
+            if (*word != buf)
+                memcpy(buf, *word, len);
+            *word = buf;
+            len = cached_stem(buf, len);
+        }
+    }
+    return len;
+}
+
+/* Wildcard pattern: folded and trimmed like words, '*' kept, never stemmed or dropped as a stop word */
+size_t normalize_pattern(unsigned flags, const char **pattern, size_t len, char *buf)
+{
+    return fold(flags, pattern, len, true, buf);
+}
+
+/* "lower,punct,stop,stem" (any subset, any order) or "none" */
+Status parse_normalize(const char *text, unsigned *flags)
+{
+    static const char *const names[] = {"lower", "punct", "stop", "stem"};
+    unsigned parsed = 0;
+
+    if (strcmp(text, "none") == 0)
+    {
+        *flags = 0;
+        return SUCCESS;
+    }
+
+    while (*text)
+    {
+        size_t len = strcspn(text, ",");
+        size_t i = 0;
+        while (i < 4 && (strlen(names[i]) != len || strncmp(text, names[i], len) != 0))
+            i++;
+        if (i == 4)
+            return FAILURE;
+
+        parsed |= 1u << i; // NORM_LOWER, NORM_PUNCT, NORM_STOP, NORM_STEM
+        text += len;
+        if (*text == ',' && *++text == '\0') // Trailing comma
+            return FAILURE;
+    }
+    if (parsed == 0)
+        return FAILURE;
+
+    *flags = parsed;
+    return SUCCESS;
+}
+
+/* The --normalize spelling of flags, into a NORM_NAME_SIZE buffer */
+const char *normalize_name(unsigned flags, char *out)
+{
+    static const char *const names[] = {"lower", "punct", "stop", "stem"};
+    size_t len = 0;
+
+    out[0] = '\0';
+    for (int i = 0; i < 4; i++)
+    {
+        if (flags & (1u << i))
+            len += sprintf(out + len, "%s%s", len ? "," : "", names[i]);
+    }
+    return len ? out : strcpy(out, "none");
+}
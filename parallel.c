@@ -0,0 +1,353 @@
+/***********************************************************************
+ *  File Name   : parallel.c
+ *  Description : Multi-threaded database creation for the Inverted
+ *                Search System (--threads N).
+ *
+ *                1. Index  : workers pull files from a shared queue and
+ *                            build thread-local partial indexes without
+ *                            any locking.
+ *                2. Merge  : every worker owns one hash partition of the
+ *                            vocabulary and merges the sub node arrays of
+ *                            its words from all partial indexes, packing
+ *                            each merged word as it goes.
+ *                3. Link   : the main thread links the merged words into
+ *                            the final table in first-occurrence order.
+ *
+ *                Workers take files in increasing document ID order, so
+ *                every partial index is sorted by document ID and the
+ *                result is identical to create_database().
+ *
+ *                Functions:
+ *                  - create_database_parallel()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+typedef struct build_job
+{
+    const char **names;    // File names in File_list order
+    uint32_t *doc_ids;     // Document ID of each file
+    uint32_t *lengths;     // Words in each file
+    uint32_t file_count;
+    atomic_uint next_file; // Shared work queue
+    atomic_int failed;     // Set by any worker on allocation failure
+    int threads;
+    Hash_t *partials;      // Thread-local partial indexes
+    Hash_t *parts;         // Merged hash partitions
+} Build_job;
+
+typedef struct worker
+{
+    Build_job *job;
+    int id;
+    pthread_t tid;
+    Sub_node *scratch;     // Merged sub nodes of one word before packing
+    uint32_t scratch_size; // Entries allocated in scratch
+} Worker_t;
+
+static inline int partition_of(uint64_t word_hash, int parts)
+{
+    return (int)((word_hash >> 40) % (uint64_t)parts); // High bits, independent of slot bits
+}
+
+static void *index_worker(void *arg)
+{
+    Worker_t *worker = arg;
+    Build_job *job = worker->job;
+    Hash_t *partial = &job->partials[worker->id];
+    uint32_t i;
+
+    while ((i = atomic_fetch_add(&job->next_file, 1)) < job->file_count) // Take next file
+    {
+        if (atomic_load(&job->failed) || index_file(partial, job->names[i], job->doc_ids[i], &job->lengths[i]) == FAILURE)
+        {
+            atomic_store(&job->failed, 1);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* Builds one merged word from every partial index, starting at the first one containing it */
+static Main_node *merge_word(Worker_t *worker, Hash_t *part, int first, Main_node *node)
+{
+    Build_job *job = worker->job;
+    Main_node *sources[MAX_THREADS];
+    uint32_t cursor[MAX_THREADS];
+    uint32_t total = 0;
+    int count = 0;
+
+    for (int t = first; t < job->threads; t++) // Collect the word's sub node arrays
+    {
+        Main_node *source = t == first ? node : lookup_word(&job->partials[t], node->word, node->word_len, node->hash);
+        if (source)
+        {
+            sources[count] = source;
+            cursor[count++] = 0;
+            total += source->file_count;
+        }
+    }
+
+    if (total > worker->scratch_size) // Largest word so far
+    {
+        Sub_node *grown = realloc(worker->scratch, total * sizeof(Sub_node));
+        if (grown == NULL)
+            return NULL;
+        worker->scratch = grown;
+        worker->scratch_size = total;
+    }
+    Sub_node *s_list = worker->scratch;
+
+    Main_node *merged = arena_alloc(&part->arena, sizeof(Main_node));
+    if (merged == NULL)
+        return NULL;
+
+    *merged = *node; // Cached hash and length
+    merged->word = pool_add(&part->strings, node->word, node->word_len); // The partial's pool is freed after the build
+    if (merged->word == NULL)
+        return NULL;
+    merged->file_count = 0;
+    merged->capacity = 0;
+    merged->positions = NULL;
+    if (node->positions && (positions_attach(&part->arena, merged) == FAILURE ||
+                            positions_reserve(&part->arena, merged, total) == FAILURE)) // Offsets for every file
+        return NULL;
+
+    merged->m_link = NULL;
+
+    for (uint32_t n = 0; n < total; n++) // k-way merge by document ID
+    {
+        int best = -1;
+        for (int c = 0; c < count; c++)
+        {
+            if (cursor[c] < sources[c]->file_count &&
+                (best < 0 || sources[c]->s_list[cursor[c]].doc_id < sources[best]->s_list[cursor[best]].doc_id))
+                best = c;
+        }
+        s_list[n] = sources[best]->s_list[cursor[best]++];
+        if (merged->positions && positions_copy(&part->arena, merged, n, sources[best], cursor[best] - 1, s_list[n].word_count) == FAILURE)
+            return NULL;
+    }
+
+    if (postings_pack_list(&part->arena, merged, s_list, total) == FAILURE) // Only the packed form is kept
+        return NULL;
+    return merged;
+}
+
+static void *merge_worker(void *arg)
+{
+    Worker_t *worker = arg;
+    Build_job *job = worker->job;
+    Hash_t *part = &job->parts[worker->id];
+    Stats_timer timer;
+
+    STAT_START(timer);
+    for (int t = 0; t < job->threads; t++) // Walk every partial index
+    {
+        for (Main_node *node = job->partials[t].head; node; node = node->m_link)
+        {
+            if (partition_of(node->hash, job->threads) != worker->id) // Owned by another partition
+                continue;
+            if (lookup_word(part, node->word, node->word_len, node->hash)) // Already merged from an earlier partial
+                continue;
+
+            Main_node *merged = merge_word(worker, part, t, node);
+            if (merged == NULL || insert_main_node(part, merged) == FAILURE)
+            {
+                atomic_store(&job->failed, 1);
+                return NULL;
+            }
+        }
+    }
+    STAT_STOP(timer, PHASE_MERGE);
+    return NULL;
+}
+
+static Status run_workers(Build_job *job, Worker_t *workers, void *(*routine)(void *))
+{
+    int started = 0;
+    for (int i = 0; i < job->threads; i++) // Start one thread per worker
+    {
+        if (pthread_create(&workers[i].tid, NULL, routine, &workers[i]) != 0)
+        {
+            atomic_store(&job->failed, 1);
+            break;
+        }
+        started++;
+    }
+    for (int i = 0; i < started; i++) // Wait for all of them
+        pthread_join(workers[i].tid, NULL);
+
+    return atomic_load(&job->failed) ? FAILURE : SUCCESS;
+}
+
+/* Links merged words into the final table, ordered by first document then first position */
+static Status link_words(Hash_t *hash, Build_job *job)
+{
+    Main_node *cursor[MAX_THREADS];
+    Sub_node *scratch = NULL; // Decoded sub nodes of a merged word
+    uint32_t scratch_size = 0;
+    Status status = SUCCESS;
+    for (int t = 0; t < job->threads; t++)
+        cursor[t] = job->partials[t].head;
+
+    while (1)
+    {
+        int best = -1;
+        for (int t = 0; t < job->threads; t++) // Partial lists are sorted by first document ID
+        {
+            if (cursor[t] && (best < 0 || cursor[t]->s_list[0].doc_id < cursor[best]->s_list[0].doc_id))
+                best = t;
+        }
+        if (best < 0)
+            break;
+
+        Main_node *node = cursor[best];
+        cursor[best] = node->m_link;
+
+        size_t len = node->word_len;
+        Main_node *merged = lookup_word(&job->parts[partition_of(node->hash, job->threads)], node->word, len, node->hash);
+        Main_node *existing = lookup_word(hash, node->word, len, node->hash);
+
+        if (existing == merged || merged->file_count == 0) // Already linked
+            continue;
+
+        if (existing == NULL) // New word
+        {
+            merged->m_link = NULL;
+            if (insert_main_node(hash, merged) == FAILURE)
+            {
+                status = FAILURE;
+                break;
+            }
+        }
+        else // Word already in the database -> append the new files
+        {
+            const Sub_node *subs = postings_get(merged, &scratch, &scratch_size);
+            for (uint32_t i = 0; subs && i < merged->file_count; i++)
+            {
+                Sub_node *sub = create_sub_node(&hash->arena, existing, subs[i].doc_id);
+                if (sub == NULL)
+                {
+                    subs = NULL;
+                    break;
+                }
+                sub->word_count = subs[i].word_count;
+                if (existing->positions && merged->positions &&
+                    positions_copy(&hash->arena, existing, existing->file_count - 1, merged, i, subs[i].word_count) == FAILURE)
+                {
+                    subs = NULL;
+                    break;
+                }
+            }
+            if (subs == NULL)
+            {
+                status = FAILURE;
+                break;
+            }
+            merged->file_count = 0; // Mark as consumed
+        }
+    }
+    free(scratch);
+    return status;
+}
+
+Status create_database_parallel(Hash_t *hash, File_list *head, int threads)
+{
+    uint32_t file_count = 0;
+    for (File_list *temp = head; temp; temp = temp->next) // Count files
+        file_count++;
+
+    if (threads > (int)file_count)
+        threads = (int)file_count;
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    if (threads <= 1) // Nothing to parallelise
+        return create_database(hash, head);
+
+    Build_job job;
+    Worker_t workers[MAX_THREADS];
+    Status status = FAILURE;
+    int ready = 0;
+
+    job.names = malloc(file_count * sizeof(char *));
+    job.doc_ids = malloc(file_count * sizeof(uint32_t));
+    job.lengths = malloc(file_count * sizeof(uint32_t));
+    job.partials = malloc(threads * sizeof(Hash_t));
+    job.parts = malloc(threads * sizeof(Hash_t));
+    job.file_count = file_count;
+    job.threads = threads;
+    atomic_init(&job.next_file, 0);
+    atomic_init(&job.failed, 0);
+
+    if (job.names == NULL || job.doc_ids == NULL || job.lengths == NULL || job.partials == NULL || job.parts == NULL)
+        goto cleanup;
+
+    uint32_t i = 0;
+    for (File_list *temp = head; temp; temp = temp->next, i++) // IDs assigned in list order, as sequentially
+    {
+        job.names[i] = temp->file_name;
+        job.doc_ids[i] = doc_table_add(&hash->docs, &hash->arena, temp->file_name);
+        if (job.doc_ids[i] == DOC_NONE)
+            goto cleanup;
+    }
+
+    for (; ready < threads; ready++)
+    {
+        if (initialise_hash(&job.partials[ready]) == FAILURE)
+            goto cleanup;
+        job.partials[ready].positional = hash->positional; // Workers record positions too
+        job.partials[ready].normalize = hash->normalize;   // and normalize like the index
+        if (initialise_hash(&job.parts[ready]) == FAILURE)
+        {
+            free_hash(&job.partials[ready]);
+            goto cleanup;
+        }
+        workers[ready].job = &job;
+        workers[ready].id = ready;
+        workers[ready].scratch = NULL;
+        workers[ready].scratch_size = 0;
+    }
+
+    if (run_workers(&job, workers, index_worker) == FAILURE) // Phase 1: partial indexes
+        goto cleanup;
+    for (i = 0; i < file_count; i++)
+        doc_table_set_length(&hash->docs, job.doc_ids[i], job.lengths[i]);
+    if (run_workers(&job, workers, merge_worker) == FAILURE) // Phase 2: partitioned merge
+        goto cleanup;
+
+    Stats_timer timer;
+    STAT_START(timer);
+    status = link_words(hash, &job); // Phase 3: final table
+    STAT_STOP(timer, PHASE_MERGE);
+    STAT_START(timer);
+    if (status == SUCCESS)
+        status = postings_pack_all(hash); // Words that gained files from this build
+    STAT_STOP(timer, PHASE_PACK);
+
+    for (int t = 0; t < threads; t++) // Merged words now belong to the database
+    {
+        arena_adopt(&hash->arena, &job.parts[t].arena);
+        pool_adopt(&hash->strings, &job.parts[t].strings);
+    }
+
+cleanup:
+    for (int t = 0; t < ready; t++)
+    {
+        free_hash(&job.partials[t]);
+        free_hash(&job.parts[t]);
+        free(workers[t].scratch);
+    }
+    free(job.names);
+    free(job.doc_ids);
+    free(job.lengths);
+    free(job.partials);
+    free(job.parts);
+    return status;
+}
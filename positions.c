@@ -0,0 +1,178 @@
+/***********************************************************************
+ *  File Name   : positions.c
+ *  Description : Optional positional index for the Inverted Search
+ *                System (--positions). Next to its sub node array every
+ *                word then keeps the token offsets of its occurrences:
+ *
+ *                  offsets[i] : first byte of sub node i's positions
+ *                  data       : per file, word_count varints holding
+ *                               the first offset and then the gaps
+ *                               between consecutive offsets
+ *
+ *                Sub nodes themselves do not change, so searches that
+ *                do not need positions never touch them. Offsets grow in
+ *                step with the sub node array. A word loaded from a .bin
+ *                index reads both straight from the mapping and copies
+ *                them out only if it is modified.
+ *
+ *                Functions:
+ *                  - positions_attach()
+ *                  - positions_reserve()
+ *                  - positions_add()
+ *                  - positions_copy()
+ *                  - positions_span()
+ *                  - positions_decode()
+ *                  - positions_drop()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+
+#define POSITIONS_INITIAL_SIZE 16 // Bytes first allocated for a word's varints
+
+/* Gives a word with no sub nodes yet an empty position list */
+Status positions_attach(Arena_t *arena, Main_node *node)
+{
+    Positions_t *pos = arena_alloc(arena, sizeof(Positions_t));
+    if (pos == NULL)
+        return FAILURE;
+
+    memset(pos, 0, sizeof(Positions_t));
+    node->positions = pos;
+    return SUCCESS;
+}
+
+/* Makes data hold at least extra more bytes */
+static Status reserve_bytes(Arena_t *arena, Positions_t *pos, uint32_t extra)
+{
+    if (pos->size + extra <= pos->capacity)
+        return SUCCESS;
+
+    uint32_t capacity = pos->capacity ? pos->capacity : POSITIONS_INITIAL_SIZE;
+    while (capacity < pos->size + extra)
+        capacity *= 2;
+
+    uint8_t *grown = arena_grow(arena, pos->data, pos->size, capacity);
+    if (grown == NULL)
+        return FAILURE;
+
+    pos->data = grown;
+    pos->capacity = capacity;
+    return SUCCESS;
+}
+
+/* Called before a sub node is appended: owns the data and sizes offsets for capacity sub nodes */
+Status positions_reserve(Arena_t *arena, Main_node *node, uint32_t capacity)
+{
+    Positions_t *pos = node->positions;
+
+    if (pos->capacity == 0 && pos->data) // Borrowed from a mapped index -> copy out the bytes in use
+    {
+        uint32_t size = 0;
+        if (node->file_count) // Offsets only ever increase, so the last file's run ends the data
+        {
+            uint32_t last = node->file_count - 1;
+            size = pos->offsets[last] + positions_span(pos->data + pos->offsets[last], node->s_list[last].word_count);
+        }
+
+        const uint8_t *borrowed = pos->data;
+        pos->data = NULL;
+        pos->size = 0;
+        if (reserve_bytes(arena, pos, size) == FAILURE)
+            return FAILURE;
+        if (size)
+            memcpy(pos->data, borrowed, size);
+        pos->size = size;
+    }
+
+    if (capacity <= pos->offsets_capacity) // Offsets already have room
+        return SUCCESS;
+
+    uint32_t *offsets;
+    if (pos->offsets_capacity == 0 && node->file_count) // Borrowed or exactly sized -> copy out
+    {
+        offsets = arena_grow(arena, NULL, 0, capacity * sizeof(uint32_t));
+        if (offsets)
+            memcpy(offsets, pos->offsets, node->file_count * sizeof(uint32_t));
+    }
+    else
+    {
+        offsets = arena_grow(arena, pos->offsets, pos->offsets_capacity * sizeof(uint32_t), capacity * sizeof(uint32_t));
+    }
+
+    if (offsets == NULL)
+        return FAILURE;
+    pos->offsets = offsets;
+    pos->offsets_capacity = capacity;
+    return SUCCESS;
+}
+
+/* Records the next occurrence of a word in the file being indexed (its last sub node) */
+Status positions_add(Arena_t *arena, Main_node *node, uint32_t position)
+{
+    Positions_t *pos = node->positions;
+    uint32_t last = node->file_count - 1;
+    uint32_t delta = position;
+
+    if (node->s_list[last].word_count == 1) // First occurrence in this file -> start its run
+        pos->offsets[last] = pos->size;
+    else
+        delta -= pos->last;
+
+    if (reserve_bytes(arena, pos, VARINT_MAX_BYTES) == FAILURE)
+        return FAILURE;
+
+    pos->size += varint_put(pos->data + pos->size, delta);
+    pos->last = position;
+    return SUCCESS;
+}
+
+/* Appends the positions of from's sub node from_index (word_count occurrences) as to's sub node to_index */
+Status positions_copy(Arena_t *arena, Main_node *to, uint32_t to_index, const Main_node *from, uint32_t from_index, uint32_t word_count)
+{
+    const Positions_t *src = from->positions;
+    const uint8_t *bytes = src->data + src->offsets[from_index];
+    uint32_t len = positions_span(bytes, word_count);
+    Positions_t *dst = to->positions;
+
+    if (reserve_bytes(arena, dst, len) == FAILURE)
+        return FAILURE;
+
+    dst->offsets[to_index] = dst->size;
+    memcpy(dst->data + dst->size, bytes, len);
+    dst->size += len;
+    return SUCCESS;
+}
+
+/* Bytes taken by count varints */
+uint32_t positions_span(const uint8_t *data, uint32_t count)
+{
+    uint32_t len = 0;
+    while (count)
+        count -= (data[len++] & 0x80) == 0; // A clear high bit ends one varint
+    return len;
+}
+
+/* Decodes count varint gaps into ascending token offsets */
+void positions_decode(const uint8_t *data, uint32_t count, uint32_t *out)
+{
+    uint32_t position = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t value = varint_get(&data);
+        position = i ? position + value : value;
+        out[i] = position;
+    }
+}
+
+/* Turns positional mode off, e.g. after merging a backup without positions */
+void positions_drop(Hash_t *hash)
+{
+    for (Main_node *node = hash->head; node; node = node->m_link)
+        node->positions = NULL; // Memory stays in the arena until free_hash()
+    hash->positional = false;
+}
@@ -0,0 +1,623 @@
+/***********************************************************************
+ *  File Name   : postings.c
+ *  Description : Compressed sub node lists for the Inverted Search
+ *                System. Once a word stops changing its sub nodes are
+ *                packed into one byte array:
+ *
+ *                  skip table  { last doc ID, byte offset } per full
+ *                              block, for seeking without decoding
+ *                  blocks      POSTING_BLOCK sub nodes each: document
+ *                              ID gaps and word counts - 1, bit-packed
+ *                              at the width of the block's largest
+ *                              value in four interleaved 32-bit lanes
+ *                              (SIMD-BP128 layout)
+ *                  tail        the remaining < POSTING_BLOCK sub nodes
+ *                              as varint (gap, count - 1) pairs
+ *
+ *                Blocks are unpacked four lanes at a time with SSE2 and
+ *                the gaps turned back into IDs with a vector prefix sum.
+ *                A word being modified is unpacked into an ordinary sub
+ *                node array and packed again when the operation ends.
+ *                The .bin index stores the same bytes, so a loaded
+ *                index is queried straight from the mapping: its skip
+ *                tables, widths and tails are checked when it loads and
+ *                each block when it is decoded, and a damaged word fails
+ *                the operation instead of yielding IDs past the
+ *                document table.
+ *
+ *                Functions:
+ *                  - varint_put() / varint_get()
+ *                  - postings_packed_size() / postings_encode()
+ *                  - postings_pack_list() / postings_pack()
+ *                  - postings_pack_all() / postings_unpack()
+ *                  - postings_size() / postings_check()
+ *                  - postings_decode() / postings_decode_docs()
+ *                  - postings_get()
+ *                  - cursor_init() / cursor_seek()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+typedef struct posting_skip
+{
+    uint32_t last_doc; // Last document ID of the block
+    uint32_t offset;   // Block bytes, from the start of the packed word
+} Posting_skip;
+
+/* ------------------ Varints ------------------ */
+
+uint32_t varint_put(uint8_t *out, uint32_t value)
+{
+    uint32_t n = 0;
+    while (value >= 0x80) // Low 7 bits first, high bit = more bytes follow
+    {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+uint32_t varint_get(const uint8_t **in)
+{
+    const uint8_t *p = *in;
+    uint32_t value = 0;
+    int shift = 0;
+
+    while (*p & 0x80)
+    {
+        value |= (uint32_t)(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= (uint32_t)*p++ << shift;
+
+    *in = p;
+    return value;
+}
+
+static inline uint32_t varint_len(uint32_t value)
+{
+    uint32_t n = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+/* ------------------ Bit packing ------------------ */
+
+static inline uint32_t bits_for(uint32_t value)
+{
+    return value ? 32 - (uint32_t)__builtin_clz(value) : 0;
+}
+
+static inline uint32_t block_bytes(uint32_t doc_bits, uint32_t count_bits)
+{
+    return 2 + 16 * (doc_bits + count_bits); // Two width bytes, then 4 lanes x bits words per array
+}
+
+static inline Posting_skip skip_at(const uint8_t *packed, uint32_t block)
+{
+    Posting_skip skip;
+    memcpy(&skip, packed + (size_t)block * sizeof(Posting_skip), sizeof(skip)); // Any alignment
+    return skip;
+}
+
+/* POSTING_BLOCK values into 16 * bits bytes; value i goes to lane i % 4, row i / 4 */
+static void pack_bits(const uint32_t *values, uint32_t bits, uint8_t *out)
+{
+    uint32_t words[4 * 32];
+
+    if (bits == 0) // Every value is zero
+        return;
+
+    memset(words, 0, 16 * bits);
+    for (uint32_t row = 0; row < POSTING_BLOCK / 4; row++)
+    {
+        uint32_t bit = row * bits, word = bit / 32, shift = bit % 32;
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            uint32_t value = values[4 * row + lane];
+            words[4 * word + lane] |= value << shift;
+            if (shift + bits > 32) // Row continues in the lane's next word
+                words[4 * (word + 1) + lane] |= value >> (32 - shift);
+        }
+    }
+    memcpy(out, words, 16 * bits);
+}
+
+static void unpack_bits(const uint8_t *in, uint32_t bits, uint32_t *out)
+{
+    if (bits == 0)
+    {
+        memset(out, 0, POSTING_BLOCK * sizeof(uint32_t));
+        return;
+    }
+
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi32(bits == 32 ? -1 : (int)((1u << bits) - 1));
+    const __m128i *words = (const __m128i *)in;
+    __m128i current = _mm_loadu_si128(words++);
+    uint32_t shift = 0;
+
+    for (uint32_t row = 0; row < POSTING_BLOCK / 4; row++) // One row of all four lanes per step
+    {
+        __m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128((int)shift));
+        shift += bits;
+        if (shift >= 32 && row + 1 < POSTING_BLOCK / 4) // Next word, high bits of this row first
+        {
+            current = _mm_loadu_si128(words++);
+            shift -= 32;
+            if (shift)
+                value = _mm_or_si128(value, _mm_sll_epi32(current, _mm_cvtsi32_si128((int)(bits - shift))));
+        }
+        _mm_storeu_si128((__m128i *)(out + 4 * row), _mm_and_si128(value, mask));
+    }
+#else
+    uint32_t mask = bits == 32 ? UINT32_MAX : (1u << bits) - 1;
+    for (uint32_t i = 0; i < POSTING_BLOCK; i++)
+    {
+        uint32_t bit = (i / 4) * bits, word = bit / 32, shift = bit % 32, lo, hi;
+        memcpy(&lo, in + 4 * (4 * word + i % 4), 4);
+        uint32_t value = lo >> shift;
+        if (shift + bits > 32)
+        {
+            memcpy(&hi, in + 4 * (4 * (word + 1) + i % 4), 4);
+            value |= hi << (32 - shift);
+        }
+        out[i] = value & mask;
+    }
+#endif
+}
+
+/* Gaps -> document IDs, continuing from base */
+static void prefix_sum(uint32_t *values, uint32_t base)
+{
+#if defined(__SSE2__)
+    __m128i carry = _mm_set1_epi32((int)base);
+    for (uint32_t i = 0; i < POSTING_BLOCK; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4)); // Running sum inside the register
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, carry);
+        _mm_storeu_si128((__m128i *)(values + i), v);
+        carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)); // Last sum feeds the next four
+    }
+#else
+    for (uint32_t i = 0; i < POSTING_BLOCK; i++)
+        values[i] = base += values[i];
+#endif
+}
+
+static void add_one(uint32_t *values)
+{
+#if defined(__SSE2__)
+    const __m128i one = _mm_set1_epi32(1);
+    for (uint32_t i = 0; i < POSTING_BLOCK; i += 4)
+        _mm_storeu_si128((__m128i *)(values + i), _mm_add_epi32(_mm_loadu_si128((const __m128i *)(values + i)), one));
+#else
+    for (uint32_t i = 0; i < POSTING_BLOCK; i++)
+        values[i]++;
+#endif
+}
+
+/* ------------------ Encoding ------------------ */
+
+/* Gaps and counts - 1 of one full block, with their bit widths */
+static void block_values(const Sub_node *subs, uint32_t prev, uint32_t *gaps, uint32_t *counts, uint32_t *doc_bits, uint32_t *count_bits)
+{
+    uint32_t gap_or = 0, count_or = 0;
+    for (uint32_t i = 0; i < POSTING_BLOCK; i++)
+    {
+        gaps[i] = subs[i].doc_id - prev;
+        counts[i] = subs[i].word_count - 1;
+        prev = subs[i].doc_id;
+        gap_or |= gaps[i];
+        count_or |= counts[i];
+    }
+    *doc_bits = bits_for(gap_or);
+    *count_bits = bits_for(count_or);
+}
+
+size_t postings_packed_size(const Sub_node *subs, uint32_t count)
+{
+    uint32_t blocks = count / POSTING_BLOCK;
+    size_t size = blocks * sizeof(Posting_skip);
+    uint32_t gaps[POSTING_BLOCK], counts[POSTING_BLOCK], doc_bits, count_bits, prev = 0;
+
+    for (uint32_t b = 0; b < blocks; b++)
+    {
+        block_values(subs + b * POSTING_BLOCK, prev, gaps, counts, &doc_bits, &count_bits);
+        size += block_bytes(doc_bits, count_bits);
+        prev = subs[(b + 1) * POSTING_BLOCK - 1].doc_id;
+    }
+    for (uint32_t i = blocks * POSTING_BLOCK; i < count; i++)
+    {
+        size += varint_len(subs[i].doc_id - prev) + varint_len(subs[i].word_count - 1);
+        prev = subs[i].doc_id;
+    }
+    return size;
+}
+
+void postings_encode(const Sub_node *subs, uint32_t count, uint8_t *out)
+{
+    uint32_t blocks = count / POSTING_BLOCK;
+    size_t pos = blocks * sizeof(Posting_skip);
+    uint32_t gaps[POSTING_BLOCK], counts[POSTING_BLOCK], doc_bits, count_bits, prev = 0;
+
+    for (uint32_t b = 0; b < blocks; b++)
+    {
+        block_values(subs + b * POSTING_BLOCK, prev, gaps, counts, &doc_bits, &count_bits);
+        prev = subs[(b + 1) * POSTING_BLOCK - 1].doc_id;
+
+        Posting_skip skip = {prev, (uint32_t)pos};
+        memcpy(out + b * sizeof(Posting_skip), &skip, sizeof(skip));
+
+        out[pos] = (uint8_t)doc_bits;
+        out[pos + 1] = (uint8_t)count_bits;
+        pack_bits(gaps, doc_bits, out + pos + 2);
+        pack_bits(counts, count_bits, out + pos + 2 + 16 * doc_bits);
+        pos += block_bytes(doc_bits, count_bits);
+    }
+    for (uint32_t i = blocks * POSTING_BLOCK; i < count; i++) // Short tail as varints
+    {
+        pos += varint_put(out + pos, subs[i].doc_id - prev);
+        pos += varint_put(out + pos, subs[i].word_count - 1);
+        prev = subs[i].doc_id;
+    }
+}
+
+/* Packs count sorted sub nodes into the arena as the word's postings */
+Status postings_pack_list(Arena_t *arena, Main_node *node, const Sub_node *subs, uint32_t count)
+{
+    size_t size = postings_packed_size(subs, count);
+    uint8_t *packed = arena_reuse(arena, size ? size : 1);
+    if (packed == NULL)
+        return FAILURE;
+
+    postings_encode(subs, count, packed);
+    node->packed = packed;
+    node->file_count = count;
+    return SUCCESS;
+}
+
+Status postings_pack(Arena_t *arena, Main_node *node)
+{
+    if (node->packed || node->file_count == 0) // Already packed, or about to be unlinked
+        return SUCCESS;
+
+    Sub_node *s_list = node->s_list;
+    if (postings_pack_list(arena, node, s_list, node->file_count) == FAILURE)
+        return FAILURE;
+
+    arena_release(arena, s_list, node->capacity * sizeof(Sub_node)); // Reused by later arrays and packed words
+    node->s_list = NULL;
+    node->capacity = 0;
+    return SUCCESS;
+}
+
+Status postings_pack_all(Hash_t *hash)
+{
+    for (Main_node *node = hash->head; node; node = node->m_link)
+    {
+        if (postings_pack(&hash->arena, node) == FAILURE)
+            return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* Turns a packed word back into a growable sub node array */
+Status postings_unpack(Arena_t *arena, Main_node *node)
+{
+    if (node->packed == NULL)
+        return SUCCESS;
+
+    uint32_t capacity = 1;
+    while (capacity < node->file_count)
+        capacity *= 2;
+
+    Sub_node *s_list = arena_grow(arena, NULL, 0, capacity * sizeof(Sub_node));
+    if (s_list == NULL)
+        return FAILURE;
+
+    if (postings_decode(node, s_list) == FAILURE)
+        return FAILURE;
+    node->s_list = s_list;
+    node->capacity = capacity;
+    node->packed = NULL; // Arena bytes are simply left behind, mapped bytes stay in the file
+    return SUCCESS;
+}
+
+/* ------------------ Decoding ------------------ */
+
+static inline size_t tail_offset(const uint8_t *packed, uint32_t blocks)
+{
+    if (blocks == 0)
+        return 0;
+    Posting_skip last = skip_at(packed, blocks - 1);
+    return last.offset + block_bytes(packed[last.offset], packed[last.offset + 1]);
+}
+
+/* Bytes of a packed word */
+size_t postings_size(const Main_node *node)
+{
+    uint32_t blocks = node->file_count / POSTING_BLOCK;
+    size_t tail = tail_offset(node->packed, blocks);
+    return tail + positions_span(node->packed + tail, 2 * (node->file_count % POSTING_BLOCK));
+}
+
+/* varint_get() that stops at end and rejects values past 32 bits */
+static bool varint_get_bounded(const uint8_t **in, const uint8_t *end, uint32_t *value)
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 35 && *in < end; shift += 7)
+    {
+        uint8_t byte = *(*in)++;
+        v |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            *value = (uint32_t)v;
+            return v <= UINT32_MAX;
+        }
+    }
+    return false;
+}
+
+/* Whether size bytes hold count packed sub nodes with IDs below doc_count; block contents are left to decode_block() */
+Status postings_check(const uint8_t *packed, uint64_t size, uint32_t count, uint32_t doc_count)
+{
+    uint32_t blocks = count / POSTING_BLOCK;
+    uint64_t offset = (uint64_t)blocks * sizeof(Posting_skip);
+    uint64_t prev = 0;
+
+    if (offset > size)
+        return FAILURE;
+    for (uint32_t b = 0; b < blocks; b++) // Blocks follow the skip table back to back
+    {
+        Posting_skip skip = skip_at(packed, b);
+        if (skip.offset != offset || offset + 2 > size || packed[offset] > 32 || packed[offset + 1] > 32)
+            return FAILURE;
+        offset += block_bytes(packed[offset], packed[offset + 1]);
+        if (offset > size || skip.last_doc >= doc_count || (b && skip.last_doc <= prev))
+            return FAILURE;
+        prev = skip.last_doc;
+    }
+
+    const uint8_t *in = packed + offset, *end = packed + size;
+    for (uint32_t i = 0; i < count % POSTING_BLOCK; i++)
+    {
+        uint32_t gap, word_count;
+        if (!varint_get_bounded(&in, end, &gap) || !varint_get_bounded(&in, end, &word_count) ||
+            (gap == 0 && (blocks || i)) || prev + gap >= doc_count || word_count == UINT32_MAX)
+            return FAILURE;
+        prev += gap;
+    }
+    return SUCCESS;
+}
+
+/* Whether a decoded full block rises strictly from prev to its skip entry's ID */
+static bool block_ok(const uint32_t *docs, uint32_t block, uint32_t prev, uint32_t last_doc)
+{
+    uint32_t bad = block && docs[0] <= prev;
+    for (uint32_t i = 1; i < POSTING_BLOCK; i++)
+        bad |= docs[i] <= docs[i - 1];
+    return !bad && docs[POSTING_BLOCK - 1] == last_doc;
+}
+
+/* Decodes full block b, or the tail when b is the number of full blocks; counts may be NULL. 0 for a damaged block */
+static uint32_t decode_block(const Main_node *node, uint32_t block, uint32_t *docs, uint32_t *counts)
+{
+    const uint8_t *packed = node->packed;
+    uint32_t blocks = node->file_count / POSTING_BLOCK;
+    uint32_t prev = block ? skip_at(packed, block - 1).last_doc : 0;
+
+    if (block < blocks)
+    {
+        Posting_skip skip = skip_at(packed, block);
+        const uint8_t *in = packed + skip.offset;
+        uint32_t doc_bits = in[0], count_bits = in[1];
+
+        unpack_bits(in + 2, doc_bits, docs);
+        prefix_sum(docs, prev);
+        if (!block_ok(docs, block, prev, skip.last_doc))
+            return 0;
+        if (counts)
+        {
+            unpack_bits(in + 2 + 16 * doc_bits, count_bits, counts);
+            add_one(counts);
+        }
+        return POSTING_BLOCK;
+    }
+
+    const uint8_t *in = packed + tail_offset(packed, blocks);
+    uint32_t tail = node->file_count % POSTING_BLOCK;
+    for (uint32_t i = 0; i < tail; i++)
+    {
+        prev += varint_get(&in);
+        docs[i] = prev;
+        uint32_t count = varint_get(&in) + 1;
+        if (counts)
+            counts[i] = count;
+    }
+    return tail;
+}
+
+Status postings_decode(const Main_node *node, Sub_node *out)
+{
+    if (node->packed == NULL)
+    {
+        memcpy(out, node->s_list, node->file_count * sizeof(Sub_node));
+        return SUCCESS;
+    }
+
+    uint32_t docs[POSTING_BLOCK], counts[POSTING_BLOCK];
+    for (uint32_t b = 0, n = 0; n < node->file_count; b++)
+    {
+        uint32_t size = decode_block(node, b, docs, counts);
+        if (size == 0)
+            return FAILURE;
+        for (uint32_t i = 0; i < size; i++, n++)
+        {
+            out[n].doc_id = docs[i];
+            out[n].word_count = counts[i];
+        }
+    }
+    return SUCCESS;
+}
+
+/* Document IDs only, for the query engine */
+Status postings_decode_docs(const Main_node *node, uint32_t *out)
+{
+    if (node->packed == NULL)
+    {
+        for (uint32_t i = 0; i < node->file_count; i++)
+            out[i] = node->s_list[i].doc_id;
+        return SUCCESS;
+    }
+
+    uint32_t blocks = node->file_count / POSTING_BLOCK;
+    for (uint32_t b = 0; b < blocks; b++) // Full blocks straight into the output
+    {
+        if (decode_block(node, b, out + (size_t)b * POSTING_BLOCK, NULL) == 0)
+            return FAILURE;
+    }
+    decode_block(node, blocks, out + (size_t)blocks * POSTING_BLOCK, NULL);
+    return SUCCESS;
+}
+
+/* A word's sub nodes: in place, or decoded into a caller-owned scratch array */
+const Sub_node *postings_get(const Main_node *node, Sub_node **scratch, uint32_t *scratch_size)
+{
+    if (node->packed == NULL)
+        return node->s_list;
+
+    if (node->file_count > *scratch_size)
+    {
+        Sub_node *grown = realloc(*scratch, node->file_count * sizeof(Sub_node));
+        if (grown == NULL)
+            return NULL;
+        *scratch = grown;
+        *scratch_size = node->file_count;
+    }
+    return postings_decode(node, *scratch) == SUCCESS ? *scratch : NULL;
+}
+
+/* ------------------ Cursors ------------------ */
+
+void cursor_init(Posting_cursor *cursor, const Main_node *node)
+{
+    cursor->node = node;
+    cursor->block = UINT32_MAX;
+    cursor->first = 0;
+    cursor->size = 0;
+    cursor->pos = 0;
+    cursor->damaged = false;
+}
+
+/* First index at or after from whose ID is >= doc_id, by galloping */
+static uint32_t gallop_subs(const Sub_node *subs, uint32_t count, uint32_t from, uint32_t doc_id)
+{
+    uint32_t lo = from, hi = from, step = 1;
+
+    while (hi < count && subs[hi].doc_id < doc_id) // Exponential probe
+    {
+        lo = hi + 1;
+        hi += step;
+        step <<= 1;
+    }
+    if (hi > count)
+        hi = count;
+
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (subs[mid].doc_id < doc_id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Moves forward to doc_id; true (with its index and word count) if the word occurs there */
+bool cursor_seek(Posting_cursor *cursor, uint32_t doc_id, uint32_t *index, uint32_t *word_count)
+{
+    const Main_node *node = cursor->node;
+
+    if (node->packed == NULL) // Plain sub node array
+    {
+        cursor->pos = gallop_subs(node->s_list, node->file_count, cursor->pos, doc_id);
+        if (cursor->pos == node->file_count || node->s_list[cursor->pos].doc_id != doc_id)
+            return false;
+        *index = cursor->pos;
+        *word_count = node->s_list[cursor->pos].word_count;
+        return true;
+    }
+
+    if (cursor->pos >= node->file_count)
+        return false;
+
+    if (cursor->block == UINT32_MAX || cursor->docs[cursor->size - 1] < doc_id) // Past the decoded block
+    {
+        uint32_t blocks = node->file_count / POSTING_BLOCK;
+        uint32_t lo = cursor->block == UINT32_MAX ? 0 : cursor->block + 1, hi = blocks;
+
+        while (lo < hi) // First full block that can hold doc_id, from the skip table
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (skip_at(node->packed, mid).last_doc < doc_id)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo > (node->file_count - 1) / POSTING_BLOCK) // Beyond the last block, full or tail
+        {
+            cursor->pos = node->file_count;
+            return false;
+        }
+
+        cursor->size = decode_block(node, lo, cursor->docs, cursor->counts);
+        if (cursor->size == 0) // Damaged block: nothing more from this word
+        {
+            cursor->damaged = true;
+            cursor->pos = node->file_count;
+            return false;
+        }
+        cursor->block = lo;
+        cursor->first = lo * POSTING_BLOCK;
+        cursor->pos = cursor->first;
+        if (cursor->docs[cursor->size - 1] < doc_id) // Beyond the tail
+        {
+            cursor->pos = node->file_count;
+            return false;
+        }
+    }
+
+    uint32_t lo = cursor->pos - cursor->first, hi = cursor->size;
+    while (lo < hi) // Within the decoded block
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (cursor->docs[mid] < doc_id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    cursor->pos = cursor->first + lo;
+
+    if (cursor->docs[lo] != doc_id) // lo < size: the block's last ID is >= doc_id
+        return false;
+    *index = cursor->pos;
+    *word_count = cursor->counts[lo];
+    return true;
+}
@@ -0,0 +1,1116 @@
+/***********************************************************************
+ *  File Name   : query.c
+ *  Description : Boolean query engine for the Inverted Search System.
+ *                Queries combine words with AND, OR and NOT (upper
+ *                case) and parentheses. Adjacent words are ANDed, and
+ *                "a NOT b" means "a AND NOT b". NOT binds tighter than
+ *                AND, which binds tighter than OR. A word containing
+ *                '*' is a wildcard ("time*", "*ing", "t*e") matching
+ *                every word of the term dictionary that fits it.
+ *                With a positional index (--positions), "a b c" in
+ *                double quotes matches the words as a phrase, and
+ *                "a NEAR/k b" matches a and b whose positions differ by
+ *                at most k, so NEAR/1 means adjacent.
+ *                Words go through the index's normalization (case,
+ *                punctuation, stop words, stemming) before lookup; a
+ *                stop word drops out of the query, leaving the other
+ *                operand of its AND, OR or NEAR.
+ *
+ *                Every word's sub nodes are sorted by document ID, so
+ *                each operator is a merge of sorted ID sequences:
+ *                  - AND chains are flattened and intersected smallest
+ *                    list first; the running result only shrinks.
+ *                  - Lists of similar length are intersected with an
+ *                    SSE2 4x4 block compare, very unequal ones by
+ *                    galloping (exponential then binary search) through
+ *                    the longer list.
+ *                  - NOT operands of an AND chain are subtracted from
+ *                    the final, smallest result.
+ *                Packed words are decoded only when a merge needs them;
+ *                a word far longer than the running result is probed
+ *                through its skip table instead, decoding just the
+ *                blocks that can hold a candidate, so a query costs
+ *                roughly the length of its shortest AND operand.
+ *                Wildcards union the postings of their matching words
+ *                through a document bitmap, or by sorting when the
+ *                matches are sparse. Phrase and NEAR operands are
+ *                intersected like an AND chain first; only the files
+ *                left over have their positions decoded and compared.
+ *
+ *                Functions:
+ *                  - query_parse()
+ *                  - query_run()
+ *                  - doc_set_free()
+ *                  - query_positive_words()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+_Static_assert(sizeof(Sub_node) == 2 * sizeof(uint32_t), "Sub_node must be two uint32_t words");
+
+/* ------------------ Parser ------------------ */
+
+typedef enum
+{
+    T_END,
+    T_WORD,
+    T_AND,
+    T_OR,
+    T_NOT,
+    T_LPAREN,
+    T_RPAREN,
+    T_PHRASE,
+    T_NEAR,
+    T_ERROR
+} Token_kind;
+
+#define DROPPED (-2) // Operand that normalized away (stop word), as opposed to -1 for a parse error
+
+typedef struct query_parser
+{
+    const char *pos;      // Next unread character
+    Token_kind kind;      // Current token
+    char word[WORD_SIZE]; // Current T_WORD, normalized; "" when it dropped out
+    const char *phrase;   // Current T_PHRASE, between the quotes
+    size_t phrase_len;
+    uint32_t distance;    // Current T_NEAR
+    unsigned normalize;   // NORM_* steps of the index
+    Query_t *query;
+} Query_parser;
+
+/* "NEAR/k" with k >= 1 */
+static bool near_token(const char *start, size_t len, uint32_t *distance)
+{
+    if (len < 6 || strncmp(start, "NEAR/", 5) != 0)
+        return false;
+
+    uint64_t k = 0;
+    for (size_t i = 5; i < len; i++)
+    {
+        if (!isdigit((unsigned char)start[i]) || (k = k * 10 + (start[i] - '0')) > UINT32_MAX)
+            return false;
+    }
+    *distance = (uint32_t)k;
+    return k > 0;
+}
+
+static void next_token(Query_parser *p)
+{
+    while (isspace((unsigned char)*p->pos))
+        p->pos++;
+
+    if (*p->pos == '\0')
+    {
+        p->kind = T_END;
+        return;
+    }
+    if (*p->pos == '(' || *p->pos == ')')
+    {
+        p->kind = *p->pos++ == '(' ? T_LPAREN : T_RPAREN;
+        return;
+    }
+    if (*p->pos == '"') // Phrase runs to the closing quote
+    {
+        const char *end = strchr(p->pos + 1, '"');
+        p->kind = end ? T_PHRASE : T_ERROR;
+        if (end)
+        {
+            p->phrase = p->pos + 1;
+            p->phrase_len = end - p->phrase;
+            p->pos = end + 1;
+        }
+        return;
+    }
+
+    const char *start = p->pos;
+    while (*p->pos && !isspace((unsigned char)*p->pos) && *p->pos != '(' && *p->pos != ')' && *p->pos != '"')
+        p->pos++;
+
+    size_t len = p->pos - start;
+    if (len == 3 && strncmp(start, "AND", 3) == 0)
+        p->kind = T_AND;
+    else if (len == 2 && strncmp(start, "OR", 2) == 0)
+        p->kind = T_OR;
+    else if (len == 3 && strncmp(start, "NOT", 3) == 0)
+        p->kind = T_NOT;
+    else if (near_token(start, len, &p->distance))
+        p->kind = T_NEAR;
+    else
+    {
+        len = clamp_word_len(start, len); // Same truncation and normalization as indexing
+        len = memchr(start, '*', len) ? normalize_pattern(p->normalize, &start, len, p->word)
+                                      : normalize_word(p->normalize, &start, len, p->word);
+        memmove(p->word, start, len); // start may point into p->word already
+        p->word[len] = '\0';
+        p->kind = T_WORD;
+    }
+}
+
+static int new_node(Query_parser *p, Query_op op, int left, int right)
+{
+    if (((op == Q_NOT || op == Q_AND || op == Q_OR || op == Q_NEAR) && left < 0) ||
+        ((op == Q_AND || op == Q_OR || op == Q_NEAR) && right < 0)) // Operand failed to parse
+        return -1;
+    if (p->query->count == MAX_QUERY_NODES)
+    {
+        fprintf(stderr, "Error: Query has more than %d terms and operators\n", MAX_QUERY_NODES);
+        return -1;
+    }
+
+    Query_node *node = &p->query->nodes[p->query->count];
+    node->op = op;
+    node->left = left;
+    node->right = right;
+    node->distance = 0;
+    node->word[0] = '\0';
+    return p->query->count++;
+}
+
+/* left op right, where an operand that dropped out leaves the other one */
+static int combine(Query_parser *p, Query_op op, int left, int right)
+{
+    if (left == DROPPED)
+        return right;
+    if (right == DROPPED)
+        return left;
+    return new_node(p, op, left, right);
+}
+
+static int new_term(Query_parser *p, const char *word, size_t len)
+{
+    int node = new_node(p, Q_TERM, -1, -1);
+    if (node >= 0)
+    {
+        memcpy(p->query->nodes[node].word, word, len);
+        p->query->nodes[node].word[len] = '\0';
+    }
+    return node;
+}
+
+/* Words of the current T_PHRASE as consecutive Q_TERM nodes under one Q_PHRASE */
+static int parse_phrase(Query_parser *p)
+{
+    const char *pos = p->phrase, *end = p->phrase + p->phrase_len;
+    char word[WORD_SIZE];
+    int first = -1, count = 0, words = 0;
+
+    while (pos < end)
+    {
+        while (pos < end && isspace((unsigned char)*pos))
+            pos++;
+        const char *start = pos;
+        while (pos < end && !isspace((unsigned char)*pos))
+            pos++;
+        if (pos == start)
+            break;
+
+        if (memchr(start, '*', pos - start))
+        {
+            fprintf(stderr, "Error: Wildcards are not allowed inside a phrase\n");
+            return -1;
+        }
+        words++;
+        const char *term = start;
+        size_t len = normalize_word(p->normalize, &term, clamp_word_len(start, pos - start), word); // Same as indexing
+        if (len == 0) // Stop words hold no position in the index either
+            continue;
+        int node = new_term(p, term, len);
+        if (node < 0)
+            return -1;
+        if (count++ == 0)
+            first = node;
+    }
+
+    if (count <= 1) // "" is invalid, "word" is just the word
+        return words && count == 0 ? DROPPED : first;
+    return new_node(p, Q_PHRASE, first, count);
+}
+
+static int parse_or(Query_parser *p);
+
+static int parse_unary(Query_parser *p)
+{
+    if (p->kind == T_NOT)
+    {
+        next_token(p);
+        int operand = parse_unary(p);
+        return operand == DROPPED ? DROPPED : new_node(p, Q_NOT, operand, -1);
+    }
+    if (p->kind == T_LPAREN)
+    {
+        next_token(p);
+        int node = parse_or(p);
+        if (node == -1 || p->kind != T_RPAREN)
+            return -1;
+        next_token(p);
+        return node;
+    }
+    if (p->kind == T_PHRASE)
+    {
+        int node = parse_phrase(p);
+        next_token(p);
+        return node;
+    }
+    if (p->kind == T_WORD)
+    {
+        int node = p->word[0] ? new_node(p, strchr(p->word, '*') ? Q_WILDCARD : Q_TERM, -1, -1) : DROPPED;
+        if (node >= 0)
+            strcpy(p->query->nodes[node].word, p->word);
+        next_token(p);
+
+        if (node != -1 && p->kind == T_NEAR) // word NEAR/k word
+        {
+            uint32_t distance = p->distance;
+            next_token(p);
+            if (p->kind != T_WORD || (node >= 0 && p->query->nodes[node].op != Q_TERM) || strchr(p->word, '*'))
+                return -1; // Both sides must be plain words
+            int right = p->word[0] ? new_term(p, p->word, strlen(p->word)) : DROPPED;
+            next_token(p);
+
+            if (node == DROPPED || right == DROPPED) // Nothing to be near, the other word stands alone
+                return node == DROPPED ? right : node;
+            node = new_node(p, Q_NEAR, node, right);
+            if (node >= 0)
+                p->query->nodes[node].distance = distance;
+        }
+        return node;
+    }
+    return -1; // Operator or ')' where a word was expected
+}
+
+static int parse_and(Query_parser *p)
+{
+    int left = parse_unary(p);
+
+    while (left != -1)
+    {
+        if (p->kind == T_AND)
+            next_token(p);
+        else if (p->kind != T_WORD && p->kind != T_NOT && p->kind != T_LPAREN && p->kind != T_PHRASE) // Not an implicit AND either
+            break;
+
+        left = combine(p, Q_AND, left, parse_unary(p));
+    }
+    return left;
+}
+
+static int parse_or(Query_parser *p)
+{
+    int left = parse_and(p);
+
+    while (left != -1 && p->kind == T_OR)
+    {
+        next_token(p);
+        left = combine(p, Q_OR, left, parse_and(p));
+    }
+    return left;
+}
+
+Status query_parse(const char *text, unsigned normalize, Query_t *query)
+{
+    Query_parser p = {.pos = text, .kind = T_END, .normalize = normalize, .query = query};
+    Stats_timer timer;
+
+    STAT_START(timer);
+    query->count = 0;
+    next_token(&p);
+    query->root = parse_or(&p);
+    STAT_STOP(timer, PHASE_PARSE);
+
+    if (query->root == DROPPED && p.kind == T_END)
+    {
+        fprintf(stderr, "Error: Query '%s' has only stop words\n", text);
+        return FAILURE;
+    }
+    if (query->root < 0 || p.kind != T_END)
+    {
+        fprintf(stderr, "Error: Invalid query '%s'\n", text);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* ------------------ Posting Cursors ------------------ */
+
+/* Sorted document IDs read in place: a word's sub nodes (stride 2) or a Doc_set (stride 1) */
+typedef struct posting_view
+{
+    const uint32_t *ids;
+    uint32_t count;
+    uint32_t stride;        // uint32_t words from one ID to the next
+    const Main_node *word;  // Packed word not decoded yet (ids is NULL), else NULL
+} Posting_view;
+
+static inline uint32_t view_at(const Posting_view *v, uint32_t i)
+{
+    return v->ids[(size_t)i * v->stride];
+}
+
+static Posting_view term_view(Hash_t *hash, const char *word)
+{
+    size_t len = strlen(word);
+    Main_node *node = lookup_word(hash, word, len, hash_word(word, len));
+    Posting_view view = {NULL, 0, 2, NULL};
+
+    if (node && node->file_count)
+    {
+        view.count = node->file_count;
+        if (node->packed) // Decoded later, or seeked block by block
+            view.word = node;
+        else
+            view.ids = &node->s_list[0].doc_id;
+    }
+    return view;
+}
+
+/* First index at or after from whose ID is >= target */
+static uint32_t gallop(const Posting_view *v, uint32_t from, uint32_t target)
+{
+    uint32_t lo = from, hi = from, step = 1;
+
+    while (hi < v->count && view_at(v, hi) < target) // Exponential probe
+    {
+        lo = hi + 1;
+        hi += step;
+        step <<= 1;
+    }
+    if (hi > v->count)
+        hi = v->count;
+
+    while (lo < hi) // Binary search in (last smaller, first probe >= target]
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (view_at(v, mid) < target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+#if defined(__SSE2__)
+/* Four consecutive IDs of a view in one register */
+static inline __m128i load4(const Posting_view *v, uint32_t i)
+{
+    if (v->stride == 1)
+        return _mm_loadu_si128((const __m128i *)(v->ids + i));
+
+    __m128 lo = _mm_loadu_ps((const float *)(v->ids + 2 * (size_t)i)); // Two sub nodes per load
+    __m128 hi = _mm_loadu_ps((const float *)(v->ids + 2 * (size_t)i + 4));
+    return _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))); // Keep the doc_id lanes
+}
+#endif
+
+/* a INTERSECT b into out; a is the shorter list and out may alias a */
+static uint32_t intersect(const Posting_view *a, const Posting_view *b, uint32_t *out)
+{
+    uint32_t i = 0, j = 0, k = 0;
+
+    if (b->count / GALLOP_RATIO > a->count) // Very unequal -> gallop through b
+    {
+        for (; i < a->count && j < b->count; i++)
+        {
+            uint32_t id = view_at(a, i);
+            j = gallop(b, j, id);
+            if (j < b->count && view_at(b, j) == id)
+                out[k++] = id;
+        }
+        return k;
+    }
+
+#if defined(__SSE2__)
+    while (i + 4 <= a->count && j + 4 <= b->count) // 4x4 block compare
+    {
+        __m128i va = load4(a, i);
+        __m128i vb = load4(b, j);
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i *)lanes, va); // Before out[] can overwrite a
+        uint32_t b_last = view_at(b, j + 3);
+
+        for (int mask = _mm_movemask_ps(_mm_castsi128_ps(hit)); mask; mask &= mask - 1)
+            out[k++] = lanes[__builtin_ctz(mask)];
+
+        if (lanes[3] <= b_last) // Advance the block(s) that ended first
+            i += 4;
+        if (b_last <= lanes[3])
+            j += 4;
+    }
+#endif
+
+    while (i < a->count && j < b->count) // Scalar merge of the tails
+    {
+        uint32_t x = view_at(a, i), y = view_at(b, j);
+        if (x < y)
+            i++;
+        else if (y < x)
+            j++;
+        else
+        {
+            out[k++] = x;
+            i++;
+            j++;
+        }
+    }
+    return k;
+}
+
+/* a MINUS b into out; out may alias a */
+static uint32_t subtract(const Posting_view *a, const Posting_view *b, uint32_t *out)
+{
+    uint32_t j = 0, k = 0;
+    bool gallop_b = b->count / GALLOP_RATIO > a->count;
+
+    for (uint32_t i = 0; i < a->count; i++)
+    {
+        uint32_t id = view_at(a, i);
+        if (gallop_b)
+            j = gallop(b, j, id);
+        else
+            while (j < b->count && view_at(b, j) < id)
+                j++;
+
+        if (j == b->count || view_at(b, j) != id)
+            out[k++] = id;
+    }
+    return k;
+}
+
+/* a UNION b into out, which has room for both */
+static uint32_t unite(const Posting_view *a, const Posting_view *b, uint32_t *out)
+{
+    uint32_t i = 0, j = 0, k = 0;
+
+    while (i < a->count && j < b->count)
+    {
+        uint32_t x = view_at(a, i), y = view_at(b, j);
+        out[k++] = x <= y ? x : y;
+        i += x <= y;
+        j += y <= x;
+    }
+    while (i < a->count)
+        out[k++] = view_at(a, i++);
+    while (j < b->count)
+        out[k++] = view_at(b, j++);
+    return k;
+}
+
+/* ------------------ Evaluation ------------------ */
+
+static Status eval(Hash_t *hash, const Query_t *query, int index, Doc_set *out);
+
+static Status alloc_set(Doc_set *set, size_t count)
+{
+    set->ids = malloc((count + 1) * sizeof(uint32_t)); // +1: never malloc(0)
+    set->count = 0;
+    return set->ids ? SUCCESS : FAILURE;
+}
+
+/* A view's IDs copied (or decoded) into a new set */
+static Status load_view(const Posting_view *view, Doc_set *out)
+{
+    if (alloc_set(out, view->count) == FAILURE)
+        return FAILURE;
+
+    if (view->word)
+    {
+        if (postings_decode_docs(view->word, out->ids) == FAILURE) // Damaged word in a loaded index
+        {
+            doc_set_free(out);
+            return FAILURE;
+        }
+    }
+    else
+        for (uint32_t i = 0; i < view->count; i++)
+            out->ids[i] = view_at(view, i);
+    out->count = view->count;
+    return SUCCESS;
+}
+
+/* Makes a packed word's view readable by index, decoding it into owned */
+static Status decode_view(Posting_view *view, Doc_set *owned)
+{
+    if (view->word == NULL)
+        return SUCCESS;
+    if (load_view(view, owned) == FAILURE)
+        return FAILURE;
+
+    Posting_view set = {owned->ids, owned->count, 1, NULL};
+    *view = set;
+    return SUCCESS;
+}
+
+/* ids AND word (or AND NOT word) by seeking the packed word, for words much longer than ids */
+static Status seek_word(uint32_t *ids, uint32_t *count, const Main_node *word, bool negated)
+{
+    Posting_cursor cursor;
+    uint32_t index, word_count, k = 0;
+
+    cursor_init(&cursor, word);
+    for (uint32_t i = 0; i < *count; i++) // ids ascend, so the cursor only moves forward
+    {
+        if (cursor_seek(&cursor, ids[i], &index, &word_count) != negated)
+            ids[k++] = ids[i];
+    }
+    *count = k;
+    return cursor.damaged ? FAILURE : SUCCESS;
+}
+
+/* Narrows out by one AND (or AND NOT) operand; buffer holds decoded packed words between calls */
+static Status narrow(Doc_set *out, const Posting_view *view, bool negated, Doc_set *buffer)
+{
+    Posting_view current = {out->ids, out->count, 1, NULL};
+    Posting_view operand = *view;
+
+    if (operand.word && operand.count / GALLOP_RATIO > out->count) // Touch only the blocks of the candidates
+    {
+        return seek_word(out->ids, &out->count, operand.word, negated);
+    }
+    if (operand.word) // Similar lengths -> decode and merge
+    {
+        doc_set_free(buffer);
+        if (decode_view(&operand, buffer) == FAILURE)
+            return FAILURE;
+    }
+
+    out->count = negated ? subtract(&current, &operand, out->ids) : intersect(&current, &operand, out->ids);
+    return SUCCESS;
+}
+
+/* Words are read in place (packed ones left for the caller to decode), anything else is evaluated into owned */
+static Status eval_view(Hash_t *hash, const Query_t *query, int index, Posting_view *view, Doc_set *owned)
+{
+    owned->ids = NULL;
+    owned->count = 0;
+
+    if (query->nodes[index].op == Q_TERM)
+    {
+        *view = term_view(hash, query->nodes[index].word);
+        return SUCCESS;
+    }
+    if (eval(hash, query, index, owned) == FAILURE)
+        return FAILURE;
+
+    Posting_view set = {owned->ids, owned->count, 1, NULL};
+    *view = set;
+    return SUCCESS;
+}
+
+static int compare_ids(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Union of every word matching a wildcard pattern */
+static Status eval_wildcard(Hash_t *hash, const char *pattern, Doc_set *out)
+{
+    Main_node **nodes;
+    size_t count, total = 0;
+
+    if (match_terms(hash, pattern, &nodes, &count) == FAILURE)
+        return FAILURE;
+    for (size_t i = 0; i < count; i++)
+        total += nodes[i]->file_count;
+
+    uint32_t docs = hash->docs.count;
+    if (alloc_set(out, total < docs ? total : docs) == FAILURE)
+    {
+        free(nodes);
+        return FAILURE;
+    }
+
+    if (total * 64 >= docs) // Dense -> mark a bitmap, then scan it in ID order
+    {
+        uint64_t *bits = calloc(docs / 64 + 1, sizeof(uint64_t));
+        if (bits == NULL)
+        {
+            free(nodes);
+            doc_set_free(out);
+            return FAILURE;
+        }
+        uint32_t *ids = malloc((total + 1) * sizeof(uint32_t)); // One word's IDs at a time
+        if (ids == NULL)
+        {
+            free(bits);
+            free(nodes);
+            doc_set_free(out);
+            return FAILURE;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            if (postings_decode_docs(nodes[i], ids) == FAILURE)
+            {
+                free(ids);
+                free(bits);
+                free(nodes);
+                doc_set_free(out);
+                return FAILURE;
+            }
+            for (uint32_t j = 0; j < nodes[i]->file_count; j++)
+                bits[ids[j] / 64] |= 1ull << (ids[j] % 64);
+        }
+        free(ids);
+        for (uint32_t w = 0; w <= docs / 64; w++)
+        {
+            for (uint64_t word = bits[w]; word; word &= word - 1)
+                out->ids[out->count++] = w * 64 + __builtin_ctzll(word);
+        }
+        free(bits);
+    }
+    else // Sparse -> collect, sort and drop repeats
+    {
+        uint32_t *ids = malloc((total + 1) * sizeof(uint32_t));
+        if (ids == NULL)
+        {
+            free(nodes);
+            doc_set_free(out);
+            return FAILURE;
+        }
+        size_t n = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (postings_decode_docs(nodes[i], ids + n) == FAILURE)
+            {
+                free(ids);
+                free(nodes);
+                doc_set_free(out);
+                return FAILURE;
+            }
+            n += nodes[i]->file_count;
+        }
+        qsort(ids, n, sizeof(uint32_t), compare_ids);
+        for (size_t i = 0; i < n; i++)
+        {
+            if (i == 0 || ids[i] != ids[i - 1])
+                out->ids[out->count++] = ids[i];
+        }
+        free(ids);
+    }
+
+    free(nodes);
+    return SUCCESS;
+}
+
+/* Does some offset p of lists[0] have p + i in every lists[i]? */
+static bool phrase_match(uint32_t *const *lists, const uint32_t *counts, uint32_t words)
+{
+    uint32_t next[MAX_QUERY_NODES] = {0};
+
+    for (uint32_t a = 0; a < counts[0]; a++)
+    {
+        uint32_t start = lists[0][a];
+        uint32_t i = 1;
+        for (; i < words; i++)
+        {
+            while (next[i] < counts[i] && lists[i][next[i]] < start + i) // Start only grows
+                next[i]++;
+            if (next[i] == counts[i]) // No later start can match either
+                return false;
+            if (lists[i][next[i]] != start + i)
+                break;
+        }
+        if (i == words)
+            return true;
+    }
+    return false;
+}
+
+/* Are two offsets at most distance apart? */
+static bool near_match(const uint32_t *a, uint32_t a_count, const uint32_t *b, uint32_t b_count, uint32_t distance)
+{
+    uint32_t i = 0, j = 0;
+
+    while (i < a_count && j < b_count) // Step past the smaller offset
+    {
+        uint32_t gap = a[i] < b[j] ? b[j] - a[i] : a[i] - b[j];
+        if (gap <= distance)
+            return true;
+        if (a[i] < b[j])
+            i++;
+        else
+            j++;
+    }
+    return false;
+}
+
+/* Phrase or NEAR: files holding every word, then checked against their positions */
+static Status eval_positional(Hash_t *hash, const Query_t *query, const Query_node *node, Doc_set *out)
+{
+    if (!hash->positional)
+    {
+        fprintf(stderr, "Error: Phrase and NEAR queries need an index built with --positions\n");
+        return FAILURE;
+    }
+
+    uint32_t words = node->op == Q_PHRASE ? (uint32_t)node->right : 2;
+    Main_node *nodes[MAX_QUERY_NODES];
+    Posting_view views[MAX_QUERY_NODES] = {{NULL, 0, 1, NULL}};
+    uint32_t shortest = 0;
+
+    for (uint32_t i = 0; i < words; i++)
+    {
+        const char *word = query->nodes[node->op == Q_PHRASE ? node->left + (int)i : (i ? node->right : node->left)].word;
+        nodes[i] = lookup_word(hash, word, strlen(word), hash_word(word, strlen(word)));
+        if (nodes[i] == NULL || nodes[i]->file_count == 0) // A missing word matches nothing
+            return alloc_set(out, 0);
+
+        views[i] = term_view(hash, word);
+        if (views[i].count < views[shortest].count)
+            shortest = i;
+    }
+
+    Doc_set buffer = {NULL, 0};
+    if (load_view(&views[shortest], out) == FAILURE)
+        return FAILURE;
+
+    for (uint32_t i = 0; i < words && out->count; i++) // Candidates: every word present
+    {
+        if (i != shortest && narrow(out, &views[i], false, &buffer) == FAILURE)
+        {
+            doc_set_free(&buffer);
+            doc_set_free(out);
+            return FAILURE;
+        }
+    }
+    doc_set_free(&buffer);
+
+    uint32_t *lists[MAX_QUERY_NODES] = {NULL}, counts[MAX_QUERY_NODES], sizes[MAX_QUERY_NODES] = {0};
+    Posting_cursor *cursor = malloc(words * sizeof(Posting_cursor)); // Word counts and sub node indexes
+    uint32_t kept = 0;
+    Status status = cursor ? SUCCESS : FAILURE;
+
+    for (uint32_t i = 0; i < words && cursor; i++)
+        cursor_init(&cursor[i], nodes[i]);
+
+    for (uint32_t d = 0; d < out->count && status == SUCCESS; d++)
+    {
+        uint32_t doc_id = out->ids[d];
+
+        for (uint32_t i = 0; i < words; i++) // Decode each word's offsets in this file
+        {
+            const Positions_t *pos = nodes[i]->positions;
+            uint32_t index;
+            if (!cursor_seek(&cursor[i], doc_id, &index, &counts[i])) // Every candidate holds every word, unless damaged
+            {
+                status = FAILURE;
+                break;
+            }
+
+            if (counts[i] > sizes[i])
+            {
+                uint32_t *grown = realloc(lists[i], counts[i] * sizeof(uint32_t));
+                if (grown == NULL)
+                {
+                    status = FAILURE;
+                    break;
+                }
+                lists[i] = grown;
+                sizes[i] = counts[i];
+            }
+            positions_decode(pos->data + pos->offsets[index], counts[i], lists[i]);
+        }
+
+        if (status == SUCCESS && (node->op == Q_PHRASE ? phrase_match(lists, counts, words)
+                                                       : near_match(lists[0], counts[0], lists[1], counts[1], node->distance)))
+            out->ids[kept++] = doc_id;
+    }
+    out->count = kept;
+
+    for (uint32_t i = 0; i < words; i++)
+        free(lists[i]);
+    free(cursor);
+    if (status == FAILURE)
+        doc_set_free(out);
+    return status;
+}
+
+/* Every live document, for queries that start with NOT */
+static Status universe(Hash_t *hash, Doc_set *out)
+{
+    if (alloc_set(out, hash->docs.count) == FAILURE)
+        return FAILURE;
+
+    for (uint32_t id = 0; id < hash->docs.count; id++)
+    {
+        if (hash->docs.names[id])
+            out->ids[out->count++] = id;
+    }
+    return SUCCESS;
+}
+
+static Status eval_and(Hash_t *hash, const Query_t *query, int index, Doc_set *out)
+{
+    int stack[MAX_QUERY_NODES], top = 0;
+    int operands[MAX_QUERY_NODES], count = 0;
+
+    stack[top++] = index;
+    while (top) // Flatten the chain: a AND (b AND c) -> a, b, c
+    {
+        const Query_node *node = &query->nodes[stack[--top]];
+        if (node->op == Q_AND)
+        {
+            stack[top++] = node->right;
+            stack[top++] = node->left;
+        }
+        else
+        {
+            operands[count++] = (int)(node - query->nodes);
+        }
+    }
+
+    Posting_view pos[MAX_QUERY_NODES], neg[MAX_QUERY_NODES];
+    Doc_set owned[MAX_QUERY_NODES], buffer = {NULL, 0};
+    int npos = 0, nneg = 0, nowned = 0;
+    Status status = FAILURE;
+
+    out->ids = NULL;
+    out->count = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const Query_node *node = &query->nodes[operands[i]];
+        bool negated = node->op == Q_NOT;
+        Posting_view *view = negated ? &neg[nneg++] : &pos[npos++];
+
+        if (eval_view(hash, query, negated ? node->left : operands[i], view, &owned[nowned++]) == FAILURE)
+            goto cleanup;
+    }
+
+    for (int i = 1; i < npos; i++) // Shortest list first
+    {
+        Posting_view v = pos[i];
+        int j = i;
+        for (; j > 0 && pos[j - 1].count > v.count; j--)
+            pos[j] = pos[j - 1];
+        pos[j] = v;
+    }
+
+    if (npos == 0) // Only NOT operands -> start from every document
+    {
+        if (universe(hash, out) == FAILURE)
+            goto cleanup;
+    }
+    else if (load_view(&pos[0], out) == FAILURE)
+    {
+        goto cleanup;
+    }
+
+    for (int i = 1; i < npos && out->count; i++) // Result never grows
+    {
+        if (narrow(out, &pos[i], false, &buffer) == FAILURE)
+            goto cleanup;
+    }
+    for (int i = 0; i < nneg && out->count; i++)
+    {
+        if (narrow(out, &neg[i], true, &buffer) == FAILURE)
+            goto cleanup;
+    }
+    status = SUCCESS;
+
+cleanup:
+    doc_set_free(&buffer);
+    for (int i = 0; i < nowned; i++)
+        doc_set_free(&owned[i]);
+    if (status == FAILURE)
+        doc_set_free(out);
+    return status;
+}
+
+static Status eval(Hash_t *hash, const Query_t *query, int index, Doc_set *out)
+{
+    const Query_node *node = &query->nodes[index];
+    Posting_view a, b;
+    Doc_set owned_a, owned_b = {NULL, 0}, all;
+    Status status = FAILURE;
+
+    switch (node->op)
+    {
+    case Q_AND:
+        return eval_and(hash, query, index, out);
+
+    case Q_WILDCARD:
+        return eval_wildcard(hash, node->word, out);
+
+    case Q_PHRASE:
+    case Q_NEAR:
+        return eval_positional(hash, query, node, out);
+
+    case Q_TERM:
+        a = term_view(hash, node->word);
+        return load_view(&a, out);
+
+    case Q_OR:
+        if (eval_view(hash, query, node->left, &a, &owned_a) == FAILURE)
+            return FAILURE;
+        if (decode_view(&a, &owned_a) == SUCCESS &&
+            eval_view(hash, query, node->right, &b, &owned_b) == SUCCESS && decode_view(&b, &owned_b) == SUCCESS &&
+            alloc_set(out, (size_t)a.count + b.count) == SUCCESS)
+        {
+            out->count = unite(&a, &b, out->ids);
+            status = SUCCESS;
+        }
+        doc_set_free(&owned_a);
+        doc_set_free(&owned_b);
+        return status;
+
+    case Q_NOT: // Stand-alone NOT -> complement
+        if (eval_view(hash, query, node->left, &a, &owned_a) == FAILURE)
+            return FAILURE;
+        if (decode_view(&a, &owned_a) == SUCCESS && universe(hash, &all) == SUCCESS)
+        {
+            Posting_view every = {all.ids, all.count, 1, NULL};
+            all.count = subtract(&every, &a, all.ids);
+            *out = all;
+            status = SUCCESS;
+        }
+        doc_set_free(&owned_a);
+        return status;
+    }
+    return FAILURE;
+}
+
+Status query_run(Hash_t *hash, const Query_t *query, Doc_set *result)
+{
+    result->ids = NULL;
+    result->count = 0;
+    if (query->count == 0)
+        return FAILURE;
+
+    Stats_timer timer;
+    STAT_START(timer);
+    Status status = eval(hash, query, query->root, result);
+    STAT_STOP(timer, PHASE_MATCH);
+    return status;
+}
+
+/* Appends the index words behind the positive (not negated) terms of a query */
+static Status positive_words(Hash_t *hash, const Query_t *query, int index, bool negated, Main_node ***words, size_t *count)
+{
+    const Query_node *node = &query->nodes[index];
+    Main_node *word = NULL;
+    Main_node **found = &word;
+    size_t found_count = 0;
+
+    if (node->op == Q_AND || node->op == Q_OR || node->op == Q_NOT)
+    {
+        if (positive_words(hash, query, node->left, negated ^ (node->op == Q_NOT), words, count) == FAILURE)
+            return FAILURE;
+        return node->op == Q_NOT ? SUCCESS : positive_words(hash, query, node->right, negated, words, count);
+    }
+    if (node->op == Q_PHRASE || node->op == Q_NEAR) // Each word of the phrase or pair
+    {
+        int terms = node->op == Q_PHRASE ? node->right : 2;
+        for (int i = 0; i < terms; i++)
+        {
+            int term = node->op == Q_PHRASE ? node->left + i : (i ? node->right : node->left);
+            if (positive_words(hash, query, term, negated, words, count) == FAILURE)
+                return FAILURE;
+        }
+        return SUCCESS;
+    }
+    if (negated)
+        return SUCCESS;
+
+    if (node->op == Q_WILDCARD) // Every word the pattern matched
+    {
+        if (match_terms(hash, node->word, &found, &found_count) == FAILURE)
+            return FAILURE;
+    }
+    else
+    {
+        word = lookup_word(hash, node->word, strlen(node->word), hash_word(node->word, strlen(node->word)));
+        if (word == NULL)
+            return SUCCESS;
+        found_count = 1;
+    }
+
+    Main_node **grown = realloc(*words, (*count + found_count + 1) * sizeof(Main_node *));
+    if (grown)
+    {
+        memcpy(grown + *count, found, found_count * sizeof(Main_node *));
+        *words = grown;
+        *count += found_count;
+    }
+    if (node->op == Q_WILDCARD)
+        free(found);
+    return grown ? SUCCESS : FAILURE;
+}
+
+/* A collected word and where it was collected, so repeats sort right after its first slot */
+typedef struct word_slot
+{
+    const Main_node *node;
+    size_t slot;
+} Word_slot;
+
+static int compare_word_slot(const void *a, const void *b)
+{
+    const Word_slot *x = a, *y = b;
+    if (x->node != y->node)
+        return (uintptr_t)x->node < (uintptr_t)y->node ? -1 : 1;
+    return (x->slot > y->slot) - (x->slot < y->slot);
+}
+
+/* Keeps the first slot of every word: "a OR a", or a wildcard that also matches a literal term, scores it once */
+static Status unique_words(Main_node **words, size_t *count)
+{
+    if (*count < 2)
+        return SUCCESS;
+    Word_slot *slots = malloc(*count * sizeof(Word_slot));
+    bool *repeat = calloc(*count, sizeof(bool));
+    if (slots == NULL || repeat == NULL)
+    {
+        free(slots);
+        free(repeat);
+        return FAILURE;
+    }
+
+    for (size_t i = 0; i < *count; i++)
+        slots[i] = (Word_slot){words[i], i};
+    qsort(slots, *count, sizeof(Word_slot), compare_word_slot);
+    for (size_t i = 1; i < *count; i++)
+        repeat[slots[i].slot] = slots[i].node == slots[i - 1].node;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < *count; i++) // Query order is kept
+        if (!repeat[i])
+            words[kept++] = words[i];
+    *count = kept;
+    free(slots);
+    free(repeat);
+    return SUCCESS;
+}
+
+Status query_positive_words(Hash_t *hash, const Query_t *query, Main_node ***words, size_t *count)
+{
+    *words = NULL;
+    *count = 0;
+    if (positive_words(hash, query, query->root, false, words, count) == FAILURE ||
+        unique_words(*words, count) == FAILURE)
+    {
+        free(*words);
+        *words = NULL;
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+void doc_set_free(Doc_set *set)
+{
+    free(set->ids);
+    set->ids = NULL;
+    set->count = 0;
+}
@@ -0,0 +1,167 @@
+/***********************************************************************
+ *  File Name   : rank.c
+ *  Description : BM25 ranking for the Inverted Search System. The
+ *                files matched by a query are scored with the word
+ *                counts and file counts already stored in the index and
+ *                the document lengths recorded while indexing:
+ *
+ *                  idf   = ln(1 + (N - df + 0.5) / (df + 0.5))
+ *                  score = sum idf * tf * (k1 + 1) /
+ *                              (tf + k1 * (1 - b + b * dl / avgdl))
+ *
+ *                summed over the query's distinct non-negated words.
+ *                Only the best k files are kept, in a bounded min-heap,
+ *                so ranking n matches costs O(n log k) and O(k) memory.
+ *                Each word's sub nodes are reached through a posting
+ *                cursor that skips whole packed blocks, so scoring a
+ *                small result does not decode long lists.
+ *
+ *                A segment of a segmented index (segments.c) is ranked
+ *                with the statistics of the whole set: N and avgdl of
+ *                its live files and df summed over every segment, so
+ *                the scores do not depend on how files are split.
+ *
+ *                Functions:
+ *                  - rank_top_k()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <math.h>
+
+/* Lower score ranks lower; on equal scores the later document does */
+static inline bool ranks_below(const Ranked_doc *a, const Ranked_doc *b)
+{
+    return a->score < b->score || (a->score == b->score && a->doc_id > b->doc_id);
+}
+
+static void sift_down(Ranked_doc *heap, uint32_t size, uint32_t i)
+{
+    while (1)
+    {
+        uint32_t lowest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < size && ranks_below(&heap[left], &heap[lowest]))
+            lowest = left;
+        if (right < size && ranks_below(&heap[right], &heap[lowest]))
+            lowest = right;
+        if (lowest == i)
+            return;
+
+        Ranked_doc temp = heap[i];
+        heap[i] = heap[lowest];
+        heap[lowest] = temp;
+        i = lowest;
+    }
+}
+
+static void sift_up(Ranked_doc *heap, uint32_t i)
+{
+    while (i > 0 && ranks_below(&heap[i], &heap[(i - 1) / 2]))
+    {
+        Ranked_doc temp = heap[i];
+        heap[i] = heap[(i - 1) / 2];
+        heap[(i - 1) / 2] = temp;
+        i = (i - 1) / 2;
+    }
+}
+
+/* Files holding the word, over every index of the scope */
+static double scope_df(const Rank_scope *scope, const Main_node *word)
+{
+    double df = 0;
+    for (uint32_t i = 0; i < scope->count; i++)
+    {
+        Main_node *node = lookup_word(scope->indexes[i], word->word, word->word_len, word->hash);
+        if (node)
+            df += node->file_count;
+    }
+    return df;
+}
+
+Status rank_top_k(Hash_t *hash, const Query_t *query, const Doc_set *matches, uint32_t k, Ranked_doc *top, uint32_t *count,
+                  const Rank_scope *scope)
+{
+    Main_node **words;
+    size_t word_count;
+
+    *count = 0;
+    if (k == 0)
+        return SUCCESS;
+    if (query_positive_words(hash, query, &words, &word_count) == FAILURE)
+        return FAILURE;
+
+    Posting_cursor *cursor = malloc((word_count + 1) * sizeof(Posting_cursor));
+    double *idf = malloc((word_count + 1) * sizeof(double));
+    if (cursor == NULL || idf == NULL)
+    {
+        free(words);
+        free(cursor);
+        free(idf);
+        return FAILURE;
+    }
+
+    Doc_table *docs = &hash->docs;
+    uint32_t files = scope ? scope->live : docs->live; // Collection statistics
+    uint64_t total_length = scope ? scope->total_length : docs->total_length;
+    double live = files;
+    double avgdl = files && total_length ? (double)total_length / files : 1.0;
+
+    for (size_t t = 0; t < word_count; t++) // Per-word part of the score
+    {
+        double df = scope ? scope_df(scope, words[t]) : words[t]->file_count;
+        idf[t] = log(1.0 + (live - df + 0.5) / (df + 0.5));
+        cursor_init(&cursor[t], words[t]);
+    }
+
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < matches->count; i++)
+    {
+        Ranked_doc doc = {matches->ids[i], 0, 0.0};
+        double norm = BM25_K1 * (1.0 - BM25_B + BM25_B * docs->lengths[doc.doc_id] / avgdl);
+
+        for (size_t t = 0; t < word_count; t++) // Matches are sorted, cursors only move forward
+        {
+            uint32_t index, tf;
+            if (cursor_seek(&cursor[t], doc.doc_id, &index, &tf))
+            {
+                doc.word_count += tf;
+                doc.score += idf[t] * tf * (BM25_K1 + 1.0) / (tf + norm);
+            }
+        }
+
+        if (size < k) // Heap not full yet
+        {
+            top[size] = doc;
+            sift_up(top, size++);
+        }
+        else if (ranks_below(&top[0], &doc)) // Beats the weakest kept file
+        {
+            top[0] = doc;
+            sift_down(top, size, 0);
+        }
+    }
+
+    for (uint32_t n = size; n > 1; n--) // Heap sort: weakest to the back, best first
+    {
+        Ranked_doc temp = top[0];
+        top[0] = top[n - 1];
+        top[n - 1] = temp;
+        sift_down(top, n - 1, 0);
+    }
+
+    Status status = SUCCESS;
+    for (size_t t = 0; t < word_count; t++) // A damaged word would leave its files unscored
+    {
+        if (cursor[t].damaged)
+            status = FAILURE;
+    }
+
+    *count = status == SUCCESS ? size : 0;
+    free(words);
+    free(cursor);
+    free(idf);
+    return status;
+}
@@ -0,0 +1,927 @@
+/***********************************************************************
+ *  File Name   : segments.c
+ *  Description : Segmented index for the Inverted Search System. A
+ *                segment directory holds immutable .bin indexes
+ *                (binary_index.c) and a MANIFEST listing them, oldest
+ *                first:
+ *
+ *                  INVSEG <version> <positions> <normalize> <next>
+ *                  seg-000001.bin <bytes>
+ *                  ...
+ *
+ *                  --segments DIR <file1> ...  indexes the files into
+ *                                              one new segment
+ *                  --segments DIR              merges segments that
+ *                                              are due, then exits
+ *                  --index DIR --queries / --listen
+ *                                              searches every segment
+ *
+ *                Adding files only builds a segment of those files, so
+ *                its cost follows the batch, not the index. A file
+ *                added again replaces its copy in older segments: the
+ *                newest segment holding a name wins. Every change
+ *                writes MANIFEST.tmp and renames it over the manifest
+ *                while holding an flock() on DIR/LOCK, so readers see
+ *                either the old set or the new one.
+ *
+ *                Searching goes through a view: the segments of one
+ *                manifest, mapped, plus a document table of the whole
+ *                set in which segment i's files take the IDs from
+ *                base[i] on and replaced copies are removed. A query
+ *                runs on every segment; replaced files are dropped
+ *                from its matches, each segment ranks its own with the
+ *                N, avgdl and df of the whole set (rank.c), and the
+ *                per-segment top k lists are merged. Views are
+ *                reference counted, so a query finishes on the view it
+ *                started with while a newer one is swapped in, and
+ *                segments are shared by the views that list them.
+ *
+ *                The server runs a merger thread. It reloads the view
+ *                when another process changes the manifest and merges
+ *                segments under a tiered policy: segments fall in size
+ *                tiers SEGMENT_MERGE_FACTOR apart, and whenever that
+ *                many adjacent segments share a tier (smallest tier
+ *                first) they are merged into a single segment in their
+ *                place. Replaced files are left out of the result.
+ *                The number of segments therefore grows with the
+ *                logarithm of the index size, which bounds the fan-out
+ *                of a query.
+ *
+ *                Functions:
+ *                  - is_segment_dir()
+ *                  - run_segments()
+ *                  - segments_open()
+ *                  - segments_start_merger()
+ *                  - segments_close()
+ *                  - segments_acquire() / segments_release()
+ *                  - segments_search()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#define SEGMENT_MAGIC "INVSEG"
+#define SEGMENT_VERSION 1
+#define SEGMENT_MANIFEST "MANIFEST"
+#define SEGMENT_LOCK "LOCK"
+#define SEGMENT_NAME_SIZE 32             // "seg-000001.bin"
+#define SEGMENT_MERGE_FACTOR 4           // Segments of one tier merged together, and the size ratio between tiers
+#define SEGMENT_TIER_FLOOR (1 << 20)     // Segments below this size share the smallest tier
+#define SEGMENT_POLL_MS 1000             // Merger looks for new segments this often
+
+typedef struct manifest
+{
+    bool found;                       // The directory has a manifest
+    bool positional;                  // Settings every segment is built with
+    unsigned normalize;
+    uint32_t next;                    // Number of the next segment file
+    uint32_t count;
+    uint32_t capacity;
+    char (*names)[SEGMENT_NAME_SIZE]; // Oldest first
+    uint64_t *sizes;                  // File sizes, for the merge policy
+} Manifest_t;
+
+typedef struct segment
+{
+    Hash_t index;                 // Mapped .bin, never changed once loaded
+    char name[SEGMENT_NAME_SIZE];
+    uint64_t size;
+    uint32_t refs;                // Views listing it (set lock)
+} Segment_t;
+
+struct segment_view
+{
+    Hash_t hash;          // Document table of the whole set and nothing else
+    Segment_t **segments; // Oldest first
+    uint32_t *base;       // Segment i's document ID 0 in hash.docs
+    uint32_t count;
+    uint32_t refs;        // The set's own plus searches in progress (set lock)
+};
+
+struct segment_set
+{
+    char *dir;
+    bool verify;           // --verify: checksum the postings of every segment loaded
+    Hash_t *handle;        // Table the set was opened on, owner of the query cache
+    pthread_mutex_t lock;  // Guards current and every refs count
+    Segment_view *current;
+    uint64_t generation;   // Of the latest view, for the query cache
+    struct stat seen;      // Manifest the current view was built from
+    pthread_t merger;
+    bool merging;          // Merger thread started
+    pthread_cond_t wake;   // Signalled when stopping
+    bool stopping;
+};
+
+bool is_segment_dir(const char *name)
+{
+    struct stat st;
+    return stat(name, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/* DIR/name into path[PATH_MAX] */
+static bool segment_path(const char *dir, const char *name, char *path)
+{
+    int n = snprintf(path, PATH_MAX, "%s/%s", dir, name);
+    return n > 0 && n < PATH_MAX;
+}
+
+static void manifest_free(Manifest_t *m)
+{
+    free(m->names);
+    free(m->sizes);
+    m->names = NULL;
+    m->sizes = NULL;
+    m->count = m->capacity = 0;
+}
+
+static Status manifest_append(Manifest_t *m, const char *name, uint64_t size)
+{
+    if (m->count == m->capacity)
+    {
+        uint32_t capacity = m->capacity ? m->capacity * 2 : 16;
+        char(*names)[SEGMENT_NAME_SIZE] = realloc(m->names, capacity * sizeof(*names));
+        if (names == NULL)
+            return FAILURE;
+        m->names = names;
+        uint64_t *sizes = realloc(m->sizes, capacity * sizeof(uint64_t));
+        if (sizes == NULL)
+            return FAILURE;
+        m->sizes = sizes;
+        m->capacity = capacity;
+    }
+    snprintf(m->names[m->count], SEGMENT_NAME_SIZE, "%s", name);
+    m->sizes[m->count++] = size;
+    return SUCCESS;
+}
+
+/* Reads DIR/MANIFEST; without one the set is empty and m->found is false */
+static Status read_manifest(const char *dir, Manifest_t *m, struct stat *seen)
+{
+    char path[PATH_MAX];
+    *m = (Manifest_t){.next = 1};
+    if (!segment_path(dir, SEGMENT_MANIFEST, path))
+        return FAILURE;
+
+    FILE *fptr = fopen(path, "r");
+    if (fptr == NULL)
+        return errno == ENOENT ? SUCCESS : FAILURE;
+
+    unsigned version, positional;
+    Status status = fscanf(fptr, SEGMENT_MAGIC " %u %u %u %u", &version, &positional, &m->normalize, &m->next) == 4 &&
+                            version == SEGMENT_VERSION && m->normalize <= NORM_ALL
+                        ? SUCCESS
+                        : FAILURE;
+    m->positional = positional;
+
+    char name[SEGMENT_NAME_SIZE];
+    unsigned long long size;
+    while (status == SUCCESS && fscanf(fptr, "%31s %llu", name, &size) == 2)
+    {
+        if (strchr(name, '/') || !is_index_file(name)) // Only plain .bin names inside the directory
+            status = FAILURE;
+        else
+            status = manifest_append(m, name, size);
+    }
+    if (status == SUCCESS && (!feof(fptr) || (seen && fstat(fileno(fptr), seen) < 0)))
+        status = FAILURE;
+    fclose(fptr);
+
+    if (status == FAILURE)
+    {
+        fprintf(stderr, "Error: '%s' is not a valid segment manifest\n", path);
+        manifest_free(m);
+        return FAILURE;
+    }
+    m->found = true;
+    return SUCCESS;
+}
+
+/* Replaces DIR/MANIFEST through a rename, so readers never see half of it */
+static Status write_manifest(const char *dir, const Manifest_t *m)
+{
+    char path[PATH_MAX], temp[PATH_MAX];
+    if (!segment_path(dir, SEGMENT_MANIFEST, path) || !segment_path(dir, SEGMENT_MANIFEST ".tmp", temp))
+        return FAILURE;
+
+    FILE *fptr = fopen(temp, "w");
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "Error: Unable to open '%s' file\n", temp);
+        return FAILURE;
+    }
+    fprintf(fptr, SEGMENT_MAGIC " %u %u %u %u\n", SEGMENT_VERSION, m->positional, m->normalize, m->next);
+    for (uint32_t i = 0; i < m->count; i++)
+        fprintf(fptr, "%s %llu\n", m->names[i], (unsigned long long)m->sizes[i]);
+
+    if (ferror(fptr) | (fclose(fptr) != 0) || rename(temp, path) != 0)
+    {
+        fprintf(stderr, "Error: Failed to write '%s'\n", path);
+        remove(temp);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* Exclusive lock on the directory's manifest, released by close(); -1 on failure */
+static int lock_manifest(const char *dir)
+{
+    char path[PATH_MAX];
+    int fd = segment_path(dir, SEGMENT_LOCK, path) ? open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644) : -1;
+    if (fd >= 0 && flock(fd, LOCK_EX) < 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0)
+        fprintf(stderr, "Error: Unable to lock segment directory '%s'\n", dir);
+    return fd;
+}
+
+/* Reserves the next segment number and names it */
+static Status reserve_segment(const char *dir, char *name)
+{
+    Manifest_t m;
+    int fd = lock_manifest(dir);
+    if (fd < 0)
+        return FAILURE;
+
+    Status status = read_manifest(dir, &m, NULL);
+    if (status == SUCCESS)
+    {
+        snprintf(name, SEGMENT_NAME_SIZE, "seg-%06u.bin", m.next++);
+        status = write_manifest(dir, &m);
+        manifest_free(&m);
+    }
+    close(fd);
+    return status;
+}
+
+static uint64_t file_size(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+static Segment_t *segment_load(Segment_set *set, const Manifest_t *m, uint32_t i)
+{
+    char path[PATH_MAX];
+    File_list *none = NULL;
+    Segment_t *seg = calloc(1, sizeof(Segment_t));
+    if (seg == NULL || initialise_hash(&seg->index) == FAILURE)
+    {
+        free(seg);
+        return NULL;
+    }
+    seg->index.positional = m->positional; // As recorded in the segment, so loading reports nothing
+    seg->index.normalize = m->normalize;
+
+    if (!segment_path(set->dir, m->names[i], path) || load_index(&seg->index, path, &none, set->verify) == FAILURE ||
+        term_dict_update(&seg->index) == FAILURE) // Wildcards only read the dictionary from here on
+    {
+        free_hash(&seg->index);
+        free(seg);
+        return NULL;
+    }
+    memcpy(seg->name, m->names[i], SEGMENT_NAME_SIZE);
+    seg->size = m->sizes[i];
+    seg->refs = 1;
+    return seg;
+}
+
+/* Drops a view whose last reference is gone, and the segments only it listed */
+static void view_free(Segment_set *set, Segment_view *view)
+{
+    for (uint32_t i = 0; i < view->count; i++)
+    {
+        Segment_t *seg = view->segments[i];
+        pthread_mutex_lock(&set->lock);
+        bool last = --seg->refs == 0;
+        pthread_mutex_unlock(&set->lock);
+        if (last)
+        {
+            free_hash(&seg->index);
+            free(seg);
+        }
+    }
+    view->hash.cache = NULL; // Belongs to the handle
+    view->hash.view = NULL;
+    free_hash(&view->hash);
+    free(view->segments);
+    free(view->base);
+    free(view);
+}
+
+static void view_release(Segment_set *set, Segment_view *view)
+{
+    pthread_mutex_lock(&set->lock);
+    bool last = --view->refs == 0;
+    pthread_mutex_unlock(&set->lock);
+    if (last)
+        view_free(set, view);
+}
+
+/* Appends a segment's files to the view; a name already there came from an older segment, whose copy is removed */
+static Status add_documents(Segment_view *view, const Segment_t *seg)
+{
+    Doc_table *docs = &view->hash.docs;
+    const Doc_table *from = &seg->index.docs;
+
+    view->base[view->count] = docs->count;
+    for (uint32_t id = 0; id < from->count; id++)
+    {
+        const char *name = from->names[id];
+        uint32_t doc_id;
+        if (name == NULL) // Keeps the segment's IDs contiguous
+        {
+            doc_id = doc_table_add_removed(docs);
+        }
+        else
+        {
+            uint32_t older = doc_table_find(docs, name);
+            if (older != DOC_NONE)
+                doc_table_remove(docs, older);
+            doc_id = doc_table_add(docs, &view->hash.arena, name);
+            if (doc_id != DOC_NONE)
+                doc_table_set_length(docs, doc_id, from->lengths[id]);
+        }
+        if (doc_id == DOC_NONE)
+            return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* View of the segments listed by the manifest, sharing those already loaded by the old view */
+static Segment_view *view_build(Segment_set *set, const Manifest_t *m, const Segment_view *old)
+{
+    Segment_view *view = calloc(1, sizeof(Segment_view));
+    if (view == NULL || initialise_hash(&view->hash) == FAILURE)
+    {
+        free(view);
+        return NULL;
+    }
+    view->segments = malloc((m->count + 1) * sizeof(Segment_t *));
+    view->base = malloc((m->count + 1) * sizeof(uint32_t));
+    view->hash.view = view;
+    view->hash.positional = m->positional;
+    view->hash.normalize = m->normalize;
+    view->refs = 1;
+
+    Status status = view->segments && view->base ? SUCCESS : FAILURE;
+    for (uint32_t i = 0; i < m->count && status == SUCCESS; i++)
+    {
+        Segment_t *seg = NULL;
+        for (uint32_t j = 0; old && j < old->count && seg == NULL; j++)
+        {
+            if (strcmp(old->segments[j]->name, m->names[i]) == 0)
+                seg = old->segments[j];
+        }
+        if (seg) // Unchanged since the old view
+        {
+            pthread_mutex_lock(&set->lock);
+            seg->refs++;
+            pthread_mutex_unlock(&set->lock);
+        }
+        else if ((seg = segment_load(set, m, i)) == NULL)
+        {
+            status = FAILURE;
+            break;
+        }
+        status = add_documents(view, seg);
+        view->segments[view->count++] = seg;
+    }
+
+    if (status == FAILURE)
+    {
+        view_free(set, view);
+        return NULL;
+    }
+    view->hash.docs.generation = ++set->generation; // Unlike any earlier view, so cached results are dropped
+    view->hash.cache = set->handle->cache;
+    return view;
+}
+
+/* Builds a view of the manifest as it is now and swaps it in, unless it lists the same segments */
+static Status refresh(Segment_set *set)
+{
+    Manifest_t m;
+    struct stat seen;
+    if (read_manifest(set->dir, &m, &seen) == FAILURE)
+        return FAILURE;
+
+    Segment_view *old = set->current; // Only this thread swaps views
+    bool same = m.found && old && m.count == old->count;
+    for (uint32_t i = 0; same && i < m.count; i++)
+        same = strcmp(m.names[i], old->segments[i]->name) == 0;
+
+    Segment_view *view = same || !m.found ? NULL : view_build(set, &m, old);
+    Status status = same || view ? SUCCESS : FAILURE;
+    if (status == FAILURE && !m.found)
+        fprintf(stderr, "Error: '%s' has no segment manifest\n", set->dir);
+    manifest_free(&m);
+    if (status == FAILURE)
+        return FAILURE;
+
+    set->seen = seen;
+    if (view)
+    {
+        pthread_mutex_lock(&set->lock);
+        set->current = view;
+        pthread_mutex_unlock(&set->lock);
+        if (old)
+            view_release(set, old);
+    }
+    return SUCCESS;
+}
+
+/* Another process added or merged segments since the current view was built */
+static bool manifest_changed(const Segment_set *set)
+{
+    char path[PATH_MAX];
+    struct stat st;
+    if (!segment_path(set->dir, SEGMENT_MANIFEST, path) || stat(path, &st) < 0)
+        return false;
+    return st.st_ino != set->seen.st_ino || st.st_mtim.tv_sec != set->seen.st_mtim.tv_sec ||
+           st.st_mtim.tv_nsec != set->seen.st_mtim.tv_nsec;
+}
+
+/* Size tier: 0 below SEGMENT_TIER_FLOOR, then one more per SEGMENT_MERGE_FACTOR times larger */
+static unsigned size_tier(uint64_t size)
+{
+    unsigned tier = 0;
+    for (uint64_t limit = SEGMENT_TIER_FLOOR; size >= limit && tier < 32; limit *= SEGMENT_MERGE_FACTOR)
+        tier++;
+    return tier;
+}
+
+/* Tiered policy: the oldest SEGMENT_MERGE_FACTOR adjacent segments of one tier, smallest tier first */
+static bool pick_merge(const Segment_view *view, uint32_t *first, uint32_t *count)
+{
+    bool found = false;
+    unsigned best = 0;
+    for (uint32_t i = 0; i < view->count;)
+    {
+        unsigned tier = size_tier(view->segments[i]->size);
+        uint32_t j = i + 1;
+        while (j < view->count && size_tier(view->segments[j]->size) == tier)
+            j++;
+        if (j - i >= SEGMENT_MERGE_FACTOR && (!found || tier < best))
+        {
+            found = true;
+            best = tier;
+            *first = i;
+            *count = SEGMENT_MERGE_FACTOR;
+        }
+        i = j;
+    }
+    return found;
+}
+
+/* Puts the merged segment (NULL when nothing survived) in place of its inputs, if they are still listed together */
+static Status commit_merge(Segment_set *set, const Segment_view *view, uint32_t first, uint32_t count, const char *name,
+                           uint64_t size)
+{
+    Manifest_t m, out;
+    int fd = lock_manifest(set->dir);
+    if (fd < 0)
+        return FAILURE;
+
+    Status status = read_manifest(set->dir, &m, NULL);
+    uint32_t at = 0;
+    while (status == SUCCESS && at < m.count && strcmp(m.names[at], view->segments[first]->name) != 0)
+        at++;
+    bool listed = status == SUCCESS && at + count <= m.count;
+    for (uint32_t i = 0; listed && i < count; i++)
+        listed = strcmp(m.names[at + i], view->segments[first + i]->name) == 0;
+    if (status == SUCCESS && !listed) // Merged by another process meanwhile
+    {
+        fprintf(stderr, "INFO: Segments of '%s' changed during a merge, its result is dropped\n", set->dir);
+        status = FAILURE;
+    }
+
+    if (status == SUCCESS)
+    {
+        out = (Manifest_t){.positional = m.positional, .normalize = m.normalize, .next = m.next};
+        for (uint32_t i = 0; i < m.count && status == SUCCESS; i++)
+        {
+            if (i == at && name)
+                status = manifest_append(&out, name, size);
+            if (status == SUCCESS && (i < at || i >= at + count))
+                status = manifest_append(&out, m.names[i], m.sizes[i]);
+        }
+        if (status == SUCCESS)
+            status = write_manifest(set->dir, &out);
+        manifest_free(&out);
+    }
+    manifest_free(&m);
+    close(fd);
+    return status;
+}
+
+/* Merges view segments first .. first + count - 1 into one new segment, leaving replaced files out */
+static Status merge_segments(Segment_set *set, const Segment_view *view, uint32_t first, uint32_t count)
+{
+    char name[SEGMENT_NAME_SIZE], path[PATH_MAX];
+    Hash_t merged;
+
+    if (reserve_segment(set->dir, name) == FAILURE || !segment_path(set->dir, name, path) ||
+        initialise_hash(&merged) == FAILURE)
+        return FAILURE;
+    merged.positional = view->hash.positional;
+    merged.normalize = view->hash.normalize;
+
+    Stats_timer timer;
+    STAT_START(timer);
+    Status status = SUCCESS;
+    for (uint32_t i = first; i < first + count && status == SUCCESS; i++) // Oldest first keeps the set's file order
+    {
+        char from_path[PATH_MAX];
+        File_list *none = NULL;
+        Hash_t from;
+        status = initialise_hash(&from);
+        if (status == FAILURE)
+            break;
+        from.positional = merged.positional;
+        from.normalize = merged.normalize;
+        if (!segment_path(set->dir, view->segments[i]->name, from_path) || load_index(&from, from_path, &none, false) == FAILURE)
+        {
+            free_hash(&from);
+            status = FAILURE;
+            break;
+        }
+
+        for (uint32_t id = 0; id < from.docs.count; id++) // Replaced by a newer segment
+        {
+            if (from.docs.names[id] && view->hash.docs.names[view->base[i] + id] == NULL)
+                doc_table_remove(&from.docs, id);
+        }
+        status = merge_database(&merged, &from); // Copies the survivors and frees from
+    }
+    STAT_STOP(timer, PHASE_MERGE);
+
+    uint32_t files = merged.docs.live;
+    if (status == SUCCESS && files)
+        status = save_index(&merged, path);
+    free_hash(&merged);
+
+    uint64_t size = files ? file_size(path) : 0;
+    if (status == SUCCESS)
+        status = commit_merge(set, view, first, count, files ? name : NULL, size);
+    if (status == FAILURE)
+    {
+        remove(path);
+        return FAILURE;
+    }
+
+    for (uint32_t i = first; i < first + count; i++) // Views still mapping them keep their pages
+    {
+        if (segment_path(set->dir, view->segments[i]->name, path))
+            remove(path);
+    }
+    fprintf(stderr, "INFO: Merged %u segments of '%s' into '%s', %u files, %.1f MB\n", count, set->dir, files ? name : "nothing",
+            files, size / 1048576.0);
+    return refresh(set);
+}
+
+/* One merge the policy asks for: 1 when done, 0 when none is due, -1 when it failed */
+static int merge_due(Segment_set *set)
+{
+    uint32_t first, count;
+    if (!pick_merge(set->current, &first, &count))
+        return 0;
+    return merge_segments(set, set->current, first, count) == SUCCESS ? 1 : -1;
+}
+
+static void *merger(void *arg)
+{
+    Segment_set *set = arg;
+    bool failed = false; // Not retried until the manifest changes
+
+    pthread_mutex_lock(&set->lock);
+    while (!set->stopping)
+    {
+        pthread_mutex_unlock(&set->lock);
+        if (manifest_changed(set))
+        {
+            uint32_t before = set->current->count;
+            failed = refresh(set) == FAILURE;
+            if (!failed && set->current->count != before)
+                fprintf(stderr, "INFO: Segments of '%s' reloaded, %u now\n", set->dir, set->current->count);
+        }
+        int merged = failed ? 0 : merge_due(set);
+        failed |= merged < 0;
+        pthread_mutex_lock(&set->lock);
+
+        if (merged != 1 && !set->stopping) // Nothing left to merge -> wait for new segments
+        {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += SEGMENT_POLL_MS / 1000;
+            until.tv_nsec += (SEGMENT_POLL_MS % 1000) * 1000000L;
+            if (until.tv_nsec >= 1000000000L)
+            {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&set->wake, &set->lock, &until);
+        }
+    }
+    pthread_mutex_unlock(&set->lock);
+    return NULL;
+}
+
+/***********************************************************************
+ * Function     : segments_open
+ * Description  : Opens a segment directory for searching: loads the
+ *                segments its manifest lists and makes the table a
+ *                handle on them. The handle's query cache must exist
+ *                already; every view uses it.
+ *
+ * Arguments    : hash    - Freshly initialised table, becomes the handle
+ *                dir     - Segment directory
+ *                options - Parsed options (--verify)
+ *
+ * Returns      : SUCCESS, or FAILURE when the manifest or a segment
+ *                cannot be read.
+ ***********************************************************************/
+Status segments_open(Hash_t *hash, const char *dir, const Options_t *options)
+{
+    Segment_set *set = calloc(1, sizeof(Segment_set));
+    if (set == NULL || (set->dir = strdup(dir)) == NULL)
+    {
+        free(set);
+        return FAILURE;
+    }
+    set->verify = options->verify_postings;
+    set->handle = hash;
+    pthread_mutex_init(&set->lock, NULL);
+    pthread_cond_init(&set->wake, NULL);
+
+    if (refresh(set) == FAILURE)
+    {
+        pthread_cond_destroy(&set->wake);
+        pthread_mutex_destroy(&set->lock);
+        free(set->dir);
+        free(set);
+        return FAILURE;
+    }
+
+    hash->segments = set;
+    hash->positional = set->current->hash.positional;
+    hash->normalize = set->current->hash.normalize;
+    fprintf(stderr, "INFO: Opened %u segment%s of '%s' with %u files\n", set->current->count, set->current->count == 1 ? "" : "s",
+            dir, set->current->hash.docs.live);
+    return SUCCESS;
+}
+
+/* Starts merging in the background; segments_close() stops it */
+Status segments_start_merger(Hash_t *hash)
+{
+    Segment_set *set = hash->segments;
+    if (pthread_create(&set->merger, NULL, merger, set) != 0)
+        return FAILURE;
+    set->merging = true;
+    return SUCCESS;
+}
+
+/* Stops the merger, letting a merge in progress finish, and drops the set; called by free_hash() */
+void segments_close(Hash_t *hash)
+{
+    Segment_set *set = hash->segments;
+    hash->segments = NULL;
+
+    pthread_mutex_lock(&set->lock);
+    set->stopping = true;
+    pthread_cond_signal(&set->wake);
+    pthread_mutex_unlock(&set->lock);
+    if (set->merging)
+        pthread_join(set->merger, NULL);
+
+    view_release(set, set->current);
+    pthread_cond_destroy(&set->wake);
+    pthread_mutex_destroy(&set->lock);
+    free(set->dir);
+    free(set);
+}
+
+/* Table to search: the current view of a segment set, held until segments_release(), or the index itself */
+Hash_t *segments_acquire(Hash_t *hash)
+{
+    Segment_set *set = hash->segments;
+    if (set == NULL)
+        return hash;
+
+    pthread_mutex_lock(&set->lock);
+    Segment_view *view = set->current;
+    view->refs++;
+    pthread_mutex_unlock(&set->lock);
+    return &view->hash;
+}
+
+void segments_release(Hash_t *hash, Hash_t *index)
+{
+    if (index != hash)
+        view_release(hash->segments, index->view);
+}
+
+/* Best first; on equal scores the earlier file, as in rank.c */
+static int compare_ranked(const void *a, const void *b)
+{
+    const Ranked_doc *x = a, *y = b;
+    if (x->score != y->score)
+        return x->score > y->score ? -1 : 1;
+    return x->doc_id < y->doc_id ? -1 : x->doc_id > y->doc_id;
+}
+
+/***********************************************************************
+ * Function     : segments_search
+ * Description  : Runs a query on every segment of a view and merges
+ *                the results. Matches in files a newer segment
+ *                replaced are dropped; the rest are ranked with the
+ *                statistics of the whole set, so the k best files and
+ *                their scores are those of one index holding the same
+ *                files.
+ *
+ * Arguments    : index   - Table of a view (segments_acquire())
+ *                query   - Parsed query
+ *                k       - Files wanted
+ *                top     - Receives up to k of them, best first, with
+ *                          IDs of the view's document table
+ *                shown   - Receives how many
+ *                matches - Receives the number of matching files
+ *
+ * Returns      : SUCCESS, or FAILURE if memory runs out.
+ ***********************************************************************/
+Status segments_search(Hash_t *index, const Query_t *query, uint32_t k, Ranked_doc *top, uint32_t *shown, uint32_t *matches)
+{
+    Segment_view *view = index->view;
+    Doc_table *docs = &index->docs;
+    Hash_t **indexes = malloc((view->count + 1) * sizeof(Hash_t *));
+    Ranked_doc *found = malloc(((size_t)view->count * k + 1) * sizeof(Ranked_doc)); // Every segment's top k
+
+    *shown = 0;
+    *matches = 0;
+    if (indexes == NULL || found == NULL)
+    {
+        free(indexes);
+        free(found);
+        return FAILURE;
+    }
+    for (uint32_t i = 0; i < view->count; i++)
+        indexes[i] = &view->segments[i]->index;
+    Rank_scope scope = {indexes, view->count, docs->live, docs->total_length};
+
+    Status status = SUCCESS;
+    size_t n = 0;
+    for (uint32_t i = 0; i < view->count && status == SUCCESS; i++)
+    {
+        Doc_set result;
+        uint32_t base = view->base[i], kept = 0, ranked = 0;
+        if (query_run(indexes[i], query, &result) == FAILURE)
+        {
+            status = FAILURE;
+            break;
+        }
+        for (uint32_t j = 0; j < result.count; j++) // Replaced files no longer match
+        {
+            if (docs->names[base + result.ids[j]])
+                result.ids[kept++] = result.ids[j];
+        }
+        result.count = kept;
+        *matches += kept;
+
+        Stats_timer timer;
+        STAT_START(timer);
+        if (kept)
+            status = rank_top_k(indexes[i], query, &result, k, found + n, &ranked, &scope);
+        STAT_STOP(timer, PHASE_RANK);
+        for (uint32_t j = 0; j < ranked; j++)
+            found[n + j].doc_id += base;
+        n += ranked;
+        doc_set_free(&result);
+    }
+
+    if (status == SUCCESS)
+    {
+        qsort(found, n, sizeof(Ranked_doc), compare_ranked);
+        *shown = n < k ? n : k;
+        memcpy(top, found, *shown * sizeof(Ranked_doc));
+    }
+    free(indexes);
+    free(found);
+    return status;
+}
+
+/* Indexes the files into a new segment at the end of the set */
+static Status add_segment(const Options_t *options, File_list *files)
+{
+    const char *dir = options->segment_dir;
+    char name[SEGMENT_NAME_SIZE], path[PATH_MAX];
+    Manifest_t m;
+    Hash_t hash;
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Error: Unable to create segment directory '%s'\n", dir);
+        return FAILURE;
+    }
+    int fd = lock_manifest(dir); // Held for the build, which only covers the new files
+    if (fd < 0)
+        return FAILURE;
+    if (read_manifest(dir, &m, NULL) == FAILURE)
+    {
+        close(fd);
+        return FAILURE;
+    }
+
+    if (!m.found) // New set: the options decide its settings for good
+    {
+        m.positional = options->positions;
+        m.normalize = options->normalize;
+    }
+    else if (m.positional != options->positions || m.normalize != options->normalize)
+    {
+        char steps[NORM_NAME_SIZE];
+        printf("INFO: Segments of '%s' keep their settings: %s, normalized as '%s'\n", dir,
+               m.positional ? "with positions" : "no positions", normalize_name(m.normalize, steps));
+    }
+    snprintf(name, sizeof(name), "seg-%06u.bin", m.next++);
+
+    Status status = segment_path(dir, name, path) ? initialise_hash(&hash) : FAILURE;
+    if (status == SUCCESS)
+    {
+        hash.positional = m.positional;
+        hash.normalize = m.normalize;
+        status = create_database_parallel(&hash, files, options->threads);
+        if (status == SUCCESS)
+            status = save_index(&hash, path);
+        if (status == SUCCESS)
+            status = manifest_append(&m, name, file_size(path));
+        if (status == SUCCESS)
+            status = write_manifest(dir, &m);
+
+        if (status == SUCCESS)
+            printf("INFO: Added segment '%s' with %u files, %u segment%s in '%s'\n", name, hash.docs.live, m.count,
+                   m.count == 1 ? "" : "s", dir);
+        else
+            remove(path);
+        if (status == SUCCESS && options->stats)
+            print_stats(stdout, &hash);
+        free_hash(&hash);
+    }
+    if (status == FAILURE)
+        fprintf(stderr, "Error: Failed to add a segment to '%s'\n", dir);
+
+    manifest_free(&m);
+    close(fd);
+    return status;
+}
+
+/* Merges every segment the policy asks for, without a server */
+static Status compact_segments(const Options_t *options)
+{
+    Hash_t handle;
+    if (initialise_hash(&handle) == FAILURE)
+        return FAILURE;
+    if (segments_open(&handle, options->segment_dir, options) == FAILURE)
+    {
+        free_hash(&handle);
+        return FAILURE;
+    }
+
+    int merged;
+    while ((merged = merge_due(handle.segments)) == 1)
+        ;
+    printf("INFO: %u segment%s in '%s'\n", handle.segments->current->count, handle.segments->current->count == 1 ? "" : "s",
+           options->segment_dir);
+    free_hash(&handle);
+    return merged == 0 ? SUCCESS : FAILURE;
+}
+
+/***********************************************************************
+ * Function     : run_segments
+ * Description  : --segments DIR: with files, indexes them into a new
+ *                segment of DIR (created with the current options if
+ *                it has no manifest yet); without files, runs the
+ *                merges the tiered policy asks for.
+ *
+ * Arguments    : options - Parsed command-line options
+ *                files   - Validated input files, or NULL
+ *
+ * Returns      : SUCCESS, else FAILURE.
+ ***********************************************************************/
+Status run_segments(const Options_t *options, File_list *files)
+{
+    return files ? add_segment(options, files) : compact_segments(options);
+}
@@ -0,0 +1,596 @@
+/***********************************************************************
+ *  File Name   : server.c
+ *  Description : Long-running query server for the Inverted Search
+ *                System:
+ *
+ *                  --index backup.bin --listen /tmp/search.sock
+ *                  --index backup.bin --listen 7070
+ *                  [--format tsv|json] [--top N] [--threads N]
+ *
+ *                The index is loaded once and then served on a Unix
+ *                domain socket (any address that is not a number) or on
+ *                the localhost TCP port given. The protocol is line
+ *                based: a client sends one query per line and gets one
+ *                response per query, in order, each ending with an empty
+ *                line. A response is what batch mode prints for that
+ *                query (TSV rows without the header, or one JSON
+ *                object), numbered by the request's position on the
+ *                connection. Empty request lines are ignored; a line
+ *                longer than SERVER_MAX_REQUEST closes the connection.
+ *
+ *                One thread runs an epoll event loop that accepts
+ *                connections and does all socket I/O without blocking.
+ *                Complete request lines go to a queue served by
+ *                --threads N workers, which run and format the query
+ *                and hand the response back through an eventfd. Each
+ *                connection has at most one request with the workers,
+ *                so pipelined requests are answered in order, while
+ *                different connections are served in parallel.
+ *                SIGINT / SIGTERM stop the server cleanly.
+ *
+ *                Served from a segment directory, the index also gets
+ *                a background thread (segments.c) that picks up new
+ *                segments and merges small ones while queries run.
+ *
+ *                Functions:
+ *                  - run_server()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#define _GNU_SOURCE // accept4()
+#include "inverted_search.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVER_BACKLOG 128             // Pending connections for listen()
+#define SERVER_EVENTS 64               // epoll events handled per wake-up
+#define SERVER_READ_SIZE 4096          // Bytes asked of each recv()
+#define SERVER_MAX_REQUEST 4096        // Longest request line
+#define SERVER_INPUT_LIMIT (64 << 10)  // Buffered request bytes before a connection stops being read
+#define SERVER_OUTPUT_LIMIT (1 << 20)  // Unsent response bytes before a connection stops being served
+
+typedef struct connection
+{
+    int fd;                  // -1 once closed
+    uint32_t events;         // Current epoll interest
+    char *in;                // Received bytes not yet taken as requests
+    size_t in_len;
+    size_t in_capacity;
+    Text_buffer out;         // Responses not yet sent
+    size_t out_sent;
+    uint32_t requests;       // Requests taken so far
+    bool busy;               // A request is with the workers
+    bool eof;                // Peer has finished sending
+    bool broken;             // Peer gone or protocol error
+    struct connection *prev; // Live connections / closed ones awaiting free
+    struct connection *next;
+} Connection;
+
+typedef struct request
+{
+    Connection *conn;
+    uint32_t line;        // Position of the request on its connection
+    Text_buffer response;
+    struct request *next;
+    char text[];          // The query
+} Request;
+
+typedef struct server
+{
+    Hash_t hash;
+    const Options_t *options;
+    bool tcp;
+    int epoll_fd;
+    int listen_fd;
+    int wake_fd;             // eventfd: workers -> event loop
+    int signal_fd;           // SIGINT / SIGTERM
+    Connection *live;
+    Connection *closed;      // Freed after the current batch of events
+
+    pthread_mutex_t lock;    // Guards everything below
+    pthread_cond_t ready;
+    Request *queue_head;     // Waiting for a worker, oldest first
+    Request *queue_tail;
+    Request *done;           // Answered, waiting for the event loop
+    bool stopping;
+} Server_t;
+
+static void *server_worker(void *arg)
+{
+    Server_t *server = arg;
+    Ranked_doc *top = malloc(server->options->top_k * sizeof(Ranked_doc));
+
+    pthread_mutex_lock(&server->lock);
+    while (true)
+    {
+        while (server->queue_head == NULL && !server->stopping)
+            pthread_cond_wait(&server->ready, &server->lock);
+        if (server->queue_head == NULL) // Stopping and nothing left
+            break;
+
+        Request *req = server->queue_head;
+        server->queue_head = req->next;
+        if (server->queue_head == NULL)
+            server->queue_tail = NULL;
+        pthread_mutex_unlock(&server->lock);
+
+        if (top == NULL)
+            req->response.failed = true;
+        else
+            format_query(&server->hash, server->options, req->text, req->line, top, &req->response);
+
+        pthread_mutex_lock(&server->lock);
+        req->next = server->done;
+        server->done = req;
+        uint64_t one = 1;
+        if (write(server->wake_fd, &one, sizeof(one)) < 0)
+        {
+            // Counter saturated: the loop is awake anyway
+        }
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    free(top);
+    return NULL;
+}
+
+/* Takes the next complete request line of an idle connection and queues it for the workers */
+static void connection_dispatch(Server_t *server, Connection *conn)
+{
+    while (!conn->busy && !conn->broken && conn->out.len - conn->out_sent < SERVER_OUTPUT_LIMIT)
+    {
+        char *eol = memchr(conn->in, '\n', conn->in_len);
+        if (eol == NULL && conn->eof && conn->in_len) // Last line without a newline
+            eol = conn->in + conn->in_len;
+        if (eol == NULL)
+        {
+            if (conn->in_len > SERVER_MAX_REQUEST)
+                conn->broken = true;
+            return;
+        }
+
+        size_t taken = eol - conn->in + (eol < conn->in + conn->in_len);
+        char *text = conn->in;
+        size_t len = eol - conn->in;
+        while (len && (text[len - 1] == '\r' || text[len - 1] == ' ' || text[len - 1] == '\t'))
+            len--;
+        while (len && (*text == ' ' || *text == '\t'))
+        {
+            text++;
+            len--;
+        }
+
+        if (len > SERVER_MAX_REQUEST)
+        {
+            conn->broken = true;
+            return;
+        }
+        if (len) // Empty lines are ignored
+        {
+            Request *req = calloc(1, sizeof(Request) + len + 1);
+            if (req == NULL)
+            {
+                conn->broken = true;
+                return;
+            }
+            req->conn = conn;
+            req->line = ++conn->requests;
+            memcpy(req->text, text, len);
+
+            pthread_mutex_lock(&server->lock);
+            if (server->queue_tail)
+                server->queue_tail->next = req;
+            else
+                server->queue_head = req;
+            server->queue_tail = req;
+            pthread_cond_signal(&server->ready);
+            pthread_mutex_unlock(&server->lock);
+            conn->busy = true;
+        }
+
+        conn->in_len -= taken;
+        memmove(conn->in, conn->in + taken, conn->in_len);
+    }
+}
+
+/* Reads whatever the peer has sent, up to SERVER_INPUT_LIMIT buffered bytes */
+static void connection_read(Connection *conn)
+{
+    while (!conn->eof && !conn->broken && conn->in_len < SERVER_INPUT_LIMIT)
+    {
+        if (conn->in_capacity - conn->in_len < SERVER_READ_SIZE)
+        {
+            size_t capacity = conn->in_capacity ? conn->in_capacity * 2 : 2 * SERVER_READ_SIZE;
+            char *grown = realloc(conn->in, capacity);
+            if (grown == NULL)
+            {
+                conn->broken = true;
+                return;
+            }
+            conn->in = grown;
+            conn->in_capacity = capacity;
+        }
+
+        ssize_t n = recv(conn->fd, conn->in + conn->in_len, conn->in_capacity - conn->in_len, 0);
+        if (n > 0)
+            conn->in_len += n;
+        else if (n == 0)
+            conn->eof = true;
+        else if (errno != EINTR)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                conn->broken = true;
+            return;
+        }
+    }
+}
+
+/* Sends as much pending output as the socket takes */
+static void connection_flush(Connection *conn)
+{
+    while (conn->out_sent < conn->out.len)
+    {
+        ssize_t n = send(conn->fd, conn->out.data + conn->out_sent, conn->out.len - conn->out_sent, MSG_NOSIGNAL);
+        if (n >= 0)
+            conn->out_sent += n;
+        else if (errno != EINTR)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                conn->broken = true;
+            return;
+        }
+    }
+    conn->out.len = conn->out_sent = 0;
+}
+
+/* Moves a connection along after any event: dispatch, send, then close it or update its epoll interest */
+static void connection_update(Server_t *server, Connection *conn)
+{
+    connection_dispatch(server, conn);
+    if (!conn->broken)
+        connection_flush(conn);
+
+    bool finished = conn->eof && !conn->busy && conn->in_len == 0 && conn->out.len == 0;
+    if (conn->broken || finished)
+    {
+        if (conn->fd >= 0)
+        {
+            close(conn->fd); // Also leaves the epoll set
+            conn->fd = -1;
+        }
+        if (conn->busy) // Freed once its request comes back
+            return;
+
+        if (conn->prev)
+            conn->prev->next = conn->next;
+        else
+            server->live = conn->next;
+        if (conn->next)
+            conn->next->prev = conn->prev;
+        conn->prev = NULL;
+        conn->next = server->closed;
+        server->closed = conn;
+        return;
+    }
+
+    uint32_t events = 0;
+    if (!conn->eof && conn->in_len < SERVER_INPUT_LIMIT)
+        events |= EPOLLIN;
+    if (conn->out.len)
+        events |= EPOLLOUT;
+    if (events != conn->events)
+    {
+        struct epoll_event ev = {.events = events, .data.ptr = conn};
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+        conn->events = events;
+    }
+}
+
+static void connection_free(Connection *conn)
+{
+    if (conn->fd >= 0)
+        close(conn->fd);
+    free(conn->in);
+    free(conn->out.data);
+    free(conn);
+}
+
+static void server_accept(Server_t *server)
+{
+    while (true)
+    {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("accept");
+            return;
+        }
+
+        if (server->tcp) // Responses are small, send them at once
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        Connection *conn = calloc(1, sizeof(Connection));
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = conn};
+        if (conn == NULL || epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+        conn->next = server->live;
+        if (server->live)
+            server->live->prev = conn;
+        server->live = conn;
+    }
+}
+
+/* Hands answered requests back to their connections */
+static void server_collect(Server_t *server)
+{
+    uint64_t count;
+    if (read(server->wake_fd, &count, sizeof(count)) < 0)
+    {
+        // Spurious wake-up, the done list tells what to do
+    }
+
+    pthread_mutex_lock(&server->lock);
+    Request *done = server->done;
+    server->done = NULL;
+    pthread_mutex_unlock(&server->lock);
+
+    while (done)
+    {
+        Request *req = done;
+        Connection *conn = req->conn;
+        done = req->next;
+
+        conn->busy = false;
+        if (req->response.failed)
+        {
+            conn->broken = true;
+        }
+        else if (conn->fd >= 0)
+        {
+            if (conn->out.len == 0) // Take the worker's buffer as it is
+            {
+                Text_buffer spare = conn->out;
+                conn->out = req->response;
+                req->response = spare;
+                text_append(&conn->out, "\n");
+            }
+            else
+            {
+                text_append(&conn->out, "%.*s\n", (int)req->response.len, req->response.data);
+            }
+            conn->broken = conn->out.failed;
+        }
+        free(req->response.data);
+        free(req);
+
+        connection_update(server, conn);
+    }
+}
+
+/* Binds a Unix socket path, or localhost TCP when the address is a port number */
+static int server_listen(const char *addr, bool *tcp)
+{
+    *tcp = *addr && strspn(addr, "0123456789") == strlen(addr);
+    int fd = socket(*tcp ? AF_INET : AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    int bound;
+    if (*tcp)
+    {
+        long port = strtol(addr, NULL, 10);
+        if (port < 1 || port > 65535)
+        {
+            fprintf(stderr, "Error: '%s' is not a valid port\n", addr);
+            close(fd);
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        struct sockaddr_in sin = {.sin_family = AF_INET, .sin_port = htons(port)};
+        sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bound = bind(fd, (struct sockaddr *)&sin, sizeof(sin));
+    }
+    else
+    {
+        struct sockaddr_un sun = {.sun_family = AF_UNIX};
+        if (strlen(addr) >= sizeof(sun.sun_path))
+        {
+            fprintf(stderr, "Error: Socket path '%s' is too long\n", addr);
+            close(fd);
+            return -1;
+        }
+        strcpy(sun.sun_path, addr);
+
+        struct stat st;
+        if (stat(addr, &st) == 0 && S_ISSOCK(st.st_mode)) // Left behind by an earlier run
+            unlink(addr);
+        bound = bind(fd, (struct sockaddr *)&sun, sizeof(sun));
+    }
+
+    if (bound < 0 || listen(fd, SERVER_BACKLOG) < 0)
+    {
+        perror(addr);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static Status watch(Server_t *server, int *fd)
+{
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = fd}; // The fd's address tells the loop what woke it
+    return *fd >= 0 && epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, *fd, &ev) == 0 ? SUCCESS : FAILURE;
+}
+
+Status run_server(const Options_t *options)
+{
+    Server_t server = {.options = options, .epoll_fd = -1, .listen_fd = -1, .wake_fd = -1, .signal_fd = -1};
+
+    if (load_search_index(&server.hash, options) == FAILURE)
+        return FAILURE;
+
+    sigset_t signals; // Delivered through signal_fd; blocked before the workers inherit the mask
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.ready, NULL);
+
+    server.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    server.listen_fd = server_listen(options->listen_addr, &server.tcp);
+    server.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server.signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    Status status = server.epoll_fd >= 0 && watch(&server, &server.listen_fd) == SUCCESS &&
+                    watch(&server, &server.wake_fd) == SUCCESS && watch(&server, &server.signal_fd) == SUCCESS
+                        ? SUCCESS
+                        : FAILURE;
+
+    pthread_t tids[MAX_THREADS];
+    int started = 0;
+    for (; status == SUCCESS && started < options->threads; started++)
+    {
+        if (pthread_create(&tids[started], NULL, server_worker, &server) != 0)
+        {
+            status = started ? SUCCESS : FAILURE; // Serve with the workers we have
+            break;
+        }
+    }
+
+    if (status == SUCCESS && server.hash.segments && segments_start_merger(&server.hash) == FAILURE)
+        fprintf(stderr, "Warning: Segments of '%s' will not be merged while serving\n", options->index_name);
+
+    char served[32] = "segments"; // A segment set reported its size when it was opened
+    if (!server.hash.segments)
+        snprintf(served, sizeof(served), "%u words", (unsigned)server.hash.count);
+    if (status == SUCCESS)
+        fprintf(stderr, "INFO: Serving %s from '%s' on %s%s with %d worker thread%s\n", served, options->index_name,
+                server.tcp ? "127.0.0.1:" : "", options->listen_addr, started, started == 1 ? "" : "s");
+
+    struct epoll_event events[SERVER_EVENTS];
+    bool running = status == SUCCESS;
+    while (running)
+    {
+        int n = epoll_wait(server.epoll_fd, events, SERVER_EVENTS, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            status = FAILURE;
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            void *tag = events[i].data.ptr;
+            if (tag == &server.listen_fd)
+            {
+                server_accept(&server);
+            }
+            else if (tag == &server.wake_fd)
+            {
+                server_collect(&server);
+            }
+            else if (tag == &server.signal_fd)
+            {
+                struct signalfd_siginfo info; // Consumed, so unblocking it later does not kill us
+                if (read(server.signal_fd, &info, sizeof(info)) == sizeof(info))
+                    fprintf(stderr, "INFO: %s received, stopping\n", strsignal(info.ssi_signo));
+                running = false;
+            }
+            else
+            {
+                Connection *conn = tag;
+                if (conn->fd < 0) // Closed earlier in this batch
+                    continue;
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) // Nothing more can be sent
+                    conn->broken = true;
+                else if (events[i].events & EPOLLIN)
+                    connection_read(conn);
+                connection_update(&server, conn);
+            }
+        }
+
+        while (server.closed) // No event of this batch refers to them any more
+        {
+            Connection *conn = server.closed;
+            server.closed = conn->next;
+            connection_free(conn);
+        }
+    }
+
+    pthread_mutex_lock(&server.lock); // Workers finish the queue, then exit
+    server.stopping = true;
+    pthread_cond_broadcast(&server.ready);
+    pthread_mutex_unlock(&server.lock);
+    for (int t = 0; t < started; t++)
+        pthread_join(tids[t], NULL);
+
+    while (server.done)
+    {
+        Request *req = server.done;
+        server.done = req->next;
+        free(req->response.data);
+        free(req);
+    }
+    while (server.live)
+    {
+        Connection *conn = server.live;
+        server.live = conn->next;
+        connection_free(conn);
+    }
+
+    if (server.listen_fd >= 0)
+    {
+        close(server.listen_fd);
+        if (!server.tcp)
+            unlink(options->listen_addr);
+    }
+    if (server.wake_fd >= 0)
+        close(server.wake_fd);
+    if (server.signal_fd >= 0)
+        close(server.signal_fd);
+    if (server.epoll_fd >= 0)
+        close(server.epoll_fd);
+    pthread_cond_destroy(&server.ready);
+    pthread_mutex_destroy(&server.lock);
+    pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+
+    fprintf(stderr, status == SUCCESS ? "INFO: Server stopped\n" : "Error: Server failed\n");
+    print_cache_stats(stderr, &server.hash);
+    if (options->stats)
+        print_stats(stderr, &server.hash);
+    free_hash(&server.hash);
+    return status;
+}
@@ -0,0 +1,916 @@
+/***********************************************************************
+ *  File Name   : spimi.c
+ *  Description : External-memory index construction (--build) for
+ *                corpora larger than RAM, after the single-pass
+ *                in-memory indexing scheme (SPIMI):
+ *
+ *                  1. Files are indexed into an ordinary in-memory
+ *                     block. index_file() hands it to spill() after
+ *                     every token batch; once its nodes, words and word
+ *                     table leave no room in the --memory budget for
+ *                     another arena chunk and for write_run()'s buffer
+ *                     and word array, the words are written in byte
+ *                     order to a run file and the block is emptied. A file can end
+ *                     up split across two runs.
+ *                  2. While there are more runs than the budget can
+ *                     give a RUN_BUFFER_MIN read buffer each, groups
+ *                     of consecutive runs are merged into larger runs
+ *                     (merge_group()), keeping document order.
+ *                  3. The runs are then merged k ways, word by word,
+ *                     straight into a .bin index (binary_index.c). Each
+ *                     word's sub nodes are packed and written as soon
+ *                     as the word is complete; its dictionary entry,
+ *                     bytes and positions go to side files that are
+ *                     appended once the postings are done. A chunk is
+ *                     closed after every INDEX_CHUNK_BYTES of postings.
+ *
+ *                Every file is written and read sequentially through
+ *                large stdio buffers. A run record is
+ *
+ *                  varint word_len, word bytes, varint file_count,
+ *                  file_count x (varint doc ID gap, varint word_count),
+ *                  positional: per file, word_count position varints
+ *                  (first offset, then gaps, as in positions.c)
+ *
+ *                Runs and side files are named after the index with
+ *                '.run<N>', '.terms', '.strings', '.offsets' and
+ *                '.positions' appended, and removed when the build
+ *                ends. The index itself is written to '<name>.tmp' and
+ *                renamed into place.
+ *
+ *                Memory: the block and the buffers that write it out
+ *                stay within the budget. The merge takes its write
+ *                buffers off the budget, then gives the run read
+ *                buffers at most half of it (read_budget()); it also
+ *                holds the file list of the word being merged, 8 bytes
+ *                per file (plus 4 with positions). Positions are
+ *                streamed.
+ *
+ *                Functions:
+ *                  - run_build()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+
+#define BUILD_IO_BUFFER (1 << 20) // Write buffer of runs and of the index
+#define SIDE_BUFFER (256 << 10)   // Write buffer of each side file
+#define RUN_BUFFER_MIN (64 << 10) // Read buffer of one run during the merge, at least ...
+#define RUN_BUFFER_MAX (1 << 20)  // ... and at most
+#define MAX_RUNS 512              // Most runs merged at once, each holds an open file
+
+typedef struct build
+{
+    const Options_t *options;
+    Doc_table docs;   // Every file of the build
+    Arena_t names;    // File names of docs
+    char *path;       // Name of a run or side file (run_path)
+    size_t path_size;
+    uint32_t runs;    // Runs written, those of merge passes included
+    size_t peak;      // Largest block handed to spill()
+} Build_t;
+
+typedef struct run
+{
+    FILE *fptr;
+    char *buffer;      // stdio read buffer
+    uint32_t index;    // Runs are numbered in document order
+    uint32_t word_len; // Word of the next record, 0 once the run is exhausted
+    char word[WORD_SIZE];
+} Run_t;
+
+typedef struct merge
+{
+    Section_writer w;  // Postings, straight into the index file
+    FILE *run;         // Output of an earlier pass instead, NULL in the last one
+    FILE *terms;       // Bin_term[] of the merged words
+    FILE *strings;     // Their bytes
+    FILE *offsets;     // Per positional word: file_count, data bytes, file_count offsets
+    FILE *positions;   // Per positional word: the varints, padded to 4 bytes
+    Sub_node *subs;    // Files of the word being merged
+    uint32_t *starts;  // Where each file's positions begin in the word's varints
+    uint32_t count;
+    uint32_t capacity;
+    uint8_t *packed;   // Packed sub nodes of the word
+    size_t packed_capacity;
+    uint64_t data_size; // Position bytes of the word so far
+    uint32_t last;      // Last position of the word's final file so far
+    uint64_t term_count;
+    uint64_t posting_count;
+    uint64_t strings_size;
+    uint64_t blocks;   // Positions section used so far, in 4-byte units
+    Bin_chunk *chunks; // Chunks so far, the last one still open
+    uint64_t chunk_count;
+} Merge_t;
+
+/* Name of run n, or of a side file when suffix is given */
+static const char *run_path(Build_t *build, const char *suffix, uint32_t n)
+{
+    if (suffix)
+        snprintf(build->path, build->path_size, "%s.%s", build->options->build_name, suffix);
+    else
+        snprintf(build->path, build->path_size, "%s.run%u", build->options->build_name, n);
+    return build->path;
+}
+
+/* Bytes the block takes: nodes, sub nodes and positions in the arena, words in the pool, table slots */
+static size_t block_memory(const Hash_t *hash)
+{
+    return hash->arena.bytes_reserved + hash->strings.bytes_reserved + hash->capacity * sizeof(Main_node *);
+}
+
+static uint32_t put_varint(FILE *fptr, uint32_t value)
+{
+    uint32_t n = 1;
+    for (; value >= 0x80; n++) // Same encoding as varint_put()
+    {
+        putc_unlocked((int)(value | 0x80) & 0xff, fptr);
+        value >>= 7;
+    }
+    putc_unlocked((int)value, fptr);
+    return n;
+}
+
+static bool get_varint(FILE *fptr, uint32_t *value)
+{
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        int byte = getc_unlocked(fptr);
+        if (byte == EOF)
+            return false;
+        v |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ------------------ Runs ------------------ */
+
+static int compare_nodes(const void *a, const void *b)
+{
+    return strcmp((*(Main_node *const *)a)->word, (*(Main_node *const *)b)->word);
+}
+
+/* Writes the block's words in byte order, with their files and positions, as the next run */
+static Status write_run(Build_t *build, Hash_t *hash)
+{
+    Main_node **words = malloc(hash->count * sizeof(Main_node *));
+    if (words == NULL)
+        return FAILURE;
+
+    size_t n = 0;
+    for (Main_node *node = hash->head; node; node = node->m_link)
+        words[n++] = node;
+    qsort(words, n, sizeof(Main_node *), compare_nodes);
+
+    FILE *fptr = fopen(run_path(build, NULL, build->runs), "wb");
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "Error: Unable to open '%s' file\n", build->path);
+        free(words);
+        return FAILURE;
+    }
+    setvbuf(fptr, NULL, _IOFBF, BUILD_IO_BUFFER);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const Main_node *node = words[i];
+        put_varint(fptr, node->word_len);
+        fwrite(node->word, 1, node->word_len, fptr);
+        put_varint(fptr, node->file_count);
+
+        uint32_t prev = 0;
+        for (uint32_t f = 0; f < node->file_count; f++) // Block words are never packed
+        {
+            put_varint(fptr, node->s_list[f].doc_id - prev);
+            put_varint(fptr, node->s_list[f].word_count);
+            prev = node->s_list[f].doc_id;
+        }
+
+        for (uint32_t f = 0; node->positions && f < node->file_count; f++) // Already varints, copied as they are
+        {
+            const uint8_t *data = node->positions->data + node->positions->offsets[f];
+            fwrite(data, 1, positions_span(data, node->s_list[f].word_count), fptr);
+        }
+    }
+    free(words);
+
+    bool failed = ferror(fptr);
+    if (fclose(fptr) != 0 || failed)
+    {
+        fprintf(stderr, "Error: Failed to write run '%s'\n", build->path);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* Turns the block into a run and empties it; the table goes back to its initial size too */
+static Status flush_block(Build_t *build, Hash_t *hash)
+{
+    if (hash->count == 0)
+        return SUCCESS;
+
+    size_t used = block_memory(hash);
+    if (used > build->peak)
+        build->peak = used;
+    Stats_timer timer;
+    STAT_START(timer);
+    if (write_run(build, hash) == FAILURE)
+        return FAILURE;
+    STAT_STOP(timer, PHASE_SAVE);
+    printf("INFO: Run %u written, %zu words, %.1f MB in memory\n", build->runs, hash->count, used / 1048576.0);
+    build->runs++;
+
+    free(hash->table);
+    arena_free(&hash->arena);
+    pool_free(&hash->strings);
+    hash->table = calloc(HASH_INITIAL_SIZE, sizeof(Main_node *));
+    if (hash->table == NULL)
+        return FAILURE;
+    hash->capacity = HASH_INITIAL_SIZE;
+    hash->count = 0;
+    hash->head = NULL;
+    hash->tail = NULL;
+    return SUCCESS;
+}
+
+/* index_file() hook, called after every token batch; leaves room for the arena chunk the next batch may open
+   and for what write_run() allocates: the sorted word array and the run's write buffer */
+static Status spill(Hash_t *hash)
+{
+    Build_t *build = hash->spill_context;
+    if (block_memory(hash) + ARENA_CHUNK_SIZE + hash->count * sizeof(Main_node *) + BUILD_IO_BUFFER <= build->options->memory_budget)
+        return SUCCESS;
+    return flush_block(build, hash);
+}
+
+/* Reads the word of the run's next record; word_len stays 0 at the end of the run */
+static Status run_next(Run_t *run)
+{
+    run->word_len = 0;
+    int byte = getc_unlocked(run->fptr);
+    if (byte == EOF)
+        return ferror(run->fptr) ? FAILURE : SUCCESS;
+    ungetc(byte, run->fptr);
+
+    uint32_t len;
+    if (!get_varint(run->fptr, &len) || len == 0 || len > MAX_WORD_LEN || fread(run->word, 1, len, run->fptr) != len)
+        return FAILURE;
+    run->word[len] = '\0';
+    run->word_len = len;
+    return SUCCESS;
+}
+
+/* ------------------ Merge ------------------ */
+
+/* Heap order: words in byte order, a word's runs in document order */
+static bool run_before(const Run_t *a, const Run_t *b)
+{
+    int cmp = strcmp(a->word, b->word);
+    return cmp < 0 || (cmp == 0 && a->index < b->index);
+}
+
+static void heap_down(Run_t **heap, uint32_t size, uint32_t i)
+{
+    while (2 * i + 1 < size)
+    {
+        uint32_t child = 2 * i + 1;
+        if (child + 1 < size && run_before(heap[child + 1], heap[child]))
+            child++;
+        if (!run_before(heap[child], heap[i]))
+            break;
+        Run_t *swap = heap[i];
+        heap[i] = heap[child];
+        heap[child] = swap;
+        i = child;
+    }
+}
+
+static Status reserve_files(Merge_t *m, uint32_t extra)
+{
+    if (m->count + extra <= m->capacity)
+        return SUCCESS;
+
+    uint32_t capacity = m->capacity ? m->capacity : 64;
+    while (capacity < m->count + extra)
+        capacity *= 2;
+
+    Sub_node *subs = realloc(m->subs, capacity * sizeof(Sub_node));
+    if (subs)
+        m->subs = subs;
+    uint32_t *starts = realloc(m->starts, capacity * sizeof(uint32_t));
+    if (starts)
+        m->starts = starts;
+    if (subs == NULL || starts == NULL)
+        return FAILURE;
+
+    m->capacity = capacity;
+    return SUCCESS;
+}
+
+/* Appends the files of the run's current record to the word being merged */
+static Status merge_record(Merge_t *m, Run_t *run, bool positional)
+{
+    uint32_t files, doc_id = 0, split_count = 0;
+    if (!get_varint(run->fptr, &files) || files == 0 || reserve_files(m, files) == FAILURE)
+        return FAILURE;
+
+    uint32_t first = m->count;
+    bool split = false; // The record starts with the file the previous run ended in
+    for (uint32_t i = 0; i < files; i++)
+    {
+        uint32_t gap, word_count;
+        if (!get_varint(run->fptr, &gap) || !get_varint(run->fptr, &word_count) || word_count == 0)
+            return FAILURE;
+        doc_id += gap;
+
+        if (i == 0 && m->count && m->subs[m->count - 1].doc_id == doc_id)
+        {
+            m->subs[m->count - 1].word_count += word_count;
+            split_count = word_count;
+            split = true;
+            continue;
+        }
+        if (m->count && doc_id <= m->subs[m->count - 1].doc_id) // Files must stay in ascending order
+            return FAILURE;
+        m->subs[m->count++] = (Sub_node){doc_id, word_count};
+    }
+
+    for (uint32_t i = 0; positional && i < files; i++)
+    {
+        bool continued = split && i == 0;
+        uint32_t count = continued ? split_count : m->subs[first + i - split].word_count;
+        uint32_t position = 0;
+
+        if (!continued)
+            m->starts[first + i - split] = (uint32_t)m->data_size;
+        for (uint32_t k = 0; k < count; k++)
+        {
+            uint32_t value;
+            if (!get_varint(run->fptr, &value))
+                return FAILURE;
+            position += value; // Each run starts a file's list with its absolute offset
+            if (continued && k == 0)
+            {
+                if (value <= m->last)
+                    return FAILURE;
+                value -= m->last; // Rebased on the part in the previous run
+            }
+            m->data_size += put_varint(m->positions, value);
+        }
+        m->last = position;
+    }
+    if (m->data_size > UINT32_MAX) // Offsets of a word are 32-bit
+        return FAILURE;
+    return SUCCESS;
+}
+
+/* Packs the merged word into the postings and queues its dictionary entry, bytes and positions */
+static Status finish_word(Merge_t *m, const char *word, uint32_t word_len, bool positional)
+{
+    size_t size = postings_packed_size(m->subs, m->count);
+    if (size > m->packed_capacity)
+    {
+        uint8_t *packed = realloc(m->packed, size);
+        if (packed == NULL)
+            return FAILURE;
+        m->packed = packed;
+        m->packed_capacity = size;
+    }
+    postings_encode(m->subs, m->count, m->packed);
+
+    Bin_term term = {hash_word(word, word_len), m->w.size, (uint32_t)m->strings_size, word_len, m->count, (uint32_t)m->blocks};
+    section_write(&m->w, m->packed, size);
+    fwrite(&term, sizeof(term), 1, m->terms);
+    fwrite(word, 1, word_len, m->strings);
+    m->strings_size += word_len;
+
+    if (positional) // Block layout of binary_index.c: offsets, then the varints, 4-byte aligned
+    {
+        while (m->data_size % 4)
+        {
+            putc_unlocked(0, m->positions);
+            m->data_size++;
+        }
+        uint32_t record[2] = {m->count, (uint32_t)m->data_size};
+        fwrite(record, sizeof(uint32_t), 2, m->offsets);
+        fwrite(m->starts, sizeof(uint32_t), m->count, m->offsets);
+        m->blocks += m->count + m->data_size / 4;
+    }
+
+    m->term_count++;
+    m->posting_count += m->count;
+    m->count = 0;
+    m->data_size = 0;
+
+    Bin_chunk *chunk = &m->chunks[m->chunk_count - 1];
+    if (m->w.size - chunk->postings_offset >= INDEX_CHUNK_BYTES && m->chunk_count < INDEX_MAX_CHUNKS) // Next word opens a chunk
+    {
+        chunk->term_count = m->term_count - chunk->first_term;
+        chunk->checksum[2] = section_chunk(&m->w);
+        for (; m->strings_size % 8; m->strings_size++) // Every chunk region is 8-byte aligned
+            putc_unlocked(0, m->strings);
+        m->blocks += m->blocks % 2;
+
+        chunk++;
+        chunk->first_term = m->term_count;
+        chunk->strings_offset = m->strings_size;
+        chunk->postings_offset = m->w.size;
+        chunk->positions_offset = m->blocks * 4;
+        m->chunk_count++;
+    }
+    if (m->strings_size > UINT32_MAX || m->blocks > UINT32_MAX) // Bin_term fields are 32-bit
+        return FAILURE;
+    return SUCCESS;
+}
+
+/* Copies size bytes of a side file into the current section */
+static Status copy_side(Section_writer *w, FILE *from, uint64_t size, unsigned char *buffer)
+{
+    while (size)
+    {
+        size_t take = size < BUILD_IO_BUFFER ? size : BUILD_IO_BUFFER;
+        if (fread(buffer, 1, take, from) != take)
+            return FAILURE;
+        section_write(w, buffer, take);
+        size -= take;
+    }
+    return SUCCESS;
+}
+
+/* Appends the dictionary, strings and positions sections from the side files, then the chunk table */
+static Status append_sections(Merge_t *m, Bin_header *header, bool positional)
+{
+    unsigned char *buffer = malloc(BUILD_IO_BUFFER);
+    Status status = buffer ? SUCCESS : FAILURE;
+
+    if (fflush(m->terms) != 0 || fflush(m->strings) != 0 || (positional && (fflush(m->offsets) != 0 || fflush(m->positions) != 0)))
+        status = FAILURE;
+    rewind(m->terms);
+    rewind(m->strings);
+
+    header->terms_offset = header->postings_offset + header->postings_size;
+    section_begin(&m->w);
+    for (uint64_t c = 0; c < m->chunk_count; c++)
+    {
+        if (status == SUCCESS)
+            status = copy_side(&m->w, m->terms, m->chunks[c].term_count * sizeof(Bin_term), buffer);
+        m->chunks[c].checksum[0] = section_chunk(&m->w);
+    }
+    header->terms_size = m->w.size;
+
+    header->strings_offset = header->terms_offset + header->terms_size;
+    section_begin(&m->w);
+    for (uint64_t c = 0; c < m->chunk_count; c++) // The side file already holds the padding between chunks
+    {
+        uint64_t end = c + 1 < m->chunk_count ? m->chunks[c + 1].strings_offset : m->strings_size;
+        if (status == SUCCESS)
+            status = copy_side(&m->w, m->strings, end - m->chunks[c].strings_offset, buffer);
+        m->chunks[c].checksum[1] = section_chunk(&m->w);
+    }
+    header->strings_size = m->w.size;
+
+    header->positions_offset = header->strings_offset + header->strings_size;
+    section_begin(&m->w);
+    if (positional)
+    {
+        rewind(m->offsets);
+        rewind(m->positions);
+    }
+    for (uint64_t c = 0; c < m->chunk_count; c++)
+    {
+        for (uint64_t i = 0; positional && i < m->chunks[c].term_count && status == SUCCESS; i++) // Offsets and varints of each word interleaved
+        {
+            uint32_t record[2];
+            if (fread(record, sizeof(uint32_t), 2, m->offsets) != 2 ||
+                copy_side(&m->w, m->offsets, (uint64_t)record[0] * sizeof(uint32_t), buffer) == FAILURE ||
+                copy_side(&m->w, m->positions, record[1], buffer) == FAILURE)
+                status = FAILURE;
+        }
+        m->chunks[c].checksum[3] = section_chunk(&m->w);
+    }
+    header->positions_size = m->w.size;
+
+    header->chunks_offset = header->positions_offset + header->positions_size;
+    header->chunk_count = m->chunk_count;
+    write_chunk_table(&m->w, header, m->chunks);
+
+    free(buffer);
+    return status;
+}
+
+static FILE *open_side(Build_t *build, const char *suffix)
+{
+    FILE *fptr = fopen(run_path(build, suffix, 0), "w+b");
+    if (fptr == NULL)
+        fprintf(stderr, "Error: Unable to open '%s' file\n", build->path);
+    else
+        setvbuf(fptr, NULL, _IOFBF, SIDE_BUFFER);
+    return fptr;
+}
+
+static void close_side(Build_t *build, FILE *fptr, const char *suffix)
+{
+    if (fptr)
+    {
+        fclose(fptr);
+        remove(run_path(build, suffix, 0));
+    }
+}
+
+/* Bytes of the budget for run read buffers: half of it, less what the final merge's write buffers leave */
+static size_t read_budget(const Options_t *options)
+{
+    size_t output = BUILD_IO_BUFFER + (options->positions ? 4 : 2) * SIDE_BUFFER; // Index file and side files
+    size_t half = options->memory_budget / 2;
+    size_t left = options->memory_budget > output ? options->memory_budget - output : 0;
+    return left < half ? left : half;
+}
+
+/* Opens runs [first, first + count), each with a read buffer of buffer_size, and heaps those holding words */
+static Status open_runs(Build_t *build, Run_t *runs, Run_t **heap, uint32_t first, uint32_t count, size_t buffer_size,
+                        uint32_t *live, Run_t **bad)
+{
+    *live = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        runs[i].index = first + i;
+        runs[i].fptr = fopen(run_path(build, NULL, first + i), "rb");
+        runs[i].buffer = malloc(buffer_size);
+        if (runs[i].fptr == NULL || runs[i].buffer == NULL)
+        {
+            fprintf(stderr, "Error: Unable to open '%s' file\n", build->path);
+            return FAILURE;
+        }
+        setvbuf(runs[i].fptr, runs[i].buffer, _IOFBF, buffer_size);
+        if (run_next(&runs[i]) == FAILURE)
+        {
+            *bad = &runs[i];
+            return FAILURE;
+        }
+        if (runs[i].word_len)
+            heap[(*live)++] = &runs[i];
+    }
+    for (uint32_t i = *live / 2; i-- > 0;)
+        heap_down(heap, *live, i);
+    return SUCCESS;
+}
+
+static void close_runs(Run_t *runs, uint32_t count)
+{
+    for (uint32_t i = 0; runs && i < count; i++)
+    {
+        if (runs[i].fptr)
+            fclose(runs[i].fptr);
+        free(runs[i].buffer);
+        runs[i].fptr = NULL;
+        runs[i].buffer = NULL;
+    }
+}
+
+/* Writes the merged word as one record of the pass's output run; its positions wait in the side file */
+static Status put_record(Merge_t *m, const char *word, uint32_t word_len, bool positional)
+{
+    put_varint(m->run, word_len);
+    fwrite(word, 1, word_len, m->run);
+    put_varint(m->run, m->count);
+
+    uint32_t prev = 0;
+    for (uint32_t f = 0; f < m->count; f++)
+    {
+        put_varint(m->run, m->subs[f].doc_id - prev);
+        put_varint(m->run, m->subs[f].word_count);
+        prev = m->subs[f].doc_id;
+    }
+
+    if (positional)
+    {
+        char bytes[4096];
+        if (fseek(m->positions, 0, SEEK_SET) != 0)
+            return FAILURE;
+        for (uint64_t left = m->data_size; left;)
+        {
+            size_t take = left < sizeof(bytes) ? left : sizeof(bytes);
+            if (fread(bytes, 1, take, m->positions) != take)
+                return FAILURE;
+            fwrite(bytes, 1, take, m->run);
+            left -= take;
+        }
+        rewind(m->positions); // The next word's varints overwrite these
+    }
+
+    m->count = 0;
+    m->data_size = 0;
+    return ferror(m->run) ? FAILURE : SUCCESS;
+}
+
+/* Merges the heaped runs word by word into the output run, or the index when there is none; bad is set if a run cannot be read */
+static Status merge_heap(Merge_t *m, Run_t **heap, uint32_t live, bool positional, Run_t **bad)
+{
+    while (live)
+    {
+        char word[WORD_SIZE];
+        uint32_t word_len = heap[0]->word_len;
+        memcpy(word, heap[0]->word, word_len + 1);
+
+        while (live && strcmp(heap[0]->word, word) == 0) // Every run holding the word, in document order
+        {
+            Run_t *run = heap[0];
+            if (merge_record(m, run, positional) == FAILURE || run_next(run) == FAILURE)
+            {
+                *bad = run;
+                return FAILURE;
+            }
+            if (run->word_len == 0) // Run exhausted
+                heap[0] = heap[--live];
+            heap_down(heap, live, 0);
+        }
+        if ((m->run ? put_record(m, word, word_len, positional) : finish_word(m, word, word_len, positional)) == FAILURE)
+            return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* Earlier pass: runs [first, first + count) merged into run out, then removed */
+static Status merge_group(Build_t *build, uint32_t first, uint32_t count, uint32_t out)
+{
+    bool positional = build->options->positions;
+    Status status = FAILURE;
+    Run_t *bad = NULL;
+    uint32_t live;
+    Merge_t m;
+    memset(&m, 0, sizeof(m));
+
+    Run_t *runs = calloc(count, sizeof(Run_t));
+    Run_t **heap = calloc(count, sizeof(Run_t *));
+    size_t buffer_size = read_budget(build->options) / count;
+    if (buffer_size > RUN_BUFFER_MAX)
+        buffer_size = RUN_BUFFER_MAX;
+    if (runs == NULL || heap == NULL)
+        goto cleanup;
+    if (open_runs(build, runs, heap, first, count, buffer_size, &live, &bad) == FAILURE)
+        goto corrupt;
+    if (positional && (m.positions = open_side(build, "positions")) == NULL)
+        goto cleanup;
+
+    m.run = fopen(run_path(build, NULL, out), "wb");
+    if (m.run == NULL)
+    {
+        fprintf(stderr, "Error: Unable to open '%s' file\n", build->path);
+        goto cleanup;
+    }
+    setvbuf(m.run, NULL, _IOFBF, BUILD_IO_BUFFER);
+
+    status = merge_heap(&m, heap, live, positional, &bad);
+    bool failed = ferror(m.run);
+    if (fclose(m.run) != 0 || failed || (status == FAILURE && bad == NULL))
+    {
+        fprintf(stderr, "Error: Failed to write run '%s'\n", run_path(build, NULL, out));
+        status = FAILURE;
+    }
+    if (status == SUCCESS)
+    {
+        for (uint32_t i = 0; i < count; i++) // Inputs are no longer needed
+            remove(run_path(build, NULL, first + i));
+    }
+
+corrupt:
+    if (bad)
+    {
+        fprintf(stderr, "Error: Run '%s' is corrupt or unreadable\n", run_path(build, NULL, bad->index));
+        status = FAILURE;
+    }
+
+cleanup:
+    close_side(build, m.positions, "positions");
+    close_runs(runs, count);
+    free(runs);
+    free(heap);
+    free(m.subs);
+    free(m.starts);
+    return status;
+}
+
+/* Last pass: k-way merge of runs [first, first + count) into the .bin index */
+static Status merge_index(Build_t *build, uint32_t first, uint32_t count, uint32_t spilled)
+{
+    const Options_t *options = build->options;
+    bool positional = options->positions;
+    Status status = FAILURE;
+    Run_t *bad = NULL; // Run that could not be read
+    uint32_t live;
+    Merge_t m;
+    memset(&m, 0, sizeof(m));
+
+    Run_t *runs = calloc(count ? count : 1, sizeof(Run_t));
+    Run_t **heap = calloc(count ? count : 1, sizeof(Run_t *));
+    size_t temp_size = strlen(options->build_name) + 8;
+    char *temp_name = malloc(temp_size);
+    m.chunks = calloc(INDEX_MAX_CHUNKS, sizeof(Bin_chunk));
+    m.chunk_count = 1;
+    if (runs == NULL || heap == NULL || temp_name == NULL || m.chunks == NULL)
+        goto cleanup;
+    snprintf(temp_name, temp_size, "%s.tmp", options->build_name);
+
+    size_t buffer_size = read_budget(options) / (count ? count : 1);
+    if (buffer_size > RUN_BUFFER_MAX)
+        buffer_size = RUN_BUFFER_MAX;
+    if (open_runs(build, runs, heap, first, count, buffer_size, &live, &bad) == FAILURE)
+    {
+        if (bad)
+            goto corrupt;
+        goto cleanup;
+    }
+
+    m.terms = open_side(build, "terms");
+    m.strings = open_side(build, "strings");
+    if (m.terms == NULL || m.strings == NULL)
+        goto cleanup;
+    if (positional && ((m.offsets = open_side(build, "offsets")) == NULL || (m.positions = open_side(build, "positions")) == NULL))
+        goto cleanup;
+
+    m.w.fptr = fopen(temp_name, "wb");
+    if (m.w.fptr == NULL)
+    {
+        fprintf(stderr, "Error: Unable to open '%s' file\n", temp_name);
+        goto cleanup;
+    }
+    setvbuf(m.w.fptr, NULL, _IOFBF, BUILD_IO_BUFFER);
+
+    Bin_header header;
+    index_header_init(&header, build->docs.count, positional, options->normalize);
+    section_write(&m.w, &header, sizeof(header)); // Placeholder, rewritten by commit_index()
+
+    header.docs_offset = sizeof(header);
+    write_doc_section(&m.w, &build->docs);
+    header.docs_size = m.w.size;
+    header.checksum[0] = m.w.checksum;
+
+    header.postings_offset = header.docs_offset + header.docs_size;
+    section_begin(&m.w);
+    if (merge_heap(&m, heap, live, positional, &bad) == FAILURE)
+    {
+        if (bad)
+            goto corrupt;
+        fprintf(stderr, "Error: Index '%s' is too large for the .bin format\n", options->build_name);
+        goto cleanup;
+    }
+    close_runs(runs, count); // Their buffers make room for the one that copies the side files
+    m.chunks[m.chunk_count - 1].term_count = m.term_count - m.chunks[m.chunk_count - 1].first_term;
+    m.chunks[m.chunk_count - 1].checksum[2] = section_chunk(&m.w);
+    header.postings_size = m.w.size;
+    header.posting_count = m.posting_count;
+    header.term_count = m.term_count;
+
+    if (append_sections(&m, &header, positional) == FAILURE)
+        m.w.failed = true;
+    status = commit_index(&m.w, &header, temp_name, options->build_name);
+    m.w.fptr = NULL; // Closed by commit_index()
+    if (status == SUCCESS)
+        printf("INFO: %u file(s), %llu words and %llu postings from %u run(s) merged into index file '%s'\n",
+               build->docs.count, (unsigned long long)m.term_count, (unsigned long long)m.posting_count, spilled,
+               options->build_name);
+    goto cleanup;
+
+corrupt:
+    fprintf(stderr, "Error: Run '%s' is corrupt or unreadable\n", run_path(build, NULL, bad->index));
+
+cleanup:
+    if (m.w.fptr) // Failed before commit_index()
+    {
+        fclose(m.w.fptr);
+        remove(temp_name);
+    }
+    close_side(build, m.terms, "terms");
+    close_side(build, m.strings, "strings");
+    close_side(build, m.offsets, "offsets");
+    close_side(build, m.positions, "positions");
+    close_runs(runs, count);
+    free(runs);
+    free(heap);
+    free(temp_name);
+    free(m.subs);
+    free(m.starts);
+    free(m.packed);
+    free(m.chunks);
+    return status;
+}
+
+/* Merges the runs into the index, first in groups of consecutive runs while there are too many to read at once */
+static Status merge_runs(Build_t *build)
+{
+    uint32_t spilled = build->runs, first = 0, count = build->runs;
+    size_t ways = read_budget(build->options) / RUN_BUFFER_MIN; // Runs that fit in the budget at the smallest buffer
+    if (ways > MAX_RUNS)
+        ways = MAX_RUNS;
+    if (ways < 2)
+        ways = 2;
+
+    while (count > ways) // Document order is kept: groups and their outputs follow the runs
+    {
+        uint32_t groups = (uint32_t)((count + ways - 1) / ways), next = build->runs;
+        for (uint32_t g = 0; g < groups; g++)
+        {
+            uint32_t from = first + (uint32_t)((uint64_t)count * g / groups), to = first + (uint32_t)((uint64_t)count * (g + 1) / groups);
+            uint32_t out = build->runs++; // Counted first, so a failed pass still removes it
+            if (merge_group(build, from, to - from, out) == FAILURE)
+                return FAILURE;
+        }
+        printf("INFO: %u runs merged into %u\n", count, groups);
+        first = next;
+        count = groups;
+    }
+    return merge_index(build, first, count, spilled);
+}
+
+/***********************************************************************
+ * Function     : run_build
+ * Description  : External build: indexes the files within the
+ *                --memory budget, spilling sorted runs, and merges the
+ *                runs into the --build .bin index. The runs are
+ *                removed afterwards, whether the build succeeded or
+ *                not. With --stats the finished index is loaded back
+ *                and described by the statistics report.
+ *
+ * Arguments    : options - Parsed command-line options
+ *                files   - Validated input files, in document ID order
+ *
+ * Returns      : SUCCESS once the index is in place, else FAILURE.
+ ***********************************************************************/
+Status run_build(const Options_t *options, File_list *files)
+{
+    Build_t build = {.options = options, .runs = 0, .peak = 0};
+    Hash_t block;
+    Status status = FAILURE;
+
+    build.path_size = strlen(options->build_name) + 32;
+    build.path = malloc(build.path_size);
+    arena_init(&build.names);
+    if (build.path == NULL || doc_table_init(&build.docs) == FAILURE)
+    {
+        free(build.path);
+        return FAILURE;
+    }
+    if (initialise_hash(&block) == FAILURE)
+        goto cleanup;
+    block.positional = options->positions;
+    block.normalize = options->normalize;
+    block.spill = spill;
+    block.spill_context = &build;
+
+    printf("INFO: Building '%s' within %zu MB\n", options->build_name, options->memory_budget >> 20);
+    for (File_list *file = files; file; file = file->next) // Document IDs follow the file list, so do the runs
+    {
+        uint32_t length;
+        uint32_t doc_id = doc_table_add(&build.docs, &build.names, file->file_name);
+        if (doc_id == DOC_NONE || index_file(&block, file->file_name, doc_id, &length) == FAILURE)
+            break;
+        doc_table_set_length(&build.docs, doc_id, length);
+        if (file->next == NULL)
+            status = flush_block(&build, &block); // Last words
+    }
+    free_hash(&block);
+
+    if (status == SUCCESS)
+    {
+        Stats_timer timer;
+        STAT_START(timer);
+        status = merge_runs(&build);
+        STAT_STOP(timer, PHASE_MERGE);
+    }
+    else
+    {
+        fprintf(stderr, "Error: Failed to build index '%s'\n", options->build_name);
+    }
+    if (status == SUCCESS)
+        printf("INFO: Largest in-memory block %.1f MB\n", build.peak / 1048576.0);
+
+    if (status == SUCCESS && options->stats) // Describe the finished index
+    {
+        Hash_t index;
+        File_list *none = NULL;
+        if (initialise_hash(&index) == SUCCESS)
+        {
+            index.normalize = options->normalize;
+            if (load_index(&index, options->build_name, &none, false) == SUCCESS)
+                print_stats(stdout, &index);
+            free_hash(&index);
+        }
+    }
+
+cleanup:
+    for (uint32_t i = 0; i < build.runs; i++)
+        remove(run_path(&build, NULL, i));
+    doc_table_free(&build.docs);
+    arena_free(&build.names);
+    free(build.path);
+    return status;
+}
@@ -0,0 +1,335 @@
+/***********************************************************************
+ *  File Name   : stats.c
+ *  Description : Built-in instrumentation for the Inverted Search
+ *                System. Two kinds of figures are reported:
+ *
+ *                  - Counters kept while the code runs: probes per word
+ *                    table lookup (histogram), table resizes, main and
+ *                    sub nodes created and the bytes they took, files,
+ *                    bytes and tokens indexed, queries searched, and
+ *                    per-phase call counts with wall and CPU time.
+ *                  - Figures taken from the index when the report is
+ *                    printed: term / posting / file counts, load factor
+ *                    and the distance of every word from its home slot
+ *                    (the "chain" a lookup of it walks), and memory by
+ *                    structure.
+ *
+ *                Every thread counts into its own Stats_counters block,
+ *                so counting is a plain increment with no locking or
+ *                atomics; a block is registered on the thread's first
+ *                count and folded into a retired total when the thread
+ *                exits. Phase timers read two clocks per call and only
+ *                run with --stats; phases are timed per file, per
+ *                batch of tokens or per operation, never per word.
+ *
+ *                Building with -DNO_STATS compiles every counter and
+ *                timer out; the report then shows the index figures
+ *                only.
+ *
+ *                Functions:
+ *                  - stats_register()
+ *                  - stats_start() / stats_stop()
+ *                  - stats_collect()
+ *                  - print_stats()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <pthread.h>
+#include <time.h>
+
+bool stats_timing = false;
+
+static const char *phase_names[PHASE_COUNT] = {"open", "tokenize", "insert", "merge", "pack",
+                                               "save", "load", "parse", "match", "rank"};
+
+#ifndef NO_STATS
+
+_Thread_local Stats_counters *stats_thread;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;        // Runs stats_retire() when a counting thread exits
+static Stats_counters *stats_live;     // Blocks of running threads
+static Stats_counters stats_retired;   // Sum of exited threads
+static Stats_counters stats_fallback;  // Shared block when a thread's cannot be allocated
+
+/* Adds every counter of from to to */
+static void add_counters(Stats_counters *to, const Stats_counters *from)
+{
+    uint64_t *dst = (uint64_t *)to;
+    const uint64_t *src = (const uint64_t *)from;
+    for (size_t i = 0; i < offsetof(Stats_counters, next) / sizeof(uint64_t); i++)
+        dst[i] += src[i];
+}
+
+static void stats_retire(void *arg)
+{
+    Stats_counters *block = arg;
+
+    pthread_mutex_lock(&stats_lock);
+    Stats_counters **link = &stats_live;
+    while (*link && *link != block)
+        link = &(*link)->next;
+    if (*link)
+        *link = block->next;
+    add_counters(&stats_retired, block);
+    pthread_mutex_unlock(&stats_lock);
+    free(block);
+}
+
+static void stats_key_create(void)
+{
+    pthread_key_create(&stats_key, stats_retire);
+}
+
+/* Gives the calling thread its counter block on its first count */
+Stats_counters *stats_register(void)
+{
+    Stats_counters *block = calloc(1, sizeof(Stats_counters));
+    if (block == NULL)
+        return stats_thread = &stats_fallback;
+
+    pthread_once(&stats_once, stats_key_create);
+    pthread_setspecific(stats_key, block);
+
+    pthread_mutex_lock(&stats_lock);
+    block->next = stats_live;
+    stats_live = block;
+    pthread_mutex_unlock(&stats_lock);
+    return stats_thread = block;
+}
+
+static uint64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void stats_start(Stats_timer *timer)
+{
+    if (!stats_timing)
+        return;
+    timer->wall_ns = clock_ns(CLOCK_MONOTONIC);
+    timer->cpu_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void stats_stop(Stats_timer *timer, Stats_phase phase)
+{
+    if (!stats_timing)
+        return;
+
+    Stats_counters *c = stats_thread ? stats_thread : stats_register();
+    c->calls[phase]++;
+    c->wall_ns[phase] += clock_ns(CLOCK_MONOTONIC) - timer->wall_ns;
+    c->cpu_ns[phase] += clock_ns(CLOCK_THREAD_CPUTIME_ID) - timer->cpu_ns;
+}
+
+/* Sum over every thread that ever counted, running or not */
+void stats_collect(Stats_counters *total)
+{
+    memset(total, 0, sizeof(Stats_counters));
+
+    pthread_mutex_lock(&stats_lock);
+    add_counters(total, &stats_retired);
+    for (Stats_counters *block = stats_live; block; block = block->next)
+        add_counters(total, block);
+    pthread_mutex_unlock(&stats_lock);
+    add_counters(total, &stats_fallback);
+}
+
+#else
+
+void stats_collect(Stats_counters *total)
+{
+    memset(total, 0, sizeof(Stats_counters));
+}
+
+#endif
+
+/* ------------------ Report ------------------ */
+
+typedef struct index_memory
+{
+    size_t slots;      // Word table
+    size_t main_nodes;
+    size_t strings;    // String pool, reserved bytes
+    size_t sub_arrays; // Plain sub node arrays (allocated capacity)
+    size_t packed;     // Packed postings in the arena
+    size_t mapped;     // Packed postings read from a mapped .bin index
+    size_t positions;  // Position lists owned by the arena
+    size_t docs;       // Document table with its name bytes
+    size_t dict;       // Term dictionary arrays
+} Index_memory;
+
+static void print_histogram(FILE *out, const char *title, const uint64_t *hist, uint64_t total)
+{
+    fprintf(out, "  %-26s:", title);
+    for (int b = 0; b < STATS_HISTOGRAM; b++)
+    {
+        char label[16];
+        uint64_t low = 1ull << b, high = (1ull << (b + 1)) - 1;
+        if (b == STATS_HISTOGRAM - 1)
+            snprintf(label, sizeof(label), "%llu+", (unsigned long long)low);
+        else if (low == high)
+            snprintf(label, sizeof(label), "%llu", (unsigned long long)low);
+        else
+            snprintf(label, sizeof(label), "%llu-%llu", (unsigned long long)low, (unsigned long long)high);
+        fprintf(out, " %s: %.1f%%", label, total ? 100.0 * hist[b] / total : 0.0);
+    }
+    fprintf(out, "\n");
+}
+
+static void print_size(FILE *out, const char *name, size_t bytes)
+{
+    fprintf(out, "  %-26s: %10.1f KB\n", name, bytes / 1024.0);
+}
+
+/* Walks the index once for the figures no counter keeps */
+static void measure_index(const Hash_t *hash, Index_memory *mem, uint64_t *postings, uint64_t *distance_hist,
+                          size_t *longest)
+{
+    memset(mem, 0, sizeof(Index_memory));
+    *postings = 0;
+    *longest = 0;
+    memset(distance_hist, 0, STATS_HISTOGRAM * sizeof(uint64_t));
+
+    const unsigned char *map = hash->map;
+    size_t mask = hash->capacity - 1;
+    for (size_t i = 0; i < hash->capacity; i++) // Slots walked by a lookup of each word
+    {
+        const Main_node *node = hash->table[i];
+        if (node == NULL)
+            continue;
+        size_t slots = ((i - (node->hash & mask)) & mask) + 1;
+        if (slots > *longest)
+            *longest = slots;
+        distance_hist[slots >= (1u << (STATS_HISTOGRAM - 1)) ? STATS_HISTOGRAM - 1 : 63 - __builtin_clzll(slots)]++;
+    }
+
+    for (const Main_node *node = hash->head; node; node = node->m_link)
+    {
+        *postings += node->file_count;
+        if (node->packed)
+        {
+            const unsigned char *packed = node->packed;
+            bool borrowed = map && packed >= map && packed < map + hash->map_size;
+            *(borrowed ? &mem->mapped : &mem->packed) += node->file_count ? postings_size(node) : 0;
+        }
+        else
+            mem->sub_arrays += node->capacity * sizeof(Sub_node);
+        if (node->positions)
+            mem->positions += sizeof(Positions_t) + node->positions->capacity +
+                              node->positions->offsets_capacity * sizeof(uint32_t);
+    }
+
+    mem->slots = hash->capacity * sizeof(Main_node *);
+    mem->main_nodes = hash->count * sizeof(Main_node);
+    mem->strings = hash->strings.bytes_reserved;
+    mem->docs = hash->docs.capacity * (sizeof(char *) + sizeof(uint32_t)) + hash->docs.slot_capacity * sizeof(uint32_t);
+    for (uint32_t d = 0; d < hash->docs.count; d++)
+        mem->docs += hash->docs.names[d] ? strlen(hash->docs.names[d]) + 1 : 0;
+    mem->dict = (hash->dict.sorted ? 2 : 0) * hash->dict.count * sizeof(Main_node *);
+}
+
+/***********************************************************************
+ * Function     : print_stats
+ * Description  : Prints the instrumentation report: index shape, word
+ *                table probing, memory by structure, allocation
+ *                counters and per-phase times.
+ *
+ * Arguments    : out  - Destination stream
+ *                hash - Index to describe
+ ***********************************************************************/
+void print_stats(FILE *out, const Hash_t *hash)
+{
+    Stats_counters c;
+    Index_memory mem;
+    uint64_t postings, distance_hist[STATS_HISTOGRAM];
+    size_t longest;
+    Cache_stats cache;
+    char name[NORM_NAME_SIZE];
+
+    stats_collect(&c);
+    measure_index(hash, &mem, &postings, distance_hist, &longest);
+    query_cache_stats(hash, &cache);
+
+    fprintf(out, "\n=====================================================\n");
+    fprintf(out, "                 INDEX STATISTICS                 \n");
+    fprintf(out, "=====================================================\n\n");
+
+    fprintf(out, "Index\n");
+    fprintf(out, "  %-26s: %zu\n", "Terms", hash->count);
+    fprintf(out, "  %-26s: %llu (%.2f per term)\n", "Postings (sub nodes)", (unsigned long long)postings,
+            hash->count ? (double)postings / hash->count : 0.0);
+    fprintf(out, "  %-26s: %u live, %u registered\n", "Files", hash->docs.live, hash->docs.count);
+    fprintf(out, "  %-26s: %llu\n", "Tokens in live files", (unsigned long long)hash->docs.total_length);
+    fprintf(out, "  %-26s: %s\n", "Normalization", normalize_name(hash->normalize, name));
+
+    fprintf(out, "\nWord table\n");
+    fprintf(out, "  %-26s: %zu slots, load factor %.3f (grows above %.2f)\n", "Size", hash->capacity,
+            hash->capacity ? (double)hash->count / hash->capacity : 0.0, HASH_MAX_LOAD / 100.0);
+    print_histogram(out, "Slots to reach each word", distance_hist, hash->count);
+    fprintf(out, "  %-26s: %zu slots\n", "Longest probe chain", longest);
+
+#ifndef NO_STATS
+    fprintf(out, "  %-26s: %llu lookups, %.3f slots on average, %llu resizes\n", "Lookups so far",
+            (unsigned long long)c.lookups, c.lookups ? (double)c.probes / c.lookups : 0.0, (unsigned long long)c.resizes);
+    print_histogram(out, "Slots per lookup", c.probe_hist, c.lookups);
+#endif
+
+    fprintf(out, "\nMemory\n");
+    print_size(out, "Word table slots", mem.slots);
+    print_size(out, "Main nodes", mem.main_nodes);
+    fprintf(out, "  %-26s: %10.1f KB reserved, %.1f KB of terms\n", "String pool", mem.strings / 1024.0,
+            hash->strings.bytes_used / 1024.0);
+    print_size(out, "Sub node arrays", mem.sub_arrays);
+    print_size(out, "Packed postings", mem.packed);
+    if (hash->map)
+    {
+        print_size(out, "Packed postings (mapped)", mem.mapped);
+        print_size(out, "Mapped index file", hash->map_size);
+    }
+    if (hash->positional)
+        print_size(out, "Positions", mem.positions);
+    print_size(out, "Document table", mem.docs);
+    print_size(out, "Term dictionary", mem.dict);
+    if (cache.budget)
+        print_size(out, "Query cache", cache.bytes);
+    fprintf(out, "  %-26s: %10.1f KB used, %.1f KB reserved\n", "Arena", hash->arena.bytes_used / 1024.0,
+            hash->arena.bytes_reserved / 1024.0);
+
+#ifndef NO_STATS
+    fprintf(out, "\nActivity (all threads, since start)\n");
+    fprintf(out, "  %-26s: %llu, %.1f KB\n", "create_main_node()", (unsigned long long)c.main_nodes, c.main_bytes / 1024.0);
+    fprintf(out, "  %-26s: %llu, %.1f KB of sub node arrays\n", "create_sub_node()", (unsigned long long)c.sub_nodes,
+            c.sub_bytes / 1024.0);
+    fprintf(out, "  %-26s: %llu files, %.1f MB, %llu tokens\n", "Indexed", (unsigned long long)c.files,
+            c.file_bytes / 1048576.0, (unsigned long long)c.tokens);
+    fprintf(out, "  %-26s: %llu (%llu from the cache)\n", "Searches", (unsigned long long)c.queries, (unsigned long long)cache.hits);
+
+    if (!stats_timing)
+    {
+        fprintf(out, "\nPhase times: not collected, run with --stats\n");
+    }
+    else
+    {
+        fprintf(out, "\nPhases (summed over threads)\n");
+        fprintf(out, "  %-10s %12s %12s %12s\n", "Phase", "Calls", "Wall ms", "CPU ms");
+        for (int p = 0; p < PHASE_COUNT; p++)
+        {
+            if (c.calls[p])
+                fprintf(out, "  %-10s %12llu %12.3f %12.3f\n", phase_names[p], (unsigned long long)c.calls[p],
+                        c.wall_ns[p] / 1e6, c.cpu_ns[p] / 1e6);
+        }
+    }
+#else
+    (void)phase_names;
+    fprintf(out, "\nCounters and phase timers: compiled out (-DNO_STATS)\n");
+#endif
+    fprintf(out, "=====================================================\n");
+}
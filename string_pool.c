@@ -0,0 +1,100 @@
+/***********************************************************************
+ *  File Name   : string_pool.c
+ *  Description : Append-only string pool holding the bytes of every
+ *                term of an index. A term is copied in once, with a
+ *                terminating NUL, when its main node is created; the
+ *                node keeps a pointer to it and its cached length.
+ *                Terms are packed back to back in large chunks, so
+ *                each costs its length plus one byte instead of a fixed
+ *                WORD_SIZE array inside the node, and words touched by
+ *                one lookup or dictionary scan sit close together.
+ *
+ *                Chunks never move or shrink: a pointer into the pool
+ *                stays valid until the pool is freed, also after the
+ *                pool has been handed to another index by pool_adopt()
+ *                (parallel builds). Words removed from the index leave
+ *                their bytes behind, like their nodes in the arena.
+ *
+ *                Functions:
+ *                  - pool_init()
+ *                  - pool_add()
+ *                  - pool_adopt()
+ *                  - pool_free()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+
+void pool_init(String_pool *pool)
+{
+    pool->chunks = NULL; // No chunk until the first term
+    pool->bytes_used = 0;
+    pool->bytes_reserved = 0;
+}
+
+/* Copies len bytes plus a NUL into the pool; returns the stored copy */
+const char *pool_add(String_pool *pool, const char *word, size_t len)
+{
+    Arena_chunk *chunk = pool->chunks;
+
+    if (chunk == NULL || chunk->used + len + 1 > chunk->size) // Current chunk full, its tail stays unused
+    {
+        size_t chunk_size = len + 1 > POOL_CHUNK_SIZE ? len + 1 : POOL_CHUNK_SIZE;
+        chunk = malloc(sizeof(Arena_chunk) + chunk_size);
+        if (chunk == NULL)
+            return NULL;
+
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->bytes_reserved += chunk_size;
+    }
+
+    char *copy = (char *)chunk->data + chunk->used;
+    memcpy(copy, word, len);
+    copy[len] = '\0';
+    chunk->used += len + 1;
+    pool->bytes_used += len + 1;
+    return copy;
+}
+
+/* Moves every chunk of from into pool; terms keep their addresses */
+void pool_adopt(String_pool *pool, String_pool *from)
+{
+    if (from->chunks == NULL)
+        return;
+
+    Arena_chunk *tail = from->chunks;
+    while (tail->next)
+        tail = tail->next;
+
+    if (pool->chunks) // Behind the current chunk, which keeps taking new terms
+    {
+        tail->next = pool->chunks->next;
+        pool->chunks->next = from->chunks;
+    }
+    else
+    {
+        pool->chunks = from->chunks;
+    }
+
+    pool->bytes_used += from->bytes_used;
+    pool->bytes_reserved += from->bytes_reserved;
+    pool_init(from);
+}
+
+void pool_free(String_pool *pool)
+{
+    Arena_chunk *chunk = pool->chunks;
+    while (chunk)
+    {
+        Arena_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    pool_init(pool);
+}
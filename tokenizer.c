@@ -0,0 +1,232 @@
+/***********************************************************************
+ *  File Name   : tokenizer.c
+ *  Description : Zero-copy tokenizer for the Inverted Search System.
+ *                Each input file is mapped into memory (or read into a
+ *                single buffer when mapping is not possible) and split
+ *                on whitespace, exactly like fscanf("%s"). Each
+ *                64-byte block is classified once into a whitespace
+ *                bitmask (four SSE2 compares, or two with -mavx2), and
+ *                token starts and ends are the next clear and set bits,
+ *                found with count-trailing-zeros.
+ *
+ *                Tokens are handed out as (pointer, length) slices into
+ *                the mapping; nothing is copied. Tokens longer than
+ *                MAX_WORD_LEN bytes are truncated to MAX_WORD_LEN bytes
+ *                (backing off to a UTF-8 character boundary) and counted
+ *                in Tokenizer_t.truncated.
+ *
+ *                Functions:
+ *                  - tokenizer_open()
+ *                  - tokenizer_next()
+ *                  - tokenizer_close()
+ *                  - clamp_word_len()
+ *
+ *  Author      : Omkar Ashok Sawant
+ *  Batch ID    : 25021C_309
+ *  Date        : 07/12/2025
+ ***********************************************************************/
+
+#include "inverted_search.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_WIDTH 16
+#endif
+
+#define SCAN_BLOCK 64 // Bytes per whitespace bitmask
+
+/* Same set as isspace() in the C locale: ' ', '\t', '\n', '\v', '\f', '\r' */
+static inline bool is_space(unsigned char ch)
+{
+    return ch == ' ' || (unsigned char)(ch - '\t') <= '\r' - '\t';
+}
+
+#ifdef SIMD_WIDTH
+/* Bit i set when data[i] is whitespace */
+static inline uint32_t space_mask(const char *data)
+{
+#if SIMD_WIDTH == 32
+    __m256i bytes = _mm256_loadu_si256((const __m256i *)data);
+    __m256i blank = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+    __m256i shifted = _mm256_sub_epi8(bytes, _mm256_set1_epi8('\t')); // '\t'..'\r' -> 0..4
+    __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(blank, control));
+#else
+    __m128i bytes = _mm_loadu_si128((const __m128i *)data);
+    __m128i blank = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+    __m128i shifted = _mm_sub_epi8(bytes, _mm_set1_epi8('\t')); // '\t'..'\r' -> 0..4
+    __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(blank, control));
+#endif
+}
+#endif
+
+/* Bit i set when data[i] is whitespace, for the SCAN_BLOCK bytes at data */
+static inline uint64_t block_mask(const char *data)
+{
+#ifdef SIMD_WIDTH
+    uint64_t mask = 0;
+    for (int i = 0; i < SCAN_BLOCK; i += SIMD_WIDTH)
+        mask |= (uint64_t)space_mask(data + i) << i;
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < SCAN_BLOCK; i++)
+        mask |= (uint64_t)is_space(data[i]) << i;
+    return mask;
+#endif
+}
+
+/* Same for the last, partial block; bytes past the end count as whitespace, so a word ends there */
+static uint64_t tail_mask(const char *data, size_t count)
+{
+    uint64_t mask = ~0ULL << count;
+    for (size_t i = 0; i < count; i++)
+        mask |= (uint64_t)is_space(data[i]) << i;
+    return mask;
+}
+
+/* Word bytes of the block at base: bit i set when data[base + i] is not whitespace, bits past the end clear */
+static inline uint64_t word_mask(const Tokenizer_t *tok, size_t base)
+{
+    return base + SCAN_BLOCK <= tok->size ? ~block_mask(tok->data + base) : ~tail_mask(tok->data + base, tok->size - base);
+}
+
+Status tokenizer_open(Tokenizer_t *tok, const char *file_name)
+{
+    tok->data = NULL;
+    tok->size = 0;
+    tok->pos = 0;
+    tok->block = -(size_t)SCAN_BLOCK; // The first block is loaded by the first call
+    tok->words = 0;
+    tok->mapped = false;
+    tok->truncated = 0;
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+        return FAILURE;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return FAILURE;
+    }
+
+    if (st.st_size == 0) // Nothing to tokenize
+    {
+        close(fd);
+        return SUCCESS;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) // Zero-copy path
+    {
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        tok->data = map;
+        tok->size = st.st_size;
+        tok->mapped = true;
+        close(fd);
+        return SUCCESS;
+    }
+
+    char *buffer = malloc(st.st_size); // Fallback: one large read
+    size_t done = 0;
+    while (buffer && done < (size_t)st.st_size)
+    {
+        ssize_t n = read(fd, buffer + done, st.st_size - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    close(fd);
+
+    if (buffer == NULL)
+        return FAILURE;
+
+    tok->data = buffer;
+    tok->size = done;
+    return SUCCESS;
+}
+
+bool tokenizer_next(Tokenizer_t *tok, const char **token, size_t *len)
+{
+    uint64_t words = tok->words;
+    size_t base = tok->block;
+    while (words == 0) // Skip whitespace, a block at a time
+    {
+        base += SCAN_BLOCK;
+        if (base >= tok->size)
+        {
+            tok->block = base;
+            tok->pos = tok->size;
+            return false;
+        }
+        words = word_mask(tok, base);
+    }
+
+    unsigned first = __builtin_ctzll(words);
+    uint64_t gaps = ~(words >> first); // Bit k set when byte first + k is whitespace, or lies past the block
+    unsigned stop = gaps ? first + __builtin_ctzll(gaps) : SCAN_BLOCK;
+    size_t start = base + first, end;
+    if (stop < SCAN_BLOCK) // Word ends inside this block: the common case
+    {
+        end = base + stop;
+        words &= ~0ULL << stop;
+    }
+    else
+    {
+        do // Word runs on into the next blocks; past the end counts as whitespace
+        {
+            base += SCAN_BLOCK;
+            words = base < tok->size ? word_mask(tok, base) : 0;
+        } while (words == ~0ULL);
+        stop = __builtin_ctzll(~words);
+        end = base + stop;
+        words &= ~0ULL << stop; // stop < SCAN_BLOCK: ~words is not zero
+    }
+    tok->block = base;
+    tok->words = words;
+    tok->pos = end;
+
+    size_t length = end - start;
+    if (length > MAX_WORD_LEN) // Rare: cut down to the limit
+    {
+        length = clamp_word_len(tok->data + start, length);
+        tok->truncated++;
+    }
+
+    *token = tok->data + start;
+    *len = length;
+    return true;
+}
+
+/* Truncation policy for over-long tokens, shared with the query parser */
+size_t clamp_word_len(const char *word, size_t len)
+{
+    if (len <= MAX_WORD_LEN)
+        return len;
+
+    size_t length = MAX_WORD_LEN;
+    while (length > 0 && ((unsigned char)word[length] & 0xc0) == 0x80)
+        length--; // Do not split a UTF-8 character
+    return length ? length : MAX_WORD_LEN;
+}
+
+void tokenizer_close(Tokenizer_t *tok)
+{
+    if (tok->mapped)
+        munmap((void *)tok->data, tok->size);
+    else
+        free((void *)tok->data);
+
+    tok->data = NULL;
+    tok->size = 0;
+}
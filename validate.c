@@ -5,9 +5,12 @@
  *                  - Validating input file arguments
  *                  - Checking file extensions and sizes
  *                  - Detecting duplicate filenames
+ *                  - Expanding directories and @LIST file lists
  *                  - Building the file list structure
+ *                  - Parsing command-line options
  *
  *                Functions:
+ *                  - read_options()
  *                  - read_and_validate_input_arguments()
  *                  - validate_file_extension()
  *                  - validate_file_size()
@@ -20,16 +23,465 @@
  ***********************************************************************/
 
 #include "inverted_search.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/***********************************************************************
+ * Function     : read_options
+ * Description  : Extracts command-line options and removes them from
+ *                argv so only file names remain. Supported options:
+ *                  --threads N   Build the database with N threads
+ *                  --verify      Checksum postings when loading a .bin index
+ *                  --top N       Show the N best ranked files per search
+ *                  --positions   Record word positions (phrase / NEAR queries)
+ *                  --index F     Batch mode: search the backup F ...
+ *                  --queries Q   ... with every line of Q, no menu
+ *                  --format T    Batch output, tsv (default) or json
+ *                  --cache MB    Query result cache budget (default
+ *                                CACHE_DEFAULT_MB, 0 disables it)
+ *                  --listen A    Serve the --index backup on the Unix
+ *                                socket path A or localhost TCP port A
+ *                  --stats       Time the build / load / query phases and
+ *                                print the statistics report at the end
+ *                  --normalize S Token normalization steps, a comma list
+ *                                of lower, punct, stop, stem, or none
+ *                                (default lower,punct)
+ *                  --build F     External build: index the files into
+ *                                the .bin index F, no menu
+ *                  --memory MB   Memory budget of --build (default
+ *                                BUILD_MEMORY_MB)
+ *                  --segments D  Segmented index: add the files to the
+ *                                segment directory D as a new segment,
+ *                                or merge its segments without files
+ *                  --journal F   Menu database kept in the .bin snapshot
+ *                                F and the write-ahead log F.wal
+ *
+ * Arguments    : argc    - Pointer to count of command-line arguments
+ *                argv    - Argument vector (compacted in place)
+ *                options - Parsed options
+ *
+ * Returns      : SUCCESS, or FAILURE on a malformed option.
+ ***********************************************************************/
+Status read_options(int *argc, char *argv[], Options_t *options)
+{
+    options->threads = 1;
+    options->verify_postings = false;
+    options->top_k = TOP_K_DEFAULT;
+    options->positions = false;
+    options->index_name = NULL;
+    options->query_name = NULL;
+    options->format = FORMAT_TSV;
+    options->listen_addr = NULL;
+    options->cache_size = (size_t)CACHE_DEFAULT_MB << 20;
+    options->stats = false;
+    options->normalize = NORM_DEFAULT;
+    options->build_name = NULL;
+    options->memory_budget = 0; // BUILD_MEMORY_MB unless --memory is given
+    options->segment_dir = NULL;
+    options->journal_name = NULL;
+
+    int kept = 1;
+    for (int i = 1; i < *argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0)
+        {
+            if (i + 1 >= *argc || atoi(argv[i + 1]) < 1)
+            {
+                fprintf(stderr, "Error: --threads needs a positive number.\n");
+                return FAILURE;
+            }
+            options->threads = atoi(argv[++i]);
+            if (options->threads > MAX_THREADS)
+                options->threads = MAX_THREADS;
+            continue;
+        }
+        if (strcmp(argv[i], "--top") == 0)
+        {
+            if (i + 1 >= *argc || atoi(argv[i + 1]) < 1)
+            {
+                fprintf(stderr, "Error: --top needs a positive number.\n");
+                return FAILURE;
+            }
+            options->top_k = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--cache") == 0)
+        {
+            if (i + 1 >= *argc || argv[i + 1][0] == '\0' || strspn(argv[i + 1], "0123456789") != strlen(argv[i + 1]))
+            {
+                fprintf(stderr, "Error: --cache needs a size in MB (0 disables the cache).\n");
+                return FAILURE;
+            }
+            options->cache_size = (size_t)atoi(argv[++i]) << 20;
+            continue;
+        }
+        if (strcmp(argv[i], "--memory") == 0)
+        {
+            if (i + 1 >= *argc || strspn(argv[i + 1], "0123456789") != strlen(argv[i + 1]) || atoi(argv[i + 1]) < BUILD_MEMORY_MIN_MB)
+            {
+                fprintf(stderr, "Error: --memory needs a budget in MB (at least %d).\n", BUILD_MEMORY_MIN_MB);
+                return FAILURE;
+            }
+            options->memory_budget = (size_t)atoi(argv[++i]) << 20;
+            continue;
+        }
+        if (strcmp(argv[i], "--build") == 0)
+        {
+            if (i + 1 >= *argc || !is_index_file(argv[i + 1]))
+            {
+                fprintf(stderr, "Error: --build needs a .bin index file name.\n");
+                return FAILURE;
+            }
+            options->build_name = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--segments") == 0)
+        {
+            if (i + 1 >= *argc || argv[i + 1][0] == '\0' || is_index_file(argv[i + 1]))
+            {
+                fprintf(stderr, "Error: --segments needs a directory name.\n");
+                return FAILURE;
+            }
+            options->segment_dir = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--journal") == 0)
+        {
+            if (i + 1 >= *argc || !is_index_file(argv[i + 1]) || strlen(argv[i + 1]) >= PATH_MAX)
+            {
+                fprintf(stderr, "Error: --journal needs a .bin index file name shorter than %d characters.\n", PATH_MAX);
+                return FAILURE;
+            }
+            options->journal_name = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--verify") == 0)
+        {
+            options->verify_postings = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--positions") == 0)
+        {
+            options->positions = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--stats") == 0)
+        {
+            options->stats = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--index") == 0 || strcmp(argv[i], "--queries") == 0 || strcmp(argv[i], "--listen") == 0)
+        {
+            if (i + 1 >= *argc)
+            {
+                fprintf(stderr, "Error: %s needs an argument.\n", argv[i]);
+                return FAILURE;
+            }
+            if (argv[i][2] == 'i')
+                options->index_name = argv[++i];
+            else if (argv[i][2] == 'q')
+                options->query_name = argv[++i];
+            else
+                options->listen_addr = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--normalize") == 0)
+        {
+            if (i + 1 >= *argc || parse_normalize(argv[i + 1], &options->normalize) == FAILURE)
+            {
+                fprintf(stderr, "Error: --normalize needs a list of lower, punct, stop, stem, or none.\n");
+                return FAILURE;
+            }
+            i++;
+            continue;
+        }
+        if (strcmp(argv[i], "--format") == 0)
+        {
+            if (i + 1 < *argc && strcmp(argv[i + 1], "tsv") == 0)
+                options->format = FORMAT_TSV;
+            else if (i + 1 < *argc && strcmp(argv[i + 1], "json") == 0)
+                options->format = FORMAT_JSON;
+            else
+            {
+                fprintf(stderr, "Error: --format needs tsv or json.\n");
+                return FAILURE;
+            }
+            i++;
+            continue;
+        }
+        argv[kept++] = argv[i]; // Not an option -> keep as file name
+    }
+
+    *argc = kept;
+    argv[kept] = NULL;
+
+    if (!options->index_name != (!options->query_name && !options->listen_addr) || (options->query_name && options->listen_addr))
+    {
+        fprintf(stderr, "Error: --index needs either --queries (batch) or --listen (server).\n");
+        return FAILURE;
+    }
+    if ((options->build_name && options->index_name) || (options->memory_budget && !options->build_name))
+    {
+        fprintf(stderr, "Error: --memory goes with --build, which cannot be combined with --index.\n");
+        return FAILURE;
+    }
+    if (options->segment_dir && (options->index_name || options->build_name))
+    {
+        fprintf(stderr, "Error: --segments cannot be combined with --index or --build.\n");
+        return FAILURE;
+    }
+    if (options->journal_name && (options->index_name || options->build_name || options->segment_dir))
+    {
+        fprintf(stderr, "Error: --journal cannot be combined with --index, --build or --segments.\n");
+        return FAILURE;
+    }
+    if (options->memory_budget == 0)
+        options->memory_budget = (size_t)BUILD_MEMORY_MB << 20;
+    return SUCCESS;
+}
+
+/* Candidate input file, collected before any file is opened */
+typedef struct candidate
+{
+    const char *name; // argv entry or a copy in the expansion arena
+    int source;       // argv index the file came from
+    bool expanded;    // Found in a directory or a file list, not named directly
+    long size;        // Set by check_files(): bytes, or -1 if it is not a readable regular file
+} Candidate;
+
+typedef struct candidates
+{
+    Candidate *items; // Growable array in argument order
+    size_t count;
+    size_t capacity;
+    size_t unreadable; // Directories and file lists that could not be opened
+    Arena_t names;     // Paths built while expanding directories and file lists
+} Candidates;
+
+/* Slice of the candidates checked by one worker of check_files() */
+typedef struct check_job
+{
+    Candidate *items;
+    size_t count;
+    size_t stride;
+} Check_job;
+
+/* Appends one candidate, copying name into the arena when it is not an argv entry */
+static Status add_candidate(Candidates *list, const char *name, size_t len, int source, bool expanded)
+{
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        Candidate *items = realloc(list->items, capacity * sizeof(Candidate));
+        if (!items)
+            return FAILURE;
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    if (expanded)
+    {
+        char *copy = arena_alloc(&list->names, len + 1);
+        if (!copy)
+            return FAILURE;
+        memcpy(copy, name, len);
+        copy[len] = '\0';
+        name = copy;
+    }
+    list->items[list->count++] = (Candidate){name, source, expanded, 0};
+    return SUCCESS;
+}
+
+/* qsort comparator: directory entries in byte order, so file numbering does not depend on the file system */
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Adds every .txt file below path, recursing into subdirectories */
+static Status expand_directory(Candidates *list, const char *path, int source)
+{
+    DIR *dir = opendir(path);
+    if (!dir)
+    {
+        fprintf(stderr, "Error: Directory '%s' cannot be read.\n", path);
+        list->unreadable++;
+        return SUCCESS; // Other inputs are still usable
+    }
+
+    char **entries = NULL;
+    size_t count = 0, capacity = 0;
+    Status status = SUCCESS;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] == '.') // ".", ".." and hidden files
+            continue;
+        if (count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 32;
+            char **grown = realloc(entries, capacity * sizeof(char *));
+            if (!grown)
+            {
+                status = FAILURE;
+                break;
+            }
+            entries = grown;
+        }
+        if ((entries[count] = strdup(entry->d_name)) == NULL)
+        {
+            status = FAILURE;
+            break;
+        }
+        count++;
+    }
+    closedir(dir);
+    if (count > 1)
+        qsort(entries, count, sizeof(char *), compare_names);
+
+    size_t dir_len = strlen(path);
+    while (dir_len > 1 && path[dir_len - 1] == '/') // "docs/" -> "docs/a.txt", not "docs//a.txt"
+        dir_len--;
+    for (size_t i = 0; i < count && status == SUCCESS; i++)
+    {
+        size_t len = dir_len + 1 + strlen(entries[i]);
+        char *child = malloc(len + 1);
+        if (!child)
+        {
+            status = FAILURE;
+            break;
+        }
+        sprintf(child, "%.*s/%s", (int)dir_len, path, entries[i]);
+
+        struct stat st;
+        if (lstat(child, &st) == 0 && S_ISDIR(st.st_mode)) // Symbolic links to directories are not followed
+            status = expand_directory(list, child, source);
+        else if (validate_file_extension(entries[i]) == SUCCESS) // Other files are skipped silently
+            status = add_candidate(list, child, len, source, true);
+        free(child);
+    }
+
+    for (size_t i = 0; i < count; i++)
+        free(entries[i]);
+    free(entries);
+    return status;
+}
+
+/* Adds the files named in a file list, one path per line; blank lines and # comments are skipped */
+static Status expand_file_list(Candidates *list, const char *path, int source)
+{
+    FILE *fptr = fopen(path, "r");
+    if (!fptr)
+    {
+        fprintf(stderr, "Error: File list '%s' not found or cannot be opened.\n", path);
+        list->unreadable++;
+        return SUCCESS;
+    }
+
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    Status status = SUCCESS;
+    while (status == SUCCESS && (len = getline(&line, &size, fptr)) != -1)
+    {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+        status = add_candidate(list, line, (size_t)len, source, true);
+    }
+    free(line);
+    fclose(fptr);
+    return status;
+}
+
+/* Worker of check_files(): sizes every stride-th candidate of its slice */
+static void *check_worker(void *arg)
+{
+    Check_job *job = arg;
+    for (size_t i = 0; i < job->count; i += job->stride)
+    {
+        Candidate *item = &job->items[i];
+        struct stat st;
+        int fd = open(item->name, O_RDONLY | O_CLOEXEC); // Opening proves the file is readable
+        if (fd < 0)
+        {
+            item->size = -1;
+            continue;
+        }
+        item->size = (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) ? (long)st.st_size : -1;
+        close(fd);
+    }
+    return NULL;
+}
+
+/* Sizes all candidates, on several threads once there are enough of them to hide open() latency */
+static void check_files(Candidate *items, size_t count)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = count / VALIDATE_FILES_PER_THREAD;
+    if (threads > (size_t)(cpus > 0 ? cpus : 1))
+        threads = (size_t)(cpus > 0 ? cpus : 1);
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+
+    if (threads < 1)
+        threads = 1;
+
+    Check_job jobs[MAX_THREADS];
+    pthread_t workers[MAX_THREADS];
+    bool started[MAX_THREADS] = {false};
+    for (size_t t = 0; t < threads; t++)
+        jobs[t] = (Check_job){items + t, count > t ? count - t : 0, threads};
+    for (size_t t = 1; t < threads; t++)
+        started[t] = pthread_create(&workers[t], NULL, check_worker, &jobs[t]) == 0;
+
+    for (size_t t = 0; t < threads; t++) // Slice 0, and any slice whose worker failed to start
+        if (!started[t])
+            check_worker(&jobs[t]);
+    for (size_t t = 1; t < threads; t++)
+        if (started[t])
+            pthread_join(workers[t], NULL);
+}
+
+/* Open-addressing set of file names, sized for every name up front */
+typedef struct name_set
+{
+    const char **slots;
+    size_t mask;
+} Name_set;
+
+/* Adds name to the set; DUPLICATE if it is already there */
+static Status name_set_add(Name_set *set, const char *name)
+{
+    size_t slot = (size_t)hash_word(name, strlen(name)) & set->mask;
+    while (set->slots[slot])
+    {
+        if (strcmp(set->slots[slot], name) == 0)
+            return DUPLICATE;
+        slot = (slot + 1) & set->mask;
+    }
+    set->slots[slot] = name;
+    return SUCCESS;
+}
 
 /***********************************************************************
  * Function     : read_and_validate_input_arguments
  * Description  : Validates each input file provided via command-line.
- *                Checks:
+ *                An argument may also be a directory, searched
+ *                recursively for .txt files, or @LIST, a file with one
+ *                path per line. Checks:
  *                  - Valid .txt extension
  *                  - File accessibility
  *                  - Non-empty file size
  *                  - Duplicate file names
- *                Valid files are added to File_list.
+ *                Files are sized with open() and fstat(), in parallel
+ *                for large inputs, and duplicates are found with a hash
+ *                set, so N files cost O(N). Valid files are added to
+ *                File_list in argument order.
  *
  * Arguments    : argc  - Count of command-line arguments
  *                argv  - Argument vector
@@ -44,52 +496,89 @@ Status read_and_validate_input_arguments(int argc, char *argv[], File_list **fil
     printf("               Validating Input Files              \n");
     printf("=====================================================\n\n");
 
-    int count = 0;
-
-    for (int i = 1; i < argc; i++)
+    /* 1. Expand directories and file lists into one array of candidates */
+    Candidates list = {NULL, 0, 0, 0, {0}};
+    arena_init(&list.names);
+    Status status = SUCCESS;
+    for (int i = 1; i < argc && status == SUCCESS; i++)
     {
-        /* 1. Validate extension */
-        if (validate_file_extension(argv[i]) == FAILURE)
+        struct stat st;
+        size_t before = list.count, unreadable = list.unreadable;
+        if (argv[i][0] == '@')
+            status = expand_file_list(&list, argv[i] + 1, i);
+        else if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode))
+            status = expand_directory(&list, argv[i], i);
+        else
         {
-            fprintf(stderr, "Error: '%s' has invalid extension. Only .txt allowed.\n", argv[i]);
+            status = add_candidate(&list, argv[i], strlen(argv[i]), i, false);
             continue;
         }
+        if (status == SUCCESS && list.count == before && list.unreadable == unreadable)
+            fprintf(stderr, "Warning : No .txt files found in '%s'.\n", argv[i]);
+    }
 
-        /* 2. Validate file accessibility */
-        FILE *fptr = fopen(argv[i], "r");
-        if (!fptr)
-        {
-            fprintf(stderr, "Error: File '%s' not found or cannot be opened.\n", argv[i]);
-            continue;
-        }
+    /* 2. Size every file, then record names already in the list */
+    size_t listed = 0;
+    File_list *tail = NULL;
+    for (File_list *temp = *file; temp; temp = temp->next, listed++)
+        tail = temp;
 
-        /* 3. Validate non-empty size */
-        if (validate_file_size(fptr) == 0)
-        {
-            fprintf(stderr, "Error: File '%s' is empty.\n", argv[i]);
-            fclose(fptr);
-            continue;
-        }
-        fclose(fptr);
+    size_t capacity = 16;
+    while (capacity < 2 * (list.count + listed))
+        capacity <<= 1;
+    Name_set seen = {calloc(capacity, sizeof(char *)), capacity - 1};
+    if (status == FAILURE || !seen.slots)
+    {
+        fprintf(stderr, "Error: Out of memory while collecting input files.\n");
+        free(seen.slots);
+        free(list.items);
+        arena_free(&list.names);
+        return FAILURE;
+    }
+    check_files(list.items, list.count);
+    for (File_list *temp = *file; temp; temp = temp->next)
+        name_set_add(&seen, temp->file_name);
 
-        /* 4. Check for duplicate file names */
-        if (validate_duplicate_file(argv[i], file) == DUPLICATE)
+    /* 3. Report in argument order and append the valid files */
+    int count = 0;
+    size_t expanded_count = 0;
+    for (size_t i = 0; i < list.count; i++)
+    {
+        Candidate *item = &list.items[i];
+        const char *name = item->name;
+
+        if (validate_file_extension((char *)name) == FAILURE)
+            fprintf(stderr, "Error: '%s' has invalid extension. Only .txt allowed.\n", name);
+        else if (item->size < 0)
+            fprintf(stderr, "Error: File '%s' not found or cannot be opened.\n", name);
+        else if (item->size == 0)
+            fprintf(stderr, "Error: File '%s' is empty.\n", name);
+        else if (name_set_add(&seen, name) == DUPLICATE)
+            fprintf(stderr, "Error: Duplicate file '%s' ignored.\n", name);
+        else if (insert_at_last(tail ? &tail : file, (char *)name) == FAILURE)
+            fprintf(stderr, "Error: Failed to insert '%s' into file list.\n", name);
+        else
         {
-            fprintf(stderr, "Error: Duplicate file '%s' ignored.\n", argv[i]);
-            continue;
+            tail = tail ? tail->next : *file; // New last node, so the next append is O(1)
+            count++;
+            if (!item->expanded)
+                printf("Info : File '%s' added successfully.\n", name);
+            else
+                expanded_count++;
         }
 
-        /* 5. Insert file into linked list */
-        if (insert_at_last(file, argv[i]) == FAILURE)
+        /* One summary line per directory or file list instead of a line per file */
+        if (item->expanded && (i + 1 == list.count || list.items[i + 1].source != item->source))
         {
-            fprintf(stderr, "Error: Failed to insert '%s' into file list.\n", argv[i]);
-            continue;
+            printf("Info : %zu file(s) added from '%s'.\n", expanded_count, argv[item->source]);
+            expanded_count = 0;
         }
-
-        printf("Info : File '%s' added successfully.\n", argv[i]);
-        count++;
     }
 
+    free(seen.slots);
+    free(list.items);
+    arena_free(&list.names); // Names were copied into the list nodes
+
     printf("\n-----------------------------------------------------\n");
     printf("  Total Valid Files : %d\n", count);
     printf("=====================================================\n");
@@ -166,15 +655,17 @@ Status validate_duplicate_file(char *argv, File_list **file)
  * Arguments    : head - Pointer to list head
  *                argv - File name
  *
- * Returns      : SUCCESS on success, FAILURE if memory allocation fails.
+ * Returns      : SUCCESS on success, FAILURE if memory allocation
+ *                fails.
  ***********************************************************************/
 Status insert_at_last(File_list **head, char *argv)
 {
-    File_list *newnode = malloc(sizeof(File_list));
+    size_t len = strlen(argv);
+    File_list *newnode = malloc(sizeof(File_list) + len + 1); // Name stored inline, any length
     if (!newnode)
         return FAILURE;
 
-    strcpy(newnode->file_name, argv);
+    memcpy(newnode->file_name, argv, len + 1);
     newnode->next = NULL;
 
     if (*head == NULL)